@@ -0,0 +1,201 @@
+// byyl-bench: phase throughput on synthetic programs, on Google Benchmark.
+//
+// Each benchmark is named phase/shape/size and reports bytes_per_second
+// over the source and items_per_second over what the phase produces
+// (tokens, AST nodes, IR or bytecode instructions), and each phase/shape
+// family fits a complexity curve so superlinear growth shows as a worse
+// big-O than N. --benchmark_out=FILE --benchmark_out_format=json keeps the
+// results for comparison between builds.
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "ast/ast.h"
+#include "bench/synthetic.h"
+#include "ir/lower.h"
+#include "lex/lexer.h"
+#include "opt/optimize.h"
+#include "parse/parser.h"
+#include "support/diagnostics.h"
+#include "support/interner.h"
+#include "support/source_buffer.h"
+#include "vm/bytecode.h"
+
+namespace {
+
+using namespace byyl;
+
+struct Shape {
+  const char* name;
+  std::string (*generate)(size_t n);
+  int64_t min, max;  // range of n, stepped by factors of 4
+  // The largest n the descent parser takes, which stops at a nesting
+  // limit; 0 if that is max.
+  int64_t descentMax = 0;
+};
+
+const Shape kShapes[] = {
+    {"deep_expression", bench::deepExpression, 64, 262144, 256},
+    {"straight_line", bench::straightLine, 256, 65536},
+    {"huge_switch", bench::hugeSwitch, 64, 16384},
+    {"wide_scope", bench::wideScope, 256, 65536},
+    {"deep_scopes", bench::deepScopes, 64, 262144, 256},
+    {"wide_literals", bench::wideLiterals, 256, 262144},
+};
+
+// Generated once per shape and size and shared by every phase.
+const SourceBuffer& source(const Shape& shape, size_t n) {
+  static std::map<std::pair<const Shape*, size_t>, SourceBuffer> cache;
+  auto it = cache.find({&shape, n});
+  if (it == cache.end())
+    it = cache.emplace(std::make_pair(&shape, n), SourceBuffer::fromString(shape.generate(n)))
+             .first;
+  return it->second;
+}
+
+// Everything the front end produces for one source, so later phases can
+// be timed without it.
+struct Unit {
+  Diagnostics diags{"bench"};
+  Interner interner;
+  Ast ast;
+  NodeId root;
+  Module module;
+
+  explicit Unit(const SourceBuffer& src) {
+    Lexer lexer(src, diags, interner);
+    root = Parser(lexer, diags, ast).parse();
+    if (root && !diags.hasErrors()) module = lowerProgram(ast, root, interner, diags);
+    if (!root || diags.hasErrors()) throw std::logic_error("synthetic program does not compile");
+  }
+};
+
+void finish(benchmark::State& state, const SourceBuffer& src, int64_t items, const char* what) {
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * src.size()));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * items);
+  state.SetComplexityN(state.range(0));
+  state.SetLabel(what);
+}
+
+uint32_t irSize(const Module& module) {
+  uint32_t n = 0;
+  for (const Function& fn : module.functions) n += fn.size();
+  return n;
+}
+
+void lex(benchmark::State& state, const Shape& shape) {
+  const SourceBuffer& src = source(shape, static_cast<size_t>(state.range(0)));
+  int64_t tokens = 0;
+  for (auto _ : state) {
+    Diagnostics diags("bench");
+    Interner interner;
+    Lexer lexer(src, diags, interner);
+    tokens = 1;
+    while (lexer.next().kind != TokenKind::eof) ++tokens;
+  }
+  finish(state, src, tokens, "tokens");
+}
+
+void parse(benchmark::State& state, const Shape& shape) {
+  const SourceBuffer& src = source(shape, static_cast<size_t>(state.range(0)));
+  int64_t nodes = 0;
+  for (auto _ : state) {
+    Diagnostics diags("bench");
+    Interner interner;
+    Lexer lexer(src, diags, interner);
+    Ast ast;
+    benchmark::DoNotOptimize(Parser(lexer, diags, ast).parse());
+    nodes = ast.size();
+  }
+  finish(state, src, nodes, "AST nodes");
+}
+
+void descent(benchmark::State& state, const Shape& shape) {
+  const SourceBuffer& src = source(shape, static_cast<size_t>(state.range(0)));
+  int64_t nodes = 0;
+  for (auto _ : state) {
+    Diagnostics diags("bench");
+    Interner interner;
+    Lexer lexer(src, diags, interner);
+    Ast ast;
+    const NodeId root = Parser(lexer, diags, ast).parseDescent();
+    if (!root) return state.SkipWithError("the descent parser rejected the program");
+    nodes = ast.size();
+  }
+  finish(state, src, nodes, "AST nodes");
+}
+
+void lower(benchmark::State& state, const Shape& shape) {
+  const SourceBuffer& src = source(shape, static_cast<size_t>(state.range(0)));
+  Unit unit(src);
+  for (auto _ : state) {
+    Diagnostics diags("bench");
+    benchmark::DoNotOptimize(lowerProgram(unit.ast, unit.root, unit.interner, diags));
+  }
+  finish(state, src, irSize(unit.module), "IR instructions");
+}
+
+void optimizeIr(benchmark::State& state, const Shape& shape) {
+  const SourceBuffer& src = source(shape, static_cast<size_t>(state.range(0)));
+  Unit unit(src);
+  for (auto _ : state) {
+    state.PauseTiming();
+    Module module = unit.module;
+    state.ResumeTiming();
+    optimize(module);
+    benchmark::DoNotOptimize(module);
+  }
+  finish(state, src, irSize(unit.module), "IR instructions");
+}
+
+void bytecode(benchmark::State& state, const Shape& shape) {
+  const SourceBuffer& src = source(shape, static_cast<size_t>(state.range(0)));
+  // Unoptimized: SCCP folds most of these programs down to a print.
+  Unit unit(src);
+  size_t code = 0;
+  for (auto _ : state) {
+    const vm::Program program =
+        vm::compileBytecode(unit.module, unit.interner, 16, Allocator::LinearScan, false);
+    code = program.code.size();
+  }
+  finish(state, src, static_cast<int64_t>(code), "bytecode instructions");
+}
+
+struct Phase {
+  const char* name;
+  void (*run)(benchmark::State&, const Shape&);
+};
+
+const Phase kPhases[] = {
+    {"lex", lex},
+    {"parse", parse},
+    {"descent", descent},
+    {"lower", lower},
+    {"optimize", optimizeIr},
+    {"bytecode", bytecode},
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  for (const Phase& phase : kPhases) {
+    for (const Shape& shape : kShapes) {
+      const std::string name = std::string(phase.name) + '/' + shape.name;
+      const bool capped = phase.run == descent && shape.descentMax;
+      benchmark::RegisterBenchmark(name.c_str(), phase.run, shape)
+          ->RangeMultiplier(4)
+          ->Range(shape.min, capped ? shape.descentMax : shape.max)
+          ->Unit(benchmark::kMicrosecond)
+          ->Complexity();
+    }
+  }
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 2;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include "bench/synthetic.h"
+
+#include <cstdint>
+
+namespace byyl::bench {
+
+namespace {
+
+constexpr size_t kStraightVars = 16;
+constexpr uint64_t kWideLiteral = uint64_t{1} << 40;  // past any immediate field
+
+std::string var(const char* prefix, size_t i) { return prefix + std::to_string(i); }
+
+}  // namespace
+
+std::string deepExpression(size_t n) {
+  std::string s = "fn main() {\n  var x: int = 1;\n  x = ";
+  s.append(n, '(');
+  s += 'x';
+  static const char* const ops[] = {" + ", " ^ ", " - ", " | "};
+  for (size_t i = 0; i < n; ++i) s += ops[i % 4] + std::to_string(i % 97) + ')';
+  s += ";\n  print(x);\n}\n";
+  return s;
+}
+
+std::string straightLine(size_t n) {
+  std::string s = "fn main() {\n";
+  for (size_t v = 0; v < kStraightVars; ++v)
+    s += "  var " + var("v", v) + ": int = " + std::to_string(v) + ";\n";
+  for (size_t i = 0; i < n; ++i) {
+    s += "  " + var("v", i % kStraightVars) + " = " + var("v", (i * 7 + 3) % kStraightVars) +
+         " + " + var("v", (i * 3 + 1) % kStraightVars) + " * " + std::to_string(i % 89) + ";\n";
+  }
+  s += "  print(v0);\n}\n";
+  return s;
+}
+
+std::string hugeSwitch(size_t n) {
+  std::string s =
+      "fn main() {\n  var y: int = 0;\n  var i: int = 0;\n  while (i < 64) {\n"
+      "    switch (i * 31 % " +
+      std::to_string(n + 1) + ") {\n";
+  for (size_t c = 0; c < n; ++c) {
+    s += "      case " + std::to_string(c) + ":\n        y = y + " + std::to_string(c % 13) +
+         ";\n        break;\n";
+  }
+  s += "      default:\n        y = y - 1;\n    }\n    i = i + 1;\n  }\n  print(y);\n}\n";
+  return s;
+}
+
+std::string wideScope(size_t n) {
+  std::string s = "fn main() {\n";
+  for (size_t i = 0; i < n; ++i)
+    s += "  var " + var("w", i) + ": int = " + std::to_string(i % 101) + ";\n";
+  s += "  var sum: int = 0;\n";
+  for (size_t i = 0; i < n; ++i) s += "  sum = sum + " + var("w", n - 1 - i) + ";\n";
+  s += "  print(sum);\n}\n";
+  return s;
+}
+
+std::string deepScopes(size_t n) {
+  std::string s = "fn main() {\n  var d0: int = 0;\n  var t: int = 0;\n";
+  for (size_t i = 1; i <= n; ++i) {
+    s += "{ var " + var("d", i) + ": int = " + var("d", i - 1) + " + t;\n";
+    s += "  var t: int = " + std::to_string(i % 7) + ";\n";
+  }
+  s += "  print(" + var("d", n) + " + t);\n";
+  s.append(n, '}');
+  s += "\n}\n";
+  return s;
+}
+
+std::string wideLiterals(size_t n) {
+  std::string s = "fn main() {\n  var x: int = 0;\n";
+  for (size_t i = 0; i < n; ++i)
+    s += "  x = x ^ " + std::to_string(kWideLiteral + i * 7919) + ";\n";
+  s += "  print(x);\n}\n";
+  return s;
+}
+
+}  // namespace byyl::bench
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace byyl::bench {
+
+// Programs that grow along one axis, for measuring how each phase scales.
+// Every one is well typed and has a main(), so it goes through the whole
+// pipeline; `n` is the size along the axis.
+
+// One expression nested `n` parentheses deep.
+std::string deepExpression(size_t n);
+// One function of `n` assignments with no control flow.
+std::string straightLine(size_t n);
+// A switch of `n` cases inside a loop.
+std::string hugeSwitch(size_t n);
+// `n` variables declared in one scope, then all read.
+std::string wideScope(size_t n);
+// `n` nested blocks, each declaring a variable and shadowing another.
+std::string deepScopes(size_t n);
+// `n` distinct literals too wide for an immediate, each used once.
+std::string wideLiterals(size_t n);
+
+}  // namespace byyl::bench
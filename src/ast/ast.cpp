@@ -0,0 +1,99 @@
+#include "ast/ast.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace byyl {
+
+const char* nodeKindName(NodeKind kind) {
+  static constexpr const char* kNames[] = {
+#define BYYL_NODE_NAME(name) #name,
+      BYYL_NODE_KINDS(BYYL_NODE_NAME)
+#undef BYYL_NODE_NAME
+  };
+  return kNames[static_cast<int>(kind)];
+}
+
+Ast::Ast() : arena_(sizeof(Node) << kPageBits) { add(NodeKind::List, {}); }
+
+NodeId Ast::add(NodeKind kind, SourcePos pos, const NodeId* kids, size_t numKids) {
+  if ((size_ & kPageMask) == 0)
+    pages_.push_back(static_cast<Node*>(arena_.allocate(sizeof(Node) << kPageBits, alignof(Node))));
+  NodeId id(size_++);
+  Node& node = (*this)[id];
+  node = Node{};
+  node.kind = kind;
+  node.pos = pos;
+  node.firstKid = static_cast<uint32_t>(kids_.size());
+  node.numKids = static_cast<uint32_t>(numKids);
+  kids_.insert(kids_.end(), kids, kids + numKids);
+  return id;
+}
+
+void Ast::assign(const Node* nodes, uint32_t count, const NodeId* kids, size_t numKids) {
+  for (uint32_t first = 0; first < count; first += 1u << kPageBits) {
+    if ((first >> kPageBits) == pages_.size())
+      pages_.push_back(static_cast<Node*>(arena_.allocate(sizeof(Node) << kPageBits, alignof(Node))));
+    std::memcpy(pages_[first >> kPageBits], nodes + first,
+                std::min(count - first, 1u << kPageBits) * sizeof(Node));
+  }
+  size_ = count;
+  kids_.assign(kids, kids + numKids);
+}
+
+int64_t Ast::addText(std::string_view text) {
+  texts_.push_back(arena_.copy(text));
+  return static_cast<int64_t>(texts_.size() - 1);
+}
+
+namespace {
+
+void dumpNode(const Ast& ast, NodeId id, const Interner& interner, const LineTable& lines,
+              std::ostream& os, int depth) {
+  os << std::string(static_cast<size_t>(depth) * 2, ' ');
+  if (!id) {
+    os << "<null>\n";
+    return;
+  }
+  const Node& node = ast[id];
+  os << nodeKindName(node.kind);
+  if (node.op != TokenKind::eof) os << ' ' << tokenSpelling(node.op);
+  if (node.name) os << ' ' << interner.spelling(node.name);
+  switch (node.kind) {
+    case NodeKind::ArrayType:
+    case NodeKind::Case:
+    case NodeKind::IntLiteral:
+    case NodeKind::BoolLiteral:
+      os << ' ' << node.value;
+      break;
+    case NodeKind::StringLiteral:
+      os << ' ' << ast.text(id);
+      break;
+    default:
+      break;
+  }
+  const LineColumn at = lines.locate(node.pos);
+  os << " @" << at.line << ':' << at.column << '\n';
+}
+
+}  // namespace
+
+void dumpAst(const Ast& ast, NodeId root, const Interner& interner, const LineTable& lines,
+             std::ostream& os) {
+  // Preorder on an explicit stack, so a deep tree does not recurse.
+  std::vector<std::pair<NodeId, int>> stack{{root, 0}};
+  while (!stack.empty()) {
+    const auto [id, depth] = stack.back();
+    stack.pop_back();
+    dumpNode(ast, id, interner, lines, os, depth);
+    if (!id) continue;
+    Ast::Kids kids = ast.kids(id);
+    for (size_t i = kids.size(); i-- > 0;) stack.push_back({kids[i], depth + 1});
+  }
+}
+
+}  // namespace byyl
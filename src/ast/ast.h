@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <iosfwd>
+#include <string_view>
+#include <vector>
+
+#include "lex/token.h"
+#include "support/arena.h"
+#include "support/diagnostics.h"
+#include "support/interner.h"
+
+namespace byyl {
+
+// Child layout per kind; "?" marks a child that may be null, "..." a
+// variable-length tail.
+#define BYYL_NODE_KINDS(X)                                                \
+  X(Program)      /* decl...                                      */       \
+  X(FuncDecl)     /* name; List(param...), ret type?, Block        */      \
+  X(Param)        /* name; type                                   */       \
+  X(VarDecl)      /* name; type, init?                            */       \
+  X(TypeDecl)     /* name; type                                   */       \
+  X(IntType)      /*                                              */       \
+  X(BoolType)     /*                                              */       \
+  X(NamedType)    /* name                                         */       \
+  X(ArrayType)    /* value = length; element type                 */       \
+  X(RecordType)   /* Field...                                     */       \
+  X(Field)        /* name; type                                   */       \
+  X(Block)        /* stmt...                                      */       \
+  X(ExprStmt)     /* expr                                         */       \
+  X(EmptyStmt)    /*                                              */       \
+  X(If)           /* cond, then, else?                            */       \
+  X(While)        /* cond, body                                   */       \
+  X(For)          /* init?, cond?, step?, body                    */       \
+  X(Switch)       /* expr, (Case | Default)...                    */       \
+  X(Case)         /* value = label; stmt...                       */       \
+  X(Default)      /* stmt...                                      */       \
+  X(Break)        /*                                              */       \
+  X(Continue)     /*                                              */       \
+  X(Return)       /* value?                                       */       \
+  X(Print)        /* arg...                                       */       \
+  X(Assign)       /* target, value                                */       \
+  X(Binary)       /* op; lhs, rhs                                 */       \
+  X(Unary)        /* op; operand                                  */       \
+  X(Call)         /* callee, arg...                               */       \
+  X(Index)        /* base, index                                  */       \
+  X(Member)       /* name; base                                   */       \
+  X(Name)         /* name                                         */       \
+  X(IntLiteral)   /* value                                        */       \
+  X(BoolLiteral)  /* value = 0 or 1                               */       \
+  X(StringLiteral) /* value = Ast::text() index, including quotes */       \
+  X(List)         /* item...                                      */       \
+  X(Error)        /* a phrase syntax error recovery skipped       */
+
+enum class NodeKind : uint8_t {
+#define BYYL_NODE_ENUM(name) name,
+  BYYL_NODE_KINDS(BYYL_NODE_ENUM)
+#undef BYYL_NODE_ENUM
+};
+
+const char* nodeKindName(NodeKind kind);
+
+// Handle to a node of one Ast. Id 0 is the null node.
+class NodeId {
+ public:
+  constexpr NodeId() = default;
+  constexpr explicit NodeId(uint32_t id) : id_(id) {}
+
+  constexpr uint32_t id() const { return id_; }
+  constexpr explicit operator bool() const { return id_ != 0; }
+  friend constexpr bool operator==(NodeId a, NodeId b) { return a.id_ == b.id_; }
+  friend constexpr bool operator!=(NodeId a, NodeId b) { return a.id_ != b.id_; }
+
+ private:
+  uint32_t id_ = 0;
+};
+
+// 32 bytes, trivially destructible. Children are the run
+// kids[firstKid, firstKid + numKids) of the owning Ast.
+struct Node {
+  NodeKind kind = NodeKind::List;
+  TokenKind op = TokenKind::eof;  // Binary, Unary
+  Symbol name;
+  SourcePos pos;
+  uint32_t firstKid = 0;
+  uint32_t numKids = 0;
+  int64_t value = 0;
+};
+static_assert(sizeof(Node) == 32, "keep Node at half a cache line");
+
+// Syntax tree of one translation unit. Nodes are placed in fixed-size pages
+// bumped out of an Arena, so a NodeId resolves with two loads and the tree
+// is freed in one step with the Ast. Children of a node are one contiguous
+// run of NodeIds; a kids() span is valid until the next add().
+class Ast {
+ public:
+  struct Kids {
+    const NodeId* first;
+    uint32_t count;
+
+    const NodeId* begin() const { return first; }
+    const NodeId* end() const { return first + count; }
+    uint32_t size() const { return count; }
+    NodeId operator[](uint32_t i) const { return first[i]; }
+  };
+
+  Ast();
+  Ast(const Ast&) = delete;
+  Ast& operator=(const Ast&) = delete;
+
+  NodeId add(NodeKind kind, SourcePos pos, const NodeId* kids, size_t numKids);
+  NodeId add(NodeKind kind, SourcePos pos, std::initializer_list<NodeId> kids = {}) {
+    return add(kind, pos, kids.begin(), kids.size());
+  }
+  // Copies a StringLiteral's text into the tree and returns the index for
+  // Node::value, so the tree does not depend on the source buffer.
+  int64_t addText(std::string_view text);
+  // Replaces a new tree's nodes with `count` copied in bulk, the null node
+  // first, whose kid runs index `kids`; for loading a unit file.
+  void assign(const Node* nodes, uint32_t count, const NodeId* kids, size_t numKids);
+
+  Node& operator[](NodeId n) { return pages_[n.id() >> kPageBits][n.id() & kPageMask]; }
+  const Node& operator[](NodeId n) const { return pages_[n.id() >> kPageBits][n.id() & kPageMask]; }
+  Kids kids(NodeId n) const {
+    const Node& node = (*this)[n];
+    return {kids_.data() + node.firstKid, node.numKids};
+  }
+  NodeId kid(NodeId n, uint32_t i) const { return kids_[(*this)[n].firstKid + i]; }
+  std::string_view text(NodeId n) const { return texts_[static_cast<size_t>((*this)[n].value)]; }
+  // Every kid run and every StringLiteral text, for writing the tree out.
+  const std::vector<NodeId>& allKids() const { return kids_; }
+  const std::vector<std::string_view>& texts() const { return texts_; }
+
+  // Nodes including the null node.
+  uint32_t size() const { return size_; }
+  size_t bytesUsed() const { return arena_.bytesUsed() + kids_.capacity() * sizeof(NodeId); }
+
+ private:
+  static constexpr uint32_t kPageBits = 10;
+  static constexpr uint32_t kPageMask = (1u << kPageBits) - 1;
+
+  Arena arena_;
+  std::vector<Node*> pages_;
+  uint32_t size_ = 0;
+  std::vector<NodeId> kids_;
+  std::vector<std::string_view> texts_;
+};
+
+// Indented one-node-per-line dump, for --dump-ast; `lines` places the
+// nodes.
+void dumpAst(const Ast& ast, NodeId root, const Interner& interner, const LineTable& lines,
+             std::ostream& os);
+
+}  // namespace byyl
@@ -0,0 +1,512 @@
+#include "codegen/burg.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <map>
+
+namespace byyl::burs {
+
+namespace {
+
+struct BToken {
+  enum Kind { Word, Number, Colon, Bar, Semi, LParen, RParen, Comma, Equals, Arrow, Directive, End }
+      kind;
+  std::string text;
+  int line;
+};
+
+std::vector<BToken> tokenizeTreeGrammar(std::string_view text) {
+  std::vector<BToken> out;
+  int line = 1;
+  size_t i = 0;
+  auto isWordChar = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+  while (i < text.size()) {
+    const char c = text[i];
+    BToken::Kind punct = BToken::End;
+    switch (c) {
+      case ':': punct = BToken::Colon; break;
+      case '|': punct = BToken::Bar; break;
+      case ';': punct = BToken::Semi; break;
+      case '(': punct = BToken::LParen; break;
+      case ')': punct = BToken::RParen; break;
+      case ',': punct = BToken::Comma; break;
+      default: break;
+    }
+    if (c == '\n') {
+      ++line;
+      ++i;
+    } else if (std::isspace(static_cast<unsigned char>(c))) {
+      ++i;
+    } else if (c == '#') {
+      while (i < text.size() && text[i] != '\n') ++i;
+    } else if (punct != BToken::End) {
+      out.push_back({punct, std::string(1, c), line});
+      ++i;
+    } else if (c == '=') {
+      const bool arrow = i + 1 < text.size() && text[i + 1] == '>';
+      out.push_back({arrow ? BToken::Arrow : BToken::Equals, arrow ? "=>" : "=", line});
+      i += arrow ? 2 : 1;
+    } else if (std::isdigit(static_cast<unsigned char>(c))) {
+      size_t j = i + 1;
+      while (j < text.size() && std::isdigit(static_cast<unsigned char>(text[j]))) ++j;
+      out.push_back({BToken::Number, std::string(text.substr(i, j - i)), line});
+      i = j;
+    } else if (c == '%' || isWordChar(c)) {
+      size_t j = i + 1;
+      while (j < text.size() && isWordChar(text[j])) ++j;
+      out.push_back({c == '%' ? BToken::Directive : BToken::Word,
+                     std::string(text.substr(i, j - i)), line});
+      i = j;
+    } else {
+      throw BurgError("line " + std::to_string(line) + ": unexpected character '" +
+                      std::string(1, c) + "'");
+    }
+  }
+  out.push_back({BToken::End, "", line});
+  return out;
+}
+
+class TreeGrammarParser {
+ public:
+  explicit TreeGrammarParser(std::string_view text) : toks_(tokenizeTreeGrammar(text)) {
+    g_.rules.emplace_back();
+    g_.actions.push_back("Pass");
+  }
+
+  TreeGrammar parse() {
+    while (peek().kind != BToken::End) {
+      if (peek().kind == BToken::Directive) parseDirective();
+      else parseRule();
+    }
+    if (start_.empty()) fail(peek(), "missing %start");
+    auto it = ntIndex_.find(start_);
+    if (it == ntIndex_.end()) fail(peek(), "%start names unknown nonterminal " + start_);
+    // The start symbol is nonterminal 0.
+    std::vector<int> renumber(g_.nonterminals.size());
+    for (size_t nt = 0; nt < renumber.size(); ++nt)
+      renumber[nt] = static_cast<int>(nt) == it->second ? 0
+                     : static_cast<int>(nt) < it->second ? static_cast<int>(nt) + 1
+                                                         : static_cast<int>(nt);
+    std::rotate(g_.nonterminals.begin(), g_.nonterminals.begin() + it->second,
+                g_.nonterminals.begin() + it->second + 1);
+    std::vector<bool> defined(g_.nonterminals.size());
+    for (size_t r = 1; r < g_.rules.size(); ++r) {
+      TreeRule& rule = g_.rules[r];
+      rule.lhs = renumber[rule.lhs];
+      renumberPattern(rule.pattern, renumber);
+      defined[rule.lhs] = true;
+    }
+    for (size_t nt = 0; nt < defined.size(); ++nt)
+      if (!defined[nt]) throw BurgError("nonterminal " + g_.nonterminals[nt] + " has no rules");
+    for (int& a : g_.arity) a = std::max(a, 0);  // declared but never used: a leaf
+    return std::move(g_);
+  }
+
+ private:
+  [[noreturn]] void fail(const BToken& at, const std::string& msg) {
+    throw BurgError("line " + std::to_string(at.line) + ": " + msg);
+  }
+
+  const BToken& peek() const { return toks_[pos_]; }
+  const BToken& take() { return toks_[pos_++]; }
+  const BToken& expect(BToken::Kind kind, const char* what) {
+    if (peek().kind != kind) fail(peek(), std::string("expected ") + what);
+    return take();
+  }
+
+  void parseDirective() {
+    const BToken& dir = take();
+    if (dir.text == "%term") {
+      while (peek().kind == BToken::Word && peek().line == dir.line) {
+        const BToken& name = take();
+        if (opIndex_.count(name.text)) fail(name, "operator " + name.text + " declared twice");
+        opIndex_[name.text] = static_cast<int>(g_.operators.size());
+        g_.operators.push_back(name.text);
+        g_.arity.push_back(-1);
+      }
+    } else if (dir.text == "%start") {
+      start_ = expect(BToken::Word, "start symbol").text;
+    } else {
+      fail(dir, "unknown directive " + dir.text);
+    }
+  }
+
+  void parseRule() {
+    const BToken& lhsTok = expect(BToken::Word, "rule name");
+    if (opIndex_.count(lhsTok.text)) fail(lhsTok, lhsTok.text + " is an operator");
+    const int lhs = nonterminal(lhsTok.text);
+    expect(BToken::Colon, "':'");
+    while (true) {
+      TreeRule rule;
+      rule.lhs = lhs;
+      rule.line = peek().line;
+      rule.pattern = parsePattern();
+      if (peek().kind == BToken::Equals) {
+        take();
+        rule.cost = std::stoi(expect(BToken::Number, "cost").text);
+      }
+      if (peek().kind == BToken::Arrow) {
+        take();
+        rule.action = actionIndex(expect(BToken::Word, "action name").text);
+      }
+      g_.rules.push_back(std::move(rule));
+      const int r = static_cast<int>(g_.rules.size()) - 1;
+      if (g_.rules[r].action == 0 && g_.kids(r).size() != 1)
+        throw BurgError("line " + std::to_string(g_.rules[r].line) +
+                        ": a rule without an action must have exactly one nonterminal");
+      if (peek().kind == BToken::Bar) {
+        take();
+        continue;
+      }
+      expect(BToken::Semi, "'|' or ';'");
+      return;
+    }
+  }
+
+  Pattern parsePattern() {
+    const BToken& name = expect(BToken::Word, "operator or nonterminal");
+    Pattern p;
+    auto op = opIndex_.find(name.text);
+    if (op == opIndex_.end()) {
+      if (peek().kind == BToken::LParen) fail(name, "undeclared operator " + name.text);
+      p.nonterminal = true;
+      p.symbol = nonterminal(name.text);
+      return p;
+    }
+    p.symbol = op->second;
+    if (peek().kind == BToken::LParen) {
+      take();
+      p.kids.push_back(parsePattern());
+      while (peek().kind == BToken::Comma) {
+        take();
+        p.kids.push_back(parsePattern());
+      }
+      expect(BToken::RParen, "')'");
+    }
+    int& arity = g_.arity[p.symbol];
+    if (arity < 0) {
+      if (p.kids.size() > static_cast<size_t>(kMaxArity))
+        fail(name, name.text + " has more than " + std::to_string(kMaxArity) + " children");
+      arity = static_cast<int>(p.kids.size());
+    } else if (arity != static_cast<int>(p.kids.size())) {
+      fail(name, name.text + " takes " + std::to_string(arity) + " children");
+    }
+    return p;
+  }
+
+  int nonterminal(const std::string& name) {
+    auto it = ntIndex_.find(name);
+    if (it != ntIndex_.end()) return it->second;
+    ntIndex_[name] = static_cast<int>(g_.nonterminals.size());
+    g_.nonterminals.push_back(name);
+    return ntIndex_[name];
+  }
+
+  int actionIndex(const std::string& name) {
+    for (size_t i = 0; i < g_.actions.size(); ++i)
+      if (g_.actions[i] == name) return static_cast<int>(i);
+    g_.actions.push_back(name);
+    return static_cast<int>(g_.actions.size()) - 1;
+  }
+
+  static void renumberPattern(Pattern& p, const std::vector<int>& renumber) {
+    if (p.nonterminal) p.symbol = renumber[p.symbol];
+    for (Pattern& k : p.kids) renumberPattern(k, renumber);
+  }
+
+  std::vector<BToken> toks_;
+  size_t pos_ = 0;
+  TreeGrammar g_;
+  std::map<std::string, int> opIndex_;
+  std::map<std::string, int> ntIndex_;
+  std::string start_;
+};
+
+void collectKids(const Pattern& p, std::vector<int>& path, std::vector<RuleKid>& out) {
+  if (p.nonterminal) {
+    out.push_back({p.symbol, path});
+    return;
+  }
+  for (size_t k = 0; k < p.kids.size(); ++k) {
+    path.push_back(static_cast<int>(k));
+    collectKids(p.kids[k], path, out);
+    path.pop_back();
+  }
+}
+
+void describePattern(const TreeGrammar& g, const Pattern& p, std::string& out) {
+  if (p.nonterminal) {
+    out += g.nonterminals[p.symbol];
+    return;
+  }
+  out += g.operators[p.symbol];
+  if (p.kids.empty()) return;
+  out += '(';
+  for (size_t k = 0; k < p.kids.size(); ++k) {
+    if (k) out += ", ";
+    describePattern(g, p.kids[k], out);
+  }
+  out += ')';
+}
+
+constexpr int kInfinite = INT_MAX / 4;
+constexpr int kMaxStates = 4096;
+
+// A rule in normal form: an operator over nonterminals, or a chain rule
+// `lhs : nt` (op < 0). Nested operators in a pattern become helper
+// nonterminals with one rule each, shared between equal subpatterns.
+struct NormalRule {
+  int lhs = 0;
+  int op = -1;
+  std::vector<int> kids;
+  int cost = 0;
+  int rule = 0;  // the grammar rule this is the root of; 0 for helpers
+};
+
+class BursBuilder {
+ public:
+  explicit BursBuilder(const TreeGrammar& g)
+      : g_(g), numOps_(static_cast<int>(g.operators.size())) {
+    numNts_ = static_cast<int>(g.nonterminals.size());
+    for (size_t r = 1; r < g.rules.size(); ++r) {
+      const TreeRule& rule = g.rules[r];
+      NormalRule n;
+      n.lhs = rule.lhs;
+      n.cost = rule.cost;
+      n.rule = static_cast<int>(r);
+      if (rule.pattern.nonterminal) {
+        n.kids.push_back(rule.pattern.symbol);
+      } else {
+        n.op = rule.pattern.symbol;
+        for (const Pattern& k : rule.pattern.kids) n.kids.push_back(normalize(k));
+      }
+      normal_.push_back(std::move(n));
+    }
+    a_.helperNonterminals = numNts_ - static_cast<int>(g.nonterminals.size());
+
+    // The nonterminals each operator's rules expect at each position.
+    relevant_.assign(numOps_ * kMaxArity, {});
+    for (const NormalRule& n : normal_)
+      for (size_t p = 0; p < n.kids.size() && n.op >= 0; ++p) {
+        std::vector<int>& r = relevant_[n.op * kMaxArity + p];
+        if (std::find(r.begin(), r.end(), n.kids[p]) == r.end()) r.push_back(n.kids[p]);
+      }
+    reps_.assign(numOps_ * kMaxArity, {});
+    repIndex_.assign(numOps_ * kMaxArity, {});
+    projection_.assign(numOps_ * kMaxArity, {});
+  }
+
+  BursAutomaton build() {
+    intern(State{std::vector<int>(numNts_, kInfinite), std::vector<int>(numNts_, 0)});
+    a_.leafState.assign(numOps_, 0);
+    for (int op = 0; op < numOps_; ++op) {
+      if (g_.arity[op] != 0) continue;
+      State s{std::vector<int>(numNts_, kInfinite), std::vector<int>(numNts_, 0)};
+      for (size_t n = 0; n < normal_.size(); ++n)
+        if (normal_[n].op == op) relax(s, static_cast<int>(n), normal_[n].cost);
+      a_.leafState[op] = intern(std::move(s));
+    }
+    for (size_t s = 0; s < states_.size(); ++s) {
+      for (int op = 0; op < numOps_; ++op)
+        for (int p = 0; p < g_.arity[op]; ++p) project(op, p, static_cast<int>(s));
+    }
+    emitTables();
+    return std::move(a_);
+  }
+
+ private:
+  struct State {
+    std::vector<int> cost;  // per nonterminal, relative to the cheapest
+    std::vector<int> rule;  // per nonterminal, index into normal_
+  };
+
+  int normalize(const Pattern& p) {
+    if (p.nonterminal) return p.symbol;
+    std::string key;
+    describePattern(g_, p, key);
+    auto it = helpers_.find(key);
+    if (it != helpers_.end()) return it->second;
+    NormalRule n;
+    n.op = p.symbol;
+    for (const Pattern& k : p.kids) n.kids.push_back(normalize(k));
+    n.lhs = numNts_++;
+    helpers_[key] = n.lhs;
+    normal_.push_back(std::move(n));
+    return helpers_[key];
+  }
+
+  void relax(State& s, int n, int cost) {
+    const int lhs = normal_[n].lhs;
+    if (cost < s.cost[lhs]) {
+      s.cost[lhs] = cost;
+      s.rule[lhs] = n;
+    }
+  }
+
+  // Applies chain rules until no cost improves, then makes the cheapest
+  // nonterminal cost zero and returns the state's number.
+  int intern(State s) {
+    for (bool changed = true; changed;) {
+      changed = false;
+      for (size_t n = 0; n < normal_.size(); ++n) {
+        const NormalRule& c = normal_[n];
+        if (c.op >= 0 || s.cost[c.kids[0]] >= kInfinite) continue;
+        const int cost = s.cost[c.kids[0]] + c.cost;
+        if (cost < s.cost[c.lhs]) {
+          relax(s, static_cast<int>(n), cost);
+          changed = true;
+        }
+      }
+    }
+    const int least = *std::min_element(s.cost.begin(), s.cost.end());
+    if (least < kInfinite)
+      for (int& c : s.cost)
+        if (c < kInfinite) c -= least;
+    std::vector<int> key = s.cost;
+    key.insert(key.end(), s.rule.begin(), s.rule.end());
+    auto it = stateIndex_.find(key);
+    if (it != stateIndex_.end()) return it->second;
+    if (states_.size() == static_cast<size_t>(kMaxStates))
+      throw BurgError("more than " + std::to_string(kMaxStates) +
+                      " states: rule costs around a cycle of chain rules do not converge");
+    const int index = static_cast<int>(states_.size());
+    stateIndex_.emplace(std::move(key), index);
+    states_.push_back(std::move(s));
+    return index;
+  }
+
+  // Projects state `s` onto the nonterminals operator `op` uses at child
+  // `p`. A representative seen for the first time gets a transition for
+  // every combination with the representatives already known at the other
+  // positions; later ones at those positions pick up this one.
+  void project(int op, int p, int s) {
+    const int slot = op * kMaxArity + p;
+    const std::vector<int>& nts = relevant_[slot];
+    std::vector<int> costs;
+    int least = kInfinite;
+    for (int nt : nts) {
+      costs.push_back(states_[s].cost[nt]);
+      least = std::min(least, costs.back());
+    }
+    for (int& c : costs)
+      if (c < kInfinite) c -= least;
+    auto [it, added] = repIndex_[slot].emplace(costs, static_cast<int>(reps_[slot].size()));
+    projection_[slot].push_back(it->second);
+    if (!added) return;
+    reps_[slot].push_back(std::move(costs));
+
+    const int arity = g_.arity[op];
+    std::vector<int> tuple(arity, 0);
+    tuple[p] = it->second;
+    for (int q = 0; q < arity; ++q)
+      if (q != p && reps_[op * kMaxArity + q].empty()) return;
+    while (true) {
+      transition(op, tuple);
+      int q = 0;
+      for (; q < arity; ++q) {
+        if (q == p) continue;
+        if (++tuple[q] < static_cast<int>(reps_[op * kMaxArity + q].size())) break;
+        tuple[q] = 0;
+      }
+      if (q == arity) return;
+    }
+  }
+
+  void transition(int op, const std::vector<int>& tuple) {
+    State s{std::vector<int>(numNts_, kInfinite), std::vector<int>(numNts_, 0)};
+    for (size_t n = 0; n < normal_.size(); ++n) {
+      const NormalRule& r = normal_[n];
+      if (r.op != op) continue;
+      int cost = r.cost;
+      for (size_t p = 0; p < r.kids.size() && cost < kInfinite; ++p) {
+        const int slot = op * kMaxArity + static_cast<int>(p);
+        const std::vector<int>& nts = relevant_[slot];
+        const size_t at = std::find(nts.begin(), nts.end(), r.kids[p]) - nts.begin();
+        const int kid = reps_[slot][tuple[p]][at];
+        cost = kid >= kInfinite ? kInfinite : cost + kid;
+      }
+      if (cost < kInfinite) relax(s, static_cast<int>(n), cost);
+    }
+    transitions_[{op, tuple}] = intern(std::move(s));
+  }
+
+  void emitTables() {
+    const int numStates = static_cast<int>(states_.size());
+    const int users = static_cast<int>(g_.nonterminals.size());
+    a_.numStates = numStates;
+    for (const State& s : states_)
+      for (int nt = 0; nt < users; ++nt)
+        a_.stateRule.push_back(s.cost[nt] < kInfinite ? normal_[s.rule[nt]].rule : 0);
+    a_.projectionBase.assign(numOps_ * kMaxArity, 0);
+    a_.stride.assign(numOps_ * kMaxArity, 0);
+    a_.transitionBase.assign(numOps_, 0);
+    for (int op = 0; op < numOps_; ++op) {
+      const int arity = g_.arity[op];
+      if (arity == 0) continue;
+      int size = 1;
+      for (int p = arity - 1; p >= 0; --p) {
+        const int slot = op * kMaxArity + p;
+        a_.projectionBase[slot] = static_cast<int>(a_.projection.size());
+        a_.projection.insert(a_.projection.end(), projection_[slot].begin(),
+                             projection_[slot].end());
+        a_.stride[slot] = size;
+        size *= static_cast<int>(reps_[slot].size());
+      }
+      a_.transitionBase[op] = static_cast<int>(a_.transition.size());
+      a_.transition.resize(a_.transition.size() + size, 0);
+    }
+    for (const auto& [key, state] : transitions_) {
+      int index = a_.transitionBase[key.first];
+      for (size_t p = 0; p < key.second.size(); ++p)
+        index += key.second[p] * a_.stride[key.first * kMaxArity + static_cast<int>(p)];
+      a_.transition[index] = state;
+    }
+  }
+
+  const TreeGrammar& g_;
+  const int numOps_;
+  int numNts_ = 0;  // grammar and helper nonterminals
+  std::vector<NormalRule> normal_;
+  std::map<std::string, int> helpers_;
+  std::vector<std::vector<int>> relevant_;  // per op * kMaxArity + position
+  std::vector<State> states_;
+  std::map<std::vector<int>, int> stateIndex_;
+  // Per op * kMaxArity + position: the distinct projected cost vectors, and
+  // each state's.
+  std::vector<std::vector<std::vector<int>>> reps_;
+  std::vector<std::map<std::vector<int>, int>> repIndex_;
+  std::vector<std::vector<int>> projection_;
+  std::map<std::pair<int, std::vector<int>>, int> transitions_;
+  BursAutomaton a_;
+};
+
+}  // namespace
+
+std::vector<RuleKid> TreeGrammar::kids(int r) const {
+  std::vector<RuleKid> out;
+  std::vector<int> path;
+  collectKids(rules[r].pattern, path, out);
+  return out;
+}
+
+std::string TreeGrammar::describe(int r) const {
+  std::string out = nonterminals[rules[r].lhs] + " : ";
+  describePattern(*this, rules[r].pattern, out);
+  return out;
+}
+
+TreeGrammar parseTreeGrammar(std::string_view text) {
+  TreeGrammar g = TreeGrammarParser(text).parse();
+  for (size_t r = 1; r < g.rules.size(); ++r)
+    for (const RuleKid& k : g.kids(static_cast<int>(r)))
+      if (k.path.size() > static_cast<size_t>(kMaxDepth))
+        throw BurgError("line " + std::to_string(g.rules[r].line) + ": " +
+                        g.nonterminals[k.nonterminal] + " lies more than " +
+                        std::to_string(kMaxDepth) + " levels deep");
+  return g;
+}
+
+BursAutomaton buildBurs(const TreeGrammar& g) { return BursBuilder(g).build(); }
+
+}  // namespace byyl::burs
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace byyl::burs {
+
+// Raised for malformed tree grammars and for automata that do not converge.
+class BurgError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+// Operators have at most this many children, and a rule's nonterminal
+// leaves lie at most this deep below its root.
+constexpr int kMaxArity = 3;
+constexpr int kMaxDepth = 3;
+
+// One node of a rule's pattern: an operator applied to subpatterns, or a
+// nonterminal leaf.
+struct Pattern {
+  bool nonterminal = false;
+  int symbol = 0;  // operator or nonterminal index
+  std::vector<Pattern> kids;
+};
+
+struct TreeRule {
+  int lhs = 0;
+  Pattern pattern;
+  int cost = 0;
+  int action = 0;  // index into TreeGrammar::actions; 0 passes its one kid through
+  int line = 0;
+};
+
+// A nonterminal leaf of a rule: which nonterminal, reached from the rule's
+// root by choosing child path[0], then path[1], ...
+struct RuleKid {
+  int nonterminal = 0;
+  std::vector<int> path;
+};
+
+// Tree grammar for bottom-up rewriting (Dragon Book 8.9): operators with
+// fixed arities, nonterminals, and rules `nt : pattern = cost => Action`.
+// Rule 0 is a placeholder so that 0 can mean "no rule" in the tables.
+struct TreeGrammar {
+  std::vector<std::string> operators;
+  std::vector<int> arity;                 // per operator
+  std::vector<std::string> nonterminals;  // start first
+  std::vector<TreeRule> rules;
+  std::vector<std::string> actions;       // action labels; actions[0] is "Pass"
+
+  // Nonterminal leaves of rule `r` in left-to-right order.
+  std::vector<RuleKid> kids(int r) const;
+  // "nt : Op(a, b)".
+  std::string describe(int r) const;
+};
+
+// Grammar file syntax:
+//   # comment
+//   %term NAME...             operators, in the order the emitted enum lists them
+//   %start NAME               the nonterminal every tree must derive
+//   nt : pattern [= cost] [=> Action] | ... ;
+// A pattern is an operator, a nonterminal, or Op(pattern, ...). An
+// operator's arity is fixed by its first use.
+TreeGrammar parseTreeGrammar(std::string_view text);
+
+// Bottom-up rewrite automaton (Proebsting, "Simple and efficient BURS table
+// generation", PLDI 1992). A state records, for every nonterminal, the
+// cheapest rule deriving it at a node and that rule's cost relative to the
+// node's cheapest nonterminal; relative costs keep the set of states finite.
+// A leaf's state depends only on its operator. An interior node's state is
+// a table lookup indexed by its children's states, each first projected
+// onto the nonterminals its operator's rules use at that position, so that
+// children differing only in irrelevant costs share a table row.
+struct BursAutomaton {
+  int numStates = 0;  // state 0 derives nothing
+  // Per state and user nonterminal, the rule deriving it there or 0.
+  std::vector<int> stateRule;  // [state * nonterminals.size() + nt]
+  std::vector<int> leafState;  // per operator, or 0 for interior operators
+  // Interior operator `op` at child position p maps a child's state through
+  // projection[projectionBase[op * kMaxArity + p] + state], then looks up
+  // transition[transitionBase[op] + sum of projected * stride].
+  std::vector<int> projectionBase;
+  std::vector<int> projection;
+  std::vector<int> stride;  // [op * kMaxArity + p]
+  std::vector<int> transitionBase;
+  std::vector<int> transition;
+  int helperNonterminals = 0;  // introduced for nested patterns
+};
+
+// Throws BurgError if relative costs grow without bound, as they can around
+// a cycle of chain rules.
+BursAutomaton buildBurs(const TreeGrammar& g);
+
+// Emits the operator, nonterminal and action enums, the rules' kid paths
+// and the automaton as constexpr definitions for the instruction selector
+// to #include.
+std::string emitBursTables(const TreeGrammar& g, const BursAutomaton& a);
+
+}  // namespace byyl::burs
@@ -0,0 +1,94 @@
+#include <sstream>
+
+#include "codegen/burg.h"
+
+namespace byyl::burs {
+
+namespace {
+
+template <typename T>
+void emitArray(std::ostringstream& os, const char* type, const char* name, const std::vector<T>& values) {
+  os << "inline constexpr " << type << ' ' << name << '[' << (values.empty() ? 1 : values.size())
+     << "] = {";
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i % 16 == 0) os << "\n   ";
+    os << ' ' << values[i] << ',';
+  }
+  if (values.empty()) os << " 0";
+  os << "\n};\n";
+}
+
+std::string cString(const std::string& s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+
+}  // namespace
+
+std::string emitBursTables(const TreeGrammar& g, const BursAutomaton& a) {
+  std::ostringstream os;
+  os << "// Generated by byyl-burg. Do not edit.\n";
+  os << "// BURS: " << a.numStates << " states, " << g.operators.size() << " operators, "
+     << g.nonterminals.size() << " nonterminals (+" << a.helperNonterminals << " helper), "
+     << g.rules.size() - 1 << " rules; " << a.transition.size() << " transitions.\n";
+
+  os << "enum class BursOp : uint8_t {\n";
+  for (const std::string& op : g.operators) os << "  " << op << ",\n";
+  os << "};\n";
+  os << "enum class BursNt : uint8_t {\n";
+  for (const std::string& nt : g.nonterminals) os << "  " << nt << ",\n";
+  os << "};\n";
+  os << "enum class BursAction : uint8_t {\n";
+  for (const std::string& action : g.actions) os << "  " << action << ",\n";
+  os << "};\n";
+
+  os << "inline constexpr int kBursNumOperators = " << g.operators.size() << ";\n";
+  os << "inline constexpr int kBursNumNonterminals = " << g.nonterminals.size() << ";\n";
+  os << "inline constexpr int kBursNumRules = " << g.rules.size() << ";\n";
+  os << "inline constexpr int kBursNumStates = " << a.numStates << ";\n";
+  os << "inline constexpr int kBursMaxArity = " << kMaxArity << ";\n";
+  emitArray(os, "uint8_t", "kBursArity", g.arity);
+
+  // A kid's path packs its depth into bits 0-1 and each step into the next
+  // two bits.
+  std::vector<int> lhs, kidBegin, kidNt, kidPath;
+  for (size_t r = 0; r < g.rules.size(); ++r) {
+    lhs.push_back(g.rules[r].lhs);
+    kidBegin.push_back(static_cast<int>(kidNt.size()));
+    if (r == 0) continue;
+    for (const RuleKid& k : g.kids(static_cast<int>(r))) {
+      int path = static_cast<int>(k.path.size());
+      for (size_t s = 0; s < k.path.size(); ++s) path |= k.path[s] << (2 + 2 * s);
+      kidNt.push_back(k.nonterminal);
+      kidPath.push_back(path);
+    }
+  }
+  kidBegin.push_back(static_cast<int>(kidNt.size()));
+  emitArray(os, "uint8_t", "kBursRuleLhs", lhs);
+  os << "inline constexpr BursAction kBursRuleAction[" << g.rules.size() << "] = {\n";
+  for (const TreeRule& r : g.rules) os << "    BursAction::" << g.actions[r.action] << ",\n";
+  os << "};\n";
+  emitArray(os, "uint16_t", "kBursRuleKids", kidBegin);
+  emitArray(os, "uint8_t", "kBursKidNt", kidNt);
+  emitArray(os, "uint8_t", "kBursKidPath", kidPath);
+  os << "inline constexpr const char* kBursRuleText[" << g.rules.size() << "] = {\n";
+  os << "    \"\",\n";
+  for (size_t r = 1; r < g.rules.size(); ++r)
+    os << "    " << cString(g.describe(static_cast<int>(r))) << ",\n";
+  os << "};\n";
+
+  emitArray(os, "uint16_t", "kBursStateRule", a.stateRule);
+  emitArray(os, "uint16_t", "kBursLeafState", a.leafState);
+  emitArray(os, "uint32_t", "kBursProjectionBase", a.projectionBase);
+  emitArray(os, "uint16_t", "kBursProjection", a.projection);
+  emitArray(os, "uint32_t", "kBursStride", a.stride);
+  emitArray(os, "uint32_t", "kBursTransitionBase", a.transitionBase);
+  emitArray(os, "uint16_t", "kBursTransition", a.transition);
+  return os.str();
+}
+
+}  // namespace byyl::burs
@@ -0,0 +1,354 @@
+#include "codegen/regalloc.h"
+
+#include <algorithm>
+#include <ostream>
+#include <unordered_set>
+
+#include "opt/analyses.h"
+#include "opt/cfg.h"
+#include "opt/ssa.h"
+
+namespace byyl {
+
+namespace {
+
+constexpr uint32_t kNone = UINT32_MAX;
+
+bool isVar(Operand o) { return o.is(Operand::Kind::Var); }
+
+// What both allocators need: which variables compete for registers, copy
+// hints, and liveness.
+class Problem {
+ public:
+  Problem(const Function& fn) : fn_(fn), copy_(fn), cfg_(copy_), live_(liveVariables(cfg_)) {
+    const auto n = static_cast<uint32_t>(fn.vars.size());
+    candidate.assign(n, 0);
+    hint.assign(n, kNone);
+    for (uint32_t v = 0; v < n; ++v) candidate[v] = fn.vars[v].size == 1;
+    for (uint32_t i = 0; i < fn.size(); ++i) {
+      if (fn.op[i] == Op::Load && isVar(fn.arg1[i])) candidate[fn.arg1[i].index()] = 0;
+      if (fn.op[i] == Op::Store && isVar(fn.result[i])) candidate[fn.result[i].index()] = 0;
+    }
+    for (uint32_t i = 0; i < fn.size(); ++i)
+      if (fn.op[i] == Op::Copy && isVar(fn.result[i]) && isVar(fn.arg1[i]))
+        hint[fn.result[i].index()] = fn.arg1[i].index();
+  }
+
+  const Function& fn() const { return fn_; }
+  const Cfg& cfg() const { return cfg_; }
+  const DataflowResult& live() const { return live_; }
+  uint32_t size() const { return static_cast<uint32_t>(candidate.size()); }
+
+  std::vector<uint8_t> candidate;
+  std::vector<uint32_t> hint;  // copy source of each copy destination
+
+ private:
+  const Function& fn_;
+  Function copy_;  // the flow graph rewrites its function
+  Cfg cfg_;
+  DataflowResult live_;
+};
+
+struct Interval {
+  uint32_t var, start, end;
+};
+
+// Instruction i reads at 2i and writes at 2i + 1, so a destination can take
+// the register of a source whose last use is the same instruction.
+// Registers and stack slots start out zero, so a variable live on entry,
+// such as a parameter or a local some path reads before setting, holds its
+// place from position 0.
+std::vector<Interval> buildIntervals(const Problem& p) {
+  const Function& fn = p.fn();
+  std::vector<uint32_t> start(p.size(), kNone), end(p.size(), 0);
+  auto extend = [&](uint32_t v, uint32_t pos) {
+    if (!p.candidate[v]) return;
+    start[v] = std::min(start[v], pos);
+    end[v] = std::max(end[v], pos);
+  };
+  for (uint32_t v = 0; v < fn.numParams; ++v) extend(v, 0);
+  p.live().in[0].forEach([&](size_t v) { extend(static_cast<uint32_t>(v), 0); });
+  for (uint32_t i = 0; i < fn.size(); ++i) {
+    for (Operand o : {fn.op[i] == Op::Store ? fn.result[i] : Operand(), fn.arg1[i], fn.arg2[i]})
+      if (isVar(o)) extend(o.index(), 2 * i);
+    if (definesResult(fn.op[i]) && isVar(fn.result[i])) extend(fn.result[i].index(), 2 * i + 1);
+  }
+  // Each block is one run of the instruction order, so a variable live
+  // into or out of it covers the start or end of that run.
+  for (uint32_t b = 0; b < p.cfg().size(); ++b) {
+    const std::vector<uint32_t>& code = p.cfg().blocks[b].code;
+    if (code.empty()) continue;
+    p.live().in[b].forEach([&](size_t v) { extend(static_cast<uint32_t>(v), 2 * code.front()); });
+    p.live().out[b].forEach([&](size_t v) { extend(static_cast<uint32_t>(v), 2 * code.back() + 1); });
+  }
+  std::vector<Interval> intervals;
+  for (uint32_t v = 0; v < p.size(); ++v)
+    if (start[v] != kNone) intervals.push_back({v, start[v], end[v]});
+  std::sort(intervals.begin(), intervals.end(), [](const Interval& a, const Interval& b) {
+    return a.start != b.start ? a.start < b.start : a.var < b.var;
+  });
+  return intervals;
+}
+
+// Stack slots for the spilled intervals: with unlimited slots, a sweep
+// that reuses the lowest slot freed so far is optimal for intervals.
+void assignSlots(std::vector<Interval>& spilled, Allocation& a) {
+  std::sort(spilled.begin(), spilled.end(),
+            [](const Interval& x, const Interval& y) { return x.start < y.start; });
+  std::vector<Interval> active;
+  std::vector<uint32_t> freeSlots;
+  for (const Interval& cur : spilled) {
+    for (size_t k = 0; k < active.size();) {
+      if (active[k].end < cur.start) {
+        freeSlots.push_back(a.vars[active[k].var].index);
+        active[k] = active.back();
+        active.pop_back();
+      } else {
+        ++k;
+      }
+    }
+    uint32_t slot;
+    if (freeSlots.empty()) {
+      slot = a.stackSlots++;
+    } else {
+      auto lowest = std::min_element(freeSlots.begin(), freeSlots.end());
+      slot = *lowest;
+      *lowest = freeSlots.back();
+      freeSlots.pop_back();
+    }
+    a.vars[cur.var] = {Location::Kind::Stack, slot};
+    active.push_back(cur);
+  }
+}
+
+void linearScan(const Problem& p, uint32_t registers, Allocation& a) {
+  std::vector<Interval> intervals = buildIntervals(p);
+  std::vector<Interval> active;  // holding registers, by increasing end
+  std::vector<uint8_t> taken(registers, 0);
+  std::vector<uint32_t> reg(p.size(), kNone);
+  std::vector<Interval> spilled;
+  for (const Interval& cur : intervals) {
+    while (!active.empty() && active.front().end < cur.start) {
+      taken[reg[active.front().var]] = 0;
+      active.erase(active.begin());
+    }
+    uint32_t r = kNone;
+    const uint32_t h = p.hint[cur.var];
+    if (h != kNone && reg[h] != kNone && !taken[reg[h]]) r = reg[h];
+    for (uint32_t k = 0; r == kNone && k < registers; ++k)
+      if (!taken[k]) r = k;
+    if (r == kNone) {
+      // Spill whichever of the active intervals and this one ends last.
+      if (!active.empty() && active.back().end > cur.end) {
+        const Interval victim = active.back();
+        active.pop_back();
+        r = reg[victim.var];
+        reg[victim.var] = kNone;
+        spilled.push_back(victim);
+      } else {
+        spilled.push_back(cur);
+        continue;
+      }
+    }
+    reg[cur.var] = r;
+    taken[r] = 1;
+    active.insert(std::upper_bound(active.begin(), active.end(), cur,
+                                   [](const Interval& x, const Interval& y) { return x.end < y.end; }),
+                  cur);
+  }
+  for (uint32_t v = 0; v < p.size(); ++v)
+    if (reg[v] != kNone) {
+      a.vars[v] = {Location::Kind::Register, reg[v]};
+      a.registersUsed = std::max(a.registersUsed, reg[v] + 1);
+    }
+  a.spilled = static_cast<uint32_t>(spilled.size());
+  assignSlots(spilled, a);
+}
+
+class GraphColorer {
+ public:
+  GraphColorer(const Problem& p, uint32_t registers) : p_(p), k_(registers), adj_(p.size()) {}
+
+  void run(Allocation& a) {
+    build();
+    simplify();
+    select(a);
+  }
+
+ private:
+  void addEdge(uint32_t u, uint32_t v) {
+    if (u == v || !p_.candidate[u] || !p_.candidate[v]) return;
+    const uint64_t key = uint64_t(std::min(u, v)) << 32 | std::max(u, v);
+    if (!edges_.insert(key).second) return;
+    adj_[u].push_back(v);
+    adj_[v].push_back(u);
+  }
+
+  // A definition interferes with everything live after it except, for a
+  // copy, its source (Chaitin's rule), which lets the two share a register.
+  void build() {
+    const Function& fn = p_.fn();
+    const Cfg& cfg = p_.cfg();
+    used_.assign(p_.size(), 0);
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+      BitSet live = p_.live().out[b];
+      const std::vector<uint32_t>& code = cfg.blocks[b].code;
+      for (size_t k = code.size(); k-- > 0;) {
+        const uint32_t i = code[k];
+        if (definesResult(fn.op[i]) && isVar(fn.result[i])) {
+          const uint32_t v = fn.result[i].index();
+          const Operand src = fn.op[i] == Op::Copy ? fn.arg1[i] : Operand();
+          live.forEach([&](size_t u) {
+            if (!(isVar(src) && src.index() == u)) addEdge(v, static_cast<uint32_t>(u));
+          });
+          live.reset(v);
+          used_[v] = 1;
+        }
+        for (Operand o : {fn.op[i] == Op::Store ? fn.result[i] : Operand(), fn.arg1[i], fn.arg2[i]})
+          if (isVar(o)) {
+            live.set(o.index());
+            used_[o.index()] = 1;
+          }
+      }
+    }
+    // Everything live on entry holds its value from the start.
+    std::vector<uint32_t> entry;
+    p_.live().in[0].forEach([&](size_t v) { entry.push_back(static_cast<uint32_t>(v)); });
+    for (uint32_t v = 0; v < p_.fn().numParams; ++v)
+      if (!p_.live().in[0].test(v)) entry.push_back(v);
+    for (size_t i = 0; i < entry.size(); ++i)
+      for (size_t j = i + 1; j < entry.size(); ++j) addEdge(entry[i], entry[j]);
+    for (uint32_t v : entry) used_[v] = 1;
+    // Unreachable code is not in the flow graph but still names variables.
+    for (uint32_t i = 0; i < fn.size(); ++i)
+      for (Operand o : {fn.result[i], fn.arg1[i], fn.arg2[i]})
+        if (isVar(o)) used_[o.index()] = 1;
+  }
+
+  // Removes nodes of degree < k first; when there are none, removes the
+  // cheapest node per degree and hopes it still gets a colour (Briggs).
+  void simplify() {
+    const uint32_t n = p_.size();
+    std::vector<uint32_t> degree(n), cost(n, 1);
+    const Function& fn = p_.fn();
+    for (uint32_t i = 0; i < fn.size(); ++i)
+      for (Operand o : {fn.result[i], fn.arg1[i], fn.arg2[i]})
+        if (isVar(o)) ++cost[o.index()];
+    std::vector<uint8_t> removed(n, 0);
+    std::vector<uint32_t> low;
+    uint32_t remaining = 0;
+    for (uint32_t v = 0; v < n; ++v) {
+      if (!p_.candidate[v] || !used_[v]) {
+        removed[v] = 1;
+        continue;
+      }
+      degree[v] = static_cast<uint32_t>(adj_[v].size());
+      ++remaining;
+      if (degree[v] < k_) low.push_back(v);
+    }
+    auto remove = [&](uint32_t v) {
+      removed[v] = 1;
+      --remaining;
+      stack_.push_back(v);
+      for (uint32_t u : adj_[v])
+        if (!removed[u] && degree[u]-- == k_) low.push_back(u);
+    };
+    while (remaining) {
+      if (!low.empty()) {
+        const uint32_t v = low.back();
+        low.pop_back();
+        if (!removed[v]) remove(v);
+        continue;
+      }
+      uint32_t best = kNone;
+      for (uint32_t v = 0; v < n; ++v)
+        if (!removed[v] && (best == kNone || uint64_t(cost[v]) * degree[best] <
+                                                 uint64_t(cost[best]) * degree[v]))
+          best = v;
+      remove(best);
+    }
+  }
+
+  void select(Allocation& a) {
+    std::vector<uint32_t> color(p_.size(), kNone);
+    std::vector<uint8_t> busy(k_, 0);
+    std::vector<uint32_t> spilled;
+    for (size_t s = stack_.size(); s-- > 0;) {
+      const uint32_t v = stack_[s];
+      std::fill(busy.begin(), busy.end(), 0);
+      for (uint32_t u : adj_[v])
+        if (color[u] != kNone) busy[color[u]] = 1;
+      const uint32_t h = p_.hint[v];
+      uint32_t c = h != kNone && color[h] != kNone && !busy[color[h]] ? color[h] : kNone;
+      for (uint32_t r = 0; c == kNone && r < k_; ++r)
+        if (!busy[r]) c = r;
+      if (c == kNone) {
+        spilled.push_back(v);
+        continue;
+      }
+      color[v] = c;
+      a.vars[v] = {Location::Kind::Register, c};
+      a.registersUsed = std::max(a.registersUsed, c + 1);
+    }
+    // Spilled nodes colour the same graph again, with as many slots as
+    // they need.
+    std::vector<uint32_t> slot(p_.size(), kNone);
+    std::vector<uint8_t> slotBusy;
+    const uint32_t base = a.stackSlots;
+    for (uint32_t v : spilled) {
+      slotBusy.assign(a.stackSlots - base + 1, 0);
+      for (uint32_t u : adj_[v])
+        if (slot[u] != kNone) slotBusy[slot[u]] = 1;
+      uint32_t s = 0;
+      while (slotBusy[s]) ++s;
+      slot[v] = s;
+      a.stackSlots = std::max(a.stackSlots, base + s + 1);
+      a.vars[v] = {Location::Kind::Stack, base + s};
+    }
+    a.spilled = static_cast<uint32_t>(spilled.size());
+  }
+
+  const Problem& p_;
+  const uint32_t k_;
+  std::vector<std::vector<uint32_t>> adj_;
+  std::unordered_set<uint64_t> edges_;
+  std::vector<uint8_t> used_;
+  std::vector<uint32_t> stack_;
+};
+
+}  // namespace
+
+Allocation allocateRegisters(const Function& fn, uint32_t registers, Allocator allocator) {
+  Problem p(fn);
+  Allocation a;
+  a.vars.assign(fn.vars.size(), {Location::Kind::Register, 0});
+  if (allocator == Allocator::LinearScan) linearScan(p, registers, a);
+  else GraphColorer(p, registers).run(a);
+  // Aggregates, and scalars addressed like them, get slots of their own.
+  for (uint32_t v = 0; v < p.size(); ++v)
+    if (!p.candidate[v]) {
+      a.vars[v] = {Location::Kind::Stack, a.stackSlots};
+      a.stackSlots += fn.vars[v].size;
+    }
+  return a;
+}
+
+void dumpAllocation(const Module& module, const Interner& interner, uint32_t registers,
+                    Allocator allocator, std::ostream& os) {
+  OperandPrinter names(module, interner);
+  for (const Function& fn : module.functions) {
+    const Allocation a = allocateRegisters(fn, registers, allocator);
+    names.bind(fn);
+    os << "\nfn " << interner.spelling(fn.name) << ": " << a.registersUsed << " of " << registers
+       << " registers, " << a.spilled << " spilled, " << a.stackSlots << " stack slots\n";
+    for (uint32_t v = 0; v < fn.vars.size(); ++v) {
+      os << "  ";
+      names.print(Operand::var(v), os);
+      const Location& l = a.vars[v];
+      if (l.kind == Location::Kind::Register) os << ": r" << l.index << '\n';
+      else os << ": [" << l.index << "]\n";
+    }
+  }
+}
+
+}  // namespace byyl
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "ir/ir.h"
+
+namespace byyl {
+
+// Where a variable lives while its function runs.
+struct Location {
+  enum class Kind : uint8_t { Register, Stack };
+  Kind kind = Kind::Register;
+  uint32_t index = 0;  // register number, or first stack slot
+};
+
+enum class Allocator : uint8_t {
+  LinearScan,     // Poletto and Sarkar: one pass over sorted live intervals
+  GraphColoring,  // Chaitin-Briggs over an interference graph
+};
+
+struct Allocation {
+  std::vector<Location> vars;  // per Function::vars
+  uint32_t stackSlots = 0;     // frame size, spill slots and aggregates
+  uint32_t registersUsed = 0;  // highest register number used, plus one
+  uint32_t spilled = 0;        // scalars that did not get a register
+};
+
+// Maps the variables of `fn` onto `registers` registers and stack slots.
+// Scalars that are never the base of a Load or Store compete for
+// registers; the rest get stack slots of their size. Two scalars share a
+// register or slot only if they are never live at once. Register and stack
+// operands are interchangeable to the code generators, so a spilled
+// variable needs no reload code: it simply lives in its slot.
+//
+// Linear scan numbers the instructions in order, turns liveness into one
+// interval per variable and allocates in a single sweep, spilling the
+// interval that ends last when registers run out. Graph coloring builds the
+// full interference graph, which can be quadratic in the number of
+// variables, and colours it with optimistic (Briggs) spilling. Both take
+// the register of a copy's source for its destination when they can.
+Allocation allocateRegisters(const Function& fn, uint32_t registers, Allocator allocator);
+
+// Allocation of every function, for --dump-regalloc.
+void dumpAllocation(const Module& module, const Interner& interner, uint32_t registers,
+                    Allocator allocator, std::ostream& os);
+
+}  // namespace byyl
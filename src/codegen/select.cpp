@@ -0,0 +1,190 @@
+#include "codegen/select.h"
+
+#include <algorithm>
+
+namespace byyl::isel {
+
+namespace {
+
+// Folds nested deeper than this stop, so a long chain of single-use
+// temporaries becomes a run of trees instead of one that building and
+// reducing would recurse down. No rule looks more than two levels deep.
+constexpr uint32_t kMaxFoldDepth = 64;
+
+bool fitsInt32(int64_t v) { return v >= INT32_MIN && v <= INT32_MAX; }
+
+bool isConstant(Operand o) { return o.is(Operand::Kind::Imm) || o.is(Operand::Kind::Const); }
+
+}  // namespace
+
+void Forest::build(const Module& m, const Function& fn) {
+  m_ = &m;
+  fn_ = &fn;
+  nodes_.clear();
+  roots_.clear();
+  uses_.assign(fn.vars.size(), 0);
+  defs_.assign(fn.vars.size(), 0);
+  defAt_.assign(fn.vars.size(), 0);
+  folded_.assign(fn.size(), false);
+  for (uint32_t i = 0; i < fn.size(); ++i) {
+    for (Operand o : {fn.arg1[i], fn.arg2[i]})
+      if (o.is(Operand::Kind::Var)) ++uses_[o.index()];
+    const Operand r = fn.result[i];
+    if (!r.is(Operand::Kind::Var)) continue;
+    if (fn.op[i] == Op::Store) {
+      ++uses_[r.index()];
+    } else if (definesResult(fn.op[i])) {
+      ++defs_[r.index()];
+      defAt_[r.index()] = i;
+    }
+  }
+
+  // From the last quadruple back, so each one is known to be folded into a
+  // later tree before its own turn comes.
+  for (uint32_t i = fn.size(); i-- > 0;) {
+    if (folded_[i] || fn.op[i] == Op::Nop) continue;
+    roots_.push_back(tree(i));
+  }
+  std::reverse(roots_.begin(), roots_.end());
+
+  // Children are created before their parents, so one pass in creation
+  // order labels every tree bottom up.
+  for (Node& n : nodes_) {
+    const auto op = static_cast<uint32_t>(n.op);
+    if (n.numKids == 0) {
+      n.state = kBursLeafState[op];
+      continue;
+    }
+    uint32_t t = kBursTransitionBase[op];
+    for (uint32_t p = 0; p < n.numKids; ++p) {
+      const uint32_t at = op * kBursMaxArity + p;
+      t += kBursProjection[kBursProjectionBase[at] + nodes_[n.kids[p]].state] * kBursStride[at];
+    }
+    n.state = kBursTransition[t];
+  }
+}
+
+uint32_t Forest::leaf(BursOp op, Operand o, uint32_t insn) {
+  Node n;
+  n.op = op;
+  n.insn = insn;
+  n.operand = o;
+  nodes_.push_back(n);
+  return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+uint32_t Forest::operandLeaf(Operand o, uint32_t insn) {
+  if (o.is(Operand::Kind::Global)) return leaf(BursOp::Global, o, insn);
+  if (!isConstant(o)) return leaf(BursOp::Var, o, insn);
+  const int64_t v = m_->constantValue(o);
+  return leaf(v == 0 ? BursOp::Zero : fitsInt32(v) ? BursOp::Imm : BursOp::Wide, o, insn);
+}
+
+uint32_t Forest::node(BursOp op, uint32_t insn, std::initializer_list<uint32_t> kids) {
+  Node n;
+  n.op = op;
+  n.insn = insn;
+  for (uint32_t k : kids) n.kids[n.numKids++] = k;
+  nodes_.push_back(n);
+  return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+bool Forest::foldable(Op op) const {
+  return opShape(op) != OpShape::Other || op == Op::Load || op == Op::Call;
+}
+
+uint32_t Forest::kid(Operand o, uint32_t insn) {
+  if (cursor_ >= 0 && o.is(Operand::Kind::Var)) {
+    const uint32_t v = o.index();
+    const auto j = static_cast<uint32_t>(cursor_);
+    const Var& var = fn_->vars[v];
+    if (!var.name && var.size == 1 && uses_[v] == 1 && defs_[v] == 1 && defAt_[v] == j &&
+        foldable(fn_->op[j]) && depth_ < kMaxFoldDepth) {
+      folded_[j] = true;
+      ++depth_;
+      const uint32_t n = value(j);
+      --depth_;
+      nodes_[n].operand = o;
+      nodes_[n].folded = true;
+      return n;
+    }
+  }
+  return operandLeaf(o, insn);
+}
+
+uint32_t Forest::index(Operand base, Operand o, uint32_t insn) {
+  const uint32_t size = base.is(Operand::Kind::Global) ? m_->globals[base.index()].size
+                                                       : fn_->vars[base.index()].size;
+  if (isConstant(o) && m_->constantValue(o) >= 0 && m_->constantValue(o) < size)
+    return leaf(BursOp::Slot, o, insn);
+  return kid(o, insn);
+}
+
+uint32_t Forest::value(uint32_t i) {
+  const Function& fn = *fn_;
+  const Op op = fn.op[i];
+  cursor_ = static_cast<int64_t>(i) - 1;
+  // Later operands first: their quadruples are the nearer ones.
+  switch (opShape(op)) {
+    case OpShape::Binary:
+    case OpShape::Compare: {
+      const uint32_t y = kid(fn.arg2[i], i);
+      const uint32_t x = kid(fn.arg1[i], i);
+      return node(op == Op::Div || op == Op::Rem ? BursOp::DivRem : BursOp::Binary, i, {x, y});
+    }
+    case OpShape::Unary:
+      return node(BursOp::Unary, i, {kid(fn.arg1[i], i)});
+    case OpShape::Other:
+      break;
+  }
+  if (op == Op::Load) {
+    const uint32_t y = index(fn.arg1[i], fn.arg2[i], i);
+    return node(BursOp::Load, i, {operandLeaf(fn.arg1[i], i), y});
+  }
+  return leaf(BursOp::Call, {}, i);
+}
+
+uint32_t Forest::tree(uint32_t i) {
+  const Function& fn = *fn_;
+  const Op op = fn.op[i];
+  const Operand r = fn.result[i], a = fn.arg1[i];
+  cursor_ = static_cast<int64_t>(i) - 1;
+  switch (op) {
+    case Op::Copy: {
+      const uint32_t v = kid(a, i);
+      return node(BursOp::Set, i, {operandLeaf(r, i), v});
+    }
+    case Op::Call:
+      if (!r) return leaf(BursOp::Call, {}, i);
+      break;
+    case Op::Store: {
+      const uint32_t v = kid(fn.arg2[i], i);
+      const uint32_t x = index(r, a, i);
+      return node(BursOp::Store, i, {operandLeaf(r, i), x, v});
+    }
+    case Op::JumpIf:
+    case Op::JumpIfNot:
+      return node(BursOp::Branch, i, {kid(a, i)});
+    case Op::Param:
+      return node(BursOp::Param, i, {kid(a, i)});
+    case Op::Return:
+      return a ? node(BursOp::Return, i, {kid(a, i)}) : leaf(BursOp::Ret, {}, i);
+    case Op::PrintInt:
+    case Op::PrintBool:
+      return node(BursOp::Print, i, {kid(a, i)});
+    case Op::PrintStr:
+      return leaf(BursOp::PrintStr, a, i);
+    case Op::PrintLn:
+      return leaf(BursOp::PrintLn, {}, i);
+    case Op::Label:
+      return leaf(BursOp::Label, r, i);
+    case Op::Jump:
+      return leaf(BursOp::Jump, r, i);
+    default:
+      break;
+  }
+  const uint32_t v = value(i);
+  return node(BursOp::Set, i, {operandLeaf(r, i), v});
+}
+
+}  // namespace byyl::isel
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "ir/ir.h"
+
+namespace byyl::isel {
+
+// Operators, nonterminals, rules and the BURS automaton come from
+// src/codegen/byyl.burg via byyl-burg.
+#include "burs_tables.inc"
+
+// One node of an expression tree. Leaves are operands, classified by
+// value; an interior node stands for the quadruple `insn`.
+struct Node {
+  BursOp op = BursOp::Var;
+  uint8_t numKids = 0;
+  uint16_t state = 0;
+  uint32_t kids[kBursMaxArity] = {};
+  uint32_t insn = 0;  // for a leaf, the quadruple it is an operand of
+  // A leaf's operand, or the temporary a folded quadruple defines.
+  Operand operand;
+  bool folded = false;
+};
+
+// Instruction selection by tree rewriting (Dragon Book 8.9). Each
+// quadruple becomes the root of a tree whose operands are leaves, except
+// that a temporary defined once, used once, and computed by the quadruples
+// just before its use is folded in as a subtree, so its value can go
+// straight where its user puts it, up to a bounded depth. build() labels the nodes bottom up
+// with the byyl-burg automaton: a node's state is one table lookup on its
+// children's states, whatever the number of rules, and names the cheapest
+// rule deriving each nonterminal there.
+class Forest {
+ public:
+  void build(const Module& m, const Function& fn);
+
+  // Trees in program order; their quadruples are in the order of their
+  // nodes, each subtree's before its parent's.
+  const std::vector<uint32_t>& roots() const { return roots_; }
+  const Node& operator[](uint32_t n) const { return nodes_[n]; }
+  // Rule deriving `nt` at `n`, or 0 if none does.
+  int rule(uint32_t n, BursNt nt) const {
+    return kBursStateRule[nodes_[n].state * kBursNumNonterminals + static_cast<int>(nt)];
+  }
+  // The node a kid path of kBursKidPath leads to from `n`.
+  uint32_t follow(uint32_t n, uint8_t path) const {
+    for (int step = 0; step < (path & 3); ++step) n = nodes_[n].kids[path >> (2 + 2 * step) & 3];
+    return n;
+  }
+
+ private:
+  uint32_t leaf(BursOp op, Operand o, uint32_t insn);
+  uint32_t operandLeaf(Operand o, uint32_t insn);
+  uint32_t node(BursOp op, uint32_t insn, std::initializer_list<uint32_t> kids);
+  // Operand `o` of quadruple `insn`, folded if it is the temporary the
+  // quadruple at cursor_ defines.
+  uint32_t kid(Operand o, uint32_t insn);
+  // Index operand of a Load or Store on `base`: a Slot leaf if it is a
+  // constant within the aggregate.
+  uint32_t index(Operand base, Operand o, uint32_t insn);
+  // The node computing quadruple `i`'s value; moves cursor_ before the
+  // quadruples it folds.
+  uint32_t value(uint32_t i);
+  uint32_t tree(uint32_t i);
+  bool foldable(Op op) const;
+
+  const Module* m_ = nullptr;
+  const Function* fn_ = nullptr;
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> roots_;
+  std::vector<uint32_t> uses_, defs_, defAt_;  // per variable
+  std::vector<bool> folded_;                   // per quadruple
+  int64_t cursor_ = -1;                        // quadruple a kid may fold
+  uint32_t depth_ = 0;                         // folds in progress
+};
+
+}  // namespace byyl::isel
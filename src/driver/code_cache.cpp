@@ -0,0 +1,167 @@
+#include "driver/code_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "support/cache_dir.h"
+#include "support/hash.h"
+
+namespace byyl {
+
+namespace {
+
+// Bump when the optimizer or the code generator changes what it emits, so
+// old entries stop matching.
+constexpr uint32_t kCodeCacheVersion = 2;
+constexpr char kEntryMagic[8] = {'B', 'Y', 'Y', 'L', 'F', 'N', 'C', '\0'};
+
+// One entry file: this header, then int32 params[numParams] and
+// Insn code[numInsns], native-endian.
+struct EntryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t fileSize;
+  uint64_t name;
+  uint64_t check;
+  uint64_t checksum;  // hashBytes of everything after the header
+  uint32_t frameSize;
+  uint32_t numParams;
+  uint32_t numInsns;
+  uint32_t reserved;  // zero
+};
+static_assert(sizeof(EntryHeader) % 8 == 0, "the arrays after the header stay aligned");
+
+bool isJump(const vm::Insn& in) {
+  const auto op = static_cast<vm::Opcode>(in.op);
+  return op == vm::Opcode::Jump || op == vm::Opcode::JumpIf || op == vm::Opcode::JumpIfNot;
+}
+
+}  // namespace
+
+CodeCache::CodeCache(std::string dir, uint32_t registers, Allocator allocator, bool optimize)
+    : dir_(std::move(dir)),
+      flags_(uint64_t(registers) << 32 | uint64_t(static_cast<uint8_t>(allocator)) << 8 |
+             uint64_t(optimize)) {}
+
+std::string CodeCache::defaultDir() { return defaultCacheDir() + "/code"; }
+
+std::string CodeCache::path(uint64_t name) const {
+  char file[32];
+  std::snprintf(file, sizeof file, "%016llx.bfc", static_cast<unsigned long long>(name));
+  return dir_ + "/" + file;
+}
+
+CodeCache::Key CodeCache::key(const Module& module, const Function& fn,
+                              const std::vector<int32_t>& globalSlots) const {
+  // Each operand's kind decides how many words follow, so the stream
+  // parses one way only.
+  std::vector<uint64_t> words{kCodeCacheVersion, flags_, fn.numParams, fn.returnsValue,
+                              fn.numLabels, fn.vars.size()};
+  for (const Var& v : fn.vars) words.push_back(v.size);
+  auto operand = [&](Operand o) {
+    switch (o.kind()) {
+      case Operand::Kind::Imm:
+      case Operand::Kind::Const:
+        words.push_back(static_cast<uint64_t>(Operand::Kind::Imm));
+        words.push_back(static_cast<uint64_t>(module.constantValue(o)));
+        return;
+      case Operand::Kind::Global:
+        words.push_back(o.bits());
+        words.push_back(uint64_t(static_cast<uint32_t>(globalSlots[o.index()])) << 32 |
+                        module.globals[o.index()].size);
+        return;
+      default:
+        words.push_back(o.bits());
+    }
+  };
+  for (uint32_t i = 0; i < fn.size(); ++i) {
+    words.push_back(static_cast<uint64_t>(fn.op[i]));
+    operand(fn.result[i]);
+    operand(fn.arg1[i]);
+    operand(fn.arg2[i]);
+  }
+  Key key;
+  key.name = hashBytes(reinterpret_cast<const char*>(words.data()), words.size() * 8);
+  words.push_back(0x9e3779b97f4a7c15ull);
+  key.check = hashBytes(reinterpret_cast<const char*>(words.data()), words.size() * 8);
+  return key;
+}
+
+bool CodeCache::load(const Key& key, vm::FunctionBytecode& out) const {
+  int fd = ::open(path(key.name).c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+      static_cast<size_t>(st.st_size) < sizeof(EntryHeader)) {
+    ::close(fd);
+    return false;
+  }
+  const size_t size = static_cast<size_t>(st.st_size);
+  void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) return false;
+  const char* data = static_cast<const char*>(addr);
+
+  EntryHeader h;
+  std::memcpy(&h, data, sizeof h);
+  const size_t params = size_t(h.numParams) * sizeof(int32_t);
+  const size_t code = size_t(h.numInsns) * sizeof(vm::Insn);
+  bool ok = std::memcmp(h.magic, kEntryMagic, sizeof h.magic) == 0 &&
+            h.version == kCodeCacheVersion && h.name == key.name && h.check == key.check &&
+            h.fileSize == size && size == sizeof h + params + code &&
+            hashBytes(data + sizeof h, size - sizeof h) == h.checksum;
+  if (ok) {
+    out.info = vm::FunctionCode();
+    out.info.frameSize = h.frameSize;
+    // Empty vectors have no data() to copy into.
+    out.info.params.resize(h.numParams);
+    if (params) std::memcpy(out.info.params.data(), data + sizeof h, params);
+    out.code.resize(h.numInsns);
+    if (code) std::memcpy(out.code.data(), data + sizeof h + params, code);
+    for (const vm::Insn& in : out.code)
+      ok = ok && in.op < vm::kNumOpcodes &&
+           (!isJump(in) || static_cast<uint32_t>(in.a) < h.numInsns);
+  }
+  ::munmap(addr, size);
+  return ok;
+}
+
+void CodeCache::store(const Key& key, const vm::FunctionBytecode& code) {
+  const vm::FunctionCode& info = code.info;
+  std::string payload(reinterpret_cast<const char*>(info.params.data()),
+                      info.params.size() * sizeof(int32_t));
+  payload.append(reinterpret_cast<const char*>(code.code.data()),
+                 code.code.size() * sizeof(vm::Insn));
+
+  EntryHeader h{};
+  std::memcpy(h.magic, kEntryMagic, sizeof h.magic);
+  h.version = kCodeCacheVersion;
+  h.fileSize = static_cast<uint32_t>(sizeof h + payload.size());
+  h.name = key.name;
+  h.check = key.check;
+  h.checksum = hashBytes(payload);
+  h.frameSize = info.frameSize;
+  h.numParams = static_cast<uint32_t>(info.params.size());
+  h.numInsns = static_cast<uint32_t>(code.code.size());
+
+  const std::string file = path(key.name);
+  std::string error;
+  if (writeFileAtomically(file, std::string(reinterpret_cast<const char*>(&h), sizeof h) + payload,
+                          error))
+    return;
+  std::lock_guard<std::mutex> lock(mu_);
+  if (writeError_.empty()) writeError_ = file + ": " + error;
+}
+
+std::string CodeCache::writeError() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return writeError_;
+}
+
+}  // namespace byyl
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "codegen/regalloc.h"
+#include "ir/ir.h"
+#include "vm/bytecode.h"
+
+namespace byyl {
+
+// --code-cache: each function's finished bytecode, one file per function,
+// named by a hash of everything that code depends on. That is the
+// function's IR as lowered, with constants by value, globals by slot and
+// size, and variables by size but not name, plus the back-end flags.
+// Symbols and source positions are left out, so an edit elsewhere in a
+// file changes a function's key only if it renumbers the functions,
+// globals or strings the function refers to. A hit skips the optimizer and
+// the code generator for that function. Entries are mapped on lookup and
+// written atomically, so concurrent compilers can share a directory; a
+// directory that cannot be written just stays cold.
+class CodeCache {
+ public:
+  // Two independent hashes of the same input: `name` picks the file and
+  // `check` must match inside it, so a collision needs both to collide.
+  struct Key {
+    uint64_t name = 0;
+    uint64_t check = 0;
+  };
+
+  CodeCache(std::string dir, uint32_t registers, Allocator allocator, bool optimize);
+
+  // `fn` as lowered, before optimization.
+  Key key(const Module& module, const Function& fn, const std::vector<int32_t>& globalSlots) const;
+  // Copies the entry for `key` out of its mapped file. False on a miss or
+  // a damaged entry.
+  bool load(const Key& key, vm::FunctionBytecode& out) const;
+  void store(const Key& key, const vm::FunctionBytecode& code);
+
+  // The first failed write, if any, for a warning.
+  std::string writeError() const;
+
+  // $BYYL_CACHE_DIR/code and so on; see defaultCacheDir().
+  static std::string defaultDir();
+
+ private:
+  std::string path(uint64_t name) const;
+
+  const std::string dir_;
+  const uint64_t flags_;
+  mutable std::mutex mu_;
+  std::string writeError_;
+};
+
+}  // namespace byyl
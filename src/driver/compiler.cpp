@@ -0,0 +1,267 @@
+#include "driver/compiler.h"
+
+#include <algorithm>
+#include <optional>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "ast/ast.h"
+#include "driver/code_cache.h"
+#include "ir/lower.h"
+#include "ir/unit_file.h"
+#include "opt/analyses.h"
+#include "opt/optimize.h"
+#include "parse/parser.h"
+#include "support/cache_dir.h"
+#include "support/diagnostics.h"
+#include "support/interner.h"
+#include "support/source_buffer.h"
+#include "support/thread_pool.h"
+#include "vm/bytecode.h"
+#include "vm/vm.h"
+
+namespace byyl {
+
+namespace {
+
+void dumpTokens(Lexer& lexer, const Diagnostics& diags, std::ostream& os) {
+  for (const Token& tok : lexer.tokenize()) {
+    const LineColumn at = diags.lines().locate(tok.pos);
+    os << at.line << ':' << at.column << '\t' << tokenName(tok.kind);
+    if (!tok.text.empty()) os << '\t' << tok.text;
+    if (tok.symbol) os << "\t#" << tok.symbol.id();
+    os << '\n';
+  }
+}
+
+// Time the scanner on its own: the parser pulls tokens as it goes, so its
+// phase would hide the lexer's share. The throwaway Diagnostics keeps
+// lexical errors from being reported twice.
+void timeLexer(const SourceBuffer& source, const std::string& path, Interner& interner,
+               LexMode mode, Profile* profile) {
+  ProfileScope scope(profile, "lex");
+  Diagnostics diags(path);
+  Lexer lexer(source, diags, interner, mode);
+  uint64_t tokens = 1;
+  while (lexer.next().kind != TokenKind::eof) ++tokens;
+  BYYL_COUNT(profile, Tokens, tokens);
+}
+
+// The optimize and bytecode passes through the code cache: each function
+// is looked up by its IR as lowered, and only the misses are optimized,
+// assembled and stored. Linking is the same as compileBytecode's, so the
+// program is too.
+vm::Program compileCached(Module& module, const Interner& interner, const CompileOptions& opts,
+                          Profile* profile) {
+  ProfileScope scope(profile, "cached backend");
+  CodeCache& cache = *opts.codeCache;
+  const std::vector<int32_t> slots = vm::globalSlots(module);
+  const size_t n = module.functions.size();
+  std::vector<vm::FunctionBytecode> functions(n);
+  std::vector<char> hit(n);
+  parallelFor(opts.pool, n, [&](size_t f) {
+    Function& fn = module.functions[f];
+    const CodeCache::Key key = cache.key(module, fn, slots);
+    if ((hit[f] = cache.load(key, functions[f]))) return;
+    if (opts.optimize) optimizeFunction(fn, module);
+    functions[f] = vm::assembleFunction(module, fn, slots, opts.registers, opts.allocator,
+                                        opts.optimize);
+    cache.store(key, functions[f]);
+  });
+#ifndef BYYL_NO_STATS
+  const size_t hits = static_cast<size_t>(std::count(hit.begin(), hit.end(), 1));
+  BYYL_COUNT(profile, CodeCacheHits, hits);
+  BYYL_COUNT(profile, CodeCacheMisses, n - hits);
+#endif
+  vm::Program program = vm::linkProgram(module, interner, std::move(functions));
+  BYYL_COUNT(profile, Bytecode, program.code.size());
+  return program;
+}
+
+// A unit on its way through the pipeline, from wherever it entered.
+struct UnitState {
+  UnitState(const std::string& path, const std::string& sourceName, std::string_view source,
+            const CompileOptions& opts)
+      : path(path), opts(opts), diags(sourceName, source) {
+    diags.setErrorLimit(opts.errorLimit);
+  }
+
+  const std::string& path;  // the input
+  const CompileOptions& opts;
+  Profile* profile = nullptr;
+  Diagnostics diags;
+  Interner interner;
+  std::ostringstream out;
+  std::string errors;  // runtime and --emit errors, printed after the diagnostics
+};
+
+std::string unitFilePath(const std::string& path, const CompileOptions& opts) {
+  if (!opts.emitPath.empty()) return opts.emitPath;
+  const size_t dot = path.rfind('.');
+  const size_t slash = path.rfind('/');
+  const bool hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+  return (hasExtension ? path.substr(0, dot) : path) + ".byu";
+}
+
+void emitUnit(UnitState& u, const Ast* ast, NodeId root, const Module* module) {
+  ProfileScope scope(u.profile, "emit");
+  const std::string target = unitFilePath(u.path, u.opts);
+  std::string error;
+  const std::string bytes =
+      serializeUnit(u.diags.fileName(), u.diags.lines(), u.interner, ast, root, module);
+  if (!writeFileAtomically(target, bytes, error))
+    u.errors += "byyl: cannot write " + target + ": " + error + "\n";
+}
+
+// Optimizes, dumps, assembles and runs the error-free `module` as the
+// options ask.
+void runBackEnd(UnitState& u, Module& module) {
+  const CompileOptions& opts = u.opts;
+  Profile* profile = u.profile;
+  const bool cached = opts.codeCache && !opts.dumpIr && !opts.dumpDataflow &&
+                      !opts.dumpRegalloc && (opts.dumpBytecode || opts.run);
+  if (opts.optimize && !cached) optimize(module, profile, opts.pool);
+  if (opts.dumpIr) dumpIr(module, u.interner, u.out);
+  if (opts.dumpDataflow) dumpDataflow(module, u.interner, u.out);
+  if (opts.dumpRegalloc) dumpAllocation(module, u.interner, opts.registers, opts.allocator, u.out);
+  if (opts.dumpBytecode || opts.run) {
+    const vm::Program program =
+        cached ? compileCached(module, u.interner, opts, profile)
+               : vm::compileBytecode(module, u.interner, opts.registers, opts.allocator,
+                                     opts.optimize, profile, opts.pool);
+    if (opts.dumpBytecode) vm::dumpBytecode(program, u.out);
+    if (opts.run) {
+      std::string printed, error;
+      ProfileScope scope(profile, "run");
+      if (!vm::run(program, opts.runOptions, printed, error))
+        u.errors += u.diags.fileName() + ": runtime error: " + error + "\n";
+      u.out << printed;
+    }
+  }
+}
+
+// Everything after parsing, for a tree without syntax errors.
+void runFromAst(UnitState& u, const Ast& ast, NodeId root) {
+  if (u.opts.dumpAst) {
+    dumpAst(ast, root, u.interner, u.diags.lines(), u.out);
+    return;
+  }
+  if (u.opts.emit == EmitKind::Ast) {
+    emitUnit(u, &ast, root, nullptr);
+    return;
+  }
+  Module module;
+  {
+    ProfileScope scope(u.profile, "lower");
+    module = lowerProgram(ast, root, u.interner, u.diags);
+  }
+#ifndef BYYL_NO_STATS
+  for (const Function& fn : module.functions) BYYL_COUNT(u.profile, IrInstructions, fn.size());
+#endif
+  if (u.diags.hasErrors()) return;
+  if (u.opts.emit == EmitKind::Ir) {
+    emitUnit(u, nullptr, NodeId(), &module);
+    return;
+  }
+  runBackEnd(u, module);
+}
+
+UnitResult finishUnit(UnitState& u, UnitResult result) {
+  BYYL_COUNT(u.profile, ArenaBytes, u.interner.arena().bytesUsed());
+  std::ostringstream printed;
+  u.diags.print(printed);
+  result.output = u.out.str();
+  result.diagnostics = printed.str() + u.errors;
+  result.failed = u.diags.hasErrors() || !u.errors.empty();
+  return result;
+}
+
+// A unit file input: the tree or the three-address code comes out of the
+// mapped file in bulk, and the pipeline goes on from there.
+UnitResult resumeUnit(const std::string& path, const CompileOptions& opts) {
+  UnitResult result;
+  std::string error;
+  std::optional<UnitFile> file = UnitFile::open(path, error);
+  if (!file) {
+    result.diagnostics = "byyl: cannot load " + path + ": " + error + "\n";
+    result.failed = true;
+    return result;
+  }
+  UnitState u(path, std::string(file->sourceName()), {}, opts);
+  u.diags.setLines(file->lines());
+  if (opts.profile) {
+    result.profile = std::make_unique<Profile>(path, file->size());
+    u.profile = result.profile.get();
+  }
+
+  // What the run that wrote the file could still have done.
+  const bool needsAst = opts.dumpAst || opts.emit == EmitKind::Ast || !file->hasIr();
+  if (opts.dumpTokens || (needsAst && !file->hasAst())) {
+    u.errors = "byyl: " + path + " holds no " + (opts.dumpTokens ? "tokens" : "syntax tree") + "\n";
+    return finishUnit(u, std::move(result));
+  }
+  Ast ast;
+  NodeId root;
+  Module module;
+  {
+    ProfileScope scope(u.profile, "load");
+    file->loadSymbols(u.interner);
+    if (needsAst) root = file->loadAst(ast);
+    else module = file->loadModule();
+  }
+  if (needsAst) {
+    BYYL_COUNT(u.profile, AstNodes, ast.size());
+    runFromAst(u, ast, root);
+  } else if (opts.emit == EmitKind::Ir) {
+    emitUnit(u, nullptr, NodeId(), &module);
+  } else {
+#ifndef BYYL_NO_STATS
+    for (const Function& fn : module.functions) BYYL_COUNT(u.profile, IrInstructions, fn.size());
+#endif
+    runBackEnd(u, module);
+  }
+  return finishUnit(u, std::move(result));
+}
+
+}  // namespace
+
+UnitResult compileUnit(const std::string& path, const CompileOptions& opts) {
+  if (UnitFile::isUnitFile(path)) return resumeUnit(path, opts);
+  UnitResult result;
+  std::string error;
+  std::optional<SourceBuffer> source = SourceBuffer::open(path, error);
+  if (!source) {
+    result.diagnostics = "byyl: cannot open " + path + ": " + error + "\n";
+    result.failed = true;
+    return result;
+  }
+
+  UnitState u(path, path, source->text(), opts);
+  if (opts.profile) {
+    result.profile = std::make_unique<Profile>(path, source->size());
+    u.profile = result.profile.get();
+  }
+  Profile* profile = u.profile;
+
+  if (profile && !opts.dumpTokens) timeLexer(*source, path, u.interner, opts.lexMode, profile);
+  Lexer lexer(*source, u.diags, u.interner, opts.lexMode);
+  if (opts.dumpTokens) {
+    dumpTokens(lexer, u.diags, u.out);
+  } else {
+    Ast ast;
+    const ParseTables& tables = opts.tables ? *opts.tables : builtinParseTables();
+    NodeId root;
+    {
+      ProfileScope scope(profile, "parse");
+      Parser parser(lexer, u.diags, ast, tables);
+      root = opts.descent ? parser.parseDescent() : parser.parse();
+    }
+    BYYL_COUNT(profile, AstNodes, ast.size());
+    BYYL_COUNT(profile, ArenaBytes, ast.bytesUsed());
+    if (root && !u.diags.hasErrors()) runFromAst(u, ast, root);
+  }
+  return finishUnit(u, std::move(result));
+}
+
+}  // namespace byyl
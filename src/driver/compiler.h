@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "codegen/regalloc.h"
+#include "lex/lexer.h"
+#include "parse/parse_tables.h"
+#include "support/profile.h"
+#include "vm/vm.h"
+
+namespace byyl {
+
+class CodeCache;
+class ThreadPool;
+
+// What --emit writes instead of running the back end.
+enum class EmitKind : uint8_t {
+  None,
+  Ast,  // the syntax tree, after parsing
+  Ir,   // the three-address code, after lowering and before optimization
+};
+
+struct CompileOptions {
+  bool dumpTokens = false;
+  bool dumpAst = false;
+  bool dumpIr = false;
+  bool dumpDataflow = false;
+  bool dumpRegalloc = false;
+  bool dumpBytecode = false;
+  bool run = false;  // execute main() on the bytecode interpreter
+  vm::RunOptions runOptions;
+  bool optimize = false;
+  Allocator allocator = Allocator::LinearScan;
+  uint32_t registers = 16;
+  LexMode lexMode = LexMode::Fast;
+  const ParseTables* tables = nullptr;  // null: the built-in grammar
+  bool descent = false;                 // Parser::parseDescent() instead of the tables
+  bool profile = false;                 // fill UnitResult::profile
+  size_t errorLimit = 0;                // errors kept per unit; 0: all
+  // Optimizes and assembles the functions of a unit in parallel on it;
+  // output is the same as without. compileUnit may itself run on it.
+  ThreadPool* pool = nullptr;
+  // Reuses functions' bytecode from it when the unit is only assembled or
+  // run; the IR dumps need every function optimized, so they bypass it.
+  CodeCache* codeCache = nullptr;
+  // Writes the unit's front-end output to a unit file and stops there.
+  EmitKind emit = EmitKind::None;
+  std::string emitPath;  // empty: the input with its extension replaced by .byu
+};
+
+// Everything one translation unit produces. Units share nothing mutable:
+// each has its own Diagnostics, Interner and Ast, so any number of them can
+// compile concurrently, and the driver prints results in input order.
+struct UnitResult {
+  std::string output;       // dumps requested by the options, then --run output
+  std::string diagnostics;  // printed diagnostics, or the open error
+  bool failed = false;
+  std::unique_ptr<Profile> profile;  // with CompileOptions::profile
+};
+
+// `path` is a source file, or a unit file written by --emit, which
+// resumes the pipeline where that run stopped.
+UnitResult compileUnit(const std::string& path, const CompileOptions& opts);
+
+}  // namespace byyl
@@ -0,0 +1,341 @@
+// byyl: compiler driver.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "codegen/regalloc.h"
+#include "driver/code_cache.h"
+#include "driver/compiler.h"
+#include "parse/parser.h"
+#include "parse/table_cache.h"
+#include "support/thread_pool.h"
+
+namespace {
+
+struct Options {
+  std::vector<std::string> inputs;
+  unsigned jobs = 1;
+  bool dumpTokens = false;
+  bool dumpAst = false;
+  bool dumpIr = false;
+  bool dumpDataflow = false;
+  bool dumpRegalloc = false;
+  bool dumpBytecode = false;
+  bool run = false;
+  byyl::vm::RunOptions runOptions;
+  bool optimize = false;
+  std::optional<byyl::Allocator> allocator;  // default: by optimization level
+  bool graphColoring = false;                // -O2
+  uint32_t registers = 16;
+  std::string grammar;     // --grammar: parse with tables for this grammar
+  std::string tableCache;  // --table-cache: where those tables are cached
+  std::string codeCache;   // --code-cache: functions' bytecode is cached here
+  byyl::LexMode lexMode = byyl::LexMode::Fast;
+  bool descent = false;     // --parser=descent
+  bool timeReport = false;  // -ftime-report
+  std::string timeTrace;    // -ftime-trace: Chrome trace JSON goes here
+  size_t errorLimit = 0;    // -ferror-limit
+  byyl::EmitKind emit = byyl::EmitKind::None;
+  std::string output;  // -o: the unit file --emit writes
+};
+
+void usage() {
+  std::cerr << "usage: byyl [options] FILE...\n"
+               "  -j N                 use N threads (0: one per core), compiling files\n"
+               "                       concurrently and each file's functions in parallel\n"
+               "  -O, -O1 / -O0        optimize the three-address code and bytecode, or not\n"
+               "  -O2                  as -O1, allocating registers by graph coloring\n"
+               "  --dump-tokens        print the token stream and stop\n"
+               "  --dump-ast           print the syntax tree and stop\n"
+               "  --dump-ir            print the three-address code and stop\n"
+               "  --dump-dataflow      print liveness, reaching definitions and available\n"
+               "                       expressions per basic block\n"
+               "  --dump-regalloc      print where each variable lives\n"
+               "  --dump-bytecode      print the interpreter's register bytecode\n"
+               "  --run                run main() on the bytecode interpreter\n"
+               "  --emit=KIND          write the syntax tree (ast) or the unoptimized\n"
+               "                       three-address code (ir) to a unit file and stop;\n"
+               "                       a unit file given as FILE resumes from there\n"
+               "  -o OUT               the unit file to write (default: FILE as .byu)\n"
+               "  --no-jit             interpret only, never compile hot functions to x86-64\n"
+               "  --jit-threshold=N    calls or loop iterations before a function is\n"
+               "                       compiled (default 1000)\n"
+               "  --regalloc=KIND      register allocator: linear (default below -O2) or graph\n"
+               "  --registers=N        registers to allocate (default 16)\n"
+               "  --grammar=FILE       parse with FILE instead of the built-in grammar\n"
+               "  --table-cache=DIR    cache for --grammar tables (default $BYYL_CACHE_DIR,\n"
+               "                       $XDG_CACHE_HOME/byyl or ~/.cache/byyl)\n"
+               "  --code-cache[=DIR]   reuse unchanged functions' bytecode from DIR (default\n"
+               "                       $BYYL_CACHE_DIR/code, $XDG_CACHE_HOME/byyl/code or\n"
+               "                       ~/.cache/byyl/code)\n"
+               "  --lex-mode=MODE      scanner path: fast (default) or table\n"
+               "  --parser=KIND        lr (default), or descent: the generated recursive-descent\n"
+               "                       parser, which stops at the first syntax error\n"
+               "  -ftime-report        print the time each phase took, and counters\n"
+               "  -ftime-trace=FILE    write the phases as Chrome trace JSON to FILE\n"
+               "  -ferror-limit=N      report at most N errors per file (default 0: all)\n";
+}
+
+bool parseArgs(int argc, char** argv, Options& opts) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (std::strncmp(arg, "-j", 2) == 0) {
+      const char* n = arg[2] ? arg + 2 : (i + 1 < argc ? argv[++i] : "");
+      char* end;
+      long jobs = std::strtol(n, &end, 10);
+      if (*n == '\0' || *end != '\0' || jobs < 0) {
+        std::cerr << "byyl: -j expects a number\n";
+        return false;
+      }
+      opts.jobs = jobs == 0 ? std::max(1u, std::thread::hardware_concurrency())
+                            : static_cast<unsigned>(jobs);
+    } else if (std::strcmp(arg, "-O") == 0 || std::strcmp(arg, "-O1") == 0) {
+      opts.optimize = true;
+      opts.graphColoring = false;
+    } else if (std::strcmp(arg, "-O2") == 0) {
+      opts.optimize = true;
+      opts.graphColoring = true;
+    } else if (std::strcmp(arg, "-O0") == 0) {
+      opts.optimize = false;
+      opts.graphColoring = false;
+    } else if (std::strcmp(arg, "--dump-tokens") == 0) {
+      opts.dumpTokens = true;
+    } else if (std::strcmp(arg, "--dump-ast") == 0) {
+      opts.dumpAst = true;
+    } else if (std::strcmp(arg, "--dump-ir") == 0) {
+      opts.dumpIr = true;
+    } else if (std::strcmp(arg, "--dump-dataflow") == 0) {
+      opts.dumpDataflow = true;
+    } else if (std::strcmp(arg, "--dump-regalloc") == 0) {
+      opts.dumpRegalloc = true;
+    } else if (std::strcmp(arg, "--dump-bytecode") == 0) {
+      opts.dumpBytecode = true;
+    } else if (std::strcmp(arg, "--run") == 0) {
+      opts.run = true;
+    } else if (std::strcmp(arg, "--emit=ast") == 0) {
+      opts.emit = byyl::EmitKind::Ast;
+    } else if (std::strcmp(arg, "--emit=ir") == 0) {
+      opts.emit = byyl::EmitKind::Ir;
+    } else if (std::strcmp(arg, "-o") == 0) {
+      if (i + 1 == argc) {
+        std::cerr << "byyl: -o expects a file name\n";
+        return false;
+      }
+      opts.output = argv[++i];
+    } else if (std::strcmp(arg, "--no-jit") == 0) {
+      opts.runOptions.jit = false;
+    } else if (std::strncmp(arg, "--jit-threshold=", 16) == 0) {
+      char* end;
+      long threshold = std::strtol(arg + 16, &end, 10);
+      if (arg[16] == '\0' || *end != '\0' || threshold < 0 || threshold > UINT32_MAX) {
+        std::cerr << "byyl: --jit-threshold expects a count\n";
+        return false;
+      }
+      opts.runOptions.jitThreshold = static_cast<uint32_t>(threshold);
+    } else if (std::strcmp(arg, "--regalloc=linear") == 0) {
+      opts.allocator = byyl::Allocator::LinearScan;
+    } else if (std::strcmp(arg, "--regalloc=graph") == 0) {
+      opts.allocator = byyl::Allocator::GraphColoring;
+    } else if (std::strncmp(arg, "--registers=", 12) == 0) {
+      char* end;
+      long registers = std::strtol(arg + 12, &end, 10);
+      if (arg[12] == '\0' || *end != '\0' || registers < 1 || registers > 255) {
+        std::cerr << "byyl: --registers expects a number from 1 to 255\n";
+        return false;
+      }
+      opts.registers = static_cast<uint32_t>(registers);
+    } else if (std::strncmp(arg, "--grammar=", 10) == 0) {
+      opts.grammar = arg + 10;
+    } else if (std::strncmp(arg, "--table-cache=", 14) == 0) {
+      opts.tableCache = arg + 14;
+    } else if (std::strcmp(arg, "--code-cache") == 0) {
+      opts.codeCache = byyl::CodeCache::defaultDir();
+    } else if (std::strncmp(arg, "--code-cache=", 13) == 0 && arg[13]) {
+      opts.codeCache = arg + 13;
+    } else if (std::strcmp(arg, "--lex-mode=fast") == 0) {
+      opts.lexMode = byyl::LexMode::Fast;
+    } else if (std::strcmp(arg, "--lex-mode=table") == 0) {
+      opts.lexMode = byyl::LexMode::Table;
+    } else if (std::strcmp(arg, "--parser=lr") == 0) {
+      opts.descent = false;
+    } else if (std::strcmp(arg, "--parser=descent") == 0) {
+      opts.descent = true;
+    } else if (std::strcmp(arg, "-ftime-report") == 0) {
+      opts.timeReport = true;
+    } else if (std::strncmp(arg, "-ftime-trace=", 13) == 0 && arg[13] != '\0') {
+      opts.timeTrace = arg + 13;
+    } else if (std::strncmp(arg, "-ferror-limit=", 14) == 0) {
+      char* end;
+      long limit = std::strtol(arg + 14, &end, 10);
+      if (arg[14] == '\0' || *end != '\0' || limit < 0) {
+        std::cerr << "byyl: -ferror-limit expects a count\n";
+        return false;
+      }
+      opts.errorLimit = static_cast<size_t>(limit);
+    } else if (arg[0] == '-' && arg[1] != '\0') {
+      std::cerr << "byyl: unknown option " << arg << '\n';
+      return false;
+    } else {
+      opts.inputs.push_back(arg);
+    }
+  }
+  return !opts.inputs.empty();
+}
+
+// Tables for a --grammar file, with the file's action names rebound to the
+// parser's action numbers.
+struct GrammarTables {
+  byyl::lr::TableFile file;
+  std::vector<uint8_t> actions;
+  byyl::ParseTables tables;
+};
+
+std::optional<GrammarTables> loadGrammar(const Options& opts) {
+  std::ifstream in(opts.grammar, std::ios::binary);
+  if (!in) {
+    std::cerr << "byyl: cannot open " << opts.grammar << '\n';
+    return std::nullopt;
+  }
+  std::ostringstream text;
+  text << in.rdbuf();
+
+  std::vector<byyl::lr::TerminalInfo> terminals;
+  for (int k = 0; k < byyl::kNumTokenKinds; ++k) {
+    auto kind = static_cast<byyl::TokenKind>(k);
+    terminals.push_back({byyl::tokenName(kind), byyl::tokenSpelling(kind)});
+  }
+  std::string dir = opts.tableCache.empty() ? byyl::lr::defaultTableCacheDir() : opts.tableCache;
+  try {
+    bool hit = false;
+    std::string warning;
+    byyl::lr::TableFile file = byyl::lr::loadTables(text.str(), terminals, dir, hit, warning);
+    if (!warning.empty()) std::cerr << "byyl: warning: " << warning << '\n';
+
+    std::vector<int> binding;
+    for (std::string_view name : file.actionNames()) {
+      int index = byyl::Parser::actionIndex(name);
+      if (index < 0) {
+        std::cerr << opts.grammar << ": action '" << name << "' is not implemented by the parser\n";
+        return std::nullopt;
+      }
+      binding.push_back(index);
+    }
+    GrammarTables g{std::move(file), {}, {}};
+    g.tables = g.file.tables();
+    for (int r = 0; r < g.tables.numRules; ++r)
+      g.actions.push_back(static_cast<uint8_t>(binding[g.tables.ruleAction[r]]));
+    g.tables.ruleAction = g.actions.data();
+    return g;
+  } catch (const byyl::lr::GrammarError& e) {
+    std::cerr << opts.grammar << ": " << e.what() << '\n';
+    return std::nullopt;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  byyl::Profile::startClock();
+  Options opts;
+  if (!parseArgs(argc, argv, opts)) {
+    usage();
+    return 2;
+  }
+
+  if (opts.descent && !opts.grammar.empty()) {
+    std::cerr << "byyl: --parser=descent parses only the built-in grammar\n";
+    return 2;
+  }
+  if (!opts.output.empty() && (opts.emit == byyl::EmitKind::None || opts.inputs.size() > 1)) {
+    std::cerr << "byyl: -o names the unit file of --emit with one input\n";
+    return 2;
+  }
+  std::optional<GrammarTables> grammar;
+  if (!opts.grammar.empty() && !(grammar = loadGrammar(opts))) return 1;
+
+  byyl::CompileOptions copts;
+  copts.dumpTokens = opts.dumpTokens;
+  copts.dumpAst = opts.dumpAst;
+  copts.dumpIr = opts.dumpIr;
+  copts.dumpDataflow = opts.dumpDataflow;
+  copts.dumpRegalloc = opts.dumpRegalloc;
+  copts.dumpBytecode = opts.dumpBytecode;
+  copts.run = opts.run;
+  copts.runOptions = opts.runOptions;
+  copts.optimize = opts.optimize;
+  copts.allocator = opts.allocator.value_or(opts.graphColoring ? byyl::Allocator::GraphColoring
+                                                               : byyl::Allocator::LinearScan);
+  copts.registers = opts.registers;
+  copts.lexMode = opts.lexMode;
+  copts.tables = grammar ? &grammar->tables : nullptr;
+  copts.descent = opts.descent;
+  copts.profile = opts.timeReport || !opts.timeTrace.empty();
+  copts.errorLimit = opts.errorLimit;
+  copts.emit = opts.emit;
+  copts.emitPath = opts.output;
+
+  std::optional<byyl::CodeCache> codeCache;
+  if (!opts.codeCache.empty())
+    codeCache.emplace(opts.codeCache, copts.registers, copts.allocator, copts.optimize);
+  copts.codeCache = codeCache ? &*codeCache : nullptr;
+
+  // One pool for both levels: files are its tasks, and each file's
+  // functions go back onto it, so a lone large file still uses every core.
+  std::optional<byyl::ThreadPool> pool;
+  if (opts.jobs > 1) pool.emplace(opts.jobs);
+  copts.pool = pool ? &*pool : nullptr;
+
+  const size_t n = opts.inputs.size();
+  std::vector<byyl::UnitResult> results(n);
+  if (!pool || n == 1) {
+    for (size_t i = 0; i < n; ++i) results[i] = byyl::compileUnit(opts.inputs[i], copts);
+  } else {
+    // Largest files first, so a big file picked up last cannot leave the
+    // other workers idle at the end.
+    std::vector<std::pair<off_t, size_t>> order;
+    for (size_t i = 0; i < n; ++i) {
+      struct stat st;
+      order.emplace_back(::stat(opts.inputs[i].c_str(), &st) == 0 ? st.st_size : 0, i);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (auto [size, i] : order)
+      pool->submit([&, i = i] { results[i] = byyl::compileUnit(opts.inputs[i], copts); });
+    pool->wait();
+  }
+
+  // Input order, whatever order the units finished in.
+  bool failed = false;
+  for (const byyl::UnitResult& r : results) {
+    std::cout << r.output;
+    std::cerr << r.diagnostics;
+    failed |= r.failed;
+  }
+  if (codeCache && !codeCache->writeError().empty())
+    std::cerr << "byyl: warning: cannot write code cache " << codeCache->writeError() << '\n';
+
+  if (copts.profile) {
+    std::vector<const byyl::Profile*> profiles;
+    for (const byyl::UnitResult& r : results)
+      if (r.profile) profiles.push_back(r.profile.get());
+    if (opts.timeReport) byyl::printTimeReport(profiles, std::cerr);
+    if (!opts.timeTrace.empty()) {
+      std::ofstream trace(opts.timeTrace);
+      if (trace) byyl::writeChromeTrace(profiles, trace);
+      if (!trace) {
+        std::cerr << "byyl: cannot write " << opts.timeTrace << '\n';
+        failed = true;
+      }
+    }
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,264 @@
+#include "ir/ir.h"
+
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+
+namespace byyl {
+
+namespace {
+
+struct OpInfo {
+  const char* name;
+  const char* spelling;
+  OpShape shape;
+};
+
+constexpr OpInfo kOps[] = {
+#define BYYL_IR_INFO(name, spelling, shape) {#name, spelling, OpShape::shape},
+    BYYL_IR_OPS(BYYL_IR_INFO)
+#undef BYYL_IR_INFO
+};
+
+void printEscaped(const std::string& s, std::ostream& os) {
+  os << '"';
+  for (char c : s) {
+    if (c == '\n') os << "\\n";
+    else if (c == '\t') os << "\\t";
+    else if (c == '"' || c == '\\') os << '\\' << c;
+    else os << c;
+  }
+  os << '"';
+}
+
+class Printer {
+ public:
+  Printer(const Module& m, const Interner& interner, std::ostream& os)
+      : m_(m), interner_(interner), os_(os), names_(m, interner) {}
+
+  void run() {
+    for (const Var& g : m_.globals) {
+      os_ << "global @" << interner_.spelling(g.name);
+      if (g.size != 1) os_ << '[' << g.size << ']';
+      os_ << '\n';
+    }
+    for (const Function& f : m_.functions) function(f);
+  }
+
+ private:
+  void function(const Function& f) {
+    names_.bind(f);
+    os_ << "\nfn " << interner_.spelling(f.name) << '(';
+    for (uint32_t i = 0; i < f.numParams; ++i) {
+      if (i) os_ << ", ";
+      operand(Operand::var(i));
+    }
+    os_ << "):\n";
+    for (uint32_t i = 0; i < f.vars.size(); ++i)
+      if (i >= f.numParams && f.vars[i].size != 1) {
+        os_ << "  local ";
+        operand(Operand::var(i));
+        os_ << '[' << f.vars[i].size << "]\n";
+      }
+    for (uint32_t i = 0; i < f.size(); ++i) instruction(f, i);
+  }
+
+  void instruction(const Function& f, uint32_t i) {
+    const Op op = f.op[i];
+    const Operand res = f.result[i], a = f.arg1[i], b = f.arg2[i];
+    if (op == Op::Label) {
+      operand(res);
+      os_ << ":\n";
+      return;
+    }
+    os_ << "  ";
+    switch (opShape(op)) {
+      case OpShape::Binary:
+      case OpShape::Compare:
+        assign(res);
+        operand(a);
+        os_ << ' ' << opSpelling(op) << ' ';
+        operand(b);
+        break;
+      case OpShape::Unary:
+        assign(res);
+        os_ << opSpelling(op);
+        operand(a);
+        break;
+      case OpShape::Other:
+        other(op, res, a, b);
+        break;
+    }
+    os_ << '\n';
+  }
+
+  void other(Op op, Operand res, Operand a, Operand b) {
+    switch (op) {
+      case Op::Copy:
+        assign(res);
+        operand(a);
+        break;
+      case Op::Load:
+        assign(res);
+        operand(a);
+        os_ << '[';
+        operand(b);
+        os_ << ']';
+        break;
+      case Op::Store:
+        operand(res);
+        os_ << '[';
+        operand(a);
+        os_ << "] = ";
+        operand(b);
+        break;
+      case Op::Jump:
+        os_ << "goto ";
+        operand(res);
+        break;
+      case Op::JumpIf:
+      case Op::JumpIfNot:
+        os_ << opSpelling(op) << ' ';
+        operand(a);
+        os_ << " goto ";
+        operand(res);
+        break;
+      case Op::Call:
+        if (res) assign(res);
+        os_ << "call ";
+        operand(a);
+        os_ << ", ";
+        operand(b);
+        break;
+      default:
+        os_ << opSpelling(op);
+        if (a) {
+          os_ << ' ';
+          operand(a);
+        }
+        break;
+    }
+  }
+
+  void assign(Operand res) {
+    operand(res);
+    os_ << " = ";
+  }
+
+  void operand(Operand o) { names_.print(o, os_); }
+
+  const Module& m_;
+  const Interner& interner_;
+  std::ostream& os_;
+  OperandPrinter names_;
+};
+
+}  // namespace
+
+const char* opName(Op op) { return kOps[static_cast<int>(op)].name; }
+const char* opSpelling(Op op) { return kOps[static_cast<int>(op)].spelling; }
+OpShape opShape(Op op) { return kOps[static_cast<int>(op)].shape; }
+
+bool evaluate(Op op, int64_t a, int64_t b, int64_t& out) {
+  const uint64_t ua = static_cast<uint64_t>(a), ub = static_cast<uint64_t>(b);
+  switch (op) {
+    case Op::Add: out = static_cast<int64_t>(ua + ub); break;
+    case Op::Sub: out = static_cast<int64_t>(ua - ub); break;
+    case Op::Mul: out = static_cast<int64_t>(ua * ub); break;
+    case Op::Div:
+    case Op::Rem:
+      if (b == 0) return false;
+      if (b == -1) out = op == Op::Div ? static_cast<int64_t>(0 - ua) : 0;
+      else out = op == Op::Div ? a / b : a % b;
+      break;
+    case Op::Shl: out = static_cast<int64_t>(ua << (ub & 63)); break;
+    case Op::Shr: out = a >> (ub & 63); break;
+    case Op::And: out = a & b; break;
+    case Op::Or: out = a | b; break;
+    case Op::Xor: out = a ^ b; break;
+    case Op::Lt: out = a < b; break;
+    case Op::Le: out = a <= b; break;
+    case Op::Gt: out = a > b; break;
+    case Op::Ge: out = a >= b; break;
+    case Op::Eq: out = a == b; break;
+    case Op::Ne: out = a != b; break;
+    case Op::Neg: out = static_cast<int64_t>(0 - ua); break;
+    case Op::Not: out = !a; break;
+    case Op::BitNot: out = ~a; break;
+    default: return false;
+  }
+  return true;
+}
+
+Operand Module::constant(int64_t v) {
+  if (Operand::fitsImm(v)) return Operand::imm(v);
+  if (constantIndex.size() != constants.size()) {
+    constantIndex.clear();
+    for (size_t i = 0; i < constants.size(); ++i)
+      constantIndex.emplace(constants[i], static_cast<uint32_t>(i));
+  }
+  const auto [it, added] = constantIndex.emplace(v, static_cast<uint32_t>(constants.size()));
+  if (added) constants.push_back(v);
+  return {Operand::Kind::Const, it->second};
+}
+
+Operand Module::string(std::string s) {
+  strings.push_back(std::move(s));
+  return Operand::string(static_cast<uint32_t>(strings.size() - 1));
+}
+
+int Module::findFunction(Symbol name) const {
+  for (size_t i = 0; i < functions.size(); ++i)
+    if (functions[i].name == name) return static_cast<int>(i);
+  return -1;
+}
+
+void OperandPrinter::bind(const Function& fn) {
+  fn_ = &fn;
+  std::unordered_map<uint32_t, int> uses;
+  for (const Var& v : fn.vars)
+    if (v.name) ++uses[v.name.id()];
+  ambiguous_.assign(fn.vars.size(), false);
+  for (size_t i = 0; i < fn.vars.size(); ++i)
+    ambiguous_[i] = fn.vars[i].name && uses[fn.vars[i].name.id()] > 1;
+}
+
+void OperandPrinter::print(Operand o, std::ostream& os) const {
+  switch (o.kind()) {
+    case Operand::Kind::None:
+      os << '_';
+      break;
+    case Operand::Kind::Var: {
+      const Var& v = fn_->vars[o.index()];
+      if (!v.name) {
+        os << 't' << o.index();
+        break;
+      }
+      os << interner_.spelling(v.name);
+      if (ambiguous_[o.index()]) os << '.' << o.index();
+      break;
+    }
+    case Operand::Kind::Global:
+      os << '@' << interner_.spelling(m_.globals[o.index()].name);
+      break;
+    case Operand::Kind::Imm:
+    case Operand::Kind::Const:
+      os << m_.constantValue(o);
+      break;
+    case Operand::Kind::Label:
+      os << 'L' << o.index();
+      break;
+    case Operand::Kind::Func:
+      os << interner_.spelling(m_.functions[o.index()].name);
+      break;
+    case Operand::Kind::String:
+      printEscaped(m_.strings[o.index()], os);
+      break;
+  }
+}
+
+void dumpIr(const Module& module, const Interner& interner, std::ostream& os) {
+  Printer(module, interner, os).run();
+}
+
+}  // namespace byyl
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "support/interner.h"
+
+namespace byyl {
+
+// A 32-bit instruction operand: a 3-bit kind above a 29-bit payload. Equal
+// operands have equal bits, so a pass can compare or hash them as integers.
+class Operand {
+ public:
+  enum class Kind : uint8_t {
+    None,
+    Var,     // function-local slot: parameter, local or temporary
+    Global,  // module-level slot
+    Imm,     // signed 29-bit constant held in the payload
+    Const,   // index into Module::constants, for wider constants
+    Label,
+    Func,    // index into Module::functions
+    String,  // index into Module::strings
+  };
+
+  static constexpr uint32_t kPayloadBits = 29;
+  static constexpr uint32_t kPayloadMask = (1u << kPayloadBits) - 1;
+  static constexpr int64_t kImmMin = -(int64_t(1) << (kPayloadBits - 1));
+  static constexpr int64_t kImmMax = (int64_t(1) << (kPayloadBits - 1)) - 1;
+
+  constexpr Operand() = default;
+  constexpr Operand(Kind kind, uint32_t index)
+      : bits_(static_cast<uint32_t>(kind) << kPayloadBits | (index & kPayloadMask)) {}
+  static constexpr Operand var(uint32_t i) { return {Kind::Var, i}; }
+  static constexpr Operand global(uint32_t i) { return {Kind::Global, i}; }
+  static constexpr Operand label(uint32_t i) { return {Kind::Label, i}; }
+  static constexpr Operand func(uint32_t i) { return {Kind::Func, i}; }
+  static constexpr Operand string(uint32_t i) { return {Kind::String, i}; }
+  static constexpr bool fitsImm(int64_t v) { return v >= kImmMin && v <= kImmMax; }
+  // `v` must satisfy fitsImm().
+  static constexpr Operand imm(int64_t v) { return {Kind::Imm, static_cast<uint32_t>(v)}; }
+
+  constexpr Kind kind() const { return static_cast<Kind>(bits_ >> kPayloadBits); }
+  constexpr uint32_t index() const { return bits_ & kPayloadMask; }
+  constexpr int64_t immValue() const { return static_cast<int32_t>(bits_ << 3) >> 3; }
+  constexpr uint32_t bits() const { return bits_; }
+  constexpr bool is(Kind k) const { return kind() == k; }
+  constexpr explicit operator bool() const { return bits_ != 0; }
+
+  friend constexpr bool operator==(Operand a, Operand b) { return a.bits_ == b.bits_; }
+  friend constexpr bool operator!=(Operand a, Operand b) { return a.bits_ != b.bits_; }
+
+ private:
+  uint32_t bits_ = 0;
+};
+static_assert(sizeof(Operand) == 4, "operands are 32-bit ids");
+
+// Quadruple opcodes: X(name, spelling, shape). Binary and Unary compute
+// `result = arg1 op arg2` and `result = op arg1`; Compare is Binary with a
+// 0/1 result. The other shapes use the fields as shown.
+#define BYYL_IR_OPS(X)                                                    \
+  X(Nop, "nop", Other)                                                    \
+  X(Copy, "", Other)           /* result = arg1                       */  \
+  X(Add, "+", Binary)                                                     \
+  X(Sub, "-", Binary)                                                     \
+  X(Mul, "*", Binary)                                                     \
+  X(Div, "/", Binary)                                                     \
+  X(Rem, "%", Binary)                                                     \
+  X(Shl, "<<", Binary)                                                    \
+  X(Shr, ">>", Binary)                                                    \
+  X(And, "&", Binary)                                                     \
+  X(Or, "|", Binary)                                                      \
+  X(Xor, "^", Binary)                                                     \
+  X(Lt, "<", Compare)                                                     \
+  X(Le, "<=", Compare)                                                    \
+  X(Gt, ">", Compare)                                                     \
+  X(Ge, ">=", Compare)                                                    \
+  X(Eq, "==", Compare)                                                    \
+  X(Ne, "!=", Compare)                                                    \
+  X(Neg, "-", Unary)                                                      \
+  X(Not, "!", Unary)                                                      \
+  X(BitNot, "~", Unary)                                                   \
+  X(Load, "", Other)           /* result = arg1[arg2], slot offset    */  \
+  X(Store, "", Other)          /* result[arg1] = arg2                 */  \
+  X(Label, "", Other)          /* result:                             */  \
+  X(Jump, "goto", Other)       /* goto result                         */  \
+  X(JumpIf, "if", Other)       /* if arg1 goto result                 */  \
+  X(JumpIfNot, "ifFalse", Other) /* ifFalse arg1 goto result          */  \
+  X(Param, "param", Other)     /* param arg1                          */  \
+  X(Call, "call", Other)       /* result? = call arg1, arg2 = Imm argc */ \
+  X(Return, "return", Other)   /* return arg1?                        */  \
+  X(PrintInt, "print", Other)  /* print arg1                          */  \
+  X(PrintBool, "printb", Other)                                           \
+  X(PrintStr, "prints", Other)                                            \
+  X(PrintLn, "println", Other) /* ends a print statement's line      */
+
+enum class Op : uint8_t {
+#define BYYL_IR_ENUM(name, spelling, shape) name,
+  BYYL_IR_OPS(BYYL_IR_ENUM)
+#undef BYYL_IR_ENUM
+};
+
+enum class OpShape : uint8_t { Binary, Compare, Unary, Other };
+
+const char* opName(Op op);
+const char* opSpelling(Op op);
+OpShape opShape(Op op);
+// Always transfers control: nothing after it in a block runs.
+inline bool isTerminator(Op op) { return op == Op::Jump || op == Op::Return; }
+// Writes `result`: the Binary, Compare and Unary ops, Copy, Load, and a Call
+// that has a result.
+inline bool definesResult(Op op) {
+  return opShape(op) != OpShape::Other || op == Op::Copy || op == Op::Load || op == Op::Call;
+}
+// Applies a Binary, Compare or Unary op (which ignores `b`) to constants,
+// with the semantics every back end implements: 64-bit wrap-around, shift
+// counts taken mod 64, arithmetic right shift. Returns false for division
+// or remainder by zero, which is left for run time.
+bool evaluate(Op op, int64_t a, int64_t b, int64_t& out);
+
+struct Var {
+  Symbol name;  // invalid for temporaries
+  uint32_t size = 1;  // slots
+};
+
+// One function as quadruples (Dragon Book 6.2.2) in struct-of-arrays form:
+// instruction i is (op[i], result[i], arg1[i], arg2[i]). Passes that scan
+// for an opcode or rewrite one operand column only touch that dense array,
+// and an instruction costs 13 bytes with no pointers to chase.
+struct Function {
+  Symbol name;
+  uint32_t numParams = 0;  // vars [0, numParams) are the parameters
+  bool returnsValue = false;
+  std::vector<Var> vars;
+  uint32_t numLabels = 0;
+
+  std::vector<Op> op;
+  std::vector<Operand> result, arg1, arg2;
+
+  uint32_t size() const { return static_cast<uint32_t>(op.size()); }
+  uint32_t emit(Op o, Operand res = {}, Operand a1 = {}, Operand a2 = {}) {
+    op.push_back(o);
+    result.push_back(res);
+    arg1.push_back(a1);
+    arg2.push_back(a2);
+    return size() - 1;
+  }
+  Operand newVar(Symbol name, uint32_t slots = 1) {
+    vars.push_back({name, slots});
+    return Operand::var(static_cast<uint32_t>(vars.size() - 1));
+  }
+  Operand newTemp() { return newVar(Symbol()); }
+  Operand newLabel() { return Operand::label(numLabels++); }
+
+  size_t bytesUsed() const {
+    return op.capacity() * sizeof(Op) +
+           (result.capacity() + arg1.capacity() + arg2.capacity()) * sizeof(Operand) +
+           vars.capacity() * sizeof(Var);
+  }
+};
+
+// Three-address code of one translation unit.
+struct Module {
+  std::vector<Function> functions;
+  std::vector<Var> globals;
+  std::vector<int64_t> constants;
+  std::vector<std::string> strings;  // escapes already decoded
+  int initFunction = -1;  // global initialisers, run before main; -1 if none
+  // Where each value is in `constants`, for constant(); rebuilt there if
+  // `constants` was filled some other way.
+  std::unordered_map<int64_t, uint32_t> constantIndex;
+
+  // An Imm operand when `v` fits, otherwise a pooled Const.
+  Operand constant(int64_t v);
+  // Value of an Imm or Const operand.
+  int64_t constantValue(Operand o) const {
+    return o.is(Operand::Kind::Imm) ? o.immValue() : constants[o.index()];
+  }
+  Operand string(std::string s);
+  int findFunction(Symbol name) const;
+};
+
+// Human-readable listing, for --dump-ir.
+void dumpIr(const Module& module, const Interner& interner, std::ostream& os);
+
+// Spells operands the way dumpIr does. Vars need the function they belong
+// to, set with bind(): a user name that occurs twice in it gets the slot
+// number appended.
+class OperandPrinter {
+ public:
+  OperandPrinter(const Module& module, const Interner& interner)
+      : m_(module), interner_(interner) {}
+
+  void bind(const Function& fn);
+  void print(Operand o, std::ostream& os) const;
+
+ private:
+  const Module& m_;
+  const Interner& interner_;
+  const Function* fn_ = nullptr;
+  std::vector<bool> ambiguous_;
+};
+
+}  // namespace byyl
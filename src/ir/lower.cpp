@@ -0,0 +1,895 @@
+#include "ir/lower.h"
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "sema/scope.h"
+#include "sema/type.h"
+
+namespace byyl {
+
+namespace {
+
+struct Entity {
+  enum class Kind : uint8_t { Var, Global, Func, Type };
+  Kind kind;
+  const Type* type;   // Var, Global: its type; Type: the named type
+  Operand op;         // Var, Global
+  uint32_t func = 0;  // Func: index into Module::functions
+};
+
+struct Signature {
+  std::vector<const Type*> params;
+  const Type* result;
+};
+
+struct Value {
+  Operand op;
+  const Type* type;
+};
+
+// An arithmetic operator waiting for its operands to be lowered.
+struct Pending {
+  NodeId n;
+  uint32_t next;  // kids lowered so far
+};
+
+// Storage named by an lvalue: the slots of `base` from `offset` on, or all
+// of `base` when there is no offset.
+struct Place {
+  Operand base;
+  Operand offset;
+  const Type* type;
+};
+
+Op binaryOp(TokenKind k) {
+  switch (k) {
+    case TokenKind::plus: return Op::Add;
+    case TokenKind::minus: return Op::Sub;
+    case TokenKind::star: return Op::Mul;
+    case TokenKind::slash: return Op::Div;
+    case TokenKind::percent: return Op::Rem;
+    case TokenKind::less_less: return Op::Shl;
+    case TokenKind::greater_greater: return Op::Shr;
+    case TokenKind::amp: return Op::And;
+    case TokenKind::pipe: return Op::Or;
+    case TokenKind::caret: return Op::Xor;
+    case TokenKind::less: return Op::Lt;
+    case TokenKind::less_equal: return Op::Le;
+    case TokenKind::greater: return Op::Gt;
+    case TokenKind::greater_equal: return Op::Ge;
+    case TokenKind::equal_equal: return Op::Eq;
+    case TokenKind::exclaim_equal: return Op::Ne;
+    default: return Op::Nop;
+  }
+}
+
+// Levels of statement, condition or non-arithmetic expression nesting.
+// Arithmetic is lowered on a work stack whatever its depth; everything
+// else recurses, a few C++ frames per level.
+constexpr uint32_t kMaxNesting = 1024;
+
+// Whether `n` is an operator lowered on the work stack: any unary one, and
+// the binary ones but && and ||, which are jumping code.
+bool isArithmetic(const Node& n) {
+  return n.kind == NodeKind::Unary ||
+         (n.kind == NodeKind::Binary && n.op != TokenKind::amp_amp && n.op != TokenKind::pipe_pipe);
+}
+
+// Decodes the escapes of a string literal, quotes included in `text`.
+std::string decodeString(std::string_view text) {
+  std::string out;
+  for (size_t i = 1; i + 1 < text.size(); ++i) {
+    char c = text[i];
+    if (c == '\\' && i + 2 < text.size()) {
+      c = text[++i];
+      if (c == 'n') c = '\n';
+      else if (c == 't') c = '\t';
+    }
+    out += c;
+  }
+  return out;
+}
+
+class Lowering {
+ public:
+  Lowering(const Ast& ast, Interner& interner, Diagnostics& diags)
+      : ast_(ast), interner_(interner), diags_(diags) {}
+
+  Module run(NodeId root) {
+    scopes_.push();
+    std::vector<NodeId> inits;
+    for (NodeId decl : ast_.kids(root)) {
+      declareTopLevel(decl);
+      if (ast_[decl].kind == NodeKind::VarDecl && ast_.kid(decl, 1)) inits.push_back(decl);
+    }
+    if (!inits.empty()) {
+      module_.initFunction = static_cast<int>(module_.functions.size());
+      module_.functions.emplace_back();
+      module_.functions.back().name = interner_.intern("<init>");
+      sigs_.push_back({{}, types_.voidType()});
+    }
+
+    if (!inits.empty()) {
+      beginFunction(static_cast<uint32_t>(module_.initFunction));
+      for (NodeId decl : inits) {
+        const Entity* global = scopes_.lookup(ast_[decl].name);
+        initialise({global->op, Operand(), global->type}, ast_.kid(decl, 1), ast_[decl].pos);
+      }
+      endFunction();
+    }
+    uint32_t index = 0;
+    for (NodeId decl : ast_.kids(root))
+      if (ast_[decl].kind == NodeKind::FuncDecl) lowerFunction(decl, index++);
+    return std::move(module_);
+  }
+
+ private:
+  void error(SourcePos pos, const char* format, std::initializer_list<DiagArg> args = {}) {
+    diags_.error(pos, format, args);
+  }
+  std::string_view spell(Symbol s) const { return interner_.spelling(s); }
+  std::string typeName(const Type* t) const { return types_.name(t, interner_); }
+
+  // Counts a level of recursion for as long as it lives.
+  class Nested {
+   public:
+    explicit Nested(uint32_t& depth) : depth_(++depth) {}
+    Nested(const Nested&) = delete;
+    Nested& operator=(const Nested&) = delete;
+    ~Nested() { --depth_; }
+
+   private:
+    uint32_t& depth_;
+  };
+
+  // Reported once: the levels above the limit all end there.
+  void tooDeep(NodeId n) {
+    if (!tooDeep_) error(ast_[n].pos, "nesting too deep");
+    tooDeep_ = true;
+  }
+
+  void declare(Symbol name, SourcePos pos, Entity e) {
+    if (!scopes_.declare(name, e)) error(pos, "'{}' is already defined in this scope", {spell(name)});
+  }
+
+  // ---------------------------------------------------------------------
+  // Declarations
+
+  const Type* resolveType(NodeId n) {
+    if (depth_ == kMaxNesting) {
+      tooDeep(n);
+      return types_.error();
+    }
+    Nested nested(depth_);
+    const Node& node = ast_[n];
+    switch (node.kind) {
+      case NodeKind::IntType:
+        return types_.intType();
+      case NodeKind::BoolType:
+        return types_.boolType();
+      case NodeKind::NamedType: {
+        const Entity* e = scopes_.lookup(node.name);
+        if (!e || e->kind != Entity::Kind::Type) {
+          error(node.pos, "unknown type '{}'", {spell(node.name)});
+          return types_.error();
+        }
+        return e->type;
+      }
+      case NodeKind::ArrayType: {
+        // `int[10][4]` nests as ArrayType 4 (ArrayType 10 (int)) but means
+        // ten rows of four, so the outermost node is the innermost array.
+        std::vector<NodeId> dims;
+        NodeId base = n;
+        for (; ast_[base].kind == NodeKind::ArrayType; base = ast_.kid(base, 0)) dims.push_back(base);
+        const Type* t = resolveType(base);
+        for (NodeId d : dims) {
+          int64_t length = ast_[d].value;
+          if (length <= 0 || length > INT32_MAX / (t->size ? t->size : 1)) {
+            error(ast_[d].pos, "array length {} is out of range", {length});
+            return types_.error();
+          }
+          if (t->isError()) return t;
+          t = types_.array(t, static_cast<uint32_t>(length));
+        }
+        return t;
+      }
+      case NodeKind::RecordType: {
+        std::vector<Type::Field> fields;
+        std::unordered_set<uint32_t> seen;
+        bool bad = false;
+        int64_t size = 0;
+        for (NodeId f : ast_.kids(n)) {
+          const Node& field = ast_[f];
+          const Type* t = resolveType(ast_.kid(f, 0));
+          if (!seen.insert(field.name.id()).second) {
+            error(field.pos, "duplicate field '{}'", {spell(field.name)});
+            bad = true;
+          }
+          bad |= t->isError();
+          // Offsets are slot numbers too, so the record is held to what an
+          // array may be.
+          size += t->size;
+          if (size > INT32_MAX && size - t->size <= INT32_MAX) {
+            error(field.pos, "record size {} is out of range", {size});
+            bad = true;
+          }
+          fields.push_back({field.name, t, 0});
+        }
+        return bad ? types_.error() : types_.record(std::move(fields));
+      }
+      default:
+        return types_.error();
+    }
+  }
+
+  // Parameters and results must fit a slot.
+  const Type* scalarType(NodeId n, const char* what) {
+    const Type* t = resolveType(n);
+    if (!t->isScalar() && !t->isError()) {
+      error(ast_[n].pos, "{} must be int or bool, not {}", {what, typeName(t)});
+      return types_.error();
+    }
+    return t;
+  }
+
+  void declareTopLevel(NodeId decl) {
+    const Node& node = ast_[decl];
+    switch (node.kind) {
+      case NodeKind::TypeDecl:
+        declare(node.name, node.pos, {Entity::Kind::Type, resolveType(ast_.kid(decl, 0)), {}});
+        break;
+      case NodeKind::VarDecl: {
+        const Type* t = resolveType(ast_.kid(decl, 0));
+        module_.globals.push_back({node.name, t->size ? t->size : 1});
+        reserve(globalSlots_, module_.globals.back().size, node.pos);
+        Operand g = Operand::global(static_cast<uint32_t>(module_.globals.size() - 1));
+        declare(node.name, node.pos, {Entity::Kind::Global, t, g});
+        break;
+      }
+      case NodeKind::FuncDecl: {
+        Signature sig;
+        for (NodeId p : ast_.kids(ast_.kid(decl, 0)))
+          sig.params.push_back(scalarType(ast_.kid(p, 0), "parameter type"));
+        NodeId ret = ast_.kid(decl, 1);
+        sig.result = ret ? scalarType(ret, "result type") : types_.voidType();
+        Function f;
+        f.name = node.name;
+        f.numParams = static_cast<uint32_t>(sig.params.size());
+        f.returnsValue = static_cast<bool>(ret);
+        const auto index = static_cast<uint32_t>(module_.functions.size());
+        module_.functions.push_back(std::move(f));
+        sigs_.push_back(std::move(sig));
+        declare(node.name, node.pos, {Entity::Kind::Func, nullptr, Operand::func(index), index});
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  void beginFunction(uint32_t index) {
+    fn_ = &module_.functions[index];
+    result_ = sigs_[index].result;
+    localSlots_ = 0;
+    scopes_.push();
+  }
+
+  // A function that can fall off its end returns zero there.
+  void endFunction() {
+    if (fn_->size() == 0 || fn_->op.back() != Op::Return)
+      fn_->emit(Op::Return, {}, fn_->returnsValue ? Operand::imm(0) : Operand());
+    scopes_.pop();
+    fn_ = nullptr;
+  }
+
+  void lowerFunction(NodeId decl, uint32_t userIndex) {
+    // User functions come first in Module::functions, in declaration order.
+    beginFunction(userIndex);
+    const Signature& sig = sigs_[userIndex];
+    uint32_t i = 0;
+    for (NodeId p : ast_.kids(ast_.kid(decl, 0))) {
+      Operand v = fn_->newVar(ast_[p].name);
+      declare(ast_[p].name, ast_[p].pos, {Entity::Kind::Var, sig.params[i++], v});
+    }
+    stmt(ast_.kid(decl, 2));
+    endFunction();
+  }
+
+  // ---------------------------------------------------------------------
+  // Statements
+
+  void stmt(NodeId n) {
+    if (depth_ == kMaxNesting) return tooDeep(n);
+    Nested nested(depth_);
+    const Node& node = ast_[n];
+    switch (node.kind) {
+      case NodeKind::Block: {
+        // A block that ends in a block continues in it rather than
+        // recursing, so nesting them does not cost stack.
+        size_t opened = 0;
+        for (NodeId b = n; b;) {
+          scopes_.push();
+          ++opened;
+          Ast::Kids kids = ast_.kids(b);
+          b = NodeId();
+          for (size_t i = 0; i < kids.size(); ++i) {
+            if (i + 1 == kids.size() && ast_[kids[i]].kind == NodeKind::Block) b = kids[i];
+            else stmt(kids[i]);
+          }
+        }
+        while (opened-- > 0) scopes_.pop();
+        break;
+      }
+      case NodeKind::VarDecl:
+        localVar(n);
+        break;
+      case NodeKind::ExprStmt:
+        effect(ast_.kid(n, 0));
+        break;
+      case NodeKind::EmptyStmt:
+        break;
+      case NodeKind::If: {
+        // An else-if chain is walked in a loop; the ends of its arms are
+        // placed innermost first, as nested calls would.
+        const size_t base = ends_.size();
+        for (NodeId i = n; i;) {
+          Operand otherwise = fn_->newLabel();
+          branch(ast_.kid(i, 0), otherwise, false);
+          stmt(ast_.kid(i, 1));
+          NodeId alt = ast_.kid(i, 2);
+          i = NodeId();
+          if (!alt) {
+            fn_->emit(Op::Label, otherwise);
+            break;
+          }
+          ends_.push_back(fn_->newLabel());
+          fn_->emit(Op::Jump, ends_.back());
+          fn_->emit(Op::Label, otherwise);
+          if (ast_[alt].kind == NodeKind::If) i = alt;
+          else stmt(alt);
+        }
+        for (size_t e = ends_.size(); e-- > base;) fn_->emit(Op::Label, ends_[e]);
+        ends_.resize(base);
+        break;
+      }
+      case NodeKind::While: {
+        Operand top = fn_->newLabel(), end = fn_->newLabel();
+        fn_->emit(Op::Label, top);
+        branch(ast_.kid(n, 0), end, false);
+        loopBody(ast_.kid(n, 1), end, top);
+        fn_->emit(Op::Jump, top);
+        fn_->emit(Op::Label, end);
+        break;
+      }
+      case NodeKind::For: {
+        Operand top = fn_->newLabel(), next = fn_->newLabel(), end = fn_->newLabel();
+        if (NodeId init = ast_.kid(n, 0)) effect(init);
+        fn_->emit(Op::Label, top);
+        if (NodeId cond = ast_.kid(n, 1)) branch(cond, end, false);
+        loopBody(ast_.kid(n, 3), end, next);
+        fn_->emit(Op::Label, next);
+        if (NodeId step = ast_.kid(n, 2)) effect(step);
+        fn_->emit(Op::Jump, top);
+        fn_->emit(Op::Label, end);
+        break;
+      }
+      case NodeKind::Switch:
+        switchStmt(n);
+        break;
+      case NodeKind::Break:
+        if (breaks_.empty()) error(node.pos, "'break' outside a loop or switch");
+        else fn_->emit(Op::Jump, breaks_.back());
+        break;
+      case NodeKind::Continue:
+        if (continues_.empty()) error(node.pos, "'continue' outside a loop");
+        else fn_->emit(Op::Jump, continues_.back());
+        break;
+      case NodeKind::Return:
+        returnStmt(n);
+        break;
+      case NodeKind::Print:
+        print(n);
+        break;
+      default:
+        break;
+    }
+  }
+
+  void loopBody(NodeId body, Operand breakTo, Operand continueTo) {
+    breaks_.push_back(breakTo);
+    continues_.push_back(continueTo);
+    stmt(body);
+    breaks_.pop_back();
+    continues_.pop_back();
+  }
+
+  // Counts `slots` more storage into `used`, all the globals' or one
+  // function's locals'. Every slot of it must have an int32 number.
+  void reserve(int64_t& used, uint32_t slots, SourcePos pos) {
+    used += slots;
+    if (used > INT32_MAX && used - slots <= INT32_MAX)
+      error(pos, "storage of {} slots is out of range", {used});
+  }
+
+  void localVar(NodeId n) {
+    const Node& node = ast_[n];
+    const Type* t = resolveType(ast_.kid(n, 0));
+    Operand v = fn_->newVar(node.name, t->size ? t->size : 1);
+    reserve(localSlots_, fn_->vars.back().size, node.pos);
+    Place place{v, Operand(), t};
+    NodeId init = ast_.kid(n, 1);
+    // Declared after the initialiser is lowered, so `var x: int = x;` sees
+    // an outer x.
+    if (init) initialise(place, init, node.pos);
+    else if (t->isScalar()) fn_->emit(Op::Copy, v, Operand::imm(0));
+    declare(node.name, node.pos, {Entity::Kind::Var, t, v});
+  }
+
+  void initialise(const Place& place, NodeId init, SourcePos pos) {
+    if (!place.type->isScalar() && !place.type->isError()) {
+      error(pos, "only int and bool variables can have an initialiser");
+      return;
+    }
+    Value v = value(init);
+    if (!v.type->isError() && !place.type->isError() && !sameType(v.type, place.type)) {
+      error(ast_[init].pos, "cannot initialise {} with {}", {typeName(place.type), typeName(v.type)});
+      return;
+    }
+    store(place, v.op);
+  }
+
+  void switchStmt(NodeId n) {
+    Value subject = value(ast_.kid(n, 0));
+    if (!subject.type->isError() && subject.type->kind != Type::Kind::Int)
+      error(ast_[ast_.kid(n, 0)].pos, "switch needs an int, not {}", {typeName(subject.type)});
+    // The subject is evaluated once; every case compares against it.
+    if (!subject.op.is(Operand::Kind::Var)) {
+      Operand t = fn_->newTemp();
+      fn_->emit(Op::Copy, t, subject.op);
+      subject.op = t;
+    }
+
+    Ast::Kids kids = ast_.kids(n);
+    std::vector<NodeId> clauses(kids.begin() + 1, kids.end());
+    std::vector<Operand> labels;
+    std::unordered_set<int64_t> seen;
+    Operand end = fn_->newLabel(), fallback = end;
+    bool haveDefault = false;
+    for (NodeId c : clauses) {
+      labels.push_back(fn_->newLabel());
+      const Node& clause = ast_[c];
+      if (clause.kind == NodeKind::Default) {
+        if (haveDefault) error(clause.pos, "switch has more than one default");
+        haveDefault = true;
+        fallback = labels.back();
+        continue;
+      }
+      if (!seen.insert(clause.value).second)
+        error(clause.pos, "duplicate case {}", {clause.value});
+      Operand t = fn_->newTemp();
+      fn_->emit(Op::Eq, t, subject.op, module_.constant(clause.value));
+      fn_->emit(Op::JumpIf, labels.back(), t);
+    }
+    fn_->emit(Op::Jump, fallback);
+
+    // Clauses fall through into the next one, as in C.
+    breaks_.push_back(end);
+    for (size_t i = 0; i < clauses.size(); ++i) {
+      fn_->emit(Op::Label, labels[i]);
+      scopes_.push();
+      for (NodeId s : ast_.kids(clauses[i])) stmt(s);
+      scopes_.pop();
+    }
+    breaks_.pop_back();
+    fn_->emit(Op::Label, end);
+  }
+
+  void returnStmt(NodeId n) {
+    const Node& node = ast_[n];
+    NodeId e = ast_.kid(n, 0);
+    if (!e) {
+      if (result_->kind != Type::Kind::Void) {
+        error(node.pos, "missing return value of type {}", {typeName(result_)});
+        fn_->emit(Op::Return, {}, Operand::imm(0));
+      } else {
+        fn_->emit(Op::Return);
+      }
+      return;
+    }
+    Value v = value(e);
+    if (result_->kind == Type::Kind::Void)
+      error(ast_[e].pos, "'{}' does not return a value", {spell(fn_->name)});
+    else if (!v.type->isError() && !result_->isError() && !sameType(v.type, result_))
+      error(ast_[e].pos, "cannot return {} from a function returning {}",
+            {typeName(v.type), typeName(result_)});
+    fn_->emit(Op::Return, {}, v.op);
+  }
+
+  void print(NodeId n) {
+    for (NodeId arg : ast_.kids(n)) {
+      if (ast_[arg].kind == NodeKind::StringLiteral) {
+        fn_->emit(Op::PrintStr, {}, module_.string(decodeString(ast_.text(arg))));
+        continue;
+      }
+      Value v = value(arg);
+      if (v.type->kind == Type::Kind::Bool) fn_->emit(Op::PrintBool, {}, v.op);
+      else fn_->emit(Op::PrintInt, {}, v.op);
+    }
+    fn_->emit(Op::PrintLn);
+  }
+
+  // ---------------------------------------------------------------------
+  // Expressions
+
+  Value bad() const { return {Operand::imm(0), types_.error()}; }
+
+  Operand temp(Op op, Operand a, Operand b = {}) {
+    Operand t = fn_->newTemp();
+    fn_->emit(op, t, a, b);
+    return t;
+  }
+
+  // Evaluates a statement-level expression for its side effects.
+  void effect(NodeId n) {
+    if (ast_[n].kind == NodeKind::Call) call(n, false);
+    else value(n);
+  }
+
+  // Rvalue of a scalar expression; anything else is reported.
+  Value value(NodeId n) {
+    if (depth_ == kMaxNesting) {
+      tooDeep(n);
+      return bad();
+    }
+    Nested nested(depth_);
+    const Node& node = ast_[n];
+    switch (node.kind) {
+      case NodeKind::IntLiteral:
+        return {module_.constant(node.value), types_.intType()};
+      case NodeKind::BoolLiteral:
+        return {Operand::imm(node.value), types_.boolType()};
+      case NodeKind::StringLiteral:
+        error(node.pos, "string literals can only be printed");
+        return bad();
+      case NodeKind::Name:
+      case NodeKind::Index:
+      case NodeKind::Member: {
+        Place p;
+        if (!place(n, p)) return bad();
+        if (p.type->isError()) return bad();
+        if (!p.type->isScalar()) {
+          error(node.pos, "a value of type {} cannot be used here", {typeName(p.type)});
+          return bad();
+        }
+        if (!p.offset) return {p.base, p.type};
+        return {temp(Op::Load, p.base, p.offset), p.type};
+      }
+      case NodeKind::Assign:
+        return assign(n);
+      case NodeKind::Call:
+        return call(n, true);
+      case NodeKind::Unary:
+      case NodeKind::Binary:
+        return isArithmetic(node) ? arithmetic(n) : logical(n);
+      default:
+        return bad();
+    }
+  }
+
+  // A tree of arithmetic operators, operands before the operator as if
+  // each were lowered by a recursive call, on work stacks rather than the
+  // C++ stack, so a long chain or deep nesting of them costs no recursion.
+  // Other operands go through value(), which may come back here.
+  Value arithmetic(NodeId root) {
+    const size_t base = pending_.size();
+    pending_.push_back({root, 0});
+    const size_t valuesBase = values_.size();
+    while (pending_.size() > base) {
+      const NodeId n = pending_.back().n;
+      const bool isUnary = ast_[n].kind == NodeKind::Unary;
+      if (pending_.back().next < (isUnary ? 1u : 2u)) {
+        const NodeId kid = ast_.kid(n, pending_.back().next++);
+        if (isArithmetic(ast_[kid])) pending_.push_back({kid, 0});
+        else values_.push_back(value(kid));
+        continue;
+      }
+      pending_.pop_back();
+      if (isUnary) {
+        values_.back() = unary(n, values_.back());
+      } else {
+        const Value b = values_.back();
+        values_.pop_back();
+        values_.back() = binary(n, values_.back(), b);
+      }
+    }
+    const Value v = values_.back();
+    values_.resize(valuesBase);
+    return v;
+  }
+
+  Value assign(NodeId n) {
+    NodeId target = ast_.kid(n, 0);
+    Place p;
+    if (!place(target, p)) {
+      const NodeKind k = ast_[target].kind;
+      if (k != NodeKind::Name && k != NodeKind::Index && k != NodeKind::Member)
+        error(ast_[n].pos, "left side of '=' cannot be assigned to");
+      value(ast_.kid(n, 1));
+      return bad();
+    }
+    Value v = value(ast_.kid(n, 1));
+    if (p.type->isError() || v.type->isError()) return bad();
+    if (!p.type->isScalar()) {
+      error(ast_[n].pos, "cannot assign a whole {}", {typeName(p.type)});
+      return bad();
+    }
+    if (!sameType(p.type, v.type)) {
+      error(ast_[n].pos, "cannot assign {} to {}", {typeName(v.type), typeName(p.type)});
+      return bad();
+    }
+    store(p, v.op);
+    return {v.op, p.type};
+  }
+
+  void store(const Place& p, Operand v) {
+    if (p.offset) fn_->emit(Op::Store, p.base, p.offset, v);
+    else fn_->emit(Op::Copy, p.base, v);
+  }
+
+  // Resolves an lvalue. Returns false for expressions that do not name
+  // storage, after reporting what was wrong with a name, index or member.
+  bool place(NodeId n, Place& out) {
+    if (depth_ == kMaxNesting) {
+      tooDeep(n);
+      return false;
+    }
+    Nested nested(depth_);
+    const Node& node = ast_[n];
+    switch (node.kind) {
+      case NodeKind::Name: {
+        const Entity* e = scopes_.lookup(node.name);
+        if (!e) {
+          error(node.pos, "undefined name '{}'", {spell(node.name)});
+          return false;
+        }
+        if (e->kind == Entity::Kind::Func || e->kind == Entity::Kind::Type) {
+          error(node.pos, "'{}' is a {}, not a variable",
+                {spell(node.name), e->kind == Entity::Kind::Func ? "function" : "type"});
+          return false;
+        }
+        out = {e->op, Operand(), e->type};
+        return true;
+      }
+      case NodeKind::Index: {
+        Place base;
+        if (!place(ast_.kid(n, 0), base)) {
+          value(ast_.kid(n, 1));
+          return false;
+        }
+        Value index = value(ast_.kid(n, 1));
+        if (base.type->isError()) {
+          out = base;
+          return true;
+        }
+        if (base.type->kind != Type::Kind::Array) {
+          error(node.pos, "cannot index a value of type {}", {typeName(base.type)});
+          return false;
+        }
+        const Type* element = base.type->element;
+        if (!index.type->isError() && index.type->kind != Type::Kind::Int)
+          error(ast_[ast_.kid(n, 1)].pos, "array index must be int, not {}", {typeName(index.type)});
+        if (isConstant(index.op)) {
+          int64_t i = module_.constantValue(index.op);
+          if (i < 0 || i >= base.type->length) {
+            error(ast_[ast_.kid(n, 1)].pos, "index {} is out of bounds for {}",
+                  {i, typeName(base.type)});
+            return false;
+          }
+          out = {base.base, addOffset(base.offset, module_.constant(i * element->size)), element};
+          return true;
+        }
+        Operand scaled = element->size == 1
+                             ? index.op
+                             : temp(Op::Mul, index.op, module_.constant(element->size));
+        out = {base.base, addOffset(base.offset, scaled), element};
+        return true;
+      }
+      case NodeKind::Member: {
+        Place base;
+        if (!place(ast_.kid(n, 0), base)) return false;
+        if (base.type->isError()) {
+          out = base;
+          return true;
+        }
+        const Type::Field* f =
+            base.type->kind == Type::Kind::Record ? base.type->field(node.name) : nullptr;
+        if (!f) {
+          error(node.pos, "{} has no field '{}'", {typeName(base.type), spell(node.name)});
+          return false;
+        }
+        out = {base.base, addOffset(base.offset, module_.constant(f->offset)), f->type};
+        return true;
+      }
+      default:
+        value(n);
+        return false;
+    }
+  }
+
+  static bool isConstant(Operand o) {
+    return o.is(Operand::Kind::Imm) || o.is(Operand::Kind::Const);
+  }
+
+  // offset + delta, folded when both are constants.
+  Operand addOffset(Operand offset, Operand delta) {
+    if (!offset) return delta;
+    if (isConstant(offset) && isConstant(delta))
+      return module_.constant(module_.constantValue(offset) + module_.constantValue(delta));
+    if (isConstant(delta) && module_.constantValue(delta) == 0) return offset;
+    return temp(Op::Add, offset, delta);
+  }
+
+  Value call(NodeId n, bool wantValue) {
+    const Node& node = ast_[n];
+    Ast::Kids kids = ast_.kids(n);
+    std::vector<NodeId> args(kids.begin() + 1, kids.end());
+    const Node& callee = ast_[kids[0]];
+    const Entity* e = callee.kind == NodeKind::Name ? scopes_.lookup(callee.name) : nullptr;
+    if (!e || e->kind != Entity::Kind::Func) {
+      if (callee.kind == NodeKind::Name && !e)
+        error(callee.pos, "undefined name '{}'", {spell(callee.name)});
+      else
+        error(callee.pos, "only functions can be called");
+      for (NodeId a : args) value(a);
+      return bad();
+    }
+    const Signature& sig = sigs_[e->func];
+    const std::string_view name = spell(callee.name);
+    if (args.size() != sig.params.size())
+      error(node.pos, "'{}' takes {} argument{}, not {}",
+            {name, sig.params.size(), sig.params.size() == 1 ? "" : "s", args.size()});
+
+    // Arguments are evaluated first, so nested calls do not interleave
+    // their params with ours.
+    std::vector<Operand> values;
+    for (size_t i = 0; i < args.size(); ++i) {
+      Value v = value(args[i]);
+      if (i < sig.params.size() && !v.type->isError() && !sig.params[i]->isError() &&
+          !sameType(v.type, sig.params[i]))
+        error(ast_[args[i]].pos, "argument {} of '{}' must be {}, not {}",
+              {i + 1, name, typeName(sig.params[i]), typeName(v.type)});
+      values.push_back(v.op);
+    }
+    for (Operand v : values) fn_->emit(Op::Param, {}, v);
+
+    Operand result;
+    if (sig.result->kind != Type::Kind::Void) result = fn_->newTemp();
+    fn_->emit(Op::Call, result, e->op, module_.constant(static_cast<int64_t>(values.size())));
+    if (!wantValue) return bad();
+    if (!result) {
+      error(node.pos, "'{}' does not return a value", {name});
+      return bad();
+    }
+    return {result, sig.result};
+  }
+
+  // `n` applied to its lowered operand.
+  Value unary(NodeId n, Value v) {
+    const Node& node = ast_[n];
+    const bool logical = node.op == TokenKind::exclaim;
+    const Type* want = logical ? types_.boolType() : types_.intType();
+    if (v.type->isError()) return bad();
+    if (!sameType(v.type, want)) {
+      error(node.pos, "operand of {} must be {}, not {}",
+            {tokenSpelling(node.op), typeName(want), typeName(v.type)});
+      return bad();
+    }
+    Op op = logical ? Op::Not : node.op == TokenKind::tilde ? Op::BitNot : Op::Neg;
+    return {temp(op, v.op), want};
+  }
+
+  // && or ||: materialises the jumping code, t = 1 unless it branches to
+  // false.
+  Value logical(NodeId n) {
+    Operand t = fn_->newTemp(), no = fn_->newLabel(), end = fn_->newLabel();
+    branch(n, no, false);
+    fn_->emit(Op::Copy, t, Operand::imm(1));
+    fn_->emit(Op::Jump, end);
+    fn_->emit(Op::Label, no);
+    fn_->emit(Op::Copy, t, Operand::imm(0));
+    fn_->emit(Op::Label, end);
+    return {t, types_.boolType()};
+  }
+
+  // `n` applied to its lowered operands.
+  Value binary(NodeId n, Value a, Value b) {
+    const Node& node = ast_[n];
+    if (a.type->isError() || b.type->isError()) return bad();
+    const Op op = binaryOp(node.op);
+    const bool equality = op == Op::Eq || op == Op::Ne;
+    const bool ok = equality ? a.type->isScalar() && sameType(a.type, b.type)
+                             : a.type->kind == Type::Kind::Int && b.type->kind == Type::Kind::Int;
+    if (!ok) {
+      error(node.pos, "cannot apply {} to {} and {}",
+            {tokenSpelling(node.op), typeName(a.type), typeName(b.type)});
+      return bad();
+    }
+    const Type* t = opShape(op) == OpShape::Compare ? types_.boolType() : types_.intType();
+    return {temp(op, a.op, b.op), t};
+  }
+
+  // Jumping code: goes to `target` when the condition equals `when`, and
+  // falls through otherwise.
+  void branch(NodeId n, Operand target, bool when) {
+    if (depth_ == kMaxNesting) return tooDeep(n);
+    Nested nested(depth_);
+    for (; ast_[n].kind == NodeKind::Unary && ast_[n].op == TokenKind::exclaim; n = ast_.kid(n, 0))
+      when = !when;
+    const Node& node = ast_[n];
+    if (node.kind == NodeKind::Binary &&
+        (node.op == TokenKind::amp_amp || node.op == TokenKind::pipe_pipe)) {
+      const bool isAnd = node.op == TokenKind::amp_amp;
+      NodeId lhs = ast_.kid(n, 0), rhs = ast_.kid(n, 1);
+      if (isAnd != when) {
+        // a && b is false if either is; a || b is true if either is. So a
+        // chain of them, a && b && c, is its operands tested in turn,
+        // collected down the left spine rather than by recursion.
+        const size_t base = tests_.size();
+        tests_.push_back(rhs);
+        for (; ast_[lhs].kind == NodeKind::Binary && ast_[lhs].op == node.op;
+             lhs = ast_.kid(lhs, 0))
+          tests_.push_back(ast_.kid(lhs, 1));
+        branch(lhs, target, when);
+        for (size_t i = tests_.size(); i-- > base;) branch(tests_[i], target, when);
+        tests_.resize(base);
+      } else {
+        Operand skip = fn_->newLabel();
+        branch(lhs, skip, !when);
+        branch(rhs, target, when);
+        fn_->emit(Op::Label, skip);
+      }
+      return;
+    }
+    Value v = value(n);
+    if (!v.type->isError() && v.type->kind != Type::Kind::Bool) {
+      error(node.pos, "condition must be bool, not {}", {typeName(v.type)});
+      return;
+    }
+    if (isConstant(v.op)) {
+      if ((module_.constantValue(v.op) != 0) == when) fn_->emit(Op::Jump, target);
+      return;
+    }
+    fn_->emit(when ? Op::JumpIf : Op::JumpIfNot, target, v.op);
+  }
+
+  const Ast& ast_;
+  Interner& interner_;
+  Diagnostics& diags_;
+  TypeTable types_;
+  ScopeStack<Entity> scopes_;
+  Module module_;
+  std::vector<Signature> sigs_;
+  Function* fn_ = nullptr;
+  const Type* result_ = nullptr;
+  std::vector<Operand> breaks_, continues_;
+  int64_t globalSlots_ = 0;
+  int64_t localSlots_ = 0;  // of fn_
+  uint32_t depth_ = 0;      // recursion, up to kMaxNesting
+  bool tooDeep_ = false;
+  // Work stacks, shared by the nested calls that use them: each takes
+  // what it pushed back off before it returns.
+  std::vector<Pending> pending_;
+  std::vector<Value> values_;
+  std::vector<NodeId> tests_;
+  std::vector<Operand> ends_;
+};
+
+}  // namespace
+
+Module lowerProgram(const Ast& ast, NodeId root, Interner& interner, Diagnostics& diags) {
+  return Lowering(ast, interner, diags).run(root);
+}
+
+}  // namespace byyl
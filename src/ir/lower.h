@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ast/ast.h"
+#include "ir/ir.h"
+#include "support/diagnostics.h"
+#include "support/interner.h"
+
+namespace byyl {
+
+// Type-checks the program and translates it to three-address code in one
+// syntax-directed pass (Dragon Book 6.3-6.7): names resolve through nested
+// scopes, aggregates are addressed as base[slot offset], and conditions
+// become jumping code. Errors go to `diags`; the module is only meaningful
+// when there are none.
+//
+// Top-level declarations are visible throughout the file, except that a
+// type must be declared before it is used. Parameters and results are int
+// or bool, and only scalars can be assigned, passed or printed. A scalar
+// local is zeroed each time its declaration runs; aggregate locals are zero
+// when the function is entered and globals when the program starts.
+Module lowerProgram(const Ast& ast, NodeId root, Interner& interner, Diagnostics& diags);
+
+}  // namespace byyl
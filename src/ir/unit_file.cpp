@@ -0,0 +1,602 @@
+#include "ir/unit_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "support/hash.h"
+
+namespace byyl {
+
+static_assert(sizeof(UnitFileHeader) % 8 == 0, "sections after the header must stay aligned");
+static_assert(sizeof(Node) == 32 && sizeof(Var) == 8 && sizeof(UnitFunction) == 32,
+              "unit file records are the in-memory structs");
+
+namespace {
+
+constexpr uint32_t kNumNodeKinds = 0
+#define BYYL_NODE_COUNT(name) +1
+    BYYL_NODE_KINDS(BYYL_NODE_COUNT)
+#undef BYYL_NODE_COUNT
+    ;
+
+constexpr uint32_t kNumOps = 0
+#define BYYL_IR_COUNT(name, spelling, shape) +1
+    BYYL_IR_OPS(BYYL_IR_COUNT)
+#undef BYYL_IR_COUNT
+    ;
+
+// The kids a node of each kind has, per the layouts in ast.h: `fixed` of
+// them, where the ones whose bit is set in `optional` may be null, then,
+// if `variadic`, any number of non-null ones.
+struct KidSpec {
+  uint8_t fixed;
+  uint8_t optional;
+  bool variadic;
+};
+
+KidSpec kidSpec(NodeKind kind) {
+  switch (kind) {
+    case NodeKind::FuncDecl: return {3, 0b010, false};
+    case NodeKind::VarDecl: return {2, 0b10, false};
+    case NodeKind::If: return {3, 0b100, false};
+    case NodeKind::For: return {4, 0b0111, false};
+    case NodeKind::Return: return {1, 0b1, false};
+    case NodeKind::While:
+    case NodeKind::Assign:
+    case NodeKind::Binary:
+    case NodeKind::Index:
+      return {2, 0, false};
+    case NodeKind::Param:
+    case NodeKind::TypeDecl:
+    case NodeKind::ArrayType:
+    case NodeKind::Field:
+    case NodeKind::ExprStmt:
+    case NodeKind::Unary:
+    case NodeKind::Member:
+      return {1, 0, false};
+    case NodeKind::Switch:
+    case NodeKind::Call:
+      return {1, 0, true};
+    case NodeKind::Program:
+    case NodeKind::RecordType:
+    case NodeKind::Block:
+    case NodeKind::Case:
+    case NodeKind::Default:
+    case NodeKind::Print:
+    case NodeKind::List:
+      return {0, 0, true};
+    default:
+      return {0, 0, false};
+  }
+}
+
+// Kids that lowering takes apart without looking at their kind first.
+bool kidFits(NodeKind parent, uint32_t k, NodeKind kid) {
+  switch (parent) {
+    case NodeKind::FuncDecl: return k != 0 || kid == NodeKind::List;
+    case NodeKind::List: return kid == NodeKind::Param;
+    case NodeKind::RecordType: return kid == NodeKind::Field;
+    default: return true;
+  }
+}
+
+bool isOperator(NodeKind kind, TokenKind op) {
+  switch (op) {
+    case TokenKind::minus:
+      return true;
+    case TokenKind::exclaim:
+    case TokenKind::tilde:
+      return kind == NodeKind::Unary;
+    case TokenKind::plus:
+    case TokenKind::star:
+    case TokenKind::slash:
+    case TokenKind::percent:
+    case TokenKind::less_less:
+    case TokenKind::greater_greater:
+    case TokenKind::amp:
+    case TokenKind::pipe:
+    case TokenKind::caret:
+    case TokenKind::less:
+    case TokenKind::less_equal:
+    case TokenKind::greater:
+    case TokenKind::greater_equal:
+    case TokenKind::equal_equal:
+    case TokenKind::exclaim_equal:
+    case TokenKind::amp_amp:
+    case TokenKind::pipe_pipe:
+      return kind == NodeKind::Binary;
+    default:
+      return false;
+  }
+}
+
+// Appends sections in UnitSection order, each padded to 8 bytes.
+class Writer {
+ public:
+  Writer() : out_(sizeof(UnitFileHeader), '\0') {}
+
+  template <typename T>
+  void add(UnitSection s, const T* data, size_t count) {
+    out_.resize((out_.size() + 7) & ~size_t(7));
+    auto& range = header_.sections[static_cast<int>(s)];
+    range.offset = out_.size();
+    range.bytes = count * sizeof(T);
+    out_.append(reinterpret_cast<const char*>(data), range.bytes);
+  }
+  template <typename T>
+  void add(UnitSection s, const std::vector<T>& v) {
+    add(s, v.data(), v.size());
+  }
+  // Offsets and characters of `strings` in two sections.
+  template <typename Strings>
+  void addStrings(UnitSection offsets, UnitSection chars, const Strings& strings) {
+    std::vector<uint32_t> starts{0};
+    std::string text;
+    for (std::string_view s : strings) {
+      text += s;
+      starts.push_back(static_cast<uint32_t>(text.size()));
+    }
+    add(offsets, starts);
+    add(chars, text.data(), text.size());
+  }
+
+  UnitFileHeader& header() { return header_; }
+  std::string finish() {
+    std::memcpy(header_.magic, kUnitFileMagic, sizeof header_.magic);
+    header_.version = kUnitFileVersion;
+    header_.fileSize = out_.size();
+    header_.checksum = hashBytes(out_.data() + sizeof header_, out_.size() - sizeof header_);
+    std::memcpy(out_.data(), &header_, sizeof header_);
+    return std::move(out_);
+  }
+
+ private:
+  UnitFileHeader header_{};
+  std::string out_;
+};
+
+// Spellings of the strings stored as offsets and characters.
+std::string_view stringAt(const uint32_t* offsets, const char* chars, size_t i) {
+  return {chars + offsets[i], offsets[i + 1] - offsets[i]};
+}
+
+}  // namespace
+
+std::string serializeUnit(std::string_view sourceName, const LineTable& lines,
+                          const Interner& interner, const Ast* ast, NodeId root,
+                          const Module* module) {
+  Writer w;
+  w.add(UnitSection::SourceName, sourceName.data(), sourceName.size());
+  w.add(UnitSection::LineStarts, lines.starts());
+  std::vector<std::string_view> symbols;
+  for (uint32_t id = 1; id <= interner.size(); ++id) symbols.push_back(interner.spelling(Symbol(id)));
+  w.addStrings(UnitSection::SymbolOffsets, UnitSection::SymbolChars, symbols);
+
+  if (ast) {
+    w.header().contents |= kUnitAst;
+    w.header().astRoot = root.id();
+    std::vector<Node> nodes;
+    nodes.reserve(ast->size());
+    for (uint32_t id = 0; id < ast->size(); ++id) nodes.push_back((*ast)[NodeId(id)]);
+    w.add(UnitSection::AstNodes, nodes);
+    w.add(UnitSection::AstKids, ast->allKids());
+    w.addStrings(UnitSection::AstTextOffsets, UnitSection::AstTextChars, ast->texts());
+  }
+
+  if (module) {
+    w.header().contents |= kUnitIr;
+    w.header().initFunction = module->initFunction;
+    w.add(UnitSection::Globals, module->globals);
+    w.add(UnitSection::Constants, module->constants);
+    w.addStrings(UnitSection::StringOffsets, UnitSection::StringChars, module->strings);
+    std::vector<UnitFunction> functions;
+    std::vector<Var> vars;
+    std::vector<Op> ops;
+    std::vector<Operand> results, args1, args2;
+    for (const Function& fn : module->functions) {
+      functions.push_back({fn.name, fn.numParams, fn.returnsValue, fn.numLabels,
+                           static_cast<uint32_t>(vars.size()), static_cast<uint32_t>(fn.vars.size()),
+                           static_cast<uint32_t>(ops.size()), fn.size()});
+      vars.insert(vars.end(), fn.vars.begin(), fn.vars.end());
+      ops.insert(ops.end(), fn.op.begin(), fn.op.end());
+      results.insert(results.end(), fn.result.begin(), fn.result.end());
+      args1.insert(args1.end(), fn.arg1.begin(), fn.arg1.end());
+      args2.insert(args2.end(), fn.arg2.begin(), fn.arg2.end());
+    }
+    w.add(UnitSection::Functions, functions);
+    w.add(UnitSection::Vars, vars);
+    w.add(UnitSection::Ops, ops);
+    w.add(UnitSection::Results, results);
+    w.add(UnitSection::Args1, args1);
+    w.add(UnitSection::Args2, args2);
+  }
+  return w.finish();
+}
+
+std::optional<UnitFile> UnitFile::open(const std::string& path, std::string& error) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    error = std::strerror(errno);
+    return std::nullopt;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    error = std::strerror(errno);
+    ::close(fd);
+    return std::nullopt;
+  }
+  if (!S_ISREG(st.st_mode) || static_cast<size_t>(st.st_size) < sizeof(UnitFileHeader)) {
+    error = "not a unit file";
+    ::close(fd);
+    return std::nullopt;
+  }
+  size_t size = static_cast<size_t>(st.st_size);
+  void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    error = std::strerror(errno);
+    return std::nullopt;
+  }
+  UnitFile file;
+  file.data_ = static_cast<const char*>(addr);
+  file.size_ = size;
+  if (!file.bind(error)) return std::nullopt;
+  return file;
+}
+
+bool UnitFile::isUnitFile(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  char magic[sizeof kUnitFileMagic];
+  const bool is = ::read(fd, magic, sizeof magic) == sizeof magic &&
+                  std::memcmp(magic, kUnitFileMagic, sizeof magic) == 0;
+  ::close(fd);
+  return is;
+}
+
+// Checks the header, the checksum and every section's bounds, then every
+// index the AST and IR hold and the shapes later phases take for granted:
+// the AST is a tree whose nodes have the kids their kinds do, and every
+// quadruple has the operands its op does, so a damaged file cannot send a
+// later phase out of bounds.
+bool UnitFile::bind(std::string& error) {
+  const UnitFileHeader& h = header();
+  if (std::memcmp(h.magic, kUnitFileMagic, sizeof h.magic) != 0) {
+    error = "not a unit file";
+    return false;
+  }
+  if (h.version != kUnitFileVersion) {
+    error = "unit file version " + std::to_string(h.version) + ", expected " +
+            std::to_string(kUnitFileVersion);
+    return false;
+  }
+  if (h.fileSize != size_) {
+    error = "truncated unit file";
+    return false;
+  }
+  if (hashBytes(data_ + sizeof h, size_ - sizeof h) != h.checksum) {
+    error = "unit file checksum mismatch";
+    return false;
+  }
+
+  bool ok = (h.contents & ~(kUnitAst | kUnitIr)) == 0;
+  // A section the unit leaves out is all zero.
+  for (const UnitFileHeader::Range& r : h.sections) {
+    const bool absent = r.offset == 0 && r.bytes == 0;
+    ok = ok && (absent || (r.offset % 8 == 0 && r.offset >= sizeof h && r.offset <= size_ &&
+                           r.bytes <= size_ - r.offset));
+  }
+  const size_t numLines = count<uint32_t>(UnitSection::LineStarts);
+  const uint32_t* starts = section<uint32_t>(UnitSection::LineStarts);
+  ok = ok && numLines > 0 && starts[0] == 0;
+  for (size_t i = 1; ok && i < numLines; ++i) ok = starts[i] > starts[i - 1];
+  ok = ok && validStrings(UnitSection::SymbolOffsets, UnitSection::SymbolChars);
+  ok = ok && (!hasAst() || validAst());
+  ok = ok && (!hasIr() || validIr());
+  if (!ok) {
+    error = "malformed unit file";
+    return false;
+  }
+  return true;
+}
+
+bool UnitFile::validStrings(UnitSection offsets, UnitSection chars) const {
+  const size_t n = count<uint32_t>(offsets);
+  const uint32_t* o = section<uint32_t>(offsets);
+  if (n == 0 || o[0] != 0 || o[n - 1] != count<char>(chars)) return false;
+  for (size_t i = 1; i < n; ++i)
+    if (o[i] < o[i - 1]) return false;
+  return true;
+}
+
+bool UnitFile::validAst() const {
+  const size_t numSymbols = count<uint32_t>(UnitSection::SymbolOffsets) - 1;
+  const size_t numNodes = count<Node>(UnitSection::AstNodes);
+  const size_t numKids = count<NodeId>(UnitSection::AstKids);
+  const size_t textOffsets = count<uint32_t>(UnitSection::AstTextOffsets);
+  if (numNodes == 0 || numNodes > UINT32_MAX || header().astRoot == 0 ||
+      header().astRoot >= numNodes ||
+      !validStrings(UnitSection::AstTextOffsets, UnitSection::AstTextChars))
+    return false;
+  const Node* nodes = section<Node>(UnitSection::AstNodes);
+  for (size_t i = 0; i < numNodes; ++i) {
+    const Node& n = nodes[i];
+    if (static_cast<uint32_t>(n.kind) >= kNumNodeKinds ||
+        static_cast<int>(n.op) >= kNumTokenKinds || n.name.id() > numSymbols ||
+        n.firstKid > numKids || n.numKids > numKids - n.firstKid)
+      return false;
+    if (n.kind == NodeKind::StringLiteral &&
+        (n.value < 0 || static_cast<size_t>(n.value) >= textOffsets - 1))
+      return false;
+  }
+  // Kids are made before their parent and belong to one, so the nodes form
+  // a forest and a walk down from the root ends.
+  const NodeId* kids = section<NodeId>(UnitSection::AstKids);
+  std::vector<bool> hasParent(numNodes);
+  if (nodes[0].numKids != 0 || nodes[header().astRoot].kind != NodeKind::Program) return false;
+  for (uint32_t i = 1; i < numNodes; ++i) {
+    const Node& n = nodes[i];
+    const KidSpec spec = kidSpec(n.kind);
+    if (n.numKids < spec.fixed || (!spec.variadic && n.numKids != spec.fixed)) return false;
+    if ((n.kind == NodeKind::Binary || n.kind == NodeKind::Unary) && !isOperator(n.kind, n.op))
+      return false;
+    for (uint32_t k = 0; k < n.numKids; ++k) {
+      const NodeId kid = kids[n.firstKid + k];
+      if (!kid) {
+        if (k >= spec.fixed || !(spec.optional >> k & 1)) return false;
+        continue;
+      }
+      if (kid.id() >= i || hasParent[kid.id()] || !kidFits(n.kind, k, nodes[kid.id()].kind))
+        return false;
+      hasParent[kid.id()] = true;
+    }
+  }
+  return true;
+}
+
+bool UnitFile::validIr() const {
+  const size_t numSymbols = count<uint32_t>(UnitSection::SymbolOffsets) - 1;
+  const size_t numGlobals = count<Var>(UnitSection::Globals);
+  const size_t numConstants = count<int64_t>(UnitSection::Constants);
+  const size_t numStrings = count<uint32_t>(UnitSection::StringOffsets);
+  const size_t numFunctions = count<UnitFunction>(UnitSection::Functions);
+  const size_t numVars = count<Var>(UnitSection::Vars);
+  const size_t numInsns = count<Op>(UnitSection::Ops);
+  if (!validStrings(UnitSection::StringOffsets, UnitSection::StringChars) ||
+      count<Operand>(UnitSection::Results) != numInsns ||
+      count<Operand>(UnitSection::Args1) != numInsns ||
+      count<Operand>(UnitSection::Args2) != numInsns || header().initFunction < -1 ||
+      header().initFunction >= static_cast<int64_t>(numFunctions))
+    return false;
+  // Sizes are held to what lowering allows, so every slot has an int32
+  // number.
+  const Var* globals = section<Var>(UnitSection::Globals);
+  uint64_t globalSlots = 0;
+  for (size_t i = 0; i < numGlobals; ++i) {
+    if (globals[i].name.id() > numSymbols || globals[i].size == 0) return false;
+    globalSlots += globals[i].size;
+  }
+  if (globalSlots > INT32_MAX) return false;
+  const UnitFunction* functions = section<UnitFunction>(UnitSection::Functions);
+
+  const Var* vars = section<Var>(UnitSection::Vars);
+  const Op* ops = section<Op>(UnitSection::Ops);
+  const Operand* columns[] = {section<Operand>(UnitSection::Results),
+                              section<Operand>(UnitSection::Args1),
+                              section<Operand>(UnitSection::Args2)};
+  std::vector<uint8_t> defined;  // per label of the function
+  for (size_t f = 0; f < numFunctions; ++f) {
+    const UnitFunction& fn = functions[f];
+    // Each label is placed once, so there are no more than quadruples.
+    if (fn.name.id() > numSymbols || fn.numParams > fn.numVars || fn.firstVar > numVars ||
+        fn.numVars > numVars - fn.firstVar || fn.firstInsn > numInsns ||
+        fn.numInsns > numInsns - fn.firstInsn || fn.numLabels > fn.numInsns)
+      return false;
+    uint64_t localSlots = 0;
+    for (uint32_t v = fn.firstVar; v < fn.firstVar + fn.numVars; ++v) {
+      if (vars[v].name.id() > numSymbols || vars[v].size == 0) return false;
+      localSlots += vars[v].size;
+    }
+    if (localSlots > INT32_MAX) return false;
+    auto validOperand = [&](Operand o) {
+      switch (o.kind()) {
+        case Operand::Kind::None:
+        case Operand::Kind::Imm:
+          return true;
+        case Operand::Kind::Var:
+          return o.index() < fn.numVars;
+        case Operand::Kind::Global:
+          return o.index() < numGlobals;
+        case Operand::Kind::Const:
+          return o.index() < numConstants;
+        case Operand::Kind::Label:
+          return o.index() < fn.numLabels;
+        case Operand::Kind::Func:
+          return o.index() < numFunctions;
+        case Operand::Kind::String:
+          return o.index() < numStrings - 1;
+      }
+      return false;
+    };
+    // A scalar operand, and storage a scalar result goes to.
+    auto isPlace = [&](Operand o) {
+      return (o.is(Operand::Kind::Var) && vars[fn.firstVar + o.index()].size == 1) ||
+             (o.is(Operand::Kind::Global) && globals[o.index()].size == 1);
+    };
+    auto isValue = [&](Operand o) {
+      return isPlace(o) || o.is(Operand::Kind::Imm) || o.is(Operand::Kind::Const);
+    };
+    auto isBase = [](Operand o) {
+      return o.is(Operand::Kind::Var) || o.is(Operand::Kind::Global);
+    };
+    auto isLabel = [](Operand o) { return o.is(Operand::Kind::Label); };
+
+    // Lowering puts a call's Params right before it, one per parameter.
+    uint32_t params = 0;
+    defined.assign(fn.numLabels, 0);
+    for (uint32_t i = fn.firstInsn; i < fn.firstInsn + fn.numInsns; ++i) {
+      const Op op = ops[i];
+      if (static_cast<uint32_t>(op) >= kNumOps) return false;
+      for (const Operand* column : columns)
+        if (!validOperand(column[i])) return false;
+      const Operand r = columns[0][i], a = columns[1][i], b = columns[2][i];
+      bool fits = false;
+      switch (opShape(op)) {
+        case OpShape::Binary:
+        case OpShape::Compare:
+          fits = isPlace(r) && isValue(a) && isValue(b);
+          break;
+        case OpShape::Unary:
+          fits = isPlace(r) && isValue(a) && !b;
+          break;
+        case OpShape::Other:
+          switch (op) {
+            case Op::Nop:
+            case Op::PrintLn:
+              fits = !r && !a && !b;
+              break;
+            case Op::Copy:
+              fits = isPlace(r) && isValue(a) && !b;
+              break;
+            case Op::Load:
+              fits = isPlace(r) && isBase(a) && isValue(b);
+              break;
+            case Op::Store:
+              fits = isBase(r) && isValue(a) && isValue(b);
+              break;
+            case Op::Label:
+              fits = isLabel(r) && !a && !b && defined[r.index()]++ == 0;
+              break;
+            case Op::Jump:
+              fits = isLabel(r) && !a && !b;
+              break;
+            case Op::JumpIf:
+            case Op::JumpIfNot:
+              fits = isLabel(r) && isValue(a) && !b;
+              break;
+            case Op::Param:
+              fits = !r && isValue(a) && !b;
+              ++params;
+              break;
+            case Op::Call: {
+              const UnitFunction* callee =
+                  a.is(Operand::Kind::Func) ? &functions[a.index()] : nullptr;
+              fits = callee && (!r || (isPlace(r) && callee->returnsValue)) &&
+                     b.is(Operand::Kind::Imm) && b.immValue() == callee->numParams &&
+                     params == callee->numParams;
+              params = 0;
+              break;
+            }
+            case Op::Return:
+              fits = !r && (fn.returnsValue ? isValue(a) : !a) && !b;
+              break;
+            case Op::PrintInt:
+            case Op::PrintBool:
+              fits = !r && isValue(a) && !b;
+              break;
+            case Op::PrintStr:
+              fits = !r && a.is(Operand::Kind::String) && !b;
+              break;
+            default:
+              break;
+          }
+          break;
+      }
+      if (!fits || (op != Op::Param && op != Op::Call && params != 0)) return false;
+    }
+    // Control never runs off the end, and every label is placed.
+    if (fn.numInsns == 0 || ops[fn.firstInsn + fn.numInsns - 1] != Op::Return) return false;
+    for (uint8_t d : defined)
+      if (d != 1) return false;
+  }
+  return true;
+}
+
+std::string_view UnitFile::sourceName() const {
+  return {section<char>(UnitSection::SourceName), count<char>(UnitSection::SourceName)};
+}
+
+LineTable UnitFile::lines() const {
+  const uint32_t* starts = section<uint32_t>(UnitSection::LineStarts);
+  return LineTable(std::vector<uint32_t>(starts, starts + count<uint32_t>(UnitSection::LineStarts)));
+}
+
+void UnitFile::loadSymbols(Interner& interner) const {
+  const uint32_t* offsets = section<uint32_t>(UnitSection::SymbolOffsets);
+  const char* chars = section<char>(UnitSection::SymbolChars);
+  for (size_t i = 0; i + 1 < count<uint32_t>(UnitSection::SymbolOffsets); ++i)
+    interner.intern(stringAt(offsets, chars, i));
+}
+
+NodeId UnitFile::loadAst(Ast& ast) const {
+  ast.assign(section<Node>(UnitSection::AstNodes),
+             static_cast<uint32_t>(count<Node>(UnitSection::AstNodes)),
+             section<NodeId>(UnitSection::AstKids), count<NodeId>(UnitSection::AstKids));
+  const uint32_t* offsets = section<uint32_t>(UnitSection::AstTextOffsets);
+  const char* chars = section<char>(UnitSection::AstTextChars);
+  for (size_t i = 0; i + 1 < count<uint32_t>(UnitSection::AstTextOffsets); ++i)
+    ast.addText(stringAt(offsets, chars, i));
+  return NodeId(header().astRoot);
+}
+
+Module UnitFile::loadModule() const {
+  Module m;
+  auto copy = [&](auto& out, UnitSection s, size_t first, size_t n) {
+    using T = typename std::remove_reference_t<decltype(out)>::value_type;
+    const T* p = section<T>(s) + first;
+    out.assign(p, p + n);
+  };
+  copy(m.globals, UnitSection::Globals, 0, count<Var>(UnitSection::Globals));
+  copy(m.constants, UnitSection::Constants, 0, count<int64_t>(UnitSection::Constants));
+  const uint32_t* offsets = section<uint32_t>(UnitSection::StringOffsets);
+  const char* chars = section<char>(UnitSection::StringChars);
+  for (size_t i = 0; i + 1 < count<uint32_t>(UnitSection::StringOffsets); ++i)
+    m.strings.emplace_back(stringAt(offsets, chars, i));
+  m.initFunction = header().initFunction;
+
+  const size_t n = count<UnitFunction>(UnitSection::Functions);
+  m.functions.resize(n);
+  for (size_t f = 0; f < n; ++f) {
+    const UnitFunction& u = section<UnitFunction>(UnitSection::Functions)[f];
+    Function& fn = m.functions[f];
+    fn.name = u.name;
+    fn.numParams = u.numParams;
+    fn.returnsValue = u.returnsValue != 0;
+    fn.numLabels = u.numLabels;
+    copy(fn.vars, UnitSection::Vars, u.firstVar, u.numVars);
+    copy(fn.op, UnitSection::Ops, u.firstInsn, u.numInsns);
+    copy(fn.result, UnitSection::Results, u.firstInsn, u.numInsns);
+    copy(fn.arg1, UnitSection::Args1, u.firstInsn, u.numInsns);
+    copy(fn.arg2, UnitSection::Args2, u.firstInsn, u.numInsns);
+  }
+  return m;
+}
+
+UnitFile::UnitFile(UnitFile&& other) noexcept { *this = std::move(other); }
+
+UnitFile& UnitFile::operator=(UnitFile&& other) noexcept {
+  if (this != &other) {
+    release();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+  }
+  return *this;
+}
+
+UnitFile::~UnitFile() { release(); }
+
+void UnitFile::release() {
+  if (data_) ::munmap(const_cast<char*>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+}
+
+}  // namespace byyl
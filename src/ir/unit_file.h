@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "ast/ast.h"
+#include "ir/ir.h"
+#include "support/interner.h"
+#include "support/line_table.h"
+
+namespace byyl {
+
+// Unit file (--emit): a translation unit's front-end output, so the back
+// end can run in another process or reuse it later. It holds the unit's
+// line table and symbols, and its syntax tree, its three-address code, or
+// both. The file
+// is a fixed header followed by flat arrays, each at an 8-aligned byte
+// offset from the start of the file that the header records, so nothing
+// in it is a pointer and a mapped file is read in place. Ast nodes, Vars,
+// ops and operands are stored as their in-memory structs, every function's
+// columns concatenated; loading is a bulk copy of each array. Multi-byte
+// fields are native-endian, like the table files.
+constexpr char kUnitFileMagic[8] = {'B', 'Y', 'Y', 'L', 'U', 'N', 'T', '\0'};
+constexpr uint32_t kUnitFileVersion = 2;
+
+enum class UnitSection : uint32_t {
+  SourceName,      // char[]: the path diagnostics name
+  LineStarts,      // uint32[]: LineTable::starts() of the source
+  SymbolOffsets,   // uint32[symbols + 1]: symbol i's spelling starts at [i - 1]
+  SymbolChars,     // char[]
+  AstNodes,        // Node[], the null node first
+  AstKids,         // NodeId[]
+  AstTextOffsets,  // uint32[texts + 1], into AstTextChars
+  AstTextChars,    // char[]
+  Globals,         // Var[]
+  Constants,       // int64[]
+  StringOffsets,   // uint32[strings + 1], into StringChars
+  StringChars,     // char[]
+  Functions,       // UnitFunction[]
+  Vars,            // Var[], each function's run in turn
+  Ops,             // Op[], likewise
+  Results,         // Operand[], likewise
+  Args1,
+  Args2,
+};
+constexpr int kNumUnitSections = static_cast<int>(UnitSection::Args2) + 1;
+
+struct UnitFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t contents;  // kUnitAst | kUnitIr
+  uint64_t fileSize;
+  uint64_t checksum;  // hashBytes of everything after the header
+  uint32_t astRoot;
+  int32_t initFunction;
+  struct Range {
+    uint64_t offset;  // from the start of the file
+    uint64_t bytes;
+  } sections[kNumUnitSections];
+};
+
+constexpr uint32_t kUnitAst = 1;
+constexpr uint32_t kUnitIr = 2;
+
+// A Function's scalars and where its runs start in the column sections.
+struct UnitFunction {
+  Symbol name;
+  uint32_t numParams;
+  uint32_t returnsValue;
+  uint32_t numLabels;
+  uint32_t firstVar;
+  uint32_t numVars;
+  uint32_t firstInsn;
+  uint32_t numInsns;
+};
+
+// Either part may be left out: `ast` with a null pointer, `module` likewise.
+std::string serializeUnit(std::string_view sourceName, const LineTable& lines,
+                          const Interner& interner, const Ast* ast, NodeId root,
+                          const Module* module);
+
+// A validated unit file, mapped read-only.
+class UnitFile {
+ public:
+  // Maps `path`. Returns nullopt and sets `error` if the file is missing,
+  // corrupt or from another format version.
+  static std::optional<UnitFile> open(const std::string& path, std::string& error);
+  // Whether `path` starts with the unit file magic.
+  static bool isUnitFile(const std::string& path);
+
+  UnitFile(UnitFile&& other) noexcept;
+  UnitFile& operator=(UnitFile&& other) noexcept;
+  UnitFile(const UnitFile&) = delete;
+  UnitFile& operator=(const UnitFile&) = delete;
+  ~UnitFile();
+
+  bool hasAst() const { return header().contents & kUnitAst; }
+  bool hasIr() const { return header().contents & kUnitIr; }
+  std::string_view sourceName() const;
+  // Places the positions in the tree and in diagnostics.
+  LineTable lines() const;
+  size_t size() const { return size_; }
+
+  // Interns the unit's symbols into `interner`, which must be empty, so
+  // they get back the ids the AST and IR refer to.
+  void loadSymbols(Interner& interner) const;
+  // Fills the empty `ast` with the unit's tree and returns its root.
+  NodeId loadAst(Ast& ast) const;
+  Module loadModule() const;
+
+ private:
+  UnitFile() = default;
+  const UnitFileHeader& header() const { return *reinterpret_cast<const UnitFileHeader*>(data_); }
+  template <typename T>
+  const T* section(UnitSection s) const {
+    return reinterpret_cast<const T*>(data_ + header().sections[static_cast<int>(s)].offset);
+  }
+  template <typename T>
+  size_t count(UnitSection s) const {
+    return header().sections[static_cast<int>(s)].bytes / sizeof(T);
+  }
+  bool bind(std::string& error);
+  bool validStrings(UnitSection offsets, UnitSection chars) const;
+  bool validAst() const;
+  bool validIr() const;
+  void release();
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace byyl
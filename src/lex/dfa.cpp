@@ -0,0 +1,223 @@
+#include "lex/dfa.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace byyl::lex {
+
+Dfa::Match Dfa::longestMatch(std::string_view input) const {
+  Match best;
+  int s = start;
+  for (size_t i = 0; i < input.size(); ++i) {
+    s = move(s, static_cast<unsigned char>(input[i]));
+    if (s == kDead) break;
+    if (accept[s] != Nfa::kNoAccept) best = {i + 1, accept[s]};
+  }
+  return best;
+}
+
+int computeByteClasses(const Nfa& nfa, std::array<uint8_t, 256>& byteClass) {
+  std::array<int, 256> cls{};
+  int count = 1;
+  std::vector<ByteSet> seen;
+  for (const auto& st : nfa.states()) {
+    if (st.target < 0) continue;
+    if (std::find(seen.begin(), seen.end(), st.label) != seen.end()) continue;
+    seen.push_back(st.label);
+    // Split every existing class into its members inside and outside the label.
+    std::map<std::pair<int, bool>, int> remap;
+    int next = 0;
+    for (int b = 0; b < 256; ++b) {
+      auto key = std::make_pair(cls[b], static_cast<bool>(st.label.test(b)));
+      auto it = remap.find(key);
+      if (it == remap.end()) it = remap.emplace(key, next++).first;
+      cls[b] = it->second;
+    }
+    count = next;
+  }
+  if (count > 256) throw SpecError("too many byte classes");
+  for (int b = 0; b < 256; ++b) byteClass[b] = static_cast<uint8_t>(cls[b]);
+  return count;
+}
+
+Dfa buildDfa(const Nfa& nfa) {
+  Dfa dfa;
+  dfa.numClasses = computeByteClasses(nfa, dfa.byteClass);
+
+  std::vector<int> repByte(dfa.numClasses, -1);
+  for (int b = 255; b >= 0; --b) repByte[dfa.byteClass[b]] = b;
+
+  const auto& states = nfa.states();
+  std::map<std::vector<int>, int> index;
+  std::vector<std::vector<int>> sets;
+
+  auto intern = [&](std::vector<int> set) {
+    auto it = index.find(set);
+    if (it != index.end()) return it->second;
+    int id = static_cast<int>(sets.size());
+    index.emplace(set, id);
+    sets.push_back(std::move(set));
+    int rule = Nfa::kNoAccept;
+    for (int s : sets.back())
+      if (states[s].accept != Nfa::kNoAccept && (rule == Nfa::kNoAccept || states[s].accept < rule))
+        rule = states[s].accept;
+    dfa.accept.push_back(rule);
+    dfa.next.resize(dfa.next.size() + dfa.numClasses, Dfa::kDead);
+    return id;
+  };
+
+  intern({});  // dead state
+  std::vector<int> startSet{nfa.start()};
+  nfa.closure(startSet);
+  dfa.start = intern(std::move(startSet));
+
+  for (size_t d = 1; d < sets.size(); ++d) {
+    for (int c = 0; c < dfa.numClasses; ++c) {
+      int byte = repByte[c];
+      std::vector<int> moved;
+      for (int s : sets[d])
+        if (states[s].target >= 0 && states[s].label.test(byte)) moved.push_back(states[s].target);
+      if (moved.empty()) continue;
+      nfa.closure(moved);
+      moved.erase(std::unique(moved.begin(), moved.end()), moved.end());
+      int target = intern(std::move(moved));
+      dfa.next[d * dfa.numClasses + c] = target;
+    }
+  }
+  dfa.numStates = static_cast<int>(sets.size());
+  return dfa;
+}
+
+Dfa minimize(const Dfa& dfa) {
+  const int n = dfa.numStates;
+  const int k = dfa.numClasses;
+
+  // Inverse transitions in CSR form: preds of state t on class c are
+  // invList[invStart[c * (n + 1) + t] .. invStart[c * (n + 1) + t + 1]).
+  std::vector<int> invStart(static_cast<size_t>(k) * (n + 1) + 1, 0);
+  for (int s = 0; s < n; ++s)
+    for (int c = 0; c < k; ++c) ++invStart[c * (n + 1) + dfa.next[s * k + c] + 1];
+  for (size_t i = 1; i < invStart.size(); ++i) invStart[i] += invStart[i - 1];
+  std::vector<int> invList(static_cast<size_t>(n) * k);
+  {
+    std::vector<int> fill(invStart.begin(), invStart.end() - 1);
+    for (int s = 0; s < n; ++s)
+      for (int c = 0; c < k; ++c) invList[fill[c * (n + 1) + dfa.next[s * k + c]]++] = s;
+  }
+
+  // Partition: blocks are contiguous ranges of `elems`.
+  std::vector<int> elems(n), loc(n), blockOf(n);
+  std::vector<int> bStart, bEnd, bMark;
+  {
+    std::map<int, std::vector<int>> byAccept;
+    for (int s = 0; s < n; ++s) byAccept[dfa.accept[s]].push_back(s);
+    int pos = 0;
+    for (auto& [rule, members] : byAccept) {
+      int b = static_cast<int>(bStart.size());
+      bStart.push_back(pos);
+      for (int s : members) {
+        elems[pos] = s;
+        loc[s] = pos++;
+        blockOf[s] = b;
+      }
+      bEnd.push_back(pos);
+      bMark.push_back(bStart.back());
+    }
+  }
+
+  std::vector<char> inWork(static_cast<size_t>(n) * k, 0);
+  std::vector<std::pair<int, int>> work;
+  auto pushWork = [&](int b, int c) {
+    if (inWork[static_cast<size_t>(b) * k + c]) return;
+    inWork[static_cast<size_t>(b) * k + c] = 1;
+    work.emplace_back(b, c);
+  };
+  for (size_t b = 0; b < bStart.size(); ++b)
+    for (int c = 0; c < k; ++c) pushWork(static_cast<int>(b), c);
+
+  std::vector<int> splitter, touched;
+  while (!work.empty()) {
+    auto [a, c] = work.back();
+    work.pop_back();
+    inWork[static_cast<size_t>(a) * k + c] = 0;
+
+    splitter.assign(elems.begin() + bStart[a], elems.begin() + bEnd[a]);
+    touched.clear();
+    for (int t : splitter) {
+      for (int i = invStart[c * (n + 1) + t]; i < invStart[c * (n + 1) + t + 1]; ++i) {
+        int s = invList[i];
+        int b = blockOf[s];
+        if (loc[s] < bMark[b]) continue;  // already marked
+        if (bMark[b] == bStart[b]) touched.push_back(b);
+        int other = elems[bMark[b]];
+        std::swap(elems[loc[s]], elems[bMark[b]]);
+        loc[other] = loc[s];
+        loc[s] = bMark[b]++;
+      }
+    }
+
+    for (int b : touched) {
+      if (bMark[b] == bEnd[b]) {
+        bMark[b] = bStart[b];
+        continue;
+      }
+      // Marked prefix becomes a new block z; b keeps the unmarked suffix.
+      int z = static_cast<int>(bStart.size());
+      bStart.push_back(bStart[b]);
+      bEnd.push_back(bMark[b]);
+      bMark.push_back(bStart[b]);
+      bStart[b] = bMark[b];
+      bMark[b] = bStart[b];
+      for (int i = bStart[z]; i < bEnd[z]; ++i) blockOf[elems[i]] = z;
+      for (int cc = 0; cc < k; ++cc) {
+        if (inWork[static_cast<size_t>(b) * k + cc]) {
+          pushWork(z, cc);
+        } else if (bEnd[z] - bStart[z] <= bEnd[b] - bStart[b]) {
+          pushWork(z, cc);
+        } else {
+          pushWork(b, cc);
+        }
+      }
+    }
+  }
+
+  // Renumber: the dead block is 0, the rest breadth-first from the start.
+  const int numBlocks = static_cast<int>(bStart.size());
+  std::vector<int> order(numBlocks, -1);
+  std::vector<int> queue;
+  order[blockOf[Dfa::kDead]] = 0;
+  int nextId = 1;
+  if (order[blockOf[dfa.start]] < 0) {
+    order[blockOf[dfa.start]] = nextId++;
+    queue.push_back(blockOf[dfa.start]);
+  }
+  for (size_t qi = 0; qi < queue.size(); ++qi) {
+    int rep = elems[bStart[queue[qi]]];
+    for (int c = 0; c < k; ++c) {
+      int tb = blockOf[dfa.next[rep * k + c]];
+      if (order[tb] < 0) {
+        order[tb] = nextId++;
+        queue.push_back(tb);
+      }
+    }
+  }
+
+  Dfa out;
+  out.byteClass = dfa.byteClass;
+  out.numClasses = k;
+  out.numStates = nextId;
+  out.start = order[blockOf[dfa.start]];
+  out.next.assign(static_cast<size_t>(nextId) * k, Dfa::kDead);
+  out.accept.assign(nextId, Nfa::kNoAccept);
+  for (int b = 0; b < numBlocks; ++b) {
+    if (order[b] < 0) continue;  // unreachable
+    int rep = elems[bStart[b]];
+    out.accept[order[b]] = dfa.accept[rep];
+    for (int c = 0; c < k; ++c)
+      out.next[order[b] * k + c] = order[blockOf[dfa.next[rep * k + c]]];
+  }
+  return out;
+}
+
+}  // namespace byyl::lex
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "lex/nfa.h"
+
+namespace byyl::lex {
+
+// A complete DFA over byte equivalence classes. State 0 is always the dead
+// state: it is non-accepting and every transition out of it returns to 0, so
+// the scanner can stop as soon as it reads a zero.
+struct Dfa {
+  static constexpr int kDead = 0;
+
+  std::array<uint8_t, 256> byteClass{};
+  int numClasses = 0;
+  int numStates = 0;
+  int start = kDead;
+  std::vector<int> next;    // numStates * numClasses, row-major by state
+  std::vector<int> accept;  // rule index per state, Nfa::kNoAccept if none
+
+  int move(int state, unsigned char byte) const {
+    return next[static_cast<size_t>(state) * numClasses + byteClass[byte]];
+  }
+
+  struct Match {
+    size_t length = 0;
+    int rule = Nfa::kNoAccept;
+  };
+  // Longest-match scan from the start of `input`, as the runtime scanner does.
+  Match longestMatch(std::string_view input) const;
+};
+
+// Partitions the 256 byte values into classes that no NFA label tells apart.
+// Returns the number of classes; `byteClass` maps each byte to its class.
+int computeByteClasses(const Nfa& nfa, std::array<uint8_t, 256>& byteClass);
+
+// Subset construction (Dragon Book 3.7.1).
+Dfa buildDfa(const Nfa& nfa);
+
+// Hopcroft's partition-refinement minimisation. States accepting different
+// rules are never merged. The result is renumbered breadth-first from the
+// start state so that the hot states sit next to each other in the table.
+Dfa minimize(const Dfa& dfa);
+
+}  // namespace byyl::lex
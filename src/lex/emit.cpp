@@ -0,0 +1,163 @@
+#include "lex/emit.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+namespace byyl::lex {
+
+namespace {
+
+constexpr const char* kBanner = "// Generated by byyl-lexgen. Do not edit.\n";
+
+int kindOf(int rule) { return rule == Nfa::kNoAccept ? 0 : rule + kFirstRuleKind; }
+
+std::string cString(const std::string& s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+
+template <typename T>
+void emitArray(std::ostringstream& os, const char* type, const char* name, const std::vector<T>& values) {
+  os << "inline constexpr " << type << ' ' << name << '[' << values.size() << "] = {";
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i % 16 == 0) os << "\n   ";
+    os << ' ' << values[i] << ',';
+  }
+  os << "\n};\n";
+}
+
+const char* stateType(const Dfa& dfa) {
+  return dfa.numStates <= 0x100 ? "uint8_t" : "uint16_t";
+}
+
+}  // namespace
+
+LexerModel buildModel(LexSpec spec) {
+  if (spec.rules.size() + kFirstRuleKind > 0xFF) throw SpecError("too many token rules");
+  LexerModel model;
+  Nfa nfa;
+  std::vector<int> entries;
+  for (size_t i = 0; i < spec.rules.size(); ++i)
+    entries.push_back(nfa.addRule(*spec.rules[i].regex, static_cast<int>(i)));
+  model.dfa = minimize(buildDfa(nfa));
+  if (model.dfa.numStates > 0xFFFF) throw SpecError("lexer DFA exceeds 65535 states");
+  const Dfa& dfa = model.dfa;
+  for (int s = 0; s < dfa.numStates; ++s)
+    if (dfa.move(s, kSentinel) != Dfa::kDead)
+      throw SpecError("a token rule matches the NUL end-of-input sentinel");
+
+  ByteSet hot;
+  for (const auto& name : spec.direct) hot |= nfa.firstBytes(entries[spec.find(name)]);
+  for (int b = 0; b < 256; ++b) {
+    int cls = model.dfa.byteClass[b];
+    if (hot.test(b) && std::find(model.directClasses.begin(), model.directClasses.end(), cls) ==
+                           model.directClasses.end())
+      model.directClasses.push_back(cls);
+  }
+  std::sort(model.directClasses.begin(), model.directClasses.end());
+  model.spec = std::move(spec);
+  return model;
+}
+
+std::string emitTokenKinds(const LexerModel& model) {
+  std::ostringstream os;
+  os << kBanner;
+  os << "// BYYL_TOKEN(name, spelling, flags, message); flags: 1 = skip, 2 = error.\n";
+  os << "BYYL_TOKEN(eof, \"end of file\", 0, \"\")\n";
+  os << "BYYL_TOKEN(error, \"invalid character\", 2, \"unexpected character\")\n";
+  for (const auto& rule : model.spec.rules) {
+    int flags = (rule.skip ? 1 : 0) | (rule.error ? 2 : 0);
+    os << "BYYL_TOKEN(" << rule.name << ", " << cString(rule.spelling) << ", " << flags << ", "
+       << cString(rule.message) << ")\n";
+  }
+  return os.str();
+}
+
+std::string emitTables(const LexerModel& model) {
+  const Dfa& dfa = model.dfa;
+  std::ostringstream os;
+  os << kBanner;
+  os << "// Minimised DFA: " << dfa.numStates << " states x " << dfa.numClasses
+     << " byte classes. State 0 is dead.\n";
+  os << "using LexState = " << stateType(dfa) << ";\n";
+  os << "inline constexpr int kLexNumStates = " << dfa.numStates << ";\n";
+  os << "inline constexpr int kLexNumClasses = " << dfa.numClasses << ";\n";
+  os << "inline constexpr LexState kLexStart = " << dfa.start << ";\n";
+
+  std::vector<int> byteClass(dfa.byteClass.begin(), dfa.byteClass.end());
+  emitArray(os, "uint8_t", "kLexByteClass", byteClass);
+  emitArray(os, "LexState", "kLexNext", dfa.next);
+  std::vector<int> accept;
+  for (int rule : dfa.accept) accept.push_back(kindOf(rule));
+  emitArray(os, "uint8_t", "kLexAccept", accept);
+  return os.str();
+}
+
+std::string emitDirect(const LexerModel& model) {
+  const Dfa& dfa = model.dfa;
+  const int k = dfa.numClasses;
+  std::ostringstream os;
+  os << kBanner;
+  os << "// Direct-coded scanner: one label per DFA state reachable through the\n"
+        "// %direct token classes. Returns the token kind of the longest match at\n"
+        "// `begin`, or 0 when the first byte does not enter this path and the\n"
+        "// table-driven loop must be used instead. The input must be NUL\n"
+        "// terminated: no state has a transition on the sentinel byte.\n";
+  os << "inline uint8_t lexDirect(const unsigned char* begin, size_t& length) {\n";
+  os << "  const unsigned char* p = begin;\n";
+  os << "  const unsigned char* last = nullptr;\n";
+  os << "  uint8_t kind = 0;\n";
+
+  // Reachable states from the direct entry classes.
+  std::vector<int> order;
+  std::vector<char> seen(dfa.numStates, 0);
+  seen[Dfa::kDead] = 1;
+  auto visit = [&](int s) {
+    if (!seen[s]) {
+      seen[s] = 1;
+      order.push_back(s);
+    }
+  };
+  for (int c : model.directClasses) visit(dfa.next[dfa.start * k + c]);
+  for (size_t i = 0; i < order.size(); ++i)
+    for (int c = 0; c < k; ++c) visit(dfa.next[order[i] * k + c]);
+
+  auto emitSwitch = [&](const std::vector<std::pair<int, int>>& arms, const char* fallback) {
+    std::map<int, std::vector<int>> byTarget;
+    for (auto [cls, target] : arms)
+      if (target != Dfa::kDead) byTarget[target].push_back(cls);
+    os << "  switch (kLexByteClass[*p++]) {\n";
+    for (const auto& [target, classes] : byTarget) {
+      os << "   ";
+      for (int cls : classes) os << " case " << cls << ':';
+      os << " goto s" << target << ";\n";
+    }
+    os << "    default: " << fallback << "\n  }\n";
+  };
+
+  std::vector<std::pair<int, int>> entry;
+  for (int c : model.directClasses) entry.emplace_back(c, dfa.next[dfa.start * k + c]);
+  emitSwitch(entry, "return 0;");
+
+  for (int s : order) {
+    os << "s" << s << ":\n";
+    if (dfa.accept[s] != Nfa::kNoAccept)
+      os << "  last = p;\n  kind = " << kindOf(dfa.accept[s]) << ";\n";
+    std::vector<std::pair<int, int>> arms;
+    for (int c = 0; c < k; ++c) arms.emplace_back(c, dfa.next[s * k + c]);
+    emitSwitch(arms, "goto done;");
+  }
+  os << "done:\n";
+  os << "  if (!last) return 0;\n";
+  os << "  length = static_cast<size_t>(last - begin);\n";
+  os << "  return kind;\n";
+  os << "}\n";
+  return os.str();
+}
+
+}  // namespace byyl::lex
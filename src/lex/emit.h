@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+#include "lex/dfa.h"
+#include "lex/spec.h"
+
+namespace byyl::lex {
+
+// Token kind numbering shared by every emitted file: 0 is end of input, 1 is
+// the generic "unexpected character" error, and rule i gets kind i + 2.
+constexpr int kFirstRuleKind = 2;
+
+// The minimised automaton for a specification plus what the emitters need.
+struct LexerModel {
+  LexSpec spec;
+  Dfa dfa;                       // accept[] holds rule indices
+  std::vector<int> directClasses;  // byte classes that enter the direct scanner
+};
+
+LexerModel buildModel(LexSpec spec);
+
+// X-macro list of token kinds: BYYL_TOKEN(name, "spelling", flags, "message").
+std::string emitTokenKinds(const LexerModel& model);
+
+// Dense transition table, byte-class map and accept table as constexpr arrays.
+std::string emitTables(const LexerModel& model);
+
+// Direct-coded (goto per state) scanner for the %direct token classes.
+std::string emitDirect(const LexerModel& model);
+
+}  // namespace byyl::lex
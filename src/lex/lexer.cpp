@@ -0,0 +1,127 @@
+#include "lex/lexer.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace byyl {
+
+namespace {
+#include "lex_tables.inc"
+#include "lex_direct.inc"
+
+const unsigned char* bytes(const char* p) { return reinterpret_cast<const unsigned char*>(p); }
+}  // namespace
+
+Lexer::Lexer(const SourceBuffer& source, Diagnostics& diags, Interner& interner, LexMode mode)
+    : Lexer(source.text(), diags, interner, mode) {}
+
+Lexer::Lexer(std::string_view text, Diagnostics& diags, Interner& interner, LexMode mode)
+    : begin_(text.data()),
+      pos_(text.data()),
+      end_(text.data() + text.size()),
+      diags_(diags),
+      interner_(interner),
+      mode_(mode) {}
+
+void Lexer::seek(size_t offset) { pos_ = begin_ + offset; }
+
+void Lexer::skipTrivia() {
+  while (true) {
+    if (simd::isSpace(*pos_)) {
+      pos_ = simd::skipWhitespace(pos_);
+      continue;
+    }
+    if (*pos_ != '/') return;
+    if (pos_[1] == '/') {
+      pos_ = simd::findLineEnd(pos_ + 2);
+    } else if (pos_[1] == '*') {
+      bool terminated;
+      const char* end = simd::findBlockCommentEnd(pos_ + 2, terminated);
+      if (!terminated) return;  // scanFast reports it as a token
+      pos_ = end;
+    } else {
+      return;
+    }
+  }
+}
+
+size_t Lexer::scanFast(TokenKind& kind) {
+  bool terminated;
+  switch (*pos_) {
+    case '"': {
+      const char* end = simd::findStringEnd(pos_ + 1, terminated);
+      kind = terminated ? TokenKind::string_literal : TokenKind::unterminated_string;
+      return static_cast<size_t>(end - pos_);
+    }
+    case '/':
+      if (pos_[1] == '*') {
+        const char* end = simd::findBlockCommentEnd(pos_ + 2, terminated);
+        kind = TokenKind::unterminated_comment;
+        return static_cast<size_t>(end - pos_);
+      }
+      return 0;
+    default: {
+      size_t length = 0;
+      kind = static_cast<TokenKind>(lexDirect(bytes(pos_), length));
+      return length;
+    }
+  }
+}
+
+size_t Lexer::scanTable(TokenKind& kind) const {
+  LexState s = kLexStart;
+  const unsigned char* p = bytes(pos_);
+  const unsigned char* last = nullptr;
+  uint8_t accepted = 0;
+  while (true) {
+    s = kLexNext[s * kLexNumClasses + kLexByteClass[*p]];
+    if (s == 0) break;
+    ++p;
+    if (kLexAccept[s]) {
+      last = p;
+      accepted = kLexAccept[s];
+    }
+  }
+  kind = static_cast<TokenKind>(accepted);
+  return last ? static_cast<size_t>(last - bytes(pos_)) : 0;
+}
+
+Token Lexer::next() {
+  while (true) {
+    if (mode_ == LexMode::Fast) skipTrivia();
+
+    Token tok;
+    tok.pos.offset = static_cast<uint32_t>(pos_ - begin_);
+    if (pos_ >= end_) {
+      tok.text = std::string_view(end_, 0);
+      return tok;
+    }
+
+    size_t length = mode_ == LexMode::Fast ? scanFast(tok.kind) : 0;
+    if (length == 0) length = scanTable(tok.kind);
+    if (length == 0) {
+      tok.kind = TokenKind::error;
+      length = 1;
+    }
+
+    if (isSkipToken(tok.kind)) {
+      pos_ += length;
+      continue;
+    }
+    tok.text = std::string_view(pos_, length);
+    if (tok.kind == TokenKind::identifier) tok.symbol = interner_.intern(tok.text);
+    pos_ += length;
+    if (const char* msg = tokenErrorMessage(tok.kind)) diags_.error(tok.pos, msg);
+    return tok;
+  }
+}
+
+std::vector<Token> Lexer::tokenize() {
+  std::vector<Token> tokens;
+  do {
+    tokens.push_back(next());
+  } while (tokens.back().kind != TokenKind::eof);
+  return tokens;
+}
+
+}  // namespace byyl
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "lex/simd_scan.h"
+#include "lex/token.h"
+#include "support/diagnostics.h"
+#include "support/interner.h"
+#include "support/source_buffer.h"
+
+namespace byyl {
+
+enum class LexMode {
+  Table,  // reference path: every token, including trivia, runs the table DFA
+  Fast,   // SIMD trivia/string scanning, then the direct-coded DFA, then the table
+};
+
+// Longest-match scanner driven by the tables byyl-lexgen compiled from
+// src/lex/byyl.lex. Skip tokens are dropped; lexical errors are reported to
+// `diags` and returned as error tokens so the caller can keep going.
+//
+// The scanner never copies: token text points into `source`, and the DFA
+// loops rely on the buffer's NUL sentinel instead of checking bounds.
+//
+// In Fast mode whitespace, comments and string literals are recognised by
+// the routines in simd_scan.h instead of the DFA. They mirror the byyl.lex
+// rules for those tokens exactly; Table mode is the reference to diff against.
+class Lexer {
+ public:
+  Lexer(const SourceBuffer& source, Diagnostics& diags, Interner& interner,
+        LexMode mode = LexMode::Fast);
+  // `text` must be followed by SourceBuffer::kPadding NUL bytes.
+  Lexer(std::string_view text, Diagnostics& diags, Interner& interner,
+        LexMode mode = LexMode::Fast);
+
+  // Restarts scanning at byte `offset`, which must not be inside a token or
+  // comment.
+  void seek(size_t offset);
+  // Byte offset of a token returned by next(); eof is at the end of input.
+  size_t offsetOf(const Token& tok) const { return static_cast<size_t>(tok.text.data() - begin_); }
+
+  Token next();
+
+  // Scans the rest of the input; the last token is always eof.
+  std::vector<Token> tokenize();
+
+ private:
+  void skipTrivia();
+  size_t scanFast(TokenKind& kind);
+  size_t scanTable(TokenKind& kind) const;
+
+  const char* begin_;
+  const char* pos_;
+  const char* end_;
+  Diagnostics& diags_;
+  Interner& interner_;
+  LexMode mode_;
+};
+
+}  // namespace byyl
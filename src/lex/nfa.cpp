@@ -0,0 +1,95 @@
+#include "lex/nfa.h"
+
+#include <algorithm>
+
+namespace byyl::lex {
+
+Nfa::Nfa() { start_ = newState(); }
+
+int Nfa::newState() {
+  states_.emplace_back();
+  return static_cast<int>(states_.size()) - 1;
+}
+
+int Nfa::addRule(const Regex& re, int rule) {
+  Fragment frag = build(re);
+  states_[frag.out].accept = rule;
+  states_[start_].eps.push_back(frag.in);
+  return frag.in;
+}
+
+Nfa::Fragment Nfa::build(const Regex& re) {
+  switch (re.kind) {
+    case Regex::Kind::Empty: {
+      int s = newState();
+      return {s, s};
+    }
+    case Regex::Kind::Chars: {
+      int in = newState();
+      int out = newState();
+      states_[in].label = re.chars;
+      states_[in].target = out;
+      return {in, out};
+    }
+    case Regex::Kind::Concat: {
+      Fragment whole = build(*re.kids.front());
+      for (size_t i = 1; i < re.kids.size(); ++i) {
+        Fragment next = build(*re.kids[i]);
+        states_[whole.out].eps.push_back(next.in);
+        whole.out = next.out;
+      }
+      return whole;
+    }
+    case Regex::Kind::Alt: {
+      int in = newState();
+      int out = newState();
+      for (const auto& kid : re.kids) {
+        Fragment f = build(*kid);
+        states_[in].eps.push_back(f.in);
+        states_[f.out].eps.push_back(out);
+      }
+      return {in, out};
+    }
+    case Regex::Kind::Star:
+    case Regex::Kind::Plus:
+    case Regex::Kind::Optional: {
+      int in = newState();
+      int out = newState();
+      Fragment body = build(*re.kids.front());
+      states_[in].eps.push_back(body.in);
+      states_[body.out].eps.push_back(out);
+      if (re.kind != Regex::Kind::Plus) states_[in].eps.push_back(out);
+      if (re.kind != Regex::Kind::Optional) states_[body.out].eps.push_back(body.in);
+      return {in, out};
+    }
+  }
+  throw SpecError("unknown regex node");
+}
+
+void Nfa::closure(std::vector<int>& set) const {
+  std::vector<char> seen(states_.size(), 0);
+  std::vector<int> stack(set.begin(), set.end());
+  for (int s : set) seen[s] = 1;
+  while (!stack.empty()) {
+    int s = stack.back();
+    stack.pop_back();
+    for (int t : states_[s].eps) {
+      if (seen[t]) continue;
+      seen[t] = 1;
+      set.push_back(t);
+      stack.push_back(t);
+    }
+  }
+  std::sort(set.begin(), set.end());
+}
+
+ByteSet Nfa::firstBytes(int entry) const {
+  std::vector<int> set{entry};
+  closure(set);
+  ByteSet bytes;
+  for (int s : set)
+    if (states_[s].target >= 0) bytes |= states_[s].label;
+  return bytes;
+}
+
+}  // namespace byyl::lex
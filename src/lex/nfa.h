@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+
+#include "lex/regex.h"
+
+namespace byyl::lex {
+
+// Thompson NFA (Dragon Book 3.7.4). Every state has at most one labelled
+// transition and any number of epsilon edges; accepting states carry the
+// index of the token rule they recognise, lower index = higher priority.
+class Nfa {
+ public:
+  static constexpr int kNoAccept = -1;
+
+  struct State {
+    ByteSet label;
+    int target = -1;  // destination of the labelled transition, -1 if none
+    std::vector<int> eps;
+    int accept = kNoAccept;
+  };
+
+  Nfa();
+
+  // Adds the fragment for `re` as an alternative of the start state. Returns
+  // the fragment's own entry state.
+  int addRule(const Regex& re, int rule);
+
+  int start() const { return start_; }
+  const std::vector<State>& states() const { return states_; }
+
+  // Sorts and extends `set` to its epsilon closure in place.
+  void closure(std::vector<int>& set) const;
+
+  // Bytes that can begin a match starting at fragment entry `entry`.
+  ByteSet firstBytes(int entry) const;
+
+ private:
+  struct Fragment {
+    int in;
+    int out;
+  };
+
+  int newState();
+  Fragment build(const Regex& re);
+
+  std::vector<State> states_;
+  int start_;
+};
+
+}  // namespace byyl::lex
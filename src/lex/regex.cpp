@@ -0,0 +1,220 @@
+#include "lex/regex.h"
+
+namespace byyl::lex {
+
+namespace {
+
+class RegexParser {
+ public:
+  explicit RegexParser(std::string_view text) : text_(text) {}
+
+  std::unique_ptr<Regex> parse() {
+    auto re = parseAlt();
+    if (pos_ != text_.size()) fail("unexpected '" + std::string(1, text_[pos_]) + "'");
+    return re;
+  }
+
+ private:
+  [[noreturn]] void fail(const std::string& msg) const {
+    throw SpecError("regex '" + std::string(text_) + "': " + msg + " at offset " +
+                    std::to_string(pos_));
+  }
+
+  bool atEnd() const { return pos_ >= text_.size(); }
+  char peek() const { return text_[pos_]; }
+
+  static std::unique_ptr<Regex> make(Regex::Kind kind) {
+    auto re = std::make_unique<Regex>();
+    re->kind = kind;
+    return re;
+  }
+
+  static std::unique_ptr<Regex> single(unsigned char c) {
+    auto re = make(Regex::Kind::Chars);
+    re->chars.set(c);
+    return re;
+  }
+
+  std::unique_ptr<Regex> parseAlt() {
+    auto lhs = parseConcat();
+    if (atEnd() || peek() != '|') return lhs;
+    auto alt = make(Regex::Kind::Alt);
+    alt->kids.push_back(std::move(lhs));
+    while (!atEnd() && peek() == '|') {
+      ++pos_;
+      alt->kids.push_back(parseConcat());
+    }
+    return alt;
+  }
+
+  std::unique_ptr<Regex> parseConcat() {
+    auto cat = make(Regex::Kind::Concat);
+    while (!atEnd() && peek() != '|' && peek() != ')') cat->kids.push_back(parsePostfix());
+    if (cat->kids.empty()) return make(Regex::Kind::Empty);
+    if (cat->kids.size() == 1) return std::move(cat->kids.front());
+    return cat;
+  }
+
+  std::unique_ptr<Regex> parsePostfix() {
+    auto re = parseAtom();
+    while (!atEnd()) {
+      Regex::Kind kind;
+      switch (peek()) {
+        case '*': kind = Regex::Kind::Star; break;
+        case '+': kind = Regex::Kind::Plus; break;
+        case '?': kind = Regex::Kind::Optional; break;
+        default: return re;
+      }
+      ++pos_;
+      auto wrap = make(kind);
+      wrap->kids.push_back(std::move(re));
+      re = std::move(wrap);
+    }
+    return re;
+  }
+
+  std::unique_ptr<Regex> parseAtom() {
+    char c = peek();
+    switch (c) {
+      case '(': {
+        ++pos_;
+        auto re = parseAlt();
+        if (atEnd() || peek() != ')') fail("missing ')'");
+        ++pos_;
+        return re;
+      }
+      case '[':
+        return parseClass();
+      case '"':
+        return parseQuoted();
+      case '.': {
+        ++pos_;
+        auto re = make(Regex::Kind::Chars);
+        re->chars.set();
+        re->chars.reset('\n');
+        re->chars.reset(kSentinel);
+        return re;
+      }
+      case '\\':
+        ++pos_;
+        return single(parseEscape());
+      case '*':
+      case '+':
+      case '?':
+      case ')':
+      case '|':
+        fail("unexpected '" + std::string(1, c) + "'");
+      default:
+        ++pos_;
+        return single(static_cast<unsigned char>(c));
+    }
+  }
+
+  // Called with pos_ just past the backslash.
+  unsigned char parseEscape() {
+    if (atEnd()) fail("dangling escape");
+    char c = text_[pos_++];
+    switch (c) {
+      case 'n': return '\n';
+      case 't': return '\t';
+      case 'r': return '\r';
+      case '0': return '\0';
+      case 'x': {
+        if (pos_ + 2 > text_.size()) fail("truncated \\x escape");
+        int value = 0;
+        for (int i = 0; i < 2; ++i) {
+          char h = text_[pos_++];
+          value <<= 4;
+          if (h >= '0' && h <= '9') value |= h - '0';
+          else if (h >= 'a' && h <= 'f') value |= h - 'a' + 10;
+          else if (h >= 'A' && h <= 'F') value |= h - 'A' + 10;
+          else fail("bad hex digit in \\x escape");
+        }
+        return static_cast<unsigned char>(value);
+      }
+      default:
+        return static_cast<unsigned char>(c);
+    }
+  }
+
+  std::unique_ptr<Regex> parseClass() {
+    ++pos_;  // '['
+    bool negate = !atEnd() && peek() == '^';
+    if (negate) ++pos_;
+    auto re = make(Regex::Kind::Chars);
+    bool first = true;
+    while (true) {
+      if (atEnd()) fail("unterminated character class");
+      if (peek() == ']' && !first) break;
+      first = false;
+      unsigned char lo = classChar();
+      unsigned char hi = lo;
+      if (pos_ + 1 < text_.size() && peek() == '-' && text_[pos_ + 1] != ']') {
+        ++pos_;
+        hi = classChar();
+        if (hi < lo) fail("reversed range in character class");
+      }
+      for (int b = lo; b <= hi; ++b) re->chars.set(b);
+    }
+    ++pos_;  // ']'
+    if (negate) {
+      re->chars.flip();
+      re->chars.reset(kSentinel);
+    }
+    return re;
+  }
+
+  unsigned char classChar() {
+    char c = text_[pos_++];
+    if (c == '\\') return parseEscape();
+    return static_cast<unsigned char>(c);
+  }
+
+  std::unique_ptr<Regex> parseQuoted() {
+    ++pos_;  // opening quote
+    auto cat = make(Regex::Kind::Concat);
+    while (true) {
+      if (atEnd()) fail("unterminated quoted literal");
+      char c = text_[pos_++];
+      if (c == '"') break;
+      cat->kids.push_back(single(c == '\\' ? parseEscape() : static_cast<unsigned char>(c)));
+    }
+    if (cat->kids.empty()) fail("empty quoted literal");
+    if (cat->kids.size() == 1) return std::move(cat->kids.front());
+    return cat;
+  }
+
+  std::string_view text_;
+  size_t pos_ = 0;
+};
+
+bool appendLiteral(const Regex& re, std::string& out) {
+  switch (re.kind) {
+    case Regex::Kind::Chars: {
+      if (re.chars.count() != 1) return false;
+      for (int b = 0; b < 256; ++b)
+        if (re.chars.test(b)) out.push_back(static_cast<char>(b));
+      return true;
+    }
+    case Regex::Kind::Concat:
+      for (const auto& kid : re.kids)
+        if (!appendLiteral(*kid, out)) return false;
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<Regex> parseRegex(std::string_view text) {
+  return RegexParser(text).parse();
+}
+
+LiteralResult literalOf(const Regex& re) {
+  LiteralResult result;
+  result.ok = appendLiteral(re, result.text) && !result.text.empty();
+  return result;
+}
+
+}  // namespace byyl::lex
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <bitset>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace byyl::lex {
+
+using ByteSet = std::bitset<256>;
+
+// The scanner's end-of-input sentinel. `.` and negated classes never match
+// it, so a NUL byte always ends the current token.
+constexpr unsigned char kSentinel = '\0';
+
+// Raised for malformed regular expressions and token specifications. The
+// generators run at build time, so failing loudly is the right behaviour.
+class SpecError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+// Regular expression syntax tree (Dragon Book 3.3). Character classes are
+// folded into a single byte set so the NFA only ever sees set transitions.
+struct Regex {
+  enum class Kind { Empty, Chars, Concat, Alt, Star, Plus, Optional };
+
+  Kind kind = Kind::Empty;
+  ByteSet chars;
+  std::vector<std::unique_ptr<Regex>> kids;
+};
+
+// Parses the lex-style syntax used by token specifications:
+//   "literal"   quoted literal text
+//   [a-z_]      character class, [^...] negated (never includes NUL)
+//   .           any byte except newline and the NUL sentinel
+//   \n \t \xHH  escapes; any other escaped byte stands for itself
+//   a|b  ab  a*  a+  a?  (a)
+std::unique_ptr<Regex> parseRegex(std::string_view text);
+
+// Returns the literal string matched by `re` when it matches exactly one
+// string, or an empty optional-like result (`ok == false`) otherwise.
+struct LiteralResult {
+  bool ok = false;
+  std::string text;
+};
+LiteralResult literalOf(const Regex& re);
+
+}  // namespace byyl::lex
@@ -0,0 +1,167 @@
+#pragma once
+
+// Vectorised scanning of whitespace, comments and string literals, and of
+// newlines for a file's line table.
+//
+// Every routine stops at the first NUL, so callers must pass pointers into a
+// SourceBuffer: blocks are loaded with unaligned loads that may run up to one
+// vector width past the sentinel, which the buffer's padding covers.
+//
+// The implementation is chosen at compile time: AVX2 when the compiler
+// targets it (-mavx2 / -DBYYL_ENABLE_AVX2=ON), otherwise SSE2, which every
+// x86-64 target has. Defining BYYL_NO_SIMD forces the scalar fallback.
+
+#include <cstdint>
+
+#if !defined(BYYL_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define BYYL_SIMD_WIDTH 32
+#elif !defined(BYYL_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define BYYL_SIMD_WIDTH 16
+#else
+#define BYYL_SIMD_WIDTH 0
+#endif
+
+namespace byyl::simd {
+
+#if BYYL_SIMD_WIDTH
+using Mask = uint32_t;
+
+#if BYYL_SIMD_WIDTH == 32
+constexpr Mask kFullMask = 0xFFFFFFFFu;
+struct Block {
+  __m256i v;
+  explicit Block(const char* p) : v(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))) {}
+  Mask eq(char c) const {
+    return static_cast<Mask>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))));
+  }
+};
+#else
+constexpr Mask kFullMask = 0xFFFFu;
+struct Block {
+  __m128i v;
+  explicit Block(const char* p) : v(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+  Mask eq(char c) const {
+    return static_cast<Mask>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c))));
+  }
+};
+#endif
+
+inline unsigned lowestBit(Mask m) { return static_cast<unsigned>(__builtin_ctz(m)); }
+#endif
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+// Skips a run of ' ', '\t', '\r' and '\n'; returns the first other byte.
+inline const char* skipWhitespace(const char* p) {
+#if BYYL_SIMD_WIDTH
+  while (true) {
+    Block b(p);
+    Mask stop = ~(b.eq('\n') | b.eq(' ') | b.eq('\t') | b.eq('\r')) & kFullMask;
+    if (stop) return p + lowestBit(stop);
+    p += BYYL_SIMD_WIDTH;
+  }
+#else
+  while (isSpace(*p)) ++p;
+  return p;
+#endif
+}
+
+// Body of a `//` comment: returns the terminating '\n' or NUL.
+inline const char* findLineEnd(const char* p) {
+#if BYYL_SIMD_WIDTH
+  while (true) {
+    Block b(p);
+    Mask stop = b.eq('\n') | b.eq('\0');
+    if (stop) return p + lowestBit(stop);
+    p += BYYL_SIMD_WIDTH;
+  }
+#else
+  while (*p != '\n' && *p != '\0') ++p;
+  return p;
+#endif
+}
+
+// Body of a `/*` comment, starting just after the opener. Returns the byte
+// after the closing `*/`, or the NUL that ends an unterminated comment with
+// `terminated` set to false.
+inline const char* findBlockCommentEnd(const char* p, bool& terminated) {
+#if BYYL_SIMD_WIDTH
+  while (true) {
+    Block b(p);
+    Mask stop = b.eq('*') | b.eq('\0');
+    while (stop) {
+      unsigned n = lowestBit(stop);
+      if (p[n] == '\0' || p[n + 1] == '/') {
+        terminated = p[n] != '\0';
+        return terminated ? p + n + 2 : p + n;
+      }
+      stop &= stop - 1;
+    }
+    p += BYYL_SIMD_WIDTH;
+  }
+#else
+  for (;; ++p) {
+    if (*p == '\0') {
+      terminated = false;
+      return p;
+    }
+    if (*p == '*' && p[1] == '/') {
+      terminated = true;
+      return p + 2;
+    }
+  }
+#endif
+}
+
+// Body of a string literal, starting just after the opening quote. Returns
+// the byte after the closing quote, or, with `terminated` false, the end of
+// the unterminated literal as the token rules define it: the newline or NUL
+// that cut it off, or just past a backslash that precedes one.
+inline const char* findStringEnd(const char* p, bool& terminated) {
+  while (true) {
+#if BYYL_SIMD_WIDTH
+    Block b(p);
+    Mask stop = b.eq('"') | b.eq('\\') | b.eq('\n') | b.eq('\0');
+    if (!stop) {
+      p += BYYL_SIMD_WIDTH;
+      continue;
+    }
+    p += lowestBit(stop);
+#else
+    while (*p != '"' && *p != '\\' && *p != '\n' && *p != '\0') ++p;
+#endif
+    switch (*p) {
+      case '"':
+        terminated = true;
+        return p + 1;
+      case '\\':
+        if (p[1] == '\n' || p[1] == '\0') {
+          terminated = false;
+          return p + 1;
+        }
+        p += 2;
+        break;
+      default:
+        terminated = false;
+        return p;
+    }
+  }
+}
+
+// Calls `f(p)` for the address of every '\n' in [begin, end), in order.
+// Unlike the routines above it reads nothing outside the range, so it
+// needs no padding.
+template <typename F>
+inline void forEachNewline(const char* begin, const char* end, F&& f) {
+  const char* p = begin;
+#if BYYL_SIMD_WIDTH
+  for (; end - p >= BYYL_SIMD_WIDTH; p += BYYL_SIMD_WIDTH)
+    for (Mask nl = Block(p).eq('\n'); nl; nl &= nl - 1) f(p + lowestBit(nl));
+#endif
+  for (; p < end; ++p)
+    if (*p == '\n') f(p);
+}
+
+}  // namespace byyl::simd
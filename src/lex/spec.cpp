@@ -0,0 +1,101 @@
+#include "lex/spec.h"
+
+#include <cctype>
+
+namespace byyl::lex {
+
+namespace {
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+  while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
+  return s;
+}
+
+// Splits the next whitespace-delimited word off the front of `line`.
+std::string_view takeWord(std::string_view& line) {
+  line = trim(line);
+  size_t n = 0;
+  while (n < line.size() && !std::isspace(static_cast<unsigned char>(line[n]))) ++n;
+  std::string_view word = line.substr(0, n);
+  line.remove_prefix(n);
+  return word;
+}
+
+std::string quoteSpelling(const std::string& text) {
+  std::string out = "'";
+  for (char c : text) {
+    if (c == '\n') out += "\\n";
+    else if (c == '\'' || c == '\\') out += std::string("\\") + c;
+    else out += c;
+  }
+  return out + "'";
+}
+
+}  // namespace
+
+int LexSpec::find(std::string_view name) const {
+  for (size_t i = 0; i < rules.size(); ++i)
+    if (rules[i].name == name) return static_cast<int>(i);
+  return -1;
+}
+
+LexSpec parseSpec(std::string_view text) {
+  LexSpec spec;
+  int lineNo = 0;
+  while (!text.empty()) {
+    size_t eol = text.find('\n');
+    std::string_view line = text.substr(0, eol);
+    text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+    ++lineNo;
+
+    line = trim(line);
+    if (line.empty() || line.front() == '#') continue;
+
+    auto fail = [&](const std::string& msg) {
+      throw SpecError("line " + std::to_string(lineNo) + ": " + msg);
+    };
+
+    TokenRule rule;
+    std::string_view word = takeWord(line);
+    if (word == "%direct") {
+      for (std::string_view name = takeWord(line); !name.empty(); name = takeWord(line))
+        spec.direct.emplace_back(name);
+      continue;
+    }
+    if (word == "%skip") {
+      rule.skip = true;
+      word = takeWord(line);
+    } else if (word == "%error") {
+      rule.error = true;
+      word = takeWord(line);
+      line = trim(line);
+      if (line.empty() || line.front() != '"') fail("%error needs a quoted message");
+      size_t close = line.find('"', 1);
+      if (close == std::string_view::npos) fail("unterminated %error message");
+      rule.message = std::string(line.substr(1, close - 1));
+      line.remove_prefix(close + 1);
+    } else if (!word.empty() && word.front() == '%') {
+      fail("unknown directive " + std::string(word));
+    }
+    if (word.empty()) fail("missing token name");
+    if (spec.find(word) >= 0) fail("duplicate token " + std::string(word));
+    rule.name = std::string(word);
+    rule.pattern = std::string(trim(line));
+    if (rule.pattern.empty()) fail("missing pattern for " + rule.name);
+    try {
+      rule.regex = parseRegex(rule.pattern);
+    } catch (const SpecError& e) {
+      fail(e.what());
+    }
+    LiteralResult lit = literalOf(*rule.regex);
+    rule.spelling = lit.ok ? quoteSpelling(lit.text) : rule.name;
+    spec.rules.push_back(std::move(rule));
+  }
+
+  for (const auto& name : spec.direct)
+    if (spec.find(name) < 0) throw SpecError("%direct names unknown token " + name);
+  return spec;
+}
+
+}  // namespace byyl::lex
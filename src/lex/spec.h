@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lex/regex.h"
+
+namespace byyl::lex {
+
+// One line of a token specification. Rules are tried longest-match first;
+// among equal-length matches the earlier rule wins.
+struct TokenRule {
+  std::string name;
+  std::string pattern;
+  std::unique_ptr<Regex> regex;
+  bool skip = false;      // %skip: matched and discarded (whitespace, comments)
+  bool error = false;     // %error: matched and reported with `message`
+  std::string message;
+  std::string spelling;   // text used in diagnostics, e.g. "'+'" or "identifier"
+};
+
+struct LexSpec {
+  std::vector<TokenRule> rules;
+  std::vector<std::string> direct;  // %direct: rules given a direct-coded path
+
+  // Returns the rule index for `name`, or -1.
+  int find(std::string_view name) const;
+};
+
+// Parses a specification file. Format, one entry per line:
+//   # comment
+//   NAME REGEX
+//   %skip NAME REGEX
+//   %error NAME "message" REGEX
+//   %direct NAME...
+LexSpec parseSpec(std::string_view text);
+
+}  // namespace byyl::lex
@@ -0,0 +1,36 @@
+#include "lex/token.h"
+
+namespace byyl {
+
+namespace {
+
+struct TokenInfo {
+  const char* name;
+  const char* spelling;
+  int flags;
+  const char* message;
+};
+
+constexpr TokenInfo kTokenInfo[] = {
+#define BYYL_TOKEN(name, spelling, flags, message) {#name, spelling, flags, message},
+#include "token_kinds.inc"
+#undef BYYL_TOKEN
+};
+
+constexpr int kSkipFlag = 1;
+constexpr int kErrorFlag = 2;
+
+}  // namespace
+
+const char* tokenName(TokenKind kind) { return kTokenInfo[static_cast<int>(kind)].name; }
+
+const char* tokenSpelling(TokenKind kind) { return kTokenInfo[static_cast<int>(kind)].spelling; }
+
+bool isSkipToken(TokenKind kind) { return kTokenInfo[static_cast<int>(kind)].flags & kSkipFlag; }
+
+const char* tokenErrorMessage(TokenKind kind) {
+  const TokenInfo& info = kTokenInfo[static_cast<int>(kind)];
+  return (info.flags & kErrorFlag) ? info.message : nullptr;
+}
+
+}  // namespace byyl
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "support/interner.h"
+#include "support/line_table.h"
+
+namespace byyl {
+
+// Token kinds come from src/lex/byyl.lex via byyl-lexgen; the enumerator
+// order is the DFA's accept numbering.
+enum class TokenKind : uint8_t {
+#define BYYL_TOKEN(name, spelling, flags, message) name,
+#include "token_kinds.inc"
+#undef BYYL_TOKEN
+};
+
+inline constexpr int kNumTokenKinds = 0
+#define BYYL_TOKEN(name, spelling, flags, message) +1
+#include "token_kinds.inc"
+#undef BYYL_TOKEN
+    ;
+
+// Enumerator name, e.g. "kw_while".
+const char* tokenName(TokenKind kind);
+// Human-readable spelling for diagnostics, e.g. "'while'" or "identifier".
+const char* tokenSpelling(TokenKind kind);
+// True for whitespace/comment kinds the scanner discards.
+bool isSkipToken(TokenKind kind);
+// Non-null for kinds that represent a lexical error.
+const char* tokenErrorMessage(TokenKind kind);
+
+// `text` is a slice of the SourceBuffer the token was scanned from and is
+// valid for as long as that buffer lives; for eof it is empty and sits at
+// the end of the input. Identifiers also carry their
+// interned Symbol; later phases compare that instead of the text.
+struct Token {
+  TokenKind kind = TokenKind::eof;
+  Symbol symbol;
+  std::string_view text;
+  SourcePos pos;
+};
+
+}  // namespace byyl
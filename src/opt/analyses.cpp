@@ -0,0 +1,201 @@
+#include "opt/analyses.h"
+
+#include <map>
+#include <ostream>
+#include <tuple>
+
+#include "opt/ssa.h"
+
+namespace byyl {
+
+namespace {
+
+// The Var instruction `i` writes, if any.
+bool definedVar(const Function& fn, uint32_t i, uint32_t& v) {
+  if (!definesResult(fn.op[i]) || !fn.result[i].is(Operand::Kind::Var)) return false;
+  v = fn.result[i].index();
+  return true;
+}
+
+}  // namespace
+
+DataflowResult liveVariables(const Cfg& cfg) {
+  Function& fn = cfg.fn;
+  GenKillProblem<Direction::Backward, Meet::Union> p(cfg.size(), fn.vars.size());
+  for (uint32_t b = 0; b < cfg.size(); ++b) {
+    const std::vector<uint32_t>& code = cfg.blocks[b].code;
+    // Backwards through the block, so `gen` ends up as the uses no earlier
+    // definition in the block covers.
+    for (size_t k = code.size(); k-- > 0;) {
+      const uint32_t i = code[k];
+      uint32_t v;
+      if (definedVar(fn, i, v)) {
+        p.kill[b].set(v);
+        p.gen[b].reset(v);
+      }
+      forEachUse(fn, i, [&](Operand& o) {
+        if (o.is(Operand::Kind::Var)) p.gen[b].set(o.index());
+      });
+    }
+  }
+  return solveDataflow(cfg, p);
+}
+
+DataflowResult reachingDefinitions(const Cfg& cfg, std::vector<uint32_t>& defs) {
+  const Function& fn = cfg.fn;
+  defs.clear();
+  std::vector<std::vector<uint32_t>> defsOf(fn.vars.size());
+  for (const BasicBlock& block : cfg.blocks)
+    for (uint32_t i : block.code) {
+      uint32_t v;
+      if (!definedVar(fn, i, v)) continue;
+      defsOf[v].push_back(static_cast<uint32_t>(defs.size()));
+      defs.push_back(i);
+    }
+
+  GenKillProblem<Direction::Forward, Meet::Union> p(cfg.size(), defs.size());
+  uint32_t d = 0;
+  for (uint32_t b = 0; b < cfg.size(); ++b)
+    for (uint32_t i : cfg.blocks[b].code) {
+      uint32_t v;
+      if (!definedVar(fn, i, v)) continue;
+      // A definition kills every other one of its variable, including those
+      // the block made earlier.
+      for (uint32_t other : defsOf[v]) {
+        p.kill[b].set(other);
+        p.gen[b].reset(other);
+      }
+      p.gen[b].set(d++);
+    }
+  return solveDataflow(cfg, p);
+}
+
+DataflowResult availableExpressions(const Cfg& cfg, std::vector<Expression>& exprs) {
+  const Function& fn = cfg.fn;
+  exprs.clear();
+  std::map<std::tuple<Op, uint32_t, uint32_t>, uint32_t> index;
+  std::vector<std::vector<uint32_t>> exprsUsing(fn.vars.size());
+  std::vector<uint32_t> exprOf(fn.size(), UINT32_MAX);
+  for (const BasicBlock& block : cfg.blocks)
+    for (uint32_t i : block.code) {
+      const Op op = fn.op[i];
+      const Operand a = fn.arg1[i], b = fn.arg2[i];
+      if (opShape(op) == OpShape::Other || a.is(Operand::Kind::Global) ||
+          b.is(Operand::Kind::Global))
+        continue;
+      auto [it, added] = index.emplace(std::make_tuple(op, a.bits(), b.bits()),
+                                       static_cast<uint32_t>(exprs.size()));
+      exprOf[i] = it->second;
+      if (!added) continue;
+      exprs.push_back({op, a, b});
+      if (a.is(Operand::Kind::Var)) exprsUsing[a.index()].push_back(it->second);
+      if (b.is(Operand::Kind::Var) && b != a) exprsUsing[b.index()].push_back(it->second);
+    }
+
+  GenKillProblem<Direction::Forward, Meet::Intersection> p(cfg.size(), exprs.size());
+  for (uint32_t b = 0; b < cfg.size(); ++b)
+    for (uint32_t i : cfg.blocks[b].code) {
+      if (exprOf[i] != UINT32_MAX) {
+        p.gen[b].set(exprOf[i]);
+        p.kill[b].reset(exprOf[i]);
+      }
+      // Then the result is written, which kills what it was an operand of,
+      // possibly the expression just computed: x = x + 1.
+      uint32_t v;
+      if (!definedVar(fn, i, v)) continue;
+      for (uint32_t e : exprsUsing[v]) {
+        p.kill[b].set(e);
+        p.gen[b].reset(e);
+      }
+    }
+  return solveDataflow(cfg, p);
+}
+
+namespace {
+
+class DataflowPrinter {
+ public:
+  static constexpr uint64_t kMaxBits = uint64_t(1) << 30;
+
+  DataflowPrinter(const Module& m, const Interner& interner, std::ostream& os)
+      : names_(m, interner), os_(os) {}
+
+  void function(Function fn, const Interner& interner) {
+    // The flow graph rewrites its function, so this works on a copy.
+    Cfg cfg(fn);
+    names_.bind(fn);
+    os_ << "\nfn " << interner.spelling(fn.name) << ": " << cfg.size() << " blocks\n";
+    // Four sets per block over up to one fact per instruction: past a few
+    // hundred megabytes, say so instead.
+    if (uint64_t(cfg.size()) * (fn.size() + fn.vars.size()) > kMaxBits) {
+      os_ << "  too large for dense sets\n";
+      return;
+    }
+    std::vector<uint32_t> defs;
+    std::vector<Expression> exprs;
+    const DataflowResult live = liveVariables(cfg);
+    const DataflowResult reach = reachingDefinitions(cfg, defs);
+    const DataflowResult avail = availableExpressions(cfg, exprs);
+
+    std::vector<uint32_t> blockOf(fn.size(), 0);
+    for (uint32_t b = 0; b < cfg.size(); ++b)
+      for (uint32_t i : cfg.blocks[b].code) blockOf[i] = b;
+
+    stats("live variables", live.stats);
+    stats("reaching definitions", reach.stats);
+    stats("available expressions", avail.stats);
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+      const BasicBlock& block = cfg.blocks[b];
+      os_ << "B" << b << ':';
+      for (uint32_t s : block.succs) os_ << " ->B" << s;
+      os_ << '\n';
+      set("live in", live.in[b], [&](size_t v) { names_.print(Operand::var(uint32_t(v)), os_); });
+      set("live out", live.out[b], [&](size_t v) { names_.print(Operand::var(uint32_t(v)), os_); });
+      set("reaching in", reach.in[b], [&](size_t d) {
+        names_.print(fn.result[defs[d]], os_);
+        os_ << "@B" << blockOf[defs[d]];
+      });
+      set("available in", avail.in[b], [&](size_t e) { expression(exprs[e]); });
+    }
+  }
+
+ private:
+  void stats(const char* what, const DataflowStats& s) {
+    os_ << "  " << what << ": " << s.passes << " passes, " << s.visits << " block visits\n";
+  }
+
+  template <typename F>
+  void set(const char* what, const BitSet& bits, F&& item) {
+    os_ << "  " << what << " {";
+    const char* sep = "";
+    bits.forEach([&](size_t i) {
+      os_ << sep;
+      item(i);
+      sep = ", ";
+    });
+    os_ << "}\n";
+  }
+
+  void expression(const Expression& e) {
+    if (opShape(e.op) == OpShape::Unary) {
+      os_ << opSpelling(e.op);
+      names_.print(e.a, os_);
+      return;
+    }
+    names_.print(e.a, os_);
+    os_ << ' ' << opSpelling(e.op) << ' ';
+    names_.print(e.b, os_);
+  }
+
+  OperandPrinter names_;
+  std::ostream& os_;
+};
+
+}  // namespace
+
+void dumpDataflow(const Module& module, const Interner& interner, std::ostream& os) {
+  DataflowPrinter printer(module, interner, os);
+  for (const Function& fn : module.functions) printer.function(fn, interner);
+}
+
+}  // namespace byyl
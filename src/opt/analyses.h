@@ -0,0 +1,37 @@
+#pragma once
+
+#include <iosfwd>
+#include <vector>
+
+#include "ir/ir.h"
+#include "opt/cfg.h"
+#include "opt/dataflow.h"
+
+namespace byyl {
+
+// The classic bit-vector analyses (Dragon Book 9.2) as instances of
+// solveDataflow, over a flow graph that is not in SSA form.
+
+// Live variables; the universe is Function::vars.
+DataflowResult liveVariables(const Cfg& cfg);
+
+// Reaching definitions; the universe is `defs`, filled with the
+// instructions that write a Var, in block order.
+DataflowResult reachingDefinitions(const Cfg& cfg, std::vector<uint32_t>& defs);
+
+struct Expression {
+  Op op;
+  Operand a, b;
+};
+
+// Available expressions; the universe is `exprs`, filled with the distinct
+// Binary, Compare and Unary computations on variables and constants.
+// Computations that read a global are left out, since any store or call
+// may change it.
+DataflowResult availableExpressions(const Cfg& cfg, std::vector<Expression>& exprs);
+
+// Per-block results of all three, with their iteration counts, for
+// --dump-dataflow.
+void dumpDataflow(const Module& module, const Interner& interner, std::ostream& os);
+
+}  // namespace byyl
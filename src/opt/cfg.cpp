@@ -0,0 +1,262 @@
+#include "opt/cfg.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace byyl {
+
+namespace {
+
+constexpr uint32_t kNone = UINT32_MAX;
+
+// How a block of the instruction stream ends, before edges exist.
+struct Exit {
+  enum Kind { Fall, Jump, Branch, Return } kind = Fall;
+  Operand target;  // Jump, Branch
+  bool negated = false;  // Branch on JumpIfNot
+};
+
+}  // namespace
+
+Cfg::Cfg(Function& f) : fn(f) {
+  // Leaders are the first instruction, labels, and whatever follows a jump
+  // or return (Dragon Book algorithm 8.5). The empty entry block keeps loop
+  // headers off block 0.
+  std::vector<uint32_t> labelBlock(fn.numLabels, kNone);
+  std::vector<Exit> exits;
+  blocks.emplace_back();
+  exits.emplace_back();
+  blocks.emplace_back();
+  exits.emplace_back();
+  bool closed = false;  // the current block has its exit
+  for (uint32_t i = 0; i < fn.size(); ++i) {
+    const Op op = fn.op[i];
+    const bool fresh = !closed && blocks.back().code.empty();
+    if ((op == Op::Label && !fresh) || closed) {
+      blocks.emplace_back();
+      exits.emplace_back();
+      closed = false;
+    }
+    Exit& exit = exits.back();
+    switch (op) {
+      case Op::Label:
+        labelBlock[fn.result[i].index()] = size() - 1;
+        break;
+      case Op::Jump:
+        exit = {Exit::Jump, fn.result[i]};
+        closed = true;
+        break;
+      case Op::JumpIf:
+      case Op::JumpIfNot:
+        exit = {Exit::Branch, fn.result[i], op == Op::JumpIfNot};
+        fn.op[i] = Op::JumpIf;
+        blocks.back().code.push_back(i);
+        closed = true;
+        break;
+      case Op::Return:
+        exit.kind = Exit::Return;
+        blocks.back().code.push_back(i);
+        closed = true;
+        break;
+      default:
+        blocks.back().code.push_back(i);
+        break;
+    }
+  }
+
+  for (uint32_t b = 0; b < size(); ++b) {
+    const Exit& exit = exits[b];
+    const uint32_t next = b + 1 < size() ? b + 1 : kNone;
+    std::vector<uint32_t>& succs = blocks[b].succs;
+    switch (exit.kind) {
+      case Exit::Fall:
+        if (next != kNone) succs.push_back(next);
+        break;
+      case Exit::Jump:
+        succs.push_back(labelBlock[exit.target.index()]);
+        break;
+      case Exit::Branch: {
+        const uint32_t target = labelBlock[exit.target.index()];
+        if (target == next) {
+          blocks[b].code.pop_back();
+          succs.push_back(next);
+        } else if (exit.negated) {
+          succs = {next, target};
+        } else {
+          succs = {target, next};
+        }
+        break;
+      }
+      case Exit::Return:
+        break;
+    }
+    for (uint32_t s : succs) blocks[s].preds.push_back(b);
+  }
+  renumber();
+}
+
+uint32_t Cfg::predIndex(uint32_t to, uint32_t from) const {
+  const std::vector<uint32_t>& preds = blocks[to].preds;
+  return static_cast<uint32_t>(std::find(preds.begin(), preds.end(), from) - preds.begin());
+}
+
+void Cfg::removeEdge(uint32_t from, uint32_t to) {
+  BasicBlock& src = blocks[from];
+  BasicBlock& dst = blocks[to];
+  src.succs.erase(std::find(src.succs.begin(), src.succs.end(), to));
+  if (src.succs.size() == 1) src.code.pop_back();
+  const uint32_t k = predIndex(to, from);
+  dst.preds.erase(dst.preds.begin() + k);
+  for (Phi& phi : dst.phis) phi.args.erase(phi.args.begin() + k);
+}
+
+void Cfg::renumber() {
+  // Iterative depth-first search; a block is numbered when its last
+  // successor is done. Successors are searched last first, which puts the
+  // taken side of a branch, the loop body or then-part, right after it.
+  std::vector<uint32_t> post;
+  std::vector<uint8_t> seen(size(), 0);
+  std::vector<std::pair<uint32_t, uint32_t>> stack{{0, 0}};
+  seen[0] = 1;
+  while (!stack.empty()) {
+    auto& [b, next] = stack.back();
+    const std::vector<uint32_t>& succs = blocks[b].succs;
+    if (next < succs.size()) {
+      const uint32_t s = succs[succs.size() - 1 - next++];
+      if (!seen[s]) {
+        seen[s] = 1;
+        stack.push_back({s, 0});
+      }
+      continue;
+    }
+    post.push_back(b);
+    stack.pop_back();
+  }
+
+  std::vector<uint32_t> number(size(), kNone);
+  const auto n = static_cast<uint32_t>(post.size());
+  for (uint32_t i = 0; i < n; ++i) number[post[i]] = n - 1 - i;
+  std::vector<BasicBlock> order(n);
+  for (uint32_t old = 0; old < size(); ++old) {
+    if (number[old] == kNone) continue;
+    BasicBlock& b = order[number[old]];
+    b = std::move(blocks[old]);
+    for (uint32_t& s : b.succs) s = number[s];
+    // Edges from dropped blocks go, with their φ operands.
+    uint32_t kept = 0;
+    for (uint32_t k = 0; k < b.preds.size(); ++k) {
+      if (number[b.preds[k]] == kNone) continue;
+      b.preds[kept] = number[b.preds[k]];
+      for (Phi& phi : b.phis) phi.args[kept] = phi.args[k];
+      ++kept;
+    }
+    b.preds.resize(kept);
+    for (Phi& phi : b.phis) phi.args.resize(kept);
+  }
+  blocks = std::move(order);
+}
+
+void Cfg::splitCriticalEdges() {
+  const uint32_t n = size();
+  bool split = false;
+  for (uint32_t b = 0; b < n; ++b) {
+    if (blocks[b].succs.size() < 2) continue;
+    for (uint32_t k = 0; k < blocks[b].succs.size(); ++k) {
+      const uint32_t s = blocks[b].succs[k];
+      if (blocks[s].preds.size() < 2) continue;
+      const uint32_t m = size();
+      blocks.emplace_back();
+      blocks[m].preds = {b};
+      blocks[m].succs = {s};
+      blocks[b].succs[k] = m;
+      blocks[s].preds[predIndex(s, b)] = m;
+      split = true;
+    }
+  }
+  if (split) renumber();
+}
+
+void Cfg::linearize() {
+  // Empty blocks that only pass control on, such as split edges that got
+  // no copies, are not emitted; edges into them go to where they lead. A
+  // cycle of empty blocks is an infinite loop and stays.
+  auto forwards = [&](uint32_t b) {
+    return blocks[b].code.empty() && blocks[b].succs.size() == 1;
+  };
+  std::vector<uint8_t> skip(size(), 0);
+  for (uint32_t b = 0; b < size(); ++b) {
+    uint32_t end = b;
+    for (uint32_t steps = 0; steps < size() && forwards(end); ++steps) end = blocks[end].succs[0];
+    skip[b] = end != b && !forwards(end);
+  }
+  auto target = [&](uint32_t b) {
+    while (skip[b]) b = blocks[b].succs[0];
+    return b;
+  };
+  std::vector<uint32_t> order;
+  for (uint32_t b = 0; b < size(); ++b)
+    if (!skip[b]) order.push_back(b);
+
+  Function out;
+  std::vector<uint32_t> refs(size(), 0);
+  auto jump = [&](Op op, uint32_t to, Operand cond = {}) {
+    out.emit(op, Operand::label(to), cond);
+    ++refs[to];
+  };
+  if (order.empty() || order[0] != target(0)) jump(Op::Jump, target(0));
+  for (size_t pos = 0; pos < order.size(); ++pos) {
+    const uint32_t b = order[pos];
+    const BasicBlock& block = blocks[b];
+    out.emit(Op::Label, Operand::label(b));
+    const size_t body = block.code.size() - (block.succs.size() == 2 ? 1 : 0);
+    for (size_t k = 0; k < body; ++k) {
+      const uint32_t i = block.code[k];
+      out.emit(fn.op[i], fn.result[i], fn.arg1[i], fn.arg2[i]);
+    }
+    const uint32_t next = pos + 1 < order.size() ? order[pos + 1] : UINT32_MAX;
+    if (block.succs.size() == 1) {
+      const uint32_t to = target(block.succs[0]);
+      if (to != next) jump(Op::Jump, to);
+    } else if (block.succs.size() == 2) {
+      const Operand cond = fn.arg1[block.code.back()];
+      const uint32_t yes = target(block.succs[0]), no = target(block.succs[1]);
+      if (yes == no) {
+        if (yes != next) jump(Op::Jump, yes);
+      } else if (no == next) {
+        jump(Op::JumpIf, yes, cond);
+      } else if (yes == next) {
+        jump(Op::JumpIfNot, no, cond);
+      } else {
+        jump(Op::JumpIf, yes, cond);
+        jump(Op::Jump, no);
+      }
+    } else if (body == 0 || out.op.back() != Op::Return) {
+      out.emit(Op::Return, {}, fn.returnsValue ? Operand::imm(0) : Operand());
+    }
+  }
+
+  // Drop the labels nothing jumps to and number the rest in order.
+  std::vector<uint32_t> label(size(), kNone);
+  uint32_t labels = 0;
+  fn.op.clear();
+  fn.result.clear();
+  fn.arg1.clear();
+  fn.arg2.clear();
+  for (uint32_t i = 0; i < out.size(); ++i) {
+    if (out.op[i] == Op::Label) {
+      const uint32_t b = out.result[i].index();
+      if (!refs[b]) continue;
+      label[b] = labels++;
+    }
+    fn.emit(out.op[i], out.result[i], out.arg1[i], out.arg2[i]);
+  }
+  for (uint32_t i = 0; i < fn.size(); ++i) {
+    const Op op = fn.op[i];
+    if (op == Op::Label || op == Op::Jump || op == Op::JumpIf || op == Op::JumpIfNot)
+      fn.result[i] = Operand::label(label[fn.result[i].index()]);
+  }
+  fn.numLabels = labels;
+  blocks.clear();
+}
+
+}  // namespace byyl
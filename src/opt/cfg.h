@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ir/ir.h"
+
+namespace byyl {
+
+struct Phi {
+  Operand result;
+  uint32_t var;               // the variable it merges, before renaming
+  std::vector<Operand> args;  // one per predecessor, in BasicBlock::preds order
+};
+
+struct BasicBlock {
+  std::vector<uint32_t> code;  // indexes into the function's columns
+  std::vector<Phi> phis;
+  std::vector<uint32_t> preds;
+  // Two when the block ends in `JumpIf c`: taken first, then not taken.
+  std::vector<uint32_t> succs;
+};
+
+// Flow graph of one function (Dragon Book 8.4). Instructions stay in the
+// function's columns and blocks list them by index. Labels and jumps turn
+// into edges, so a block ends in Return with no successors, falls into its
+// only successor, or ends in `JumpIf c` with two. Blocks are numbered in
+// reverse postorder and block 0 is an entry that nothing jumps back to;
+// code the entry cannot reach is dropped.
+struct Cfg {
+  explicit Cfg(Function& fn);
+
+  // Removes the edge and the φ operands it carried. A block left with one
+  // successor loses its branch.
+  void removeEdge(uint32_t from, uint32_t to);
+  // Restores reverse-postorder numbering after edges were removed or added,
+  // dropping blocks the entry no longer reaches.
+  void renumber();
+  // Puts an empty block on every edge from a block with several successors
+  // to one with several predecessors.
+  void splitCriticalEdges();
+  // Writes the blocks back into the function as labelled quadruples, with
+  // jumps only where a block does not fall into its successor. There must be
+  // no φ left.
+  void linearize();
+
+  uint32_t size() const { return static_cast<uint32_t>(blocks.size()); }
+  // Index in `to.preds` of the edge from `from`.
+  uint32_t predIndex(uint32_t to, uint32_t from) const;
+
+  Function& fn;
+  std::vector<BasicBlock> blocks;
+};
+
+}  // namespace byyl
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "opt/cfg.h"
+#include "support/bitset.h"
+
+namespace byyl {
+
+enum class Direction : uint8_t { Forward, Backward };
+enum class Meet : uint8_t { Union, Intersection };
+
+struct DataflowStats {
+  uint32_t passes = 0;  // sweeps over the blocks until nothing changed
+  uint32_t visits = 0;  // transfer functions applied
+};
+
+// IN and OUT of every block (Dragon Book 9.2), as bit sets over the
+// problem's universe.
+struct DataflowResult {
+  std::vector<BitSet> in, out;
+  DataflowStats stats;
+};
+
+// A gen/kill problem: OUT = gen ∪ (IN − kill) forwards, IN = gen ∪ (OUT −
+// kill) backwards. Instances fill `gen` and `kill` per block and give the
+// universe size; the boundary is empty, which is what liveness, reaching
+// definitions and available expressions all want.
+template <Direction D, Meet M>
+struct GenKillProblem {
+  static constexpr Direction kDirection = D;
+  static constexpr Meet kMeet = M;
+
+  GenKillProblem(uint32_t blocks, size_t universe)
+      : universe(universe), gen(blocks, BitSet(universe)), kill(blocks, BitSet(universe)) {}
+
+  // Applies block b's transfer function; true if `to` changed.
+  bool transfer(uint32_t b, const BitSet& from, BitSet& to) const {
+    return to.assignTransfer(gen[b], from, kill[b]);
+  }
+
+  size_t universe;
+  std::vector<BitSet> gen, kill;
+};
+
+// Iterates `problem` to its fixpoint (Dragon Book algorithm 9.25 and its
+// backward twin). Blocks are swept in reverse postorder for forward
+// problems and in postorder for backward ones, so most facts reach a block
+// before it is visited, and a sweep only visits blocks on the worklist:
+// those whose neighbours' sets changed since they were last visited. Sets
+// are packed 64 to a word, so meet and transfer handle 64 facts per
+// operation.
+template <typename Problem>
+DataflowResult solveDataflow(const Cfg& cfg, const Problem& problem) {
+  constexpr bool forward = Problem::kDirection == Direction::Forward;
+  constexpr bool intersect = Problem::kMeet == Meet::Intersection;
+  const uint32_t n = cfg.size();
+  DataflowResult r;
+  // Facts start at the top of the lattice: nothing for a union, everything
+  // for an intersection. The boundary stays empty.
+  BitSet top(problem.universe);
+  if (intersect) top.setAll();
+  r.in.assign(n, top);
+  r.out.assign(n, top);
+
+  BitSet pending(n);
+  pending.setAll();
+  BitSet meet(problem.universe);
+  while (pending.any()) {
+    ++r.stats.passes;
+    for (uint32_t k = 0; k < n; ++k) {
+      const uint32_t b = forward ? k : n - 1 - k;
+      if (!pending.test(b)) continue;
+      pending.reset(b);
+      ++r.stats.visits;
+      const BasicBlock& block = cfg.blocks[b];
+      const std::vector<uint32_t>& from = forward ? block.preds : block.succs;
+      const std::vector<BitSet>& facts = forward ? r.out : r.in;
+      if (from.empty()) {
+        meet.clear();
+      } else {
+        meet.assign(facts[from[0]]);
+        for (size_t i = 1; i < from.size(); ++i) {
+          if (intersect) meet.andWith(facts[from[i]]);
+          else meet.orWith(facts[from[i]]);
+        }
+      }
+      BitSet& before = forward ? r.in[b] : r.out[b];
+      BitSet& after = forward ? r.out[b] : r.in[b];
+      before.assign(meet);
+      if (!problem.transfer(b, before, after)) continue;
+      for (uint32_t next : forward ? block.succs : block.preds) pending.set(next);
+    }
+  }
+  return r;
+}
+
+}  // namespace byyl
@@ -0,0 +1,69 @@
+#include "opt/dominance.h"
+
+namespace byyl {
+
+DominatorTree::DominatorTree(const Cfg& cfg) {
+  constexpr uint32_t kUndefined = UINT32_MAX;
+  const uint32_t n = cfg.size();
+  idom.assign(n, kUndefined);
+  idom[0] = 0;
+  // Reverse-postorder numbers are the block ids, so walking up a finger
+  // means moving to a smaller id.
+  auto intersect = [&](uint32_t a, uint32_t b) {
+    while (a != b) {
+      while (a > b) a = idom[a];
+      while (b > a) b = idom[b];
+    }
+    return a;
+  };
+  for (bool changed = true; changed;) {
+    changed = false;
+    ++sweeps;
+    for (uint32_t b = 1; b < n; ++b) {
+      uint32_t dom = kUndefined;
+      for (uint32_t p : cfg.blocks[b].preds) {
+        if (idom[p] == kUndefined) continue;
+        dom = dom == kUndefined ? p : intersect(p, dom);
+      }
+      if (idom[b] != dom) {
+        idom[b] = dom;
+        changed = true;
+      }
+    }
+  }
+
+  children.assign(n, {});
+  for (uint32_t b = 1; b < n; ++b) children[idom[b]].push_back(b);
+
+  pre.assign(n, 0);
+  span.assign(n, 1);
+  preorder.reserve(n);
+  std::vector<uint32_t> stack{0};
+  while (!stack.empty()) {
+    const uint32_t b = stack.back();
+    stack.pop_back();
+    pre[b] = static_cast<uint32_t>(preorder.size());
+    preorder.push_back(b);
+    for (auto it = children[b].rbegin(); it != children[b].rend(); ++it) stack.push_back(*it);
+  }
+  for (uint32_t i = n; i-- > 1;) {
+    const uint32_t b = preorder[i];
+    span[idom[b]] += span[b];
+  }
+
+  // A join point is in the frontier of every block on its predecessors'
+  // dominator chains up to, but excluding, its own idom.
+  frontier.assign(n, {});
+  for (uint32_t b = 0; b < n; ++b) {
+    const std::vector<uint32_t>& preds = cfg.blocks[b].preds;
+    if (preds.size() < 2) continue;
+    for (uint32_t p : preds) {
+      for (uint32_t runner = p; runner != idom[b]; runner = idom[runner]) {
+        std::vector<uint32_t>& df = frontier[runner];
+        if (df.empty() || df.back() != b) df.push_back(b);
+      }
+    }
+  }
+}
+
+}  // namespace byyl
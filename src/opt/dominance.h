@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "opt/cfg.h"
+
+namespace byyl {
+
+// Dominator tree and dominance frontiers by Cooper, Harvey and Kennedy's
+// iterative algorithm ("A Simple, Fast Dominance Algorithm"). With blocks in
+// reverse postorder, each sweep sets idom(b) to the two-finger intersection
+// of its processed predecessors' dominator chains, and the tree settles in a
+// couple of sweeps without per-block dominator sets.
+struct DominatorTree {
+  explicit DominatorTree(const Cfg& cfg);
+
+  // a dominates b, in constant time from the tree's preorder intervals.
+  bool dominates(uint32_t a, uint32_t b) const {
+    return pre[a] <= pre[b] && pre[b] < pre[a] + span[a];
+  }
+
+  std::vector<uint32_t> idom;  // idom[0] == 0
+  std::vector<std::vector<uint32_t>> children;
+  std::vector<std::vector<uint32_t>> frontier;
+  std::vector<uint32_t> preorder;  // blocks in dominator-tree preorder
+  std::vector<uint32_t> pre;       // position in `preorder`
+  std::vector<uint32_t> span;      // size of the subtree
+  uint32_t sweeps = 0;
+};
+
+}  // namespace byyl
@@ -0,0 +1,164 @@
+#include "opt/gvn.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+#include "opt/ssa.h"
+#include "support/hash.h"
+
+namespace byyl {
+
+namespace {
+
+struct Key {
+  Op op;
+  Operand a, b;
+  friend bool operator==(const Key& x, const Key& y) {
+    return x.op == y.op && x.a == y.a && x.b == y.b;
+  }
+};
+
+struct KeyHash {
+  size_t operator()(const Key& k) const {
+    const uint64_t ab = uint64_t(k.a.bits()) << 32 | k.b.bits();
+    return static_cast<size_t>(hashMix(ab ^ 0x9e3779b97f4a7c15ull, uint64_t(k.op) + 1));
+  }
+};
+
+bool commutative(Op op) {
+  switch (op) {
+    case Op::Add:
+    case Op::Mul:
+    case Op::And:
+    case Op::Or:
+    case Op::Xor:
+    case Op::Eq:
+    case Op::Ne:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool isConstant(Operand o) { return o.is(Operand::Kind::Imm) || o.is(Operand::Kind::Const); }
+
+class ValueNumbering {
+ public:
+  ValueNumbering(Cfg& cfg, const DominatorTree& dom, const Module& module)
+      : cfg_(cfg), fn_(cfg.fn), dom_(dom), module_(module), leader_(fn_.vars.size()) {}
+
+  void run() {
+    std::vector<std::pair<uint32_t, size_t>> todo{{0, SIZE_MAX}};
+    while (!todo.empty()) {
+      const auto [b, logSize] = todo.back();
+      todo.pop_back();
+      if (logSize != SIZE_MAX) {
+        while (log_.size() > logSize) {
+          table_.erase(log_.back());
+          log_.pop_back();
+        }
+        continue;
+      }
+      todo.push_back({b, log_.size()});
+      visit(b);
+      const std::vector<uint32_t>& kids = dom_.children[b];
+      for (auto it = kids.rbegin(); it != kids.rend(); ++it) todo.push_back({*it, SIZE_MAX});
+    }
+  }
+
+ private:
+  // The value an operand stands for: the leader of its SSA value, or the
+  // operand itself.
+  Operand leader(Operand o) const {
+    if (!o.is(Operand::Kind::Var)) return o;
+    const Operand l = leader_[o.index()];
+    return l ? l : o;
+  }
+
+  void visit(uint32_t b) {
+    BasicBlock& block = cfg_.blocks[b];
+    std::vector<Phi> kept;
+    for (Phi& phi : block.phis) {
+      // Back-edge operands are not numbered yet, so leave those as they are.
+      Operand same = phi.args.empty() ? Operand() : leader(phi.args[0]);
+      for (Operand& a : phi.args) {
+        a = leader(a);
+        if (a != same && a != phi.result) same = Operand();
+      }
+      if (same && same != phi.result) {
+        leader_[phi.result.index()] = same;
+        continue;
+      }
+      auto twin = std::find_if(kept.begin(), kept.end(),
+                               [&](const Phi& k) { return k.args == phi.args; });
+      if (twin != kept.end()) {
+        leader_[phi.result.index()] = twin->result;
+        continue;
+      }
+      kept.push_back(std::move(phi));
+    }
+    block.phis = std::move(kept);
+
+    size_t live = 0;
+    for (size_t k = 0; k < block.code.size(); ++k) {
+      const uint32_t i = block.code[k];
+      forEachUse(fn_, i, [&](Operand& o) { o = leader(o); });
+      if (!redundant(i)) block.code[live++] = i;
+    }
+    block.code.resize(live);
+
+    for (uint32_t s : block.succs) {
+      const uint32_t k = cfg_.predIndex(s, b);
+      for (Phi& phi : cfg_.blocks[s].phis) phi.args[k] = leader(phi.args[k]);
+    }
+  }
+
+  // Numbers the value instruction `i` computes; true if an earlier value
+  // already has it, so `i` can go.
+  bool redundant(uint32_t i) {
+    const Op op = fn_.op[i];
+    const Operand result = fn_.result[i];
+    if (!definesResult(op) || op == Op::Load || op == Op::Call || !result.is(Operand::Kind::Var))
+      return false;
+    Operand a = fn_.arg1[i], c = fn_.arg2[i];
+    // Globals can change behind any store or call, so nothing that reads
+    // one is a value.
+    if (a.is(Operand::Kind::Global) || c.is(Operand::Kind::Global)) return false;
+    if (op == Op::Copy) {
+      leader_[result.index()] = a;
+      return true;
+    }
+    int64_t folded;
+    if (isConstant(a) && (opShape(op) == OpShape::Unary || isConstant(c)) &&
+        evaluate(op, module_.constantValue(a), c ? module_.constantValue(c) : 0, folded) &&
+        Operand::fitsImm(folded)) {
+      leader_[result.index()] = Operand::imm(folded);
+      return true;
+    }
+    if (commutative(op) && a.bits() > c.bits()) std::swap(a, c);
+    auto [it, inserted] = table_.emplace(Key{op, a, c}, result);
+    if (!inserted) {
+      leader_[result.index()] = it->second;
+      return true;
+    }
+    log_.push_back(it->first);
+    return false;
+  }
+
+  Cfg& cfg_;
+  Function& fn_;
+  const DominatorTree& dom_;
+  const Module& module_;
+  std::vector<Operand> leader_;  // per SSA value; none if it leads itself
+  std::unordered_map<Key, Operand, KeyHash> table_;
+  std::vector<Key> log_;  // keys added per open block, for scoping
+};
+
+}  // namespace
+
+void numberValues(Cfg& cfg, const DominatorTree& dom, const Module& module) {
+  ValueNumbering(cfg, dom, module).run();
+}
+
+}  // namespace byyl
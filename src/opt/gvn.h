@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ir/ir.h"
+#include "opt/cfg.h"
+#include "opt/dominance.h"
+
+namespace byyl {
+
+// Dominator-based global value numbering over SSA form (Briggs, Cooper and
+// Simpson's DVNT). Blocks are visited in dominator-tree preorder with a
+// scoped hash table of (op, leader, leader) keys, so an expression computed
+// in a dominating block is reused instead of recomputed. Copies are
+// propagated, operands of commutative ops are ordered, constant operands
+// are folded, and φ-functions whose operands all agree, or that repeat an
+// earlier φ of the block, are removed. Loads, calls and reads of globals
+// are never merged.
+void numberValues(Cfg& cfg, const DominatorTree& dom, const Module& module);
+
+}  // namespace byyl
@@ -0,0 +1,124 @@
+#include "opt/optimize.h"
+
+#include <optional>
+#include <vector>
+
+#include "opt/cfg.h"
+#include "opt/dominance.h"
+#include "opt/gvn.h"
+#include "opt/sccp.h"
+#include "opt/ssa.h"
+#include "support/profile.h"
+#include "support/thread_pool.h"
+
+namespace byyl {
+
+namespace {
+
+// Division and remainder by zero fail at run time, so they only go when
+// the divisor is a nonzero constant.
+bool removable(const Function& fn, const Module& module, uint32_t i) {
+  const Op op = fn.op[i];
+  if (!definesResult(op) || op == Op::Call || !fn.result[i].is(Operand::Kind::Var)) return false;
+  if (op != Op::Div && op != Op::Rem) return true;
+  const Operand d = fn.arg2[i];
+  return (d.is(Operand::Kind::Imm) || d.is(Operand::Kind::Const)) && module.constantValue(d) != 0;
+}
+
+// Deletes SSA values nothing reads, and then the values only they read.
+void removeDeadCode(Cfg& cfg, const Module& module) {
+  Function& fn = cfg.fn;
+  std::vector<uint32_t> uses(fn.vars.size(), 0);
+  auto count = [&](Operand o, int delta) {
+    if (o.is(Operand::Kind::Var)) uses[o.index()] += delta;
+  };
+  for (const BasicBlock& b : cfg.blocks) {
+    for (const Phi& phi : b.phis)
+      for (Operand a : phi.args) count(a, 1);
+    for (uint32_t i : b.code) forEachUse(fn, i, [&](Operand& o) { count(o, 1); });
+  }
+
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (BasicBlock& b : cfg.blocks) {
+      size_t kept = 0;
+      for (size_t k = b.code.size(); k-- > 0;) {
+        const uint32_t i = b.code[k];
+        if (removable(fn, module, i) && uses[fn.result[i].index()] == 0) {
+          forEachUse(fn, i, [&](Operand& o) { count(o, -1); });
+          b.code[k] = UINT32_MAX;
+          changed = true;
+        }
+      }
+      for (uint32_t i : b.code)
+        if (i != UINT32_MAX) b.code[kept++] = i;
+      b.code.resize(kept);
+      for (size_t k = 0; k < b.phis.size();) {
+        Phi& phi = b.phis[k];
+        uint32_t self = 0;
+        for (Operand a : phi.args) self += a == phi.result;
+        if (uses[phi.result.index()] != self) {
+          ++k;
+          continue;
+        }
+        for (Operand a : phi.args) count(a, -1);
+        b.phis.erase(b.phis.begin() + static_cast<long>(k));
+        changed = true;
+      }
+    }
+  }
+}
+
+// Renumbers the variables still in use, parameters first, so SSA leaves no
+// gaps behind.
+void compactVars(Function& fn) {
+  constexpr uint32_t kUnused = UINT32_MAX;
+  std::vector<uint32_t> number(fn.vars.size(), kUnused);
+  std::vector<Var> vars;
+  auto keep = [&](uint32_t v) {
+    if (number[v] != kUnused) return;
+    number[v] = static_cast<uint32_t>(vars.size());
+    vars.push_back(fn.vars[v]);
+  };
+  for (uint32_t v = 0; v < fn.numParams; ++v) keep(v);
+  auto rename = [&](Operand& o) {
+    if (!o.is(Operand::Kind::Var)) return;
+    keep(o.index());
+    o = Operand::var(number[o.index()]);
+  };
+  for (uint32_t i = 0; i < fn.size(); ++i) {
+    rename(fn.result[i]);
+    rename(fn.arg1[i]);
+    rename(fn.arg2[i]);
+  }
+  fn.vars = std::move(vars);
+}
+
+}  // namespace
+
+void optimizeFunction(Function& fn, const Module& module, Profile* profile) {
+  auto phase = [&](const char* name, auto&& step) {
+    ProfileScope scope(profile, name);
+    step();
+  };
+  std::optional<Cfg> cfg;
+  phase("cfg", [&] { cfg.emplace(fn); });
+  phase("ssa", [&] { buildSsa(*cfg, DominatorTree(*cfg)); });
+  phase("sccp", [&] { propagateConstants(*cfg, module); });
+  phase("gvn", [&] { numberValues(*cfg, DominatorTree(*cfg), module); });
+  phase("dce", [&] { removeDeadCode(*cfg, module); });
+  phase("out of ssa", [&] {
+    destroySsa(*cfg);
+    cfg->linearize();
+    compactVars(fn);
+  });
+}
+
+void optimize(Module& module, Profile* profile, ThreadPool* pool) {
+  ProfileScope scope(profile, "optimize");
+  Profile* const phases = pool ? nullptr : profile;
+  parallelFor(pool, module.functions.size(),
+              [&](size_t f) { optimizeFunction(module.functions[f], module, phases); });
+}
+
+}  // namespace byyl
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "ir/ir.h"
+
+namespace byyl {
+
+class Profile;
+class ThreadPool;
+
+// The -O pipeline for one function: build the flow graph, go into SSA form,
+// propagate constants, number values, delete dead code, and come back out.
+// Each step is a phase of `profile`, if given.
+void optimizeFunction(Function& fn, const Module& module, Profile* profile = nullptr);
+// Every function, on `pool` if given: a function's pipeline reads only its
+// own body and the module's constants, so functions optimize independently
+// and the result does not depend on how they were scheduled. A Profile
+// records one thread's phases, so on a pool only the whole pass is timed.
+void optimize(Module& module, Profile* profile = nullptr, ThreadPool* pool = nullptr);
+
+}  // namespace byyl
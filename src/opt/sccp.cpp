@@ -0,0 +1,215 @@
+#include "opt/sccp.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "opt/ssa.h"
+
+namespace byyl {
+
+namespace {
+
+enum class Level : uint8_t { Unknown, Constant, Varies };
+
+struct Lattice {
+  Level level = Level::Unknown;
+  int64_t value = 0;
+};
+
+// Where an SSA value is read: instruction `index` of `block`, or its φ
+// number `index` when `phi` is set.
+struct Use {
+  uint32_t block;
+  uint32_t index;
+  bool phi;
+};
+
+class Propagator {
+ public:
+  Propagator(Cfg& cfg, const Module& module)
+      : cfg_(cfg), fn_(cfg.fn), module_(module), values_(fn_.vars.size()),
+        uses_(fn_.vars.size()), defined_(fn_.vars.size(), 0),
+        reached_(cfg.size(), 0), executable_(cfg.size()) {}
+
+  bool run() {
+    buildChains();
+    for (size_t b = 0; b < cfg_.size(); ++b) executable_[b].assign(cfg_.blocks[b].preds.size(), 0);
+    reach(0);
+    while (!edges_.empty() || !changed_.empty()) {
+      while (!edges_.empty()) {
+        auto [from, to] = edges_.back();
+        edges_.pop_back();
+        takeEdge(from, to);
+      }
+      while (!changed_.empty()) {
+        const uint32_t v = changed_.back();
+        changed_.pop_back();
+        for (const Use& u : uses_[v]) {
+          if (!reached_[u.block]) continue;
+          if (u.phi) visitPhi(u.block, cfg_.blocks[u.block].phis[u.index]);
+          else visit(u.block, u.index);
+        }
+      }
+    }
+    return rewrite();
+  }
+
+ private:
+  void buildChains() {
+    for (uint32_t b = 0; b < cfg_.size(); ++b) {
+      BasicBlock& block = cfg_.blocks[b];
+      for (uint32_t k = 0; k < block.phis.size(); ++k) {
+        defined_[block.phis[k].result.index()] = 1;
+        for (Operand a : block.phis[k].args)
+          if (a.is(Operand::Kind::Var)) uses_[a.index()].push_back({b, k, true});
+      }
+      for (uint32_t k = 0; k < block.code.size(); ++k) {
+        const uint32_t i = block.code[k];
+        forEachUse(fn_, i, [&](Operand& o) {
+          if (o.is(Operand::Kind::Var)) uses_[o.index()].push_back({b, k, false});
+        });
+        if (definesResult(fn_.op[i]) && fn_.result[i].is(Operand::Kind::Var))
+          defined_[fn_.result[i].index()] = 1;
+      }
+    }
+  }
+
+  // Parameters and variables kept in memory are not SSA values and vary.
+  Lattice valueOf(Operand o) const {
+    if (o.is(Operand::Kind::Imm) || o.is(Operand::Kind::Const))
+      return {Level::Constant, module_.constantValue(o)};
+    if (o.is(Operand::Kind::Var) && defined_[o.index()]) return values_[o.index()];
+    return {Level::Varies, 0};
+  }
+
+  // Moves `var` down the lattice to meet(current, to).
+  void lower(Operand var, Lattice to) {
+    Lattice& cur = values_[var.index()];
+    if (cur.level == Level::Varies || to.level == Level::Unknown) return;
+    if (cur.level == Level::Constant) {
+      if (to.level == Level::Constant && to.value == cur.value) return;
+      to.level = Level::Varies;
+    }
+    cur = to;
+    changed_.push_back(var.index());
+  }
+
+  void reach(uint32_t b) {
+    reached_[b] = 1;
+    BasicBlock& block = cfg_.blocks[b];
+    for (Phi& phi : block.phis) visitPhi(b, phi);
+    for (uint32_t k = 0; k < block.code.size(); ++k) visit(b, k);
+    if (block.succs.size() == 1) edges_.push_back({b, block.succs[0]});
+  }
+
+  void takeEdge(uint32_t from, uint32_t to) {
+    uint8_t& taken = executable_[to][cfg_.predIndex(to, from)];
+    if (taken) return;
+    taken = 1;
+    if (!reached_[to]) {
+      reach(to);
+      return;
+    }
+    for (Phi& phi : cfg_.blocks[to].phis) visitPhi(to, phi);
+  }
+
+  void visitPhi(uint32_t b, const Phi& phi) {
+    Lattice meet;
+    for (size_t k = 0; k < phi.args.size(); ++k) {
+      if (!executable_[b][k]) continue;
+      const Lattice a = valueOf(phi.args[k]);
+      if (a.level == Level::Unknown) continue;
+      if (a.level == Level::Varies || (meet.level == Level::Constant && meet.value != a.value)) {
+        meet.level = Level::Varies;
+        break;
+      }
+      meet = a;
+    }
+    lower(phi.result, meet);
+  }
+
+  void visit(uint32_t b, uint32_t k) {
+    const BasicBlock& block = cfg_.blocks[b];
+    const uint32_t i = block.code[k];
+    const Op op = fn_.op[i];
+    if (op == Op::JumpIf && k + 1 == block.code.size() && block.succs.size() == 2) {
+      const Lattice cond = valueOf(fn_.arg1[i]);
+      if (cond.level == Level::Unknown) return;
+      if (cond.level == Level::Varies || cond.value) edges_.push_back({b, block.succs[0]});
+      if (cond.level == Level::Varies || !cond.value) edges_.push_back({b, block.succs[1]});
+      return;
+    }
+    if (!definesResult(op) || !fn_.result[i].is(Operand::Kind::Var)) return;
+    Lattice out{Level::Varies, 0};
+    if (op == Op::Copy) {
+      out = valueOf(fn_.arg1[i]);
+    } else if (opShape(op) != OpShape::Other) {
+      const Lattice a = valueOf(fn_.arg1[i]);
+      const Lattice c = opShape(op) == OpShape::Unary ? Lattice{Level::Constant, 0}
+                                                      : valueOf(fn_.arg2[i]);
+      if (a.level == Level::Varies || c.level == Level::Varies) {
+        out.level = Level::Varies;
+      } else if (a.level == Level::Unknown || c.level == Level::Unknown) {
+        return;
+      } else if (evaluate(op, a.value, c.value, out.value)) {
+        out.level = Level::Constant;
+      }
+    }
+    lower(fn_.result[i], out);
+  }
+
+  Operand constantOf(Operand o) const {
+    if (!o.is(Operand::Kind::Var) || !defined_[o.index()]) return o;
+    const Lattice& v = values_[o.index()];
+    return v.level == Level::Constant && Operand::fitsImm(v.value) ? Operand::imm(v.value) : o;
+  }
+
+  bool rewrite() {
+    std::vector<std::pair<uint32_t, uint32_t>> dead;
+    for (uint32_t b = 0; b < cfg_.size(); ++b) {
+      if (!reached_[b]) continue;
+      for (uint32_t s : cfg_.blocks[b].succs)
+        if (!executable_[s][cfg_.predIndex(s, b)]) dead.push_back({b, s});
+    }
+    for (auto [from, to] : dead) cfg_.removeEdge(from, to);
+
+    for (uint32_t b = 0; b < cfg_.size(); ++b) {
+      if (!reached_[b]) continue;
+      BasicBlock& block = cfg_.blocks[b];
+      auto folded = [&](Operand result) { return constantOf(result) != result; };
+      block.phis.erase(std::remove_if(block.phis.begin(), block.phis.end(),
+                                      [&](const Phi& phi) { return folded(phi.result); }),
+                       block.phis.end());
+      for (Phi& phi : block.phis)
+        for (Operand& a : phi.args) a = constantOf(a);
+      size_t kept = 0;
+      for (size_t k = 0; k < block.code.size(); ++k) {
+        const uint32_t i = block.code[k];
+        // Folded values are pure, so their definitions can go.
+        if (definesResult(fn_.op[i]) && fn_.op[i] != Op::Call && folded(fn_.result[i])) continue;
+        forEachUse(fn_, i, [&](Operand& o) { o = constantOf(o); });
+        block.code[kept++] = i;
+      }
+      block.code.resize(kept);
+    }
+    if (!dead.empty()) cfg_.renumber();
+    return !dead.empty();
+  }
+
+  Cfg& cfg_;
+  Function& fn_;
+  const Module& module_;
+  std::vector<Lattice> values_;
+  std::vector<std::vector<Use>> uses_;
+  std::vector<uint8_t> defined_;
+  std::vector<uint8_t> reached_;
+  std::vector<std::vector<uint8_t>> executable_;  // per block, per predecessor
+  std::vector<std::pair<uint32_t, uint32_t>> edges_;
+  std::vector<uint32_t> changed_;
+};
+
+}  // namespace
+
+bool propagateConstants(Cfg& cfg, const Module& module) { return Propagator(cfg, module).run(); }
+
+}  // namespace byyl
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "ir/ir.h"
+#include "opt/cfg.h"
+
+namespace byyl {
+
+// Sparse conditional constant propagation (Wegman and Zadeck) over SSA form.
+// Values start unknown and only ever drop, to a constant and then to
+// "varies"; edges become executable when their branch can go that way, and
+// a φ meets only the operands of executable edges. Work moves along def-use
+// chains rather than sweeping every block per round. Afterwards constants
+// replace the values that have one and fit an Imm, their definitions go,
+// and branches that can only go one way become jumps. Returns true if any
+// edge was removed, which invalidates a DominatorTree of `cfg`.
+bool propagateConstants(Cfg& cfg, const Module& module);
+
+}  // namespace byyl
@@ -0,0 +1,234 @@
+#include "opt/ssa.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace byyl {
+
+namespace {
+
+bool isVar(Operand o) { return o.is(Operand::Kind::Var); }
+
+// Per-block marks that reset in O(1) by moving to a new stamp.
+class BlockMarks {
+ public:
+  explicit BlockMarks(uint32_t blocks) : marks_(blocks, 0) {}
+  void next() { ++stamp_; }
+  bool test(uint32_t b) const { return marks_[b] == stamp_; }
+  // Returns false if `b` was already marked.
+  bool mark(uint32_t b) {
+    if (marks_[b] == stamp_) return false;
+    marks_[b] = stamp_;
+    return true;
+  }
+
+ private:
+  std::vector<uint32_t> marks_;
+  uint32_t stamp_ = 0;
+};
+
+class SsaBuilder {
+ public:
+  SsaBuilder(Cfg& cfg, const DominatorTree& dom)
+      : cfg_(cfg), fn_(cfg.fn), dom_(dom), numVars_(static_cast<uint32_t>(fn_.vars.size())) {}
+
+  void run() {
+    findPromotable();
+    collectDefsAndUses();
+    placePhis();
+    rename();
+  }
+
+ private:
+  bool promoted(Operand o) const { return isVar(o) && o.index() < numVars_ && promotable_[o.index()]; }
+
+  void findPromotable() {
+    promotable_.assign(numVars_, 0);
+    for (uint32_t v = 0; v < numVars_; ++v) promotable_[v] = fn_.vars[v].size == 1;
+    for (const BasicBlock& b : cfg_.blocks)
+      for (uint32_t i : b.code) {
+        if (fn_.op[i] == Op::Load && isVar(fn_.arg1[i])) promotable_[fn_.arg1[i].index()] = 0;
+        if (fn_.op[i] == Op::Store && isVar(fn_.result[i])) promotable_[fn_.result[i].index()] = 0;
+      }
+  }
+
+  // Blocks that define each variable and blocks that read it before any
+  // definition of their own. Every variable counts as defined on entry.
+  void collectDefsAndUses() {
+    defBlocks_.assign(numVars_, {});
+    useBlocks_.assign(numVars_, {});
+    std::vector<uint32_t> lastDef(numVars_, UINT32_MAX), lastUse(numVars_, UINT32_MAX);
+    for (uint32_t v = 0; v < numVars_; ++v)
+      if (promotable_[v]) {
+        defBlocks_[v].push_back(0);
+        lastDef[v] = 0;
+      }
+    for (uint32_t b = 0; b < cfg_.size(); ++b)
+      for (uint32_t i : cfg_.blocks[b].code) {
+        forEachUse(fn_, i, [&](Operand& o) {
+          if (!promoted(o)) return;
+          const uint32_t v = o.index();
+          if (lastDef[v] != b && lastUse[v] != b) {
+            useBlocks_[v].push_back(b);
+            lastUse[v] = b;
+          }
+        });
+        if (definesResult(fn_.op[i]) && promoted(fn_.result[i])) {
+          const uint32_t v = fn_.result[i].index();
+          if (lastDef[v] != b) defBlocks_[v].push_back(b);
+          lastDef[v] = b;
+        }
+      }
+  }
+
+  // For each variable, the blocks it is live into come from a backward walk
+  // from its upward-exposed uses that stops at its definitions; φ go at the
+  // iterated frontier of the definitions, where it is live.
+  void placePhis() {
+    const uint32_t n = cfg_.size();
+    BlockMarks live(n), defined(n), hasPhi(n), queued(n);
+    std::vector<uint32_t> work;
+    for (uint32_t v = 0; v < numVars_; ++v) {
+      if (!promotable_[v] || useBlocks_[v].empty()) continue;
+      live.next();
+      defined.next();
+      for (uint32_t b : defBlocks_[v]) defined.mark(b);
+      work = useBlocks_[v];
+      for (uint32_t b : work) live.mark(b);
+      while (!work.empty()) {
+        const uint32_t b = work.back();
+        work.pop_back();
+        for (uint32_t p : cfg_.blocks[b].preds)
+          if (!defined.test(p) && live.mark(p)) work.push_back(p);
+      }
+
+      hasPhi.next();
+      queued.next();
+      work = defBlocks_[v];
+      for (uint32_t b : work) queued.mark(b);
+      while (!work.empty()) {
+        const uint32_t b = work.back();
+        work.pop_back();
+        for (uint32_t d : dom_.frontier[b]) {
+          if (!live.test(d) || !hasPhi.mark(d)) continue;
+          BasicBlock& block = cfg_.blocks[d];
+          block.phis.push_back({Operand::var(v), v, std::vector<Operand>(block.preds.size())});
+          if (queued.mark(d)) work.push_back(d);
+        }
+      }
+    }
+  }
+
+  Operand fresh(uint32_t v) {
+    const Symbol name = fn_.vars[v].name;
+    return fn_.newVar(name);
+  }
+
+  void push(uint32_t v, Operand version) {
+    stacks_[v].push_back(version);
+    log_.push_back(v);
+  }
+
+  // Walks the dominator tree keeping the current version of each variable
+  // on a stack.
+  void rename() {
+    stacks_.assign(numVars_, {});
+    for (uint32_t v = 0; v < numVars_; ++v)
+      if (promotable_[v]) stacks_[v].push_back(v < fn_.numParams ? Operand::var(v) : Operand::imm(0));
+
+    // (block, log size on entry); the second entry of a block pops the
+    // versions its subtree pushed.
+    std::vector<std::pair<uint32_t, size_t>> todo{{0, SIZE_MAX}};
+    while (!todo.empty()) {
+      const auto [b, logSize] = todo.back();
+      todo.pop_back();
+      if (logSize != SIZE_MAX) {
+        while (log_.size() > logSize) {
+          stacks_[log_.back()].pop_back();
+          log_.pop_back();
+        }
+        continue;
+      }
+      todo.push_back({b, log_.size()});
+      renameBlock(b);
+      const std::vector<uint32_t>& kids = dom_.children[b];
+      for (auto it = kids.rbegin(); it != kids.rend(); ++it) todo.push_back({*it, SIZE_MAX});
+    }
+  }
+
+  void renameBlock(uint32_t b) {
+    BasicBlock& block = cfg_.blocks[b];
+    for (Phi& phi : block.phis) {
+      phi.result = fresh(phi.var);
+      push(phi.var, phi.result);
+    }
+    for (uint32_t i : block.code) {
+      forEachUse(fn_, i, [&](Operand& o) {
+        if (promoted(o)) o = stacks_[o.index()].back();
+      });
+      if (definesResult(fn_.op[i]) && promoted(fn_.result[i])) {
+        const uint32_t v = fn_.result[i].index();
+        fn_.result[i] = fresh(v);
+        push(v, fn_.result[i]);
+      }
+    }
+    for (uint32_t s : block.succs) {
+      const uint32_t k = cfg_.predIndex(s, b);
+      for (Phi& phi : cfg_.blocks[s].phis) phi.args[k] = stacks_[phi.var].back();
+    }
+  }
+
+  Cfg& cfg_;
+  Function& fn_;
+  const DominatorTree& dom_;
+  const uint32_t numVars_;
+  std::vector<uint8_t> promotable_;
+  std::vector<std::vector<uint32_t>> defBlocks_, useBlocks_;
+  std::vector<std::vector<Operand>> stacks_;
+  std::vector<uint32_t> log_;
+};
+
+}  // namespace
+
+void buildSsa(Cfg& cfg, const DominatorTree& dom) { SsaBuilder(cfg, dom).run(); }
+
+void destroySsa(Cfg& cfg) {
+  cfg.splitCriticalEdges();
+  Function& fn = cfg.fn;
+  std::vector<std::pair<Operand, Operand>> copies;  // (destination, source)
+  for (uint32_t b = 0; b < cfg.size(); ++b) {
+    if (cfg.blocks[b].phis.empty()) continue;
+    const std::vector<uint32_t> preds = cfg.blocks[b].preds;
+    for (uint32_t k = 0; k < preds.size(); ++k) {
+      copies.clear();
+      for (const Phi& phi : cfg.blocks[b].phis)
+        if (phi.result != phi.args[k]) copies.push_back({phi.result, phi.args[k]});
+      // Each predecessor has this block as its only successor now, so the
+      // copies go last.
+      std::vector<uint32_t>& code = cfg.blocks[preds[k]].code;
+      auto emit = [&](Operand dst, Operand src) { code.push_back(fn.emit(Op::Copy, dst, src)); };
+      while (!copies.empty()) {
+        // A copy is safe once no other pending copy reads its destination.
+        auto ready = std::find_if(copies.begin(), copies.end(), [&](const auto& c) {
+          return std::none_of(copies.begin(), copies.end(),
+                              [&](const auto& o) { return o.second == c.first; });
+        });
+        if (ready != copies.end()) {
+          emit(ready->first, ready->second);
+          copies.erase(ready);
+          continue;
+        }
+        // Only cycles are left: save one destination and read it from there.
+        const Operand saved = copies.front().first;
+        const Operand tmp = fn.newTemp();
+        emit(tmp, saved);
+        for (auto& c : copies)
+          if (c.second == saved) c.second = tmp;
+      }
+    }
+    cfg.blocks[b].phis.clear();
+  }
+}
+
+}  // namespace byyl
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "opt/cfg.h"
+#include "opt/dominance.h"
+
+namespace byyl {
+
+// Rewrites the function into pruned SSA form (Cytron et al.): every
+// definition of a promotable variable gets a fresh Var, and φ-functions at
+// the iterated dominance frontier of its definitions merge them, but only
+// where the variable is live. Promotable means a one-slot variable that is
+// never the base of a Load or Store; the rest stay in memory. A variable
+// read before any assignment reads 0, a parameter its incoming value.
+void buildSsa(Cfg& cfg, const DominatorTree& dom);
+
+// Replaces the φ-functions with copies at the end of each predecessor,
+// after splitting critical edges. The copies into one block happen in
+// parallel, so they are ordered, and cycles broken through a temporary,
+// such that no source is overwritten before it is read.
+void destroySsa(Cfg& cfg);
+
+// Calls f(operand&) for each operand instruction `i` reads. Store's result
+// is the base it writes through, and counts as a read.
+template <typename F>
+void forEachUse(Function& fn, uint32_t i, F&& f) {
+  if (fn.op[i] == Op::Store) f(fn.result[i]);
+  if (fn.arg1[i]) f(fn.arg1[i]);
+  if (fn.arg2[i]) f(fn.arg2[i]);
+}
+
+}  // namespace byyl
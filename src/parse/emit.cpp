@@ -0,0 +1,85 @@
+#include "parse/emit.h"
+
+#include <sstream>
+
+namespace byyl::lr {
+
+namespace {
+
+template <typename T>
+void emitArray(std::ostringstream& os, const char* type, const char* name, const std::vector<T>& values) {
+  os << "inline constexpr " << type << ' ' << name << '[' << (values.empty() ? 1 : values.size())
+     << "] = {";
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (i % 16 == 0) os << "\n   ";
+    os << ' ' << values[i] << ',';
+  }
+  if (values.empty()) os << " 0";
+  os << "\n};\n";
+}
+
+std::string cString(const std::string& s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+
+}  // namespace
+
+std::string emitParseTables(const Grammar& g, const ParseTable& dense, const PackedTables& packed) {
+  std::ostringstream os;
+  size_t denseEntries = dense.action.size() + dense.gotos.size();
+  os << "// Generated by byyl-lrgen. Do not edit.\n";
+  os << "// LALR(1): " << dense.numStates << " states, " << g.numTerminals << " terminals, "
+     << g.numNonterminals() << " nonterminals, " << g.productions.size() << " productions.\n";
+  os << "// Dense ACTION+GOTO: " << denseEntries << " entries; packed comb vector: "
+     << packed.table.size() << " entries.\n";
+
+  os << "enum class ParseAction : uint8_t {\n";
+  for (size_t i = 0; i < g.actions.size(); ++i)
+    os << "  " << (i == 0 ? std::string("Pass") : g.actions[i]) << ",\n";
+  os << "};\n";
+  os << "inline constexpr const char* kParseActionNames[" << g.actions.size() << "] = {\n";
+  for (size_t i = 0; i < g.actions.size(); ++i)
+    os << "    \"" << (i == 0 ? std::string("Pass") : g.actions[i]) << "\",\n";
+  os << "};\n";
+
+  os << "inline constexpr int kParseNumStates = " << dense.numStates << ";\n";
+  os << "inline constexpr int kParseNumTerminals = " << g.numTerminals << ";\n";
+  os << "inline constexpr int kParseNumNonterminals = " << g.numNonterminals() << ";\n";
+  os << "inline constexpr int kParseTableSize = " << packed.table.size() << ";\n";
+  emitArray(os, "int16_t", "kParseActionBase", packed.actionBase);
+  emitArray(os, "int16_t", "kParseDefaultAction", packed.defaultAction);
+  emitArray(os, "int16_t", "kParseGotoBase", packed.gotoBase);
+  emitArray(os, "int16_t", "kParseDefaultGoto", packed.defaultGoto);
+  emitArray(os, "int16_t", "kParseTable", packed.table);
+  emitArray(os, "int16_t", "kParseCheck", packed.check);
+  os << "inline constexpr int kParseNumRecovery = " << packed.recoveryLhs.size() << ";\n";
+  emitArray(os, "int16_t", "kParseStateRecovery", packed.stateRecovery);
+  emitArray(os, "uint16_t", "kParseRecoveryLhs", packed.recoveryLhs);
+  emitArray(os, "uint8_t", "kParseRecoverySets", packed.recoverySets);
+
+  std::vector<int> length, lhs;
+  for (const Production& p : g.productions) {
+    length.push_back(static_cast<int>(p.rhs.size()));
+    lhs.push_back(g.ntIndex(p.lhs));
+  }
+  emitArray(os, "uint8_t", "kRuleLength", length);
+  emitArray(os, "uint16_t", "kRuleLhs", lhs);
+  // uint8_t rather than ParseAction so table files can carry the same array.
+  os << "inline constexpr uint8_t kRuleAction[" << g.productions.size() << "] = {\n";
+  for (const Production& p : g.productions)
+    os << "    uint8_t(ParseAction::" << (p.action == 0 ? std::string("Pass") : g.actions[p.action])
+       << "),\n";
+  os << "};\n";
+  os << "inline constexpr const char* kRuleText[" << g.productions.size() << "] = {\n";
+  for (size_t p = 0; p < g.productions.size(); ++p)
+    os << "    " << cString(g.describe(static_cast<int>(p))) << ",\n";
+  os << "};\n";
+  return os.str();
+}
+
+}  // namespace byyl::lr
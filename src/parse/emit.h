@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+#include "parse/grammar.h"
+#include "parse/tables.h"
+
+namespace byyl::lr {
+
+// Emits the packed tables, per-production metadata and the ParseAction enum
+// as constexpr definitions for the parser driver to #include.
+std::string emitParseTables(const Grammar& g, const ParseTable& dense, const PackedTables& packed);
+
+// Emits Parser::Descent, a recursive-descent parser for `g` whose
+// alternatives are chosen by switches over FIRST sets and whose reductions
+// call the same semantic actions as the tables'. Throws GrammarError if `g`
+// is not LL(1) once left recursion, common prefixes and unit-rule left
+// corners are taken care of.
+std::string emitDescentParser(const Grammar& g);
+
+}  // namespace byyl::lr
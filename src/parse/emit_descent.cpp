@@ -0,0 +1,502 @@
+#include "parse/emit.h"
+
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <set>
+#include <sstream>
+#include <utility>
+
+#include "parse/lalr.h"
+
+namespace byyl::lr {
+
+namespace {
+
+// Writes Parser::Descent, one member function per nonterminal. A FIRST set
+// becomes the case labels of a switch on the lookahead's TokenKind, so
+// choosing an alternative is one jump the compiler lays out, and each
+// right-hand side is straight-line code. Grammar shapes LL(1) cannot take
+// directly are rewritten on the way:
+//
+// - Left recursion, A : A x | y, parses y and then loops over the x
+//   alternatives in A_tail, reducing A : A x each time round, so the
+//   semantic actions see exactly the reductions an LR parser makes.
+// - Alternatives with a common prefix share the code that parses it, and
+//   the remainders are chosen between afterwards (left factoring).
+// - Alternatives X... and Y... whose FIRST sets overlap because X derives
+//   Y through unit rules (X : ... : Y) parse Y first and then decide: if a
+//   Y alternative can go on it does, otherwise Y is climbed to X through
+//   those unit rules and their loops (left-corner parsing). This is how
+//   assignment and binary expressions part ways after a unary expression.
+// - Ambiguous operator rules, A : A op A | y with a precedence on each op,
+//   become precedence climbing: rule_A(min) parses y and A_tail loops
+//   while the lookahead's entry in a generated operator table binds at
+//   least as tightly as min, parsing each right operand with rule_A at the
+//   operator's next level. One call then covers every level, where a
+//   nonterminal per level would cost a call per level per operand.
+//
+// An empty alternative is the default of its switch, and a choice between
+// stopping and going on (the dangling else) goes on, as the LR tables do.
+// Whatever else is not LL(1) after these rewrites is a GrammarError.
+//
+// Each rule function counts itself in DescentBase::Nested while it runs,
+// so input nested past the base's limit ends the parse with an error
+// instead of overflowing the stack. The _tail loops and the climbs are
+// called from rule functions and do not nest on their own.
+class DescentEmitter {
+ public:
+  explicit DescentEmitter(const Grammar& g) : g_(g), firsts_(g) {}
+
+  std::string emit();
+
+ private:
+  struct Item {
+    int production;
+    int pos;
+    int climbFrom = -1;  // rhs[pos] holds this symbol, still to climb to rhs[pos]'s
+  };
+  // What a finished alternative does with its value.
+  struct Leaf {
+    bool loop;  // in A_tail: becomes the next head
+    int tail;   // in A: the nonterminal to continue in A_tail, or -1
+  };
+  struct Branch {
+    int symbol;
+    BitSet labels;
+    std::vector<Item> items;
+  };
+
+  std::string name(int sym) const;
+  std::string fn(int sym) const { return "rule_" + name(sym); }
+  std::string tailFn(int sym) const { return fn(sym) + "_tail"; }
+  std::string climbFn(int to, int from) const { return fn(to) + "_from_" + name(from); }
+  std::string token(int t) const { return "TokenKind::" + g_.names[t]; }
+  std::string where(const Item& it) const { return g_.describe(it.production, it.pos); }
+
+  const Production& prod(const Item& it) const { return g_.productions[it.production]; }
+  bool ended(const Item& it) const {
+    return it.climbFrom < 0 && it.pos == static_cast<int>(prod(it).rhs.size());
+  }
+  BitSet first(int sym) const;
+  bool nullable(int sym) const { return !g_.isTerminal(sym) && firsts_.nullable[g_.ntIndex(sym)]; }
+  bool hasLoops(int nt) const;
+  bool isOperator(int nt) const;
+  // rule_A_tail applied to `value`, passing `min` if A climbs precedence.
+  std::string tailCall(int nt, const std::string& value, const char* min) const;
+  std::string operatorTable(int nt) const;
+  std::vector<int> chain(int from, int to) const;
+
+  void line(int indent, const std::string& text) {
+    out_ << std::string(indent, ' ') << text << '\n';
+  }
+  void step(const Item& it, int indent, bool known);
+  void finish(const Item& it, int indent, const Leaf& leaf);
+  void sequence(Item it, int indent, const Leaf& leaf, bool known);
+  void choice(std::vector<Item> items, int indent, const Leaf& leaf);
+  template <typename Default>
+  void dispatch(const std::vector<Item>& items, int indent, const Leaf& leaf, Default&& fallback);
+  void climb(int to, int from);
+  void operatorTail(int nt, const std::vector<int>& loops, std::ostringstream& table);
+
+  const Grammar& g_;
+  FirstSets firsts_;
+  std::ostringstream out_;
+  std::set<std::pair<int, int>> climbs_;  // (to, from) still to define
+  std::set<std::pair<int, int>> climbed_;
+  size_t loopWidth_ = 0;  // nonzero for an A_tail switch: each case declares rhs
+};
+
+std::string DescentEmitter::name(int sym) const {
+  std::string s = g_.names[sym];
+  std::replace(s.begin(), s.end(), '-', '_');
+  return s;
+}
+
+BitSet DescentEmitter::first(int sym) const {
+  if (!g_.isTerminal(sym)) return firsts_.first[g_.ntIndex(sym)];
+  BitSet s(g_.numTerminals);
+  s.set(sym);
+  return s;
+}
+
+bool DescentEmitter::hasLoops(int nt) const {
+  for (int p : g_.productionsOf(nt))
+    if (!g_.productions[p].rhs.empty() && g_.productions[p].rhs[0] == nt) return true;
+  return false;
+}
+
+// True if every left-recursive rule of `nt` is nt : nt op nt.
+bool DescentEmitter::isOperator(int nt) const {
+  bool any = false;
+  for (int p : g_.productionsOf(nt)) {
+    const Production& pr = g_.productions[p];
+    if (pr.rhs.empty() || pr.rhs[0] != nt) continue;
+    if (pr.rhs.size() != 3 || !g_.isTerminal(pr.rhs[1]) || pr.rhs[2] != nt) return false;
+    any = true;
+  }
+  return any;
+}
+
+std::string DescentEmitter::tailCall(int nt, const std::string& value, const char* min) const {
+  return tailFn(nt) + "(" + value + (isOperator(nt) ? std::string(", ") + min : "") + ")";
+}
+
+std::string DescentEmitter::operatorTable(int nt) const {
+  std::string s = "k";
+  bool up = true;
+  for (char c : name(nt)) {
+    if (c == '_') {
+      up = true;
+      continue;
+    }
+    s += up ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : c;
+    up = false;
+  }
+  return s + "Operators";
+}
+
+// The unit rules from `from` down to `to`, outermost first; empty if there
+// is no such chain.
+std::vector<int> DescentEmitter::chain(int from, int to) const {
+  if (g_.isTerminal(from)) return {};
+  std::vector<int> via(g_.numSymbols(), -1);  // the unit rule that reached each symbol
+  std::deque<int> queue{from};
+  while (!queue.empty()) {
+    const int c = queue.front();
+    queue.pop_front();
+    if (c == to) break;
+    if (g_.isTerminal(c)) continue;
+    for (int p : g_.productionsOf(c)) {
+      const Production& u = g_.productions[p];
+      if (u.rhs.size() != 1 || u.rhs[0] == from || via[u.rhs[0]] >= 0) continue;
+      via[u.rhs[0]] = p;
+      queue.push_back(u.rhs[0]);
+    }
+  }
+  std::vector<int> rules;
+  for (int s = to; via[s] >= 0 && s != from; s = g_.productions[via[s]].lhs)
+    rules.push_back(via[s]);
+  if (rules.empty() || g_.productions[rules.back()].lhs != from) return {};
+  std::reverse(rules.begin(), rules.end());
+  return rules;
+}
+
+void DescentEmitter::step(const Item& it, int indent, bool known) {
+  const int sym = prod(it).rhs[it.pos];
+  const std::string slot = "rhs[" + std::to_string(it.pos) + "] = ";
+  if (!g_.isTerminal(sym))
+    line(indent, slot + fn(sym) + "();");
+  else if (known)
+    line(indent, slot + "shift();");
+  else
+    line(indent, slot + "expect(" + token(sym) + ");");
+}
+
+void DescentEmitter::finish(const Item& it, int indent, const Leaf& leaf) {
+  const Production& p = prod(it);
+  const std::string action = p.action == 0 ? "Pass" : g_.actions[p.action];
+  std::string value = action == "Pass" && !p.rhs.empty()
+                          ? "rhs[0]"
+                          : "reduce(ParseAction::" + action + ", rhs, " +
+                                std::to_string(p.rhs.size()) + ")";
+  if (leaf.loop) {
+    line(indent, "v = " + value + ";");
+    line(indent, "continue;");
+  } else {
+    if (leaf.tail >= 0) value = tailCall(leaf.tail, value, "min");
+    line(indent, "return " + value + ";");
+  }
+}
+
+void DescentEmitter::sequence(Item it, int indent, const Leaf& leaf, bool known) {
+  for (; it.pos < static_cast<int>(prod(it).rhs.size()); ++it.pos, known = false)
+    step(it, indent, known);
+  finish(it, indent, leaf);
+}
+
+// Emits code choosing among `items`, which have all parsed the same prefix
+// and sit at the same position (or, climbing, one before).
+void DescentEmitter::choice(std::vector<Item> items, int indent, const Leaf& leaf) {
+  std::vector<Item> climbing, rest, done;
+  for (const Item& it : items)
+    (it.climbFrom >= 0 ? climbing : ended(it) ? done : rest).push_back(it);
+
+  if (!climbing.empty()) {
+    if (!done.empty())
+      throw GrammarError("not LL(1): '" + where(done[0]) + "' or '" + where(climbing[0]) + "'");
+    const int from = climbing[0].climbFrom, to = prod(climbing[0]).rhs[climbing[0].pos];
+    for (const Item& it : climbing)
+      if (it.climbFrom != from || prod(it).rhs[it.pos] != to)
+        throw GrammarError("not LL(1): '" + where(it) + "' or '" + where(climbing[0]) + "'");
+    auto climbThen = [&, to = to, from = from](int at) {
+      const std::string slot = "rhs[" + std::to_string(climbing[0].pos) + "]";
+      line(at, slot + " = " + climbFn(to, from) + "(" + slot + ");");
+      climbs_.insert({to, from});
+      std::vector<Item> next = climbing;
+      for (Item& it : next) {
+        it.climbFrom = -1;
+        ++it.pos;
+      }
+      choice(next, at, leaf);
+    };
+    if (rest.empty())
+      climbThen(indent);
+    else
+      dispatch(rest, indent, leaf, climbThen);
+    return;
+  }
+
+  if (items.size() == 1) {
+    sequence(items[0], indent, leaf, false);
+    return;
+  }
+  if (done.size() > 1)
+    throw GrammarError("not LL(1): '" + where(done[0]) + "' or '" + where(done[1]) + "'");
+  bool shared = done.empty();
+  for (const Item& it : rest)
+    shared &= prod(it).rhs[it.pos] == prod(rest[0]).rhs[rest[0].pos];
+  if (shared) {
+    // Left factoring: one symbol every alternative starts with.
+    step(rest[0], indent, false);
+    for (Item& it : rest) ++it.pos;
+    choice(rest, indent, leaf);
+    return;
+  }
+  dispatch(rest, indent, leaf, [&](int at) {
+    if (done.empty()) {
+      BitSet tokens(g_.numTerminals);
+      for (const Item& it : rest) tokens.orWith(first(prod(it).rhs[it.pos]));
+      std::string expected;
+      int count = 0;
+      tokens.forEach([&](size_t t) {
+        const std::string& s = g_.spellings[t].empty() ? g_.names[t] : g_.spellings[t];
+        expected += (count++ ? ", " : "") + s;
+      });
+      std::string quoted;
+      for (char c : count <= 6 ? expected : std::string()) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+      }
+      line(at, "fail(\"" + quoted + "\");");
+    } else {
+      sequence(done[0], at, leaf, false);
+    }
+  });
+}
+
+// A switch on the lookahead over the next symbols of `items`, none of
+// which has ended; `fallback(indent)` emits the default.
+template <typename Default>
+void DescentEmitter::dispatch(const std::vector<Item>& items, int indent, const Leaf& leaf,
+                              Default&& fallback) {
+  std::vector<Branch> branches;
+  for (const Item& it : items) {
+    const int sym = prod(it).rhs[it.pos];
+    if (nullable(sym))
+      throw GrammarError("not LL(1): nullable " + g_.names[sym] + " in '" + where(it) + "'");
+    auto b = std::find_if(branches.begin(), branches.end(),
+                          [&](const Branch& other) { return other.symbol == sym; });
+    if (b == branches.end()) b = branches.insert(branches.end(), {sym, first(sym), {}});
+    b->items.push_back(it);
+  }
+  // Overlapping FIRST sets: the symbol deriving the other through unit
+  // rules climbs from it; its other alternatives keep their own tokens.
+  for (size_t i = 0; i < branches.size(); ++i) {
+    for (size_t j = 0; j < branches.size(); ++j) {
+      if (i == j || !branches[i].labels.intersects(branches[j].labels)) continue;
+      const int x = branches[i].symbol, y = branches[j].symbol;
+      const std::vector<int> rules = chain(x, y);
+      if (rules.empty()) continue;
+      const BitSet fy = first(y);
+      for (int r : rules) {
+        for (int p : g_.productionsOf(g_.productions[r].lhs)) {
+          const Production& other = g_.productions[p];
+          if (p == r || other.rhs.empty() || other.rhs[0] == other.lhs) continue;
+          bool vanishes;
+          if (firsts_.firstOfSuffix(g_, p, 0, vanishes).intersects(fy))
+            throw GrammarError("not LL(1): '" + g_.describe(p) + "' overlaps '" +
+                               g_.describe(r) + "'");
+        }
+      }
+      for (Item it : branches[i].items) {
+        it.climbFrom = y;
+        branches[j].items.push_back(it);
+      }
+      branches[i].labels.subtract(fy);
+    }
+  }
+  for (size_t i = 0; i < branches.size(); ++i)
+    for (size_t j = i + 1; j < branches.size(); ++j)
+      if (branches[i].labels.intersects(branches[j].labels))
+        throw GrammarError("not LL(1): '" + where(branches[i].items[0]) + "' or '" +
+                           where(branches[j].items[0]) + "'");
+
+  const size_t loopWidth = std::exchange(loopWidth_, 0);
+  line(indent, "switch (peek()) {");
+  for (const Branch& b : branches) {
+    if (!b.labels.any()) continue;
+    const size_t last = b.labels.count();
+    size_t n = 0;
+    b.labels.forEach([&](size_t t) {
+      line(indent + 2, "case " + token(static_cast<int>(t)) + (++n == last ? ": {" : ":"));
+    });
+    std::vector<Item> next;
+    for (Item it : b.items) {
+      if (it.climbFrom < 0) ++it.pos;
+      next.push_back(it);
+    }
+    if (loopWidth) {
+      line(indent + 4, "Value rhs[" + std::to_string(loopWidth) + "];");
+      line(indent + 4, "rhs[0] = v;");
+    }
+    // The branch's own items come first; climbing ones were appended.
+    step(b.items[0], indent + 4, g_.isTerminal(b.symbol));
+    choice(next, indent + 4, leaf);
+    line(indent + 2, "}");
+  }
+  line(indent + 2, "default:");
+  fallback(indent + 4);
+  line(indent, "}");
+}
+
+// rule_X_from_Y: a Y already parsed, reduced up the unit rules to X, with
+// each nonterminal's left-recursive loop run on the way.
+void DescentEmitter::climb(int to, int from) {
+  out_ << "\ninline Parser::Value Parser::Descent::" << climbFn(to, from) << "(Value v) {\n";
+  const std::vector<int> rules = chain(to, from);
+  for (auto r = rules.rbegin(); r != rules.rend(); ++r) {
+    const Production& p = g_.productions[*r];
+    if (p.action != 0) line(2, "v = reduce(ParseAction::" + g_.actions[p.action] + ", &v, 1);");
+    if (hasLoops(p.lhs)) line(2, "v = " + tailCall(p.lhs, "v", "1") + ";");
+  }
+  line(2, "return v;");
+  out_ << "}\n";
+}
+
+// A_tail for an operator nonterminal, and its operator table: one entry
+// per TokenKind, from the rules' precedences.
+void DescentEmitter::operatorTail(int nt, const std::vector<int>& loops,
+                                  std::ostringstream& table) {
+  std::vector<std::string> entries(g_.numTerminals, "{0, 0, false, ParseAction::Pass}");
+  std::vector<bool> seen(g_.numTerminals);
+  bool nonassoc = false;
+  for (int p : loops) {
+    const Production& pr = g_.productions[p];
+    const int op = pr.rhs[1];
+    if (pr.prec.level == 0)
+      throw GrammarError("operator rule without a precedence: '" + g_.describe(p) + "'");
+    if (pr.prec.level > 254) throw GrammarError("too many precedence levels");
+    if (seen[op])
+      throw GrammarError("not LL(1): two rules of " + g_.names[nt] + " on " + g_.names[op]);
+    seen[op] = true;
+    const bool left = pr.prec.assoc != Assoc::Right;
+    nonassoc |= pr.prec.assoc == Assoc::Nonassoc;
+    entries[op] = "{" + std::to_string(pr.prec.level) + ", " +
+                  std::to_string(pr.prec.level + (left ? 1 : 0)) + ", " +
+                  (pr.prec.assoc == Assoc::Nonassoc ? "true" : "false") + ", ParseAction::" +
+                  (pr.action == 0 ? std::string("Pass") : g_.actions[pr.action]) + "}";
+  }
+  table << "  static constexpr Operator " << operatorTable(nt) << '[' << g_.numTerminals
+        << "] = {\n";
+  for (int t = 0; t < g_.numTerminals; ++t)
+    table << "      " << entries[t] << ",  // " << g_.names[t] << '\n';
+  table << "  };\n";
+
+  out_ << "\ninline Parser::Value Parser::Descent::" << tailFn(nt) << "(Value v, int min) {\n";
+  line(2, nonassoc ? "for (int last = 0;;) {" : "for (;;) {");
+  line(4, "const Operator& op = " + operatorTable(nt) + "[static_cast<int>(peek())];");
+  line(4, nonassoc ? "if (op.level < min || op.level == last) return v;"
+                   : "if (op.level < min) return v;");
+  line(4, "Value rhs[3];");
+  line(4, "rhs[0] = v;");
+  line(4, "rhs[1] = shift();");
+  line(4, "rhs[2] = " + fn(nt) + "(op.next);");
+  line(4, "v = reduce(op.action, rhs, 3);");
+  if (nonassoc) line(4, "last = op.nonassoc ? op.level : 0;");
+  line(2, "}");
+  out_ << "}\n";
+}
+
+std::string DescentEmitter::emit() {
+  std::ostringstream head;
+  int rules = 0, climbers = 0;
+  std::ostringstream decls, tables;
+  for (int nt = g_.numTerminals; nt < g_.numSymbols(); ++nt) {
+    if (nt == g_.productions[0].lhs) continue;
+    ++rules;
+    std::vector<Item> bases, loops;
+    std::vector<int> operators;
+    const bool climbs = isOperator(nt);
+    size_t width = 1;
+    for (int p : g_.productionsOf(nt)) {
+      const Production& pr = g_.productions[p];
+      width = std::max(width, pr.rhs.size());
+      if (!pr.rhs.empty() && pr.rhs[0] == nt) {
+        if (pr.rhs.size() == 1) throw GrammarError("cycle: '" + g_.describe(p) + "'");
+        loops.push_back({p, 1});
+        operators.push_back(p);
+      } else {
+        bases.push_back({p, 0});
+      }
+    }
+    if (bases.empty()) throw GrammarError(g_.names[nt] + " derives no finite string");
+
+    out_ << '\n';
+    for (int p : g_.productionsOf(nt)) out_ << "// " << g_.describe(p) << '\n';
+    out_ << "inline Parser::Value Parser::Descent::" << fn(nt)
+         << (climbs ? "(int min) {\n" : "() {\n");
+    line(2, "const Nested nested(*this);");
+    line(2, "Value rhs[" + std::to_string(width) + "];");
+    choice(bases, 2, {false, loops.empty() ? -1 : nt});
+    out_ << "}\n";
+    decls << "  Value " << fn(nt) << (climbs ? "(int min = 1);\n" : "();\n");
+
+    if (climbs) {
+      ++climbers;
+      operatorTail(nt, operators, tables);
+      decls << "  Value " << tailFn(nt) << "(Value v, int min);\n";
+    } else if (!loops.empty()) {
+      // The loop's exit is the common case, so rhs is only set up on the
+      // way round.
+      out_ << "\ninline Parser::Value Parser::Descent::" << tailFn(nt) << "(Value v) {\n";
+      line(2, "for (;;) {");
+      loopWidth_ = width;
+      dispatch(loops, 4, {true, -1}, [&](int at) { line(at, "return v;"); });
+      line(2, "}");
+      out_ << "}\n";
+      decls << "  Value " << tailFn(nt) << "(Value v);\n";
+    }
+  }
+  while (!climbs_.empty()) {
+    const auto c = *climbs_.begin();
+    climbs_.erase(climbs_.begin());
+    if (!climbed_.insert(c).second) continue;
+    climb(c.first, c.second);
+    decls << "  Value " << climbFn(c.first, c.second) << "(Value v);\n";
+  }
+
+  head << "// Generated by byyl-lrgen. Do not edit.\n";
+  head << "// Recursive descent: " << rules << " nonterminals, " << climbers
+       << " by precedence climbing, " << climbed_.size() << " left-corner climbs.\n";
+  head << "class Parser::Descent : public Parser::DescentBase {\n";
+  head << " public:\n";
+  head << "  using DescentBase::DescentBase;\n";
+  head << "  // The start symbol, then the end of input.\n";
+  head << "  Value start() {\n";
+  head << "    Value v = " << fn(g_.start) << "();\n";
+  head << "    expect(" << token(0) << ");\n";
+  head << "    return v;\n";
+  head << "  }\n\n";
+  head << " private:\n";
+  head << tables.str();
+  head << decls.str();
+  head << "};\n";
+  return head.str() + out_.str();
+}
+
+}  // namespace
+
+std::string emitDescentParser(const Grammar& g) { return DescentEmitter(g).emit(); }
+
+}  // namespace byyl::lr
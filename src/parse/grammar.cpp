@@ -0,0 +1,270 @@
+#include "parse/grammar.h"
+
+#include <cctype>
+
+#include "lex/emit.h"
+#include "lex/spec.h"
+
+namespace byyl::lr {
+
+namespace {
+
+struct GToken {
+  enum Kind { Word, Quoted, Colon, Bar, Semi, Arrow, Directive, End } kind;
+  std::string text;
+  int line;
+};
+
+std::vector<GToken> tokenizeGrammar(std::string_view text) {
+  std::vector<GToken> out;
+  int line = 1;
+  size_t i = 0;
+  auto isWordChar = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+  while (i < text.size()) {
+    char c = text[i];
+    if (c == '\n') {
+      ++line;
+      ++i;
+    } else if (std::isspace(static_cast<unsigned char>(c))) {
+      ++i;
+    } else if (c == '#') {
+      while (i < text.size() && text[i] != '\n') ++i;
+    } else if (c == ':') {
+      out.push_back({GToken::Colon, ":", line});
+      ++i;
+    } else if (c == '|') {
+      out.push_back({GToken::Bar, "|", line});
+      ++i;
+    } else if (c == ';') {
+      out.push_back({GToken::Semi, ";", line});
+      ++i;
+    } else if (c == '=' && i + 1 < text.size() && text[i + 1] == '>') {
+      out.push_back({GToken::Arrow, "=>", line});
+      i += 2;
+    } else if (c == '\'') {
+      size_t j = i + 1;
+      while (j < text.size() && text[j] != '\'' && text[j] != '\n') ++j;
+      if (j >= text.size() || text[j] != '\'')
+        throw GrammarError("line " + std::to_string(line) + ": unterminated quoted terminal");
+      out.push_back({GToken::Quoted, std::string(text.substr(i, j - i + 1)), line});
+      i = j + 1;
+    } else if (c == '%' || isWordChar(c)) {
+      size_t j = i + 1;
+      while (j < text.size() && (isWordChar(text[j]) || text[j] == '-')) ++j;
+      out.push_back({c == '%' ? GToken::Directive : GToken::Word, std::string(text.substr(i, j - i)),
+                     line});
+      i = j;
+    } else {
+      throw GrammarError("line " + std::to_string(line) + ": unexpected character '" +
+                         std::string(1, c) + "'");
+    }
+  }
+  out.push_back({GToken::End, "", line});
+  return out;
+}
+
+class GrammarParser {
+ public:
+  GrammarParser(std::string_view text, const std::vector<TerminalInfo>& terminals)
+      : toks_(tokenizeGrammar(text)) {
+    g_.numTerminals = static_cast<int>(terminals.size());
+    for (size_t t = 0; t < terminals.size(); ++t) {
+      g_.names.push_back(terminals[t].name);
+      g_.spellings.push_back(terminals[t].spelling);
+      symbolIndex_[terminals[t].name] = static_cast<int>(t);
+      if (!terminals[t].spelling.empty() && terminals[t].spelling.front() == '\'')
+        symbolIndex_[terminals[t].spelling] = static_cast<int>(t);
+    }
+    g_.termPrec.resize(terminals.size());
+    g_.actions.push_back("");
+    // $accept is nonterminal 0; its production is filled in once %start is known.
+    acceptSym_ = addNonterminal("$accept");
+    g_.productions.emplace_back();
+  }
+
+  Grammar parse() {
+    while (peek().kind != GToken::End) {
+      if (peek().kind == GToken::Directive) parseDirective();
+      else parseRule();
+    }
+    if (startName_.empty()) fail(peek(), "missing %start");
+    auto it = symbolIndex_.find(startName_);
+    if (it == symbolIndex_.end() || g_.isTerminal(it->second))
+      fail(peek(), "%start names unknown nonterminal " + startName_);
+    g_.start = it->second;
+    g_.productions[0].lhs = acceptSym_;
+    g_.productions[0].rhs = {g_.start};
+    for (const GToken& name : recoveryNames_) {
+      auto r = symbolIndex_.find(name.text);
+      if (r == symbolIndex_.end() || g_.isTerminal(r->second))
+        fail(name, "%recover names unknown nonterminal " + name.text);
+      g_.recovery.push_back(r->second);
+    }
+
+    g_.byLhs.assign(g_.numNonterminals(), {});
+    for (size_t p = 0; p < g_.productions.size(); ++p)
+      g_.byLhs[g_.ntIndex(g_.productions[p].lhs)].push_back(static_cast<int>(p));
+    for (int nt = 0; nt < g_.numNonterminals(); ++nt)
+      if (g_.byLhs[nt].empty())
+        throw GrammarError("nonterminal " + g_.names[nt + g_.numTerminals] + " has no productions" +
+                           (firstUse_.count(nt) ? " (used on line " +
+                                                      std::to_string(firstUse_[nt]) + ")"
+                                                : ""));
+    return std::move(g_);
+  }
+
+ private:
+  [[noreturn]] void fail(const GToken& at, const std::string& msg) {
+    throw GrammarError("line " + std::to_string(at.line) + ": " + msg);
+  }
+
+  const GToken& peek() const { return toks_[pos_]; }
+  const GToken& take() { return toks_[pos_++]; }
+  const GToken& expect(GToken::Kind kind, const char* what) {
+    if (peek().kind != kind) fail(peek(), std::string("expected ") + what);
+    return take();
+  }
+
+  int addNonterminal(const std::string& name) {
+    int sym = static_cast<int>(g_.names.size());
+    g_.names.push_back(name);
+    symbolIndex_[name] = sym;
+    return sym;
+  }
+
+  int symbolFor(const GToken& tok) {
+    auto it = symbolIndex_.find(tok.text);
+    if (it != symbolIndex_.end()) return it->second;
+    if (tok.kind == GToken::Quoted) fail(tok, "no token is spelled " + tok.text);
+    int sym = addNonterminal(tok.text);
+    firstUse_[g_.ntIndex(sym)] = tok.line;
+    return sym;
+  }
+
+  void parseDirective() {
+    const GToken& dir = take();
+    if (dir.text == "%start") {
+      startName_ = expect(GToken::Word, "start symbol").text;
+    } else if (dir.text == "%expect") {
+      g_.expectedConflicts = std::stoi(expect(GToken::Word, "conflict count").text);
+    } else if (dir.text == "%left" || dir.text == "%right" || dir.text == "%nonassoc") {
+      Precedence prec;
+      prec.level = ++precLevel_;
+      prec.assoc = dir.text == "%left" ? Assoc::Left
+                   : dir.text == "%right" ? Assoc::Right
+                                          : Assoc::Nonassoc;
+      while (peek().kind == GToken::Word || peek().kind == GToken::Quoted) {
+        if (peek().line != dir.line) break;
+        const GToken& name = take();
+        auto it = symbolIndex_.find(name.text);
+        if (it != symbolIndex_.end() && g_.isTerminal(it->second)) {
+          g_.termPrec[it->second] = prec;
+        } else if (name.kind == GToken::Quoted) {
+          fail(name, "no token is spelled " + name.text);
+        } else {
+          precNames_[name.text] = prec;  // precedence-only name for %prec
+        }
+      }
+    } else if (dir.text == "%recover") {
+      while (peek().kind == GToken::Word && peek().line == dir.line)
+        recoveryNames_.push_back(take());
+    } else {
+      fail(dir, "unknown directive " + dir.text);
+    }
+  }
+
+  void parseRule() {
+    const GToken& lhsTok = expect(GToken::Word, "rule name");
+    int lhs = symbolFor(lhsTok);
+    if (g_.isTerminal(lhs)) fail(lhsTok, lhsTok.text + " is a terminal");
+    expect(GToken::Colon, "':'");
+    while (true) {
+      Production prod;
+      prod.lhs = lhs;
+      prod.line = peek().line;
+      bool explicitPrec = false;
+      while (peek().kind == GToken::Word || peek().kind == GToken::Quoted) {
+        prod.rhs.push_back(symbolFor(take()));
+      }
+      if (peek().kind == GToken::Directive && peek().text == "%prec") {
+        take();
+        const GToken& name = take();
+        auto pit = precNames_.find(name.text);
+        auto sit = symbolIndex_.find(name.text);
+        if (pit != precNames_.end()) prod.prec = pit->second;
+        else if (sit != symbolIndex_.end() && g_.isTerminal(sit->second))
+          prod.prec = g_.termPrec[sit->second];
+        else fail(name, "%prec names unknown precedence " + name.text);
+        explicitPrec = true;
+      }
+      if (peek().kind == GToken::Arrow) {
+        take();
+        prod.action = actionIndex(expect(GToken::Word, "action name").text);
+      }
+      if (!explicitPrec) {
+        for (auto it = prod.rhs.rbegin(); it != prod.rhs.rend(); ++it) {
+          if (g_.isTerminal(*it)) {
+            prod.prec = g_.termPrec[*it];
+            break;
+          }
+        }
+      }
+      g_.productions.push_back(std::move(prod));
+      if (peek().kind == GToken::Bar) {
+        take();
+        continue;
+      }
+      expect(GToken::Semi, "'|' or ';'");
+      return;
+    }
+  }
+
+  int actionIndex(const std::string& name) {
+    for (size_t i = 0; i < g_.actions.size(); ++i)
+      if (g_.actions[i] == name) return static_cast<int>(i);
+    g_.actions.push_back(name);
+    return static_cast<int>(g_.actions.size()) - 1;
+  }
+
+  std::vector<GToken> toks_;
+  size_t pos_ = 0;
+  Grammar g_;
+  std::map<std::string, int> symbolIndex_;
+  std::map<std::string, Precedence> precNames_;
+  std::map<int, int> firstUse_;
+  std::string startName_;
+  std::vector<GToken> recoveryNames_;
+  int precLevel_ = 0;
+  int acceptSym_ = 0;
+};
+
+}  // namespace
+
+std::string Grammar::describe(int production, int dot) const {
+  const Production& p = productions[production];
+  std::string out = names[p.lhs] + " :";
+  for (size_t i = 0; i <= p.rhs.size(); ++i) {
+    if (static_cast<int>(i) == dot) out += " .";
+    if (i == p.rhs.size()) break;
+    out += ' ';
+    out += isTerminal(p.rhs[i]) && !spellings[p.rhs[i]].empty() ? spellings[p.rhs[i]]
+                                                                 : names[p.rhs[i]];
+  }
+  return out;
+}
+
+Grammar parseGrammar(std::string_view text, const std::vector<TerminalInfo>& terminals) {
+  return GrammarParser(text, terminals).parse();
+}
+
+std::vector<TerminalInfo> terminalsFromLexSpec(std::string_view specText) {
+  lex::LexSpec spec = lex::parseSpec(specText);
+  std::vector<TerminalInfo> out;
+  out.push_back({"eof", "end of file"});
+  out.push_back({"error", "invalid character"});
+  static_assert(lex::kFirstRuleKind == 2, "terminal numbering must match TokenKind");
+  for (const auto& rule : spec.rules) out.push_back({rule.name, rule.spelling});
+  return out;
+}
+
+}  // namespace byyl::lr
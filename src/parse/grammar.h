@@ -0,0 +1,81 @@
+#pragma once
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace byyl::lr {
+
+// Raised for malformed grammars and for conflicts the grammar does not
+// declare with %expect.
+class GrammarError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+enum class Assoc { None, Left, Right, Nonassoc };
+
+// yacc-style precedence; level 0 means "no precedence declared".
+struct Precedence {
+  int level = 0;
+  Assoc assoc = Assoc::None;
+};
+
+struct Production {
+  int lhs = 0;
+  std::vector<int> rhs;
+  int action = 0;  // index into Grammar::actions; 0 = pass $1 through
+  Precedence prec;
+  int line = 0;
+};
+
+// A terminal the grammar may reference: its token name and, for fixed
+// tokens, the quoted spelling (e.g. "'('") usable as an alias.
+struct TerminalInfo {
+  std::string name;
+  std::string spelling;
+};
+
+// Context-free grammar with symbols numbered terminals first: symbol t <
+// numTerminals is TokenKind t, so parse tables index tokens directly.
+// Production 0 is the augmented rule $accept -> start.
+struct Grammar {
+  int numTerminals = 0;
+  std::vector<std::string> names;       // every symbol
+  std::vector<std::string> spellings;   // terminals only
+  std::vector<Precedence> termPrec;     // terminals only
+  std::vector<Production> productions;
+  std::vector<std::vector<int>> byLhs;  // productions per nonterminal, by nonterminal index
+  std::vector<std::string> actions;     // action labels; actions[0] is ""
+  int start = 0;                        // start symbol
+  int expectedConflicts = 0;
+  std::vector<int> recovery;            // %recover symbols, first listed first
+
+  int numSymbols() const { return static_cast<int>(names.size()); }
+  int numNonterminals() const { return numSymbols() - numTerminals; }
+  bool isTerminal(int sym) const { return sym < numTerminals; }
+  int ntIndex(int sym) const { return sym - numTerminals; }
+  const std::vector<int>& productionsOf(int sym) const { return byLhs[ntIndex(sym)]; }
+
+  // "lhs : rhs..." with a dot before position `dot` (or none if dot < 0).
+  std::string describe(int production, int dot = -1) const;
+};
+
+// Grammar file syntax:
+//   # comment
+//   %start NAME
+//   %expect N                 number of shift/reduce conflicts resolved by default
+//   %left|%right|%nonassoc SYM...   one precedence level per line, ascending
+//   %recover NAME...          nonterminals the parser resynchronizes on after
+//                             a syntax error, preferred in the order given
+//   lhs : sym... [%prec SYM] [=> Action] | ... ;
+// Terminals are written as token names or as their quoted spelling ('(').
+Grammar parseGrammar(std::string_view text, const std::vector<TerminalInfo>& terminals);
+
+// Reads terminal names and spellings from a byyl-lexgen token specification,
+// in TokenKind order.
+std::vector<TerminalInfo> terminalsFromLexSpec(std::string_view specText);
+
+}  // namespace byyl::lr
@@ -0,0 +1,259 @@
+#include "parse/incremental.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "support/hash.h"
+
+namespace byyl {
+
+namespace {
+
+constexpr uint64_t kPrintMul = 0x9e3779b97f4a7c15ull;
+// Garbage tolerated on top of the live nodes before the Ast is compacted.
+constexpr uint32_t kCompactSlack = 4096;
+
+// Post-order on an explicit stack, since a tree the parser accepted can be
+// nested deeper than the call stack allows.
+NodeId copyTree(const Ast& from, NodeId root, Ast& to) {
+  if (!root) return root;
+  std::vector<std::pair<NodeId, uint32_t>> stack{{root, 0}};  // node, kids copied
+  std::vector<NodeId> copies;  // of the kids copied so far, for every node on the stack
+  while (true) {
+    const NodeId id = stack.back().first;
+    const Ast::Kids kids = from.kids(id);
+    if (stack.back().second < kids.size()) {
+      const NodeId kid = kids[stack.back().second++];
+      if (kid) stack.push_back({kid, 0});
+      else copies.push_back(kid);
+      continue;
+    }
+    const Node& n = from[id];
+    const NodeId out =
+        to.add(n.kind, n.pos, copies.data() + copies.size() - kids.size(), kids.size());
+    Node& m = to[out];
+    m.op = n.op;
+    m.name = n.name;
+    m.value = n.kind == NodeKind::StringLiteral ? to.addText(from.text(id)) : n.value;
+    copies.resize(copies.size() - kids.size());
+    stack.pop_back();
+    if (stack.empty()) return out;
+    copies.push_back(out);
+  }
+}
+
+bool hasErrors(const std::vector<IncrementalParser::Message>& diags) {
+  for (const IncrementalParser::Message& d : diags)
+    if (d.severity == Severity::Error) return true;
+  return false;
+}
+
+}  // namespace
+
+IncrementalParser::IncrementalParser(std::string fileName, std::string_view text, LexMode mode,
+                                     const ParseTables& tables)
+    : fileName_(std::move(fileName)), mode_(mode), tables_(tables) {
+  buffer_.reserve(text.size() + SourceBuffer::kPadding);
+  buffer_.append(text).append(SourceBuffer::kPadding, '\0');
+  parseAll();
+  finish();
+}
+
+void IncrementalParser::parseAll() {
+  ast_ = std::make_unique<Ast>();
+  chunks_.assign(1, Chunk{0, static_cast<uint32_t>(text().size()), NodeId(), true, {}});
+  for (size_t i = 0; i < chunks_.size();) i = chunks_[i].dirty ? reparse(i) : i + 1;
+  liveNodes_ = ast_->size();
+  stats_.reparsedBytes = static_cast<uint32_t>(text().size());
+}
+
+bool IncrementalParser::edit(const TextEdit& e) {
+  const auto size = static_cast<uint32_t>(text().size());
+  if (e.offset > size || e.removed > size - e.offset) return false;
+  stats_ = {};
+  const uint32_t oldEnd = e.offset + e.removed;
+  const int64_t delta = static_cast<int64_t>(e.inserted.size()) - e.removed;
+
+  // Chunks touching [offset, oldEnd], boundaries included: inserting at a
+  // boundary can change the token on either side of it.
+  auto firstIt = std::lower_bound(chunks_.begin(), chunks_.end(), e.offset,
+                                  [](const Chunk& c, uint32_t at) { return c.end < at; });
+  auto lastIt = std::upper_bound(chunks_.begin(), chunks_.end(), oldEnd,
+                                 [](uint32_t at, const Chunk& c) { return at < c.begin; });
+  const auto first = static_cast<size_t>(firstIt - chunks_.begin());
+  const auto last = static_cast<size_t>(lastIt - chunks_.begin()) - 1;
+
+  const Shift shift{e.offset, oldEnd, delta};
+
+  // An edit strictly inside one parsed chunk may leave its tokens alone.
+  bool printable = first == last && !chunks_[first].dirty && chunks_[first].decl;
+  uint64_t oldPrint = 0;
+  if (printable) {
+    const Chunk& c = chunks_[first];
+    oldPrint = fingerprint(c.begin, c.end, &shift, printable);
+  }
+
+  buffer_.replace(e.offset, e.removed, e.inserted);
+  lines_.reset();
+
+  Chunk& head = chunks_[first];
+  head.end = static_cast<uint32_t>(chunks_[last].end + delta);
+  head.dirty = true;
+  if (last > first) {
+    head.decl = NodeId();
+    head.diags.clear();
+    chunks_.erase(chunks_.begin() + first + 1, chunks_.begin() + last + 1);
+  }
+  for (size_t i = first + 1; i < chunks_.size(); ++i) {
+    Chunk& c = chunks_[i];
+    c.begin = static_cast<uint32_t>(c.begin + delta);
+    c.end = static_cast<uint32_t>(c.end + delta);
+  }
+  if (delta != 0) moveAll(shift);
+  if (printable) keepByFingerprint(chunks_[first], oldPrint);
+
+  for (size_t i = 0; i < chunks_.size();) i = chunks_[i].dirty ? reparse(i) : i + 1;
+  finish();
+  return true;
+}
+
+bool IncrementalParser::keepByFingerprint(Chunk& c, uint64_t oldPrint) {
+  bool ok = true;
+  uint64_t newPrint = fingerprint(c.begin, c.end, nullptr, ok);
+  if (!ok || newPrint != oldPrint) return false;
+  c.dirty = false;
+  ++stats_.keptByPrint;
+  return true;
+}
+
+// Hashes kind, text and offset of every token in [begin, end). With
+// `edited`, the text is the one before that edit and offsets are mapped
+// to where they end up after it; a token starting inside the replaced bytes
+// has no such position and clears `ok`. `ok` is also cleared unless the
+// next token (or eof) starts exactly at `end`, since otherwise the chunk
+// boundary has moved.
+uint64_t IncrementalParser::fingerprint(uint32_t begin, uint32_t end, const Shift* edited,
+                                        bool& ok) {
+  Diagnostics scratch(fileName_);
+  Lexer lexer(text(), scratch, interner_, mode_);
+  lexer.seek(begin);
+  uint64_t h = kPrintMul;
+  while (true) {
+    Token tok = lexer.next();
+    const size_t at = lexer.offsetOf(tok);
+    if (at >= end) {
+      ok = ok && at == end;
+      return h;
+    }
+    SourcePos p = tok.pos;
+    if (edited) {
+      if (p.offset >= edited->start && p.offset < edited->oldEnd) {
+        ok = false;
+        return 0;
+      }
+      p = edited->map(p);
+    }
+    h = hashMix(h ^ hashBytes(tok.text), kPrintMul);
+    h = hashMix(h ^ static_cast<uint64_t>(tok.kind), kPrintMul);
+    h = hashMix(h ^ p.offset, kPrintMul);
+  }
+}
+
+// Re-parses from the start of dirty chunk `first` until the parser reaches
+// the boundary of a clean chunk, and returns the index after the chunks that
+// replaced what it passed over.
+size_t IncrementalParser::reparse(size_t first) {
+  const uint32_t from = chunks_[first].begin;
+  Diagnostics diags(fileName_);
+  Lexer lexer(text(), diags, interner_, mode_);
+  lexer.seek(from);
+  Parser parser(lexer, diags, *ast_, tables_);
+
+  std::vector<Chunk> fresh;
+  Chunk next{from, 0, NodeId(), false, {}};
+  size_t reported = 0;
+  size_t k = first + 1;  // first old chunk the parser has not passed
+  auto takeDiags = [&](Chunk& c) {
+    for (; reported < diags.all().size(); ++reported) {
+      const Diagnostic& d = diags.all()[reported];
+      c.diags.push_back({d.severity, d.pos, diags.message(d)});
+    }
+  };
+  Parser::DeclsEnd end = parser.parseDecls([&](NodeId decl, const Token& lookahead) {
+    const auto at = static_cast<uint32_t>(lexer.offsetOf(lookahead));
+    next.end = at;
+    next.decl = decl;
+    takeDiags(next);
+    fresh.push_back(std::move(next));
+    next = Chunk{at, 0, NodeId(), false, {}};
+    while (k < chunks_.size() && chunks_[k].begin < at) ++k;
+    return k < chunks_.size() && chunks_[k].begin == at && !chunks_[k].dirty;
+  });
+
+  const auto size = static_cast<uint32_t>(text().size());
+  if (end != Parser::DeclsEnd::Stopped) {
+    // The parser read to the end. Declarations it did not report, and an
+    // unfinished one, go in a last chunk, which has errors.
+    k = chunks_.size();
+    if (fresh.empty() || fresh.back().end < size) {
+      next.end = size;
+      fresh.push_back(std::move(next));
+    }
+    takeDiags(fresh.back());
+  }
+  for (Chunk& c : fresh) c.dirty = hasErrors(c.diags);
+  stats_.reparsed += static_cast<uint32_t>(fresh.size());
+  stats_.reparsedBytes += fresh.back().end - from;
+
+  chunks_.erase(chunks_.begin() + first, chunks_.begin() + k);
+  chunks_.insert(chunks_.begin() + first, std::make_move_iterator(fresh.begin()),
+                 std::make_move_iterator(fresh.end()));
+  return first + fresh.size();
+}
+
+// Maps every position in the tree, garbage included, through `shift`. Most
+// of the tree usually lies past an edit, and a linear pass over the node
+// pages beats walking the kept subtrees.
+void IncrementalParser::moveAll(const Shift& shift) {
+  for (uint32_t id = 1; id < ast_->size(); ++id) {
+    Node& node = (*ast_)[NodeId(id)];
+    node.pos = shift.map(node.pos);
+  }
+  for (Chunk& c : chunks_)
+    for (Message& d : c.diags) d.pos = shift.map(d.pos);
+}
+
+void IncrementalParser::finish() {
+  root_ = NodeId();
+  stats_.chunks = static_cast<uint32_t>(chunks_.size());
+  if (ast_->size() > 2 * liveNodes_ + kCompactSlack) compact();
+  std::vector<NodeId> decls;
+  for (const Chunk& c : chunks_) {
+    if (c.dirty) return;
+    if (c.decl) decls.push_back(c.decl);
+  }
+  root_ = ast_->add(NodeKind::Program, {}, decls.data(), decls.size());
+}
+
+// Copies the live subtrees into a new Ast, dropping replaced ones.
+void IncrementalParser::compact() {
+  auto fresh = std::make_unique<Ast>();
+  for (Chunk& c : chunks_) c.decl = copyTree(*ast_, c.decl, *fresh);
+  ast_ = std::move(fresh);
+  liveNodes_ = ast_->size();
+}
+
+const LineTable& IncrementalParser::lines() const {
+  if (!lines_) lines_.emplace(text());
+  return *lines_;
+}
+
+std::vector<IncrementalParser::Message> IncrementalParser::diagnostics() const {
+  std::vector<Message> out;
+  for (const Chunk& c : chunks_) out.insert(out.end(), c.diags.begin(), c.diags.end());
+  std::stable_sort(out.begin(), out.end(),
+                   [](const Message& a, const Message& b) { return a.pos < b.pos; });
+  return out;
+}
+
+}  // namespace byyl
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast/ast.h"
+#include "lex/lexer.h"
+#include "parse/parse_tables.h"
+#include "parse/parser.h"
+#include "support/diagnostics.h"
+#include "support/interner.h"
+#include "support/source_buffer.h"
+
+namespace byyl {
+
+// Replace `removed` bytes at `offset` with `inserted`.
+struct TextEdit {
+  uint32_t offset = 0;
+  uint32_t removed = 0;
+  std::string_view inserted;
+};
+
+// Keeps the syntax tree of one document current across edits, for editor
+// and language-server use.
+//
+// The text is tiled into chunks, one per top-level declaration, each
+// running from the declaration's first token to the next one's (the first
+// chunk also owns the leading trivia). Because the declaration list is
+// left-recursive, a fresh lexer and parser started at a chunk boundary make
+// exactly the decisions a full parse makes there. An edit therefore only
+// dirties the chunks it touches:
+//
+//  * If it stays inside one chunk, that chunk's tokens are fingerprinted
+//    before and after the edit, kind, text and offset alike. Equal
+//    fingerprints (the edit was in whitespace or a comment) keep the
+//    subtree; only positions past the edit are moved.
+//  * Otherwise the dirty chunks are re-lexed and re-parsed one declaration
+//    at a time until the parser reaches the boundary of an untouched chunk,
+//    whose subtree is reused from there on.
+//
+// Chunks after the edit keep their nodes; positions are byte offsets, so
+// when the edit changed the length of the text they all move, in one pass
+// over the node pages. A chunk with an error, lexical or syntactic, stays
+// dirty, so the next edit retries it, and root() is null until the text
+// parses cleanly again. The parser recovers from errors as a full parse
+// does and only starts a chunk where it is back in the state a fresh
+// parse starts in, so diagnostics() lists what a full parse reports.
+// Replaced subtrees stay in the Ast until it is compacted, which
+// happens once they outnumber the live nodes.
+class IncrementalParser {
+ public:
+  IncrementalParser(std::string fileName, std::string_view text, LexMode mode = LexMode::Fast,
+                    const ParseTables& tables = builtinParseTables());
+
+  // Applies `edit` and brings the tree up to date. Returns false, changing
+  // nothing, if the edit reaches past the end of the text.
+  bool edit(const TextEdit& edit);
+
+  std::string_view text() const { return {buffer_.data(), buffer_.size() - SourceBuffer::kPadding}; }
+  // Program node, or null while the text has errors.
+  NodeId root() const { return root_; }
+  const Ast& ast() const { return *ast_; }
+  const Interner& interner() const { return interner_; }
+  // Line starts of the current text, for placing positions.
+  const LineTable& lines() const;
+
+  // A diagnostic with its message formatted, so it outlives the
+  // Diagnostics of the parse that reported it.
+  struct Message {
+    Severity severity = Severity::Error;
+    SourcePos pos;
+    std::string text;
+  };
+  // Diagnostics for the current text, in source order: those of a full
+  // parse, sorted stably by position.
+  std::vector<Message> diagnostics() const;
+
+  // What the last edit (or the initial parse) did.
+  struct Stats {
+    uint32_t chunks = 0;          // top-level declarations in the tree
+    uint32_t keptByPrint = 0;     // dirty chunks kept by their fingerprint
+    uint32_t reparsed = 0;        // declarations parsed again
+    uint32_t reparsedBytes = 0;
+  };
+  const Stats& lastStats() const { return stats_; }
+
+ private:
+  struct Chunk {
+    uint32_t begin = 0;
+    uint32_t end = 0;
+    NodeId decl;
+    bool dirty = false;
+    std::vector<Message> diags;
+  };
+  // The bytes an edit replaced, for moving positions past it.
+  struct Shift {
+    uint32_t start = 0, oldEnd = 0;
+    int64_t delta = 0;
+    SourcePos map(SourcePos p) const {
+      return p.offset < oldEnd ? p : SourcePos{static_cast<uint32_t>(p.offset + delta)};
+    }
+  };
+
+  void parseAll();
+  size_t reparse(size_t first);
+  bool keepByFingerprint(Chunk& c, uint64_t oldPrint);
+  uint64_t fingerprint(uint32_t begin, uint32_t end, const Shift* edited, bool& ok);
+  void moveAll(const Shift& shift);
+  void finish();
+  void compact();
+
+  std::string fileName_;
+  std::string buffer_;  // text followed by SourceBuffer::kPadding NULs
+  LexMode mode_;
+  const ParseTables& tables_;
+  Interner interner_;
+  std::unique_ptr<Ast> ast_;
+  std::vector<Chunk> chunks_;
+  NodeId root_;
+  uint32_t liveNodes_ = 0;
+  Stats stats_;
+  mutable std::optional<LineTable> lines_;  // of the current text
+};
+
+}  // namespace byyl
@@ -0,0 +1,286 @@
+#include "parse/lalr.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace byyl::lr {
+
+FirstSets::FirstSets(const Grammar& g)
+    : nullable(g.numNonterminals(), 0), first(g.numNonterminals(), BitSet(g.numTerminals)) {
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const Production& p : g.productions) {
+      int lhs = g.ntIndex(p.lhs);
+      bool allNullable = true;
+      for (int sym : p.rhs) {
+        if (g.isTerminal(sym)) {
+          if (!first[lhs].test(sym)) {
+            first[lhs].set(sym);
+            changed = true;
+          }
+          allNullable = false;
+          break;
+        }
+        changed |= first[lhs].orWith(first[g.ntIndex(sym)]);
+        if (!nullable[g.ntIndex(sym)]) {
+          allNullable = false;
+          break;
+        }
+      }
+      if (allNullable && !nullable[lhs]) {
+        nullable[lhs] = 1;
+        changed = true;
+      }
+    }
+  }
+}
+
+BitSet FirstSets::firstOfSuffix(const Grammar& g, int production, int from, bool& isNullable) const {
+  BitSet out(g.numTerminals);
+  const auto& rhs = g.productions[production].rhs;
+  for (size_t i = from; i < rhs.size(); ++i) {
+    if (g.isTerminal(rhs[i])) {
+      out.set(rhs[i]);
+      isNullable = false;
+      return out;
+    }
+    out.orWith(first[g.ntIndex(rhs[i])]);
+    if (!nullable[g.ntIndex(rhs[i])]) {
+      isNullable = false;
+      return out;
+    }
+  }
+  isNullable = true;
+  return out;
+}
+
+FollowSets::FollowSets(const Grammar& g, const FirstSets& firsts)
+    : follow(g.numNonterminals(), BitSet(g.numTerminals)) {
+  follow[g.ntIndex(g.start)].set(0);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t p = 0; p < g.productions.size(); ++p) {
+      const Production& prod = g.productions[p];
+      for (size_t i = 0; i < prod.rhs.size(); ++i) {
+        if (g.isTerminal(prod.rhs[i])) continue;
+        bool nullable;
+        BitSet la = firsts.firstOfSuffix(g, static_cast<int>(p), static_cast<int>(i) + 1, nullable);
+        if (nullable) la.orWith(follow[g.ntIndex(prod.lhs)]);
+        changed |= follow[g.ntIndex(prod.rhs[i])].orWith(la);
+      }
+    }
+  }
+}
+
+namespace {
+
+// Solves F(x) = F'(x) ∪ ⋃{F(y) | x R y} for every x, given F' in `sets`.
+// Members of one strongly connected component of R share a single result;
+// this is DeRemer and Pennello's Digraph, Tarjan's SCC walk in disguise.
+class Digraph {
+ public:
+  Digraph(const std::vector<std::vector<int>>& relation, std::vector<BitSet>& sets)
+      : relation_(relation), sets_(sets), depth_(relation.size(), 0) {}
+
+  void run() {
+    for (size_t x = 0; x < relation_.size(); ++x)
+      if (depth_[x] == 0) traverse(static_cast<int>(x));
+  }
+
+ private:
+  static constexpr int kDone = INT32_MAX;
+
+  void traverse(int x) {
+    stack_.push_back(x);
+    const int d = static_cast<int>(stack_.size());
+    depth_[x] = d;
+    for (int y : relation_[x]) {
+      if (depth_[y] == 0) traverse(y);
+      depth_[x] = std::min(depth_[x], depth_[y]);
+      sets_[x].orWith(sets_[y]);
+    }
+    if (depth_[x] == d) {
+      while (true) {
+        int top = stack_.back();
+        stack_.pop_back();
+        depth_[top] = kDone;
+        if (top == x) break;
+        sets_[top] = sets_[x];
+      }
+    }
+  }
+
+  const std::vector<std::vector<int>>& relation_;
+  std::vector<BitSet>& sets_;
+  std::vector<int> depth_;
+  std::vector<int> stack_;
+};
+
+class LalrBuilder {
+ public:
+  explicit LalrBuilder(const Grammar& g) : g_(g), firsts_(g) {}
+
+  Automaton build() {
+    buildLr0();
+    collectGotos();
+    computeReads();
+    computeIncludesAndLookback();
+    assignLookaheads();
+    checkAgainstFollow();
+    return std::move(automaton_);
+  }
+
+ private:
+  int symbolAfterDot(Item it) const {
+    const auto& rhs = g_.productions[it.production].rhs;
+    return it.dot < static_cast<int>(rhs.size()) ? rhs[it.dot] : -1;
+  }
+
+  bool nullable(int sym) const { return !g_.isTerminal(sym) && firsts_.nullable[g_.ntIndex(sym)]; }
+
+  int target(int state, int sym) const {
+    const auto& ts = automaton_.states[state].transitions;
+    auto it = std::lower_bound(ts.begin(), ts.end(), std::make_pair(sym, INT32_MIN));
+    return it != ts.end() && it->first == sym ? it->second : -1;
+  }
+
+  // LR(0) collection: kernels interned by their sorted item lists, states
+  // numbered in discovery order.
+  void buildLr0() {
+    std::map<std::vector<Item>, int> index;
+    auto intern = [&](std::vector<Item> kernel) {
+      auto [it, inserted] = index.emplace(kernel, static_cast<int>(automaton_.states.size()));
+      if (inserted) {
+        automaton_.states.emplace_back();
+        automaton_.states.back().kernel = std::move(kernel);
+      }
+      return it->second;
+    };
+    intern({{0, 0}});
+
+    std::vector<char> added(g_.numNonterminals());
+    for (size_t s = 0; s < automaton_.states.size(); ++s) {
+      std::vector<Item> items = automaton_.states[s].kernel;
+      std::fill(added.begin(), added.end(), 0);
+      for (size_t i = 0; i < items.size(); ++i) {
+        int b = symbolAfterDot(items[i]);
+        if (b < 0 || g_.isTerminal(b) || added[g_.ntIndex(b)]) continue;
+        added[g_.ntIndex(b)] = 1;
+        for (int q : g_.productionsOf(b)) items.push_back({q, 0});
+      }
+
+      std::map<int, std::vector<Item>> next;
+      std::vector<int> reduce;
+      for (Item it : items) {
+        int x = symbolAfterDot(it);
+        if (x < 0) reduce.push_back(it.production);
+        else next[x].push_back({it.production, it.dot + 1});
+      }
+      std::vector<std::pair<int, int>> transitions;
+      for (auto& [x, kernel] : next) {
+        std::sort(kernel.begin(), kernel.end());
+        transitions.emplace_back(x, intern(std::move(kernel)));
+      }
+      std::sort(reduce.begin(), reduce.end());
+      LrState& st = automaton_.states[s];
+      st.transitions = std::move(transitions);
+      for (int prod : reduce) st.reductions.emplace_back(prod, BitSet(g_.numTerminals));
+    }
+  }
+
+  // Numbers every nonterminal transition (p, A). Slot 0 is the virtual
+  // transition on $accept out of the start state, which is followed by eof.
+  void collectGotos() {
+    gotoFrom_.push_back(0);
+    gotoSym_.push_back(g_.productions[0].lhs);
+    gotoIndex_.resize(automaton_.states.size());
+    for (size_t s = 0; s < automaton_.states.size(); ++s)
+      for (auto [x, t] : automaton_.states[s].transitions)
+        if (!g_.isTerminal(x)) {
+          gotoIndex_[s].emplace(x, static_cast<int>(gotoFrom_.size()));
+          gotoFrom_.push_back(static_cast<int>(s));
+          gotoSym_.push_back(x);
+        }
+    gotoIndex_[0].emplace(g_.productions[0].lhs, 0);
+  }
+
+  // Read(p, A) = DR(p, A) ∪ ⋃{Read(r, C) | (p, A) reads (r, C)}, where DR is
+  // the terminals shifted right after the A transition, and (p, A) reads
+  // (r, C) when p --A--> r --C--> and C is nullable.
+  void computeReads() {
+    const size_t n = gotoFrom_.size();
+    follow_.assign(n, BitSet(g_.numTerminals));
+    std::vector<std::vector<int>> reads(n);
+    follow_[0].set(0);
+    for (size_t i = 1; i < n; ++i) {
+      int r = target(gotoFrom_[i], gotoSym_[i]);
+      for (auto [x, t] : automaton_.states[r].transitions) {
+        if (g_.isTerminal(x)) follow_[i].set(x);
+        else if (nullable(x)) reads[i].push_back(gotoIndex_[r].at(x));
+      }
+    }
+    Digraph(reads, follow_).run();
+  }
+
+  // (p', B) includes (p, A) when A -> β B γ, γ can vanish and p --β--> p'.
+  // The same walk over A's productions finds lookback: reducing A -> ω in
+  // q looks back to (p, A) when p --ω--> q.
+  void computeIncludesAndLookback() {
+    includes_.assign(gotoFrom_.size(), {});
+    lookback_.resize(automaton_.states.size());
+    for (size_t i = 0; i < gotoFrom_.size(); ++i) {
+      int a = gotoSym_[i];
+      for (int prod : g_.productionsOf(a)) {
+        const auto& rhs = g_.productions[prod].rhs;
+        std::vector<int> path{gotoFrom_[i]};
+        for (int sym : rhs) path.push_back(target(path.back(), sym));
+        lookback_[path.back()][prod].push_back(static_cast<int>(i));
+        for (int k = static_cast<int>(rhs.size()) - 1; k >= 0; --k) {
+          if (!g_.isTerminal(rhs[k])) includes_[gotoIndex_[path[k]].at(rhs[k])].push_back(static_cast<int>(i));
+          if (!nullable(rhs[k])) break;
+        }
+      }
+    }
+    Digraph(includes_, follow_).run();
+  }
+
+  // LA(q, A -> ω) = ⋃{Follow(p, A) | (q, A -> ω) lookback (p, A)}.
+  void assignLookaheads() {
+    for (size_t q = 0; q < automaton_.states.size(); ++q)
+      for (auto& [prod, la] : automaton_.states[q].reductions)
+        for (int i : lookback_[q][prod]) la.orWith(follow_[i]);
+  }
+
+  // LALR(1) lookaheads refine FOLLOW; anything outside it is a bug here.
+  void checkAgainstFollow() const {
+    FollowSets follows(g_, firsts_);
+    for (size_t q = 0; q < automaton_.states.size(); ++q)
+      for (const auto& [prod, la] : automaton_.states[q].reductions) {
+        if (prod == 0) continue;
+        BitSet extra = la;
+        extra.subtract(follows.follow[g_.ntIndex(g_.productions[prod].lhs)]);
+        if (extra.any())
+          throw GrammarError("internal error: lookahead outside FOLLOW in state " +
+                             std::to_string(q));
+      }
+  }
+
+  const Grammar& g_;
+  FirstSets firsts_;
+  Automaton automaton_;
+  std::vector<int> gotoFrom_, gotoSym_;           // per nonterminal transition
+  std::vector<std::map<int, int>> gotoIndex_;     // per state: symbol -> transition
+  std::vector<BitSet> follow_;                    // Read, then Follow
+  std::vector<std::vector<int>> includes_;
+  std::vector<std::map<int, std::vector<int>>> lookback_;  // per state: production -> transitions
+};
+
+}  // namespace
+
+Automaton buildLalr(const Grammar& g) { return LalrBuilder(g).build(); }
+
+}  // namespace byyl::lr
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "parse/grammar.h"
+#include "support/bitset.h"
+
+namespace byyl::lr {
+
+// LR(0) item: production with a dot before rhs[dot].
+struct Item {
+  int production = 0;
+  int dot = 0;
+
+  friend bool operator==(Item a, Item b) { return a.production == b.production && a.dot == b.dot; }
+  friend bool operator<(Item a, Item b) {
+    return a.production != b.production ? a.production < b.production : a.dot < b.dot;
+  }
+};
+
+struct LrState {
+  std::vector<Item> kernel;
+  std::vector<std::pair<int, int>> transitions;  // (symbol, target), sorted by symbol
+  std::vector<std::pair<int, BitSet>> reductions;  // (production, lookahead terminals)
+};
+
+struct Automaton {
+  std::vector<LrState> states;  // state 0 is the start state
+};
+
+// Nullability and FIRST sets, indexed by nonterminal index.
+struct FirstSets {
+  std::vector<char> nullable;
+  std::vector<BitSet> first;
+
+  explicit FirstSets(const Grammar& g);
+
+  // FIRST of rhs[from..] of `production`; sets `nullable` if it can vanish.
+  BitSet firstOfSuffix(const Grammar& g, int production, int from, bool& nullable) const;
+};
+
+// FOLLOW sets, indexed by nonterminal index; eof follows the start symbol.
+struct FollowSets {
+  std::vector<BitSet> follow;
+
+  FollowSets(const Grammar& g, const FirstSets& firsts);
+};
+
+// LALR(1) automaton: the LR(0) collection with lookaheads computed by
+// DeRemer and Pennello's relations (TOPLAS 4(4), 1982). The canonical LR(1)
+// collection is never built.
+Automaton buildLalr(const Grammar& g);
+
+}  // namespace byyl::lr
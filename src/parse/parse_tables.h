@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+#include "parse/table_format.h"
+
+namespace byyl {
+
+// Read-only view of one packed table set: the constexpr arrays compiled
+// into the parser, or a table file mapped from the cache. The view does not
+// own the arrays.
+struct ParseTables {
+  int numStates = 0;
+  int numTerminals = 0;
+  int numNonterminals = 0;
+  int numRules = 0;
+  int tableSize = 0;
+  const int16_t* actionBase = nullptr;     // per state
+  const int16_t* defaultAction = nullptr;  // per state
+  const int16_t* gotoBase = nullptr;       // per nonterminal
+  const int16_t* defaultGoto = nullptr;    // per nonterminal
+  const int16_t* table = nullptr;
+  const int16_t* check = nullptr;
+  const uint8_t* ruleLength = nullptr;
+  const uint16_t* ruleLhs = nullptr;       // nonterminal index
+  const uint8_t* ruleAction = nullptr;     // the parser's semantic action number
+  // Error recovery (lr::RecoveryEntry): per state an entry or -1, and per
+  // entry its nonterminal and its sync and stop bitsets.
+  int numRecovery = 0;
+  const int16_t* stateRecovery = nullptr;
+  const uint16_t* recoveryLhs = nullptr;
+  const uint8_t* recoverySets = nullptr;
+
+  int16_t action(int state, int terminal) const {
+    return lookup(actionBase[state], terminal, defaultAction[state]);
+  }
+  int gotoState(int state, int nonterminal) const {
+    return lookup(gotoBase[nonterminal], state, defaultGoto[nonterminal]);
+  }
+  int setBytes() const { return (numTerminals + 7) / 8; }
+  bool synchronizes(int entry, int terminal) const { return inSet(2 * entry, terminal); }
+  bool stops(int entry, int terminal) const { return inSet(2 * entry + 1, terminal); }
+
+ private:
+  int16_t lookup(int base, int column, int16_t fallback) const {
+    if (base != parse_format::kNoBase) {
+      unsigned i = static_cast<unsigned>(base + column);
+      if (i < static_cast<unsigned>(tableSize) && check[i] == column) return table[i];
+    }
+    return fallback;
+  }
+  bool inSet(int set, int terminal) const {
+    return recoverySets[set * setBytes() + terminal / 8] >> (terminal % 8) & 1;
+  }
+};
+
+}  // namespace byyl
@@ -0,0 +1,546 @@
+#include "parse/parser.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace byyl {
+
+namespace {
+#include "parse_tables.inc"
+
+namespace pf = parse_format;
+
+constexpr ParseTables kBuiltinTables = {
+    kParseNumStates,
+    kParseNumTerminals,
+    kParseNumNonterminals,
+    static_cast<int>(sizeof kRuleLength),
+    kParseTableSize,
+    kParseActionBase,
+    kParseDefaultAction,
+    kParseGotoBase,
+    kParseDefaultGoto,
+    kParseTable,
+    kParseCheck,
+    kRuleLength,
+    kRuleLhs,
+    kRuleAction,
+    kParseNumRecovery,
+    kParseStateRecovery,
+    kParseRecoveryLhs,
+    kParseRecoverySets,
+};
+
+}  // namespace
+
+const ParseTables& builtinParseTables() { return kBuiltinTables; }
+
+int Parser::actionIndex(std::string_view name) {
+  for (size_t i = 0; i < std::size(kParseActionNames); ++i)
+    if (name == kParseActionNames[i]) return static_cast<int>(i);
+  return -1;
+}
+
+// One parser stack entry: the token for a shifted terminal, or the result of
+// a reduction, which is a node, a list, or nothing. Lists under
+// construction nest like the LR stack itself, so they share one scratch
+// stack: a list is scratch_[list, top) and is always topmost when items are
+// appended or when it is consumed.
+struct Parser::Value {
+  Token token;
+  SourcePos pos;
+  NodeId node;
+  uint32_t list = 0;
+  uint32_t scratchTop = 0;  // scratch_.size() once this value was pushed
+};
+
+Parser::Parser(Lexer& lexer, Diagnostics& diags, Ast& ast, const ParseTables& tables)
+    : lexer_(lexer), diags_(diags), ast_(ast), tables_(tables) {}
+
+NodeId Parser::parse() {
+  NodeId root;
+  run(nullptr, root);
+  return root;
+}
+
+Parser::DeclsEnd Parser::parseDecls(const DeclHook& onDecl) {
+  NodeId root;
+  return run(&onDecl, root);
+}
+
+Parser::DeclsEnd Parser::run(const DeclHook* onDecl, NodeId& root) {
+  constexpr auto kListAppend = static_cast<uint8_t>(ParseAction::ListAppend);
+  std::vector<int> states{0};
+  std::vector<Value> values;
+  Token tok = nextToken();
+  while (true) {
+    int16_t act = tables_.action(states.back(), static_cast<int>(tok.kind));
+    if (pf::isShift(act)) {
+      states.push_back(act);
+      Value v;
+      v.token = tok;
+      v.pos = tok.pos;
+      v.scratchTop = static_cast<uint32_t>(scratch_.size());
+      values.push_back(v);
+      ++shifts_;
+      if (quiet_ > 0) --quiet_;
+      tok = nextToken();
+    } else if (pf::isReduce(act)) {
+      int prod = -act;
+      int len = tables_.ruleLength[prod];
+      Value result = reduce(tables_.ruleAction[prod], values.data() + values.size() - len, len);
+      if (len == 0) result.pos = tok.pos;
+      states.resize(states.size() - len);
+      values.resize(values.size() - len);
+      states.push_back(tables_.gotoState(states.back(), tables_.ruleLhs[prod]));
+      result.scratchTop = static_cast<uint32_t>(scratch_.size());
+      values.push_back(result);
+      // Only the declaration list sits at the bottom of the stack. Just
+      // after a recovery, errors are still muted or repaired tokens queued,
+      // and a parse started here would not know it, so no boundary is
+      // reported until those have passed.
+      if (onDecl && values.size() == 1 && tables_.ruleAction[prod] == kListAppend &&
+          quiet_ == 0 && ahead_.empty() && (*onDecl)(scratch_.back(), tok))
+        return DeclsEnd::Stopped;
+    } else if (act == pf::kAccept) {
+      if (!failed_) root = values.back().node;
+      return DeclsEnd::Eof;
+    } else {
+      if (quiet_ == 0) reportError(states.back(), tok);
+      if (!recover(states, values, tok)) return DeclsEnd::Error;
+    }
+  }
+}
+
+Token Parser::nextToken() {
+  if (ahead_.empty()) return lexToken();
+  Token tok = ahead_.front();
+  ahead_.pop_front();
+  return tok;
+}
+
+// The lexer has already reported its error tokens; dropping them lets the
+// parse continue as if the bad characters were not there.
+Token Parser::lexToken() {
+  Token tok;
+  do {
+    tok = lexer_.next();
+  } while (tokenErrorMessage(tok.kind));
+  return tok;
+}
+
+int Parser::trial(const std::vector<int>& states, const TokenKind* kinds, int n) {
+  constexpr int kMaxSteps = 256;  // reductions included
+  // The simulated stack is states[0, base) below trialStack_.
+  size_t base = states.size();
+  trialStack_.clear();
+  auto top = [&] { return trialStack_.empty() ? states[base - 1] : trialStack_.back(); };
+  int shifted = 0;
+  for (int step = 0; shifted < n && step < kMaxSteps; ++step) {
+    const int16_t act = tables_.action(top(), static_cast<int>(kinds[shifted]));
+    if (pf::isShift(act)) {
+      trialStack_.push_back(act);
+      ++shifted;
+    } else if (pf::isReduce(act)) {
+      size_t len = tables_.ruleLength[-act];
+      const size_t popped = std::min(len, trialStack_.size());
+      trialStack_.resize(trialStack_.size() - popped);
+      base -= len - popped;
+      trialStack_.push_back(tables_.gotoState(top(), tables_.ruleLhs[-act]));
+    } else {
+      return act == pf::kAccept ? n : shifted;
+    }
+  }
+  return shifted;
+}
+
+// Phrase-level recovery: the first single-token edit at `tok` after which
+// the parser gets through the whole lookahead window.
+bool Parser::repair(const std::vector<int>& states, Token& tok) {
+  constexpr size_t kWindow = 4;  // the token in error and three after it
+  while (ahead_.size() + 1 < kWindow &&
+         (ahead_.empty() ? tok : ahead_.back()).kind != TokenKind::eof)
+    ahead_.push_back(lexToken());
+  TokenKind kinds[kWindow + 1];
+  kinds[1] = tok.kind;
+  for (size_t i = 0; i < ahead_.size(); ++i) kinds[i + 2] = ahead_[i].kind;
+  const int n = static_cast<int>(ahead_.size() + 1);
+
+  // Only tokens with a fixed spelling are made up; an identifier or a
+  // literal would need text.
+  auto fixed = [](int t) { return tokenSpelling(static_cast<TokenKind>(t))[0] == '\''; };
+  auto made = [&](int t) {
+    Token m;
+    m.kind = static_cast<TokenKind>(t);
+    m.text = tok.text.substr(0, 0);
+    m.pos = tok.pos;
+    return m;
+  };
+  for (int t = 0; t < tables_.numTerminals; ++t) {
+    kinds[0] = static_cast<TokenKind>(t);
+    if (fixed(t) && trial(states, kinds, n + 1) == n + 1) {
+      ahead_.push_front(tok);
+      tok = made(t);
+      return true;
+    }
+  }
+  if (tok.kind != TokenKind::eof && trial(states, kinds + 2, n - 1) == n - 1) {
+    tok = nextToken();
+    return true;
+  }
+  for (int t = 0; t < tables_.numTerminals; ++t) {
+    kinds[1] = static_cast<TokenKind>(t);
+    if (fixed(t) && t != static_cast<int>(tok.kind) && trial(states, kinds + 1, n) == n) {
+      tok = made(t);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Parser::recover(std::vector<int>& states, std::vector<Value>& values, Token& tok) {
+  failed_ = true;
+  if (shifts_ == recoveredAt_) {
+    // Stuck where the last recovery left off: drop the token and retry.
+    if (tok.kind == TokenKind::eof) return false;
+    tok = nextToken();
+    return true;
+  }
+  if (repair(states, tok)) return true;
+
+  const SourcePos at = tok.pos;
+  size_t k = states.size();
+  while (k > 0 && tables_.stateRecovery[states[k - 1]] < 0) --k;
+  if (k == 0) return false;
+  const int entry = tables_.stateRecovery[states[k - 1]];
+  for (;; tok = nextToken()) {
+    const int t = static_cast<int>(tok.kind);
+    size_t resume = 0;
+    if (tables_.synchronizes(entry, t)) {
+      resume = k;
+    } else if (tables_.stops(entry, t)) {
+      for (size_t j = k - 1; j > 0 && !resume; --j) {
+        const int e = tables_.stateRecovery[states[j - 1]];
+        if (e >= 0 && tables_.synchronizes(e, t)) resume = j;
+      }
+    }
+    if (resume) {
+      states.resize(resume);
+      values.resize(resume - 1);
+      scratch_.resize(values.empty() ? 0 : values.back().scratchTop);
+      const int e = tables_.stateRecovery[states.back()];
+      states.push_back(tables_.gotoState(states.back(), tables_.recoveryLhs[e]));
+      Value v;
+      v.pos = at;
+      v.node = ast_.add(NodeKind::Error, at);
+      v.scratchTop = static_cast<uint32_t>(scratch_.size());
+      values.push_back(v);
+      quiet_ = 3;
+      recoveredAt_ = shifts_;
+      return true;
+    }
+    if (tok.kind == TokenKind::eof) return false;
+  }
+}
+
+void Parser::reportError(int state, const Token& tok) {
+  if (!diags_.keeps(Severity::Error)) return reportUnexpected(tok, {});
+  std::string expected;
+  int count = 0;
+  for (int t = 0; t < tables_.numTerminals; ++t) {
+    if (tables_.action(state, t) == pf::kError) continue;
+    if (++count > 1) expected += ", ";
+    expected += tokenSpelling(static_cast<TokenKind>(t));
+  }
+  reportUnexpected(tok, count <= 6 ? expected : std::string());
+}
+
+void Parser::reportUnexpected(const Token& tok, const std::string& expected) {
+  const bool spelled = tok.kind == TokenKind::identifier || tok.kind == TokenKind::int_literal;
+  const DiagArg kind = tokenSpelling(tok.kind);
+  if (expected.empty()) {
+    if (spelled) diags_.error(tok.pos, "unexpected {} '{}'", {kind, tok.text});
+    else diags_.error(tok.pos, "unexpected {}", {kind});
+  } else {
+    if (spelled) diags_.error(tok.pos, "unexpected {} '{}'; expected {}", {kind, tok.text, expected});
+    else diags_.error(tok.pos, "unexpected {}; expected {}", {kind, expected});
+  }
+}
+
+int64_t Parser::literalValue(const Token& tok) {
+  int64_t value = 0;
+  for (char c : tok.text) {
+    int digit = c - '0';
+    if (value > (INT64_MAX - digit) / 10) {
+      diags_.error(tok.pos, "integer literal '{}' is too large", {tok.text});
+      return 0;
+    }
+    value = value * 10 + digit;
+  }
+  return value;
+}
+
+NodeId Parser::takeList(NodeKind kind, SourcePos pos, uint32_t list,
+                        std::initializer_list<NodeId> head) {
+  scratch_.insert(scratch_.begin() + list, head);
+  NodeId n = ast_.add(kind, pos, scratch_.data() + list, scratch_.size() - list);
+  scratch_.resize(list);
+  return n;
+}
+
+Parser::Value Parser::reduce(uint8_t actionIndex, Value* rhs, int len) {
+  Value out;
+  const auto action = static_cast<ParseAction>(actionIndex);
+  if (len > 0) out.pos = rhs[0].pos;
+
+  auto node = [&](NodeKind kind, SourcePos pos, std::initializer_list<NodeId> kids = {}) {
+    out.node = ast_.add(kind, pos, kids);
+    return &ast_[out.node];
+  };
+
+  switch (action) {
+    case ParseAction::Pass:
+      if (len > 0) out = rhs[0];
+      break;
+    case ParseAction::None:
+      break;
+    case ParseAction::Second:
+      out = rhs[1];
+      break;
+    case ParseAction::ListEmpty:
+      out.list = static_cast<uint32_t>(scratch_.size());
+      break;
+    case ParseAction::ListSingle:
+      out.list = static_cast<uint32_t>(scratch_.size());
+      scratch_.push_back(rhs[0].node);
+      break;
+    case ParseAction::ListAppend:
+      out = rhs[0];
+      scratch_.push_back(rhs[1].node);
+      break;
+    case ParseAction::ListAppendSep:
+      out = rhs[0];
+      scratch_.push_back(rhs[2].node);
+      break;
+    case ParseAction::Program:
+      out.node = takeList(NodeKind::Program, {}, rhs[0].list);
+      break;
+    case ParseAction::FuncDecl: {
+      NodeId params = takeList(NodeKind::List, rhs[2].pos, rhs[3].list);
+      node(NodeKind::FuncDecl, rhs[1].pos, {params, rhs[5].node, rhs[6].node})->name =
+          rhs[1].token.symbol;
+      break;
+    }
+    case ParseAction::Param:
+      node(NodeKind::Param, rhs[0].pos, {rhs[2].node})->name = rhs[0].token.symbol;
+      break;
+    case ParseAction::TypeDecl:
+      node(NodeKind::TypeDecl, rhs[1].pos, {rhs[3].node})->name = rhs[1].token.symbol;
+      break;
+    case ParseAction::VarDecl:
+      node(NodeKind::VarDecl, rhs[1].pos, {rhs[3].node, NodeId()})->name = rhs[1].token.symbol;
+      break;
+    case ParseAction::VarDeclInit:
+      node(NodeKind::VarDecl, rhs[1].pos, {rhs[3].node, rhs[5].node})->name =
+          rhs[1].token.symbol;
+      break;
+    case ParseAction::IntType:
+      node(NodeKind::IntType, out.pos);
+      break;
+    case ParseAction::BoolType:
+      node(NodeKind::BoolType, out.pos);
+      break;
+    case ParseAction::NamedType:
+      node(NodeKind::NamedType, out.pos)->name = rhs[0].token.symbol;
+      break;
+    case ParseAction::ArrayType:
+      node(NodeKind::ArrayType, out.pos, {rhs[0].node})->value = literalValue(rhs[2].token);
+      break;
+    case ParseAction::RecordType:
+      out.node = takeList(NodeKind::RecordType, out.pos, rhs[2].list);
+      break;
+    case ParseAction::FieldAppend: {
+      out = rhs[0];
+      NodeId field = ast_.add(NodeKind::Field, rhs[1].pos, {rhs[3].node});
+      ast_[field].name = rhs[1].token.symbol;
+      scratch_.push_back(field);
+      break;
+    }
+    case ParseAction::Block:
+      out.node = takeList(NodeKind::Block, out.pos, rhs[1].list);
+      break;
+    case ParseAction::ExprStmt:
+      node(NodeKind::ExprStmt, out.pos, {rhs[0].node});
+      break;
+    case ParseAction::EmptyStmt:
+      node(NodeKind::EmptyStmt, out.pos);
+      break;
+    case ParseAction::If:
+      node(NodeKind::If, out.pos, {rhs[2].node, rhs[4].node, NodeId()});
+      break;
+    case ParseAction::IfElse:
+      node(NodeKind::If, out.pos, {rhs[2].node, rhs[4].node, rhs[6].node});
+      break;
+    case ParseAction::While:
+      node(NodeKind::While, out.pos, {rhs[2].node, rhs[4].node});
+      break;
+    case ParseAction::For:
+      node(NodeKind::For, out.pos, {rhs[2].node, rhs[4].node, rhs[6].node, rhs[8].node});
+      break;
+    case ParseAction::Switch:
+      out.node = takeList(NodeKind::Switch, out.pos, rhs[5].list, {rhs[2].node});
+      break;
+    case ParseAction::Case:
+    case ParseAction::CaseNegative: {
+      bool negative = action == ParseAction::CaseNegative;
+      int64_t label = literalValue(rhs[negative ? 2 : 1].token);
+      out.node = takeList(NodeKind::Case, out.pos, rhs[negative ? 4 : 3].list);
+      ast_[out.node].value = negative ? -label : label;
+      break;
+    }
+    case ParseAction::Default:
+      out.node = takeList(NodeKind::Default, out.pos, rhs[2].list);
+      break;
+    case ParseAction::Break:
+      node(NodeKind::Break, out.pos);
+      break;
+    case ParseAction::Continue:
+      node(NodeKind::Continue, out.pos);
+      break;
+    case ParseAction::Return:
+      node(NodeKind::Return, out.pos, {NodeId()});
+      break;
+    case ParseAction::ReturnValue:
+      node(NodeKind::Return, out.pos, {rhs[1].node});
+      break;
+    case ParseAction::Print:
+      out.node = takeList(NodeKind::Print, out.pos, rhs[2].list);
+      break;
+    case ParseAction::Assign:
+      node(NodeKind::Assign, rhs[1].pos, {rhs[0].node, rhs[2].node});
+      break;
+    case ParseAction::Binary:
+      node(NodeKind::Binary, rhs[1].pos, {rhs[0].node, rhs[2].node})->op = rhs[1].token.kind;
+      break;
+    case ParseAction::Unary:
+      node(NodeKind::Unary, out.pos, {rhs[1].node})->op = rhs[0].token.kind;
+      break;
+    case ParseAction::Call:
+      out.node = takeList(NodeKind::Call, rhs[1].pos, rhs[2].list, {rhs[0].node});
+      break;
+    case ParseAction::Index:
+      node(NodeKind::Index, rhs[1].pos, {rhs[0].node, rhs[2].node});
+      break;
+    case ParseAction::Member:
+      node(NodeKind::Member, rhs[2].pos, {rhs[0].node})->name = rhs[2].token.symbol;
+      break;
+    case ParseAction::Name:
+      node(NodeKind::Name, out.pos)->name = rhs[0].token.symbol;
+      break;
+    case ParseAction::IntLiteral:
+      node(NodeKind::IntLiteral, out.pos)->value = literalValue(rhs[0].token);
+      break;
+    case ParseAction::BoolLiteral:
+      node(NodeKind::BoolLiteral, out.pos)->value = rhs[0].token.kind == TokenKind::kw_true;
+      break;
+    case ParseAction::StringLiteral:
+      node(NodeKind::StringLiteral, out.pos)->value = ast_.addText(rhs[0].token.text);
+      break;
+  }
+  return out;
+}
+
+// The terminal-level steps the generated Descent is written in. A
+// recursive-descent parse keeps its state on the C++ stack, so there is
+// nothing to repair: fail() reports the error and unwinds to
+// parseDescent().
+class Parser::DescentBase {
+ public:
+  struct SyntaxError {};
+
+  explicit DescentBase(Parser& parser) : p_(parser), tok_(parser.nextToken()) {}
+
+ protected:
+  // Rule calls in progress at most. For the built-in grammar that is some
+  // 340 nested parentheses or 680 nested blocks, in under 2 MB of stack.
+  static constexpr uint32_t kMaxDepth = 2048;
+
+  // Held by every generated rule function while it runs. Input nested
+  // deeper than kMaxDepth rules stops the parse the way a syntax error
+  // does, rather than overflowing the stack.
+  class Nested {
+   public:
+    explicit Nested(DescentBase& d) : d_(d) {
+      if (++d_.depth_ > kMaxDepth) d_.tooDeep();
+    }
+    Nested(const Nested&) = delete;
+    Nested& operator=(const Nested&) = delete;
+    ~Nested() { --d_.depth_; }
+
+   private:
+    DescentBase& d_;
+  };
+
+  // A token's entry in a generated operator table, for precedence climbing:
+  // its %left/%right/%nonassoc level, or 0 if it ends the expression, and
+  // the least level its right operand may contain (one more for %left and
+  // %nonassoc, the same for %right).
+  struct Operator {
+    uint8_t level;
+    uint8_t next;
+    bool nonassoc;
+    ParseAction action;
+  };
+
+  TokenKind peek() const { return tok_.kind; }
+
+  Value shift() {
+    Value v;
+    v.token = tok_;
+    v.pos = tok_.pos;
+    tok_ = p_.nextToken();
+    return v;
+  }
+
+  Value expect(TokenKind kind) {
+    if (tok_.kind != kind) fail(tokenSpelling(kind));
+    return shift();
+  }
+
+  [[noreturn]] void fail(const char* expected) {
+    p_.reportUnexpected(tok_, expected);
+    throw SyntaxError();
+  }
+
+  [[noreturn]] void tooDeep() {
+    p_.diags_.error(tok_.pos, "nesting too deep");
+    throw SyntaxError();
+  }
+
+  Value reduce(ParseAction action, Value* rhs, int len) {
+    Value v = p_.reduce(static_cast<uint8_t>(action), rhs, len);
+    if (len == 0) v.pos = tok_.pos;
+    return v;
+  }
+
+ private:
+  Parser& p_;
+  Token tok_;
+  uint32_t depth_ = 0;
+};
+
+#include "parse_descent.inc"
+
+NodeId Parser::parseDescent() {
+  try {
+    return Descent(*this).start().node;
+  } catch (const DescentBase::SyntaxError&) {
+    scratch_.clear();
+    return NodeId();
+  }
+}
+
+}  // namespace byyl
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <string_view>
+#include <vector>
+
+#include "ast/ast.h"
+#include "lex/lexer.h"
+#include "lex/token.h"
+#include "parse/parse_tables.h"
+#include "support/diagnostics.h"
+
+namespace byyl {
+
+// The constexpr tables byyl-lrgen generated from src/parse/byyl.grammar at
+// build time; using them costs nothing at startup.
+const ParseTables& builtinParseTables();
+
+// Table-driven LALR(1) parser. It pulls tokens from the lexer one at a
+// time, so memory is bounded by the parse stack and the tree, never by a
+// token vector. Other tables (a grammar loaded with
+// --grammar) must use the same terminals, and their ruleAction entries must
+// be this parser's action numbers; see actionIndex().
+//
+// parse() reports every syntax error in the input. At an error it first
+// tries a phrase-level repair: inserting one token, deleting the current
+// one or replacing it, whichever lets the parser go on through the next few
+// tokens, checked on a copy of the stack top. Failing that it recovers in
+// panic mode from the tables' recovery entries: it pops to the innermost
+// state with a goto on a %recover nonterminal, discards tokens until one
+// that state (or an enclosing one) synchronizes on, and pushes an Error
+// node for the nonterminal. Every state popped was pushed once and every
+// token discarded is read once, so recovery keeps the parse linear. Errors
+// in the next three tokens after a panic recovery are not reported, as in
+// yacc, and an error at the same point with no token shifted since drops
+// that token, which guarantees progress.
+class Parser {
+ public:
+  // Nodes are added to `ast`.
+  Parser(Lexer& lexer, Diagnostics& diags, Ast& ast,
+         const ParseTables& tables = builtinParseTables());
+
+  // Number of the semantic action called `name` in a grammar file ("Pass"
+  // for pass-through alternatives), or -1 if the parser has none by that
+  // name.
+  static int actionIndex(std::string_view name);
+
+  // Returns the Program node, or null after reporting syntax errors.
+  NodeId parse();
+
+  // parse() by the recursive-descent parser byyl-lrgen generated from the
+  // built-in grammar (--parser=descent), ignoring the tables. It builds the
+  // same tree through the same semantic actions, choosing alternatives by
+  // switches on the lookahead instead of ACTION lookups, but stops at the
+  // first syntax error.
+  NodeId parseDescent();
+
+  // Declaration-at-a-time parsing for IncrementalParser. After each
+  // top-level declaration is reduced, onDecl(decl, lookahead) is called and
+  // may return true to stop there. This relies on the start symbol being a
+  // left-recursive declaration list, as in the built-in grammar: the parser
+  // is then in the same state at every declaration boundary, so it can be
+  // started at any of them. Errors are recovered from as parse() does, and
+  // until the parser is back to normal after a recovery, the declarations
+  // it reduces are not reported; the next one reported stands for them.
+  // Error is returned only when recovery runs into the end of the input.
+  enum class DeclsEnd { Eof, Stopped, Error };
+  using DeclHook = std::function<bool(NodeId decl, const Token& lookahead)>;
+  DeclsEnd parseDecls(const DeclHook& onDecl);
+
+ private:
+  struct Value;
+  class DescentBase;
+  class Descent;  // generated into parse_descent.inc
+
+  DeclsEnd run(const DeclHook* onDecl, NodeId& root);
+
+  Token nextToken();
+  Token lexToken();
+  // How many of `kinds` the parser would shift from `states` before an
+  // error; n if it accepts first.
+  int trial(const std::vector<int>& states, const TokenKind* kinds, int n);
+  bool repair(const std::vector<int>& states, Token& tok);
+  bool recover(std::vector<int>& states, std::vector<Value>& values, Token& tok);
+  // Semantic action `action` (a ParseAction) for a rule of `len` symbols,
+  // whose values are at `rhs`. An empty rule's position is left to the
+  // caller.
+  Value reduce(uint8_t action, Value* rhs, int len);
+  // Adds a node whose kids are `head` followed by the list at `list`, and
+  // pops that list off the scratch stack.
+  NodeId takeList(NodeKind kind, SourcePos pos, uint32_t list,
+                  std::initializer_list<NodeId> head = {});
+  void reportError(int state, const Token& tok);
+  // "unexpected X; expected <expected>", or without the list if it is empty.
+  void reportUnexpected(const Token& tok, const std::string& expected);
+  int64_t literalValue(const Token& tok);
+
+  Lexer& lexer_;
+  Diagnostics& diags_;
+  Ast& ast_;
+  const ParseTables& tables_;
+  std::vector<NodeId> scratch_;
+
+  // Error recovery.
+  std::deque<Token> ahead_;   // read from the lexer but not yet by the parser
+  std::vector<int> trialStack_;
+  bool failed_ = false;
+  int quiet_ = 0;             // tokens to shift before errors are reported again
+  size_t shifts_ = 0;
+  size_t recoveredAt_ = SIZE_MAX;  // shifts_ at the last panic recovery
+};
+
+}  // namespace byyl
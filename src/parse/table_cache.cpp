@@ -0,0 +1,47 @@
+#include "parse/table_cache.h"
+
+#include <cstdio>
+
+#include "parse/lalr.h"
+#include "parse/tables.h"
+#include "support/cache_dir.h"
+
+namespace byyl::lr {
+
+std::string defaultTableCacheDir() { return defaultCacheDir(); }
+
+std::string tableCachePath(const std::string& dir, uint64_t key) {
+  char name[32];
+  std::snprintf(name, sizeof name, "%016llx.lrt", static_cast<unsigned long long>(key));
+  return dir + "/" + name;
+}
+
+std::string buildTableFile(const std::string& grammarText,
+                           const std::vector<TerminalInfo>& terminals, const std::string& path,
+                           std::string& writeError) {
+  Grammar g = parseGrammar(grammarText, terminals);
+  PackedTables packed = pack(buildTable(g, buildLalr(g)));
+  std::string bytes = serializeTables(g, packed, tableKey(grammarText, terminals));
+  writeFileAtomically(path, bytes, writeError);
+  return bytes;
+}
+
+TableFile loadTables(const std::string& grammarText, const std::vector<TerminalInfo>& terminals,
+                     const std::string& dir, bool& cacheHit, std::string& warning) {
+  uint64_t key = tableKey(grammarText, terminals);
+  std::string path = tableCachePath(dir, key);
+  std::string error;
+  if (auto file = TableFile::open(path, key, error)) {
+    cacheHit = true;
+    return std::move(*file);
+  }
+  cacheHit = false;
+  std::string writeError;
+  std::string bytes = buildTableFile(grammarText, terminals, path, writeError);
+  if (!writeError.empty()) warning = "cannot write table cache " + path + ": " + writeError;
+  auto file = TableFile::fromBytes(bytes, key, error);
+  if (!file) throw GrammarError("internal error: generated table file is invalid: " + error);
+  return std::move(*file);
+}
+
+}  // namespace byyl::lr
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "parse/grammar.h"
+#include "parse/table_file.h"
+
+namespace byyl::lr {
+
+// $BYYL_CACHE_DIR, else $XDG_CACHE_HOME/byyl, else $HOME/.cache/byyl.
+std::string defaultTableCacheDir();
+
+// Path of the cached table file for `key` inside `dir`.
+std::string tableCachePath(const std::string& dir, uint64_t key);
+
+// Builds the tables for `grammarText` and writes them to `path` atomically,
+// creating the directory if needed. Returns the serialized bytes. Throws
+// GrammarError for a bad grammar; `writeError` is set when the file cannot
+// be written, which leaves the cache cold but the tables usable.
+std::string buildTableFile(const std::string& grammarText,
+                           const std::vector<TerminalInfo>& terminals, const std::string& path,
+                           std::string& writeError);
+
+// Maps the cached tables for this grammar from `dir`, or builds and caches
+// them on a miss. `cacheHit` reports which happened.
+TableFile loadTables(const std::string& grammarText, const std::vector<TerminalInfo>& terminals,
+                     const std::string& dir, bool& cacheHit, std::string& warning);
+
+}  // namespace byyl::lr
@@ -0,0 +1,245 @@
+#include "parse/table_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "support/hash.h"
+
+namespace byyl::lr {
+
+namespace pf = parse_format;
+
+static_assert(sizeof(TableFileHeader) % 8 == 0, "arrays after the header must stay aligned");
+
+uint64_t tableKey(std::string_view grammarText, const std::vector<TerminalInfo>& terminals) {
+  uint64_t h = hashBytes(grammarText) ^ kTableFileVersion;
+  for (const TerminalInfo& t : terminals) {
+    h = hashMix(h ^ hashBytes(t.name), 0x9e3779b97f4a7c15ull);
+    h = hashMix(h ^ hashBytes(t.spelling), 0x9e3779b97f4a7c15ull);
+  }
+  return h;
+}
+
+namespace {
+
+template <typename T>
+void append(std::string& out, const std::vector<int>& values) {
+  for (int v : values) {
+    T x = static_cast<T>(v);
+    out.append(reinterpret_cast<const char*>(&x), sizeof x);
+  }
+}
+
+}  // namespace
+
+std::string serializeTables(const Grammar& g, const PackedTables& packed, uint64_t key) {
+  if (g.actions.size() > 256) throw GrammarError("too many semantic actions for a table file");
+  std::vector<int> length, lhs, action;
+  for (const Production& p : g.productions) {
+    length.push_back(static_cast<int>(p.rhs.size()));
+    lhs.push_back(g.ntIndex(p.lhs));
+    action.push_back(p.action);
+  }
+
+  std::string payload;
+  append<int16_t>(payload, packed.actionBase);
+  append<int16_t>(payload, packed.defaultAction);
+  append<int16_t>(payload, packed.gotoBase);
+  append<int16_t>(payload, packed.defaultGoto);
+  append<int16_t>(payload, packed.table);
+  append<int16_t>(payload, packed.check);
+  append<int16_t>(payload, packed.stateRecovery);
+  append<uint16_t>(payload, lhs);
+  append<uint16_t>(payload, packed.recoveryLhs);
+  append<uint8_t>(payload, length);
+  append<uint8_t>(payload, action);
+  append<uint8_t>(payload, packed.recoverySets);
+  for (size_t i = 0; i < g.actions.size(); ++i) {
+    payload += i == 0 ? std::string("Pass") : g.actions[i];
+    payload += '\0';
+  }
+
+  TableFileHeader h{};
+  std::memcpy(h.magic, kTableFileMagic, sizeof h.magic);
+  h.version = kTableFileVersion;
+  h.fileSize = static_cast<uint32_t>(sizeof h + payload.size());
+  h.key = key;
+  h.checksum = hashBytes(payload);
+  h.numStates = static_cast<uint32_t>(packed.actionBase.size());
+  h.numTerminals = static_cast<uint32_t>(g.numTerminals);
+  h.numNonterminals = static_cast<uint32_t>(packed.gotoBase.size());
+  h.numRules = static_cast<uint32_t>(g.productions.size());
+  h.tableSize = static_cast<uint32_t>(packed.table.size());
+  h.numActions = static_cast<uint32_t>(g.actions.size());
+  h.numRecovery = static_cast<uint32_t>(packed.recoveryLhs.size());
+  return std::string(reinterpret_cast<const char*>(&h), sizeof h) + payload;
+}
+
+std::optional<TableFile> TableFile::open(const std::string& path, uint64_t key,
+                                         std::string& error) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    error = std::strerror(errno);
+    return std::nullopt;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    error = std::strerror(errno);
+    ::close(fd);
+    return std::nullopt;
+  }
+  if (!S_ISREG(st.st_mode) || static_cast<size_t>(st.st_size) < sizeof(TableFileHeader)) {
+    error = "not a table file";
+    ::close(fd);
+    return std::nullopt;
+  }
+  size_t size = static_cast<size_t>(st.st_size);
+  void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    error = std::strerror(errno);
+    return std::nullopt;
+  }
+  TableFile file;
+  file.data_ = static_cast<const char*>(addr);
+  file.size_ = size;
+  file.mapped_ = size;
+  if (!file.bind(key, error)) return std::nullopt;
+  return file;
+}
+
+std::optional<TableFile> TableFile::fromBytes(std::string_view bytes, uint64_t key,
+                                              std::string& error) {
+  TableFile file;
+  file.owned_.assign(bytes.begin(), bytes.end());
+  file.data_ = file.owned_.data();
+  file.size_ = file.owned_.size();
+  if (!file.bind(key, error)) return std::nullopt;
+  return file;
+}
+
+// Checks the header and checksum, points tables_ into the payload, and
+// range-checks every entry so a damaged file cannot send the parser out of
+// bounds.
+bool TableFile::bind(uint64_t key, std::string& error) {
+  TableFileHeader h;
+  if (size_ < sizeof h) {
+    error = "truncated table file";
+    return false;
+  }
+  std::memcpy(&h, data_, sizeof h);
+  if (std::memcmp(h.magic, kTableFileMagic, sizeof h.magic) != 0) {
+    error = "not a table file";
+    return false;
+  }
+  if (h.version != kTableFileVersion) {
+    error = "table file version " + std::to_string(h.version) + ", expected " +
+            std::to_string(kTableFileVersion);
+    return false;
+  }
+  if (h.key != key) {
+    error = "table file was built from a different grammar";
+    return false;
+  }
+  const size_t s = h.numStates, nt = h.numNonterminals, r = h.numRules, n = h.tableSize;
+  const size_t e = h.numRecovery, sets = 2 * e * ((h.numTerminals + 7) / 8);
+  const size_t arrays = 2 * (3 * s + 2 * nt + 2 * n + r + e) + 2 * r + sets;
+  if (h.fileSize != size_ || size_ < sizeof h + arrays) {
+    error = "truncated table file";
+    return false;
+  }
+  const char* payload = data_ + sizeof h;
+  if (hashBytes(payload, size_ - sizeof h) != h.checksum) {
+    error = "table file checksum mismatch";
+    return false;
+  }
+
+  const char* p = payload;
+  auto take = [&](auto*& out, size_t count) {
+    out = reinterpret_cast<std::remove_reference_t<decltype(out)>>(p);
+    p += count * sizeof(*out);
+  };
+  ParseTables& t = tables_;
+  t.numStates = static_cast<int>(s);
+  t.numTerminals = static_cast<int>(h.numTerminals);
+  t.numNonterminals = static_cast<int>(nt);
+  t.numRules = static_cast<int>(r);
+  t.tableSize = static_cast<int>(n);
+  take(t.actionBase, s);
+  take(t.defaultAction, s);
+  take(t.gotoBase, nt);
+  take(t.defaultGoto, nt);
+  take(t.table, n);
+  take(t.check, n);
+  take(t.stateRecovery, s);
+  take(t.ruleLhs, r);
+  take(t.recoveryLhs, e);
+  take(t.ruleLength, r);
+  take(t.ruleAction, r);
+  take(t.recoverySets, sets);
+  t.numRecovery = static_cast<int>(e);
+
+  actionNames_.clear();
+  const char* end = data_ + size_;
+  while (p < end) {
+    const char* nul = static_cast<const char*>(std::memchr(p, '\0', static_cast<size_t>(end - p)));
+    if (!nul) break;
+    actionNames_.emplace_back(p, static_cast<size_t>(nul - p));
+    p = nul + 1;
+  }
+
+  auto validAction = [&](int16_t a) {
+    return a == pf::kAccept || (pf::isShift(a) && static_cast<size_t>(a) < s) ||
+           (pf::isReduce(a) && static_cast<size_t>(-a) < r) || a == pf::kError;
+  };
+  bool ok = p == end && actionNames_.size() == h.numActions && s > 0;
+  for (size_t i = 0; ok && i < s; ++i) ok = validAction(t.defaultAction[i]);
+  for (size_t i = 0; ok && i < nt; ++i)
+    ok = t.defaultGoto[i] >= 0 && static_cast<size_t>(t.defaultGoto[i]) < s;
+  // Whether a slot is an ACTION or a GOTO entry depends on whose base
+  // reaches it, so accept a value valid as either.
+  for (size_t i = 0; ok && i < n; ++i) ok = validAction(t.table[i]);
+  for (size_t i = 0; ok && i < r; ++i)
+    ok = t.ruleLhs[i] < nt && t.ruleAction[i] < h.numActions;
+  for (size_t i = 0; ok && i < s; ++i)
+    ok = t.stateRecovery[i] >= -1 && t.stateRecovery[i] < static_cast<int>(e);
+  for (size_t i = 0; ok && i < e; ++i) ok = t.recoveryLhs[i] < nt;
+  if (!ok) {
+    error = "malformed table file";
+    return false;
+  }
+  return true;
+}
+
+TableFile::TableFile(TableFile&& other) noexcept { *this = std::move(other); }
+
+TableFile& TableFile::operator=(TableFile&& other) noexcept {
+  if (this != &other) {
+    release();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    mapped_ = std::exchange(other.mapped_, 0);
+    owned_ = std::move(other.owned_);  // the heap block, and so data_, stays put
+    tables_ = other.tables_;
+    actionNames_ = std::move(other.actionNames_);
+  }
+  return *this;
+}
+
+TableFile::~TableFile() { release(); }
+
+void TableFile::release() {
+  if (mapped_) ::munmap(const_cast<char*>(data_), mapped_);
+  data_ = nullptr;
+  mapped_ = 0;
+  owned_.clear();
+}
+
+}  // namespace byyl::lr
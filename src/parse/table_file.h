@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parse/grammar.h"
+#include "parse/parse_tables.h"
+#include "parse/tables.h"
+
+namespace byyl::lr {
+
+// Binary table file: a fixed header followed by the packed arrays in
+// ParseTables order (int16 arrays, stateRecovery, then ruleLhs,
+// recoveryLhs, ruleLength, ruleAction, recoverySets)
+// and the grammar's action names, NUL-separated. Multi-byte fields are
+// native-endian; a file written on another byte order fails the version
+// check. ruleAction indexes the file's own action names, so a reader binds
+// names to its semantic actions when it loads the file.
+constexpr char kTableFileMagic[8] = {'B', 'Y', 'Y', 'L', 'L', 'R', 'T', '\0'};
+constexpr uint32_t kTableFileVersion = 2;
+
+struct TableFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t fileSize;
+  uint64_t key;       // tableKey() of the grammar the tables were built from
+  uint64_t checksum;  // hashBytes of everything after the header
+  uint32_t numStates;
+  uint32_t numTerminals;
+  uint32_t numNonterminals;
+  uint32_t numRules;
+  uint32_t tableSize;
+  uint32_t numActions;
+  uint32_t numRecovery;
+  uint32_t reserved;  // zero
+};
+
+// Cache key for a grammar: its text, the terminal set it was resolved
+// against and the file format version.
+uint64_t tableKey(std::string_view grammarText, const std::vector<TerminalInfo>& terminals);
+
+std::string serializeTables(const Grammar& g, const PackedTables& packed, uint64_t key);
+
+// A validated table file, mapped read-only or held in memory.
+class TableFile {
+ public:
+  // Maps `path`. Returns nullopt and sets `error` if the file is missing,
+  // corrupt, from another format version, or not built for `key`.
+  static std::optional<TableFile> open(const std::string& path, uint64_t key, std::string& error);
+  // Copies serialized bytes, validated the same way.
+  static std::optional<TableFile> fromBytes(std::string_view bytes, uint64_t key,
+                                            std::string& error);
+
+  TableFile(TableFile&& other) noexcept;
+  TableFile& operator=(TableFile&& other) noexcept;
+  TableFile(const TableFile&) = delete;
+  TableFile& operator=(const TableFile&) = delete;
+  ~TableFile();
+
+  // ruleAction in the view holds indices into actionNames().
+  const ParseTables& tables() const { return tables_; }
+  const std::vector<std::string_view>& actionNames() const { return actionNames_; }
+  bool isMapped() const { return mapped_ != 0; }
+
+ private:
+  TableFile() = default;
+  bool bind(uint64_t key, std::string& error);
+  void release();
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  size_t mapped_ = 0;  // length of the mapping, 0 if owned_ holds the bytes
+  std::vector<char> owned_;
+  ParseTables tables_;
+  std::vector<std::string_view> actionNames_;
+};
+
+}  // namespace byyl::lr
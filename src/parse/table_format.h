@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+// Encoding shared by byyl-lrgen and the parser driver.
+//
+// ACTION/GOTO are stored the way yacc and bison store them: each state's
+// ACTION row and each nonterminal's GOTO column is a sparse vector whose
+// most common entry has been factored out into a default, and the remaining
+// entries of all vectors are overlaid into one comb vector:
+//
+//   i = base[row] + column
+//   value = (base[row] != kNoBase && 0 <= i < size && check[i] == column)
+//               ? table[i] : default[row]
+//
+// Bases are pairwise distinct, so check[] holding the column is enough to
+// tell whose entry a slot is.
+namespace byyl::parse_format {
+
+constexpr int16_t kNoBase = INT16_MIN;
+
+// Action values: 0 is a syntax error, s > 0 shifts to state s (the start state
+// is never a shift target), -r reduces by production r, kAccept accepts.
+constexpr int16_t kError = 0;
+constexpr int16_t kAccept = INT16_MAX;
+
+constexpr bool isShift(int16_t a) { return a > 0 && a != kAccept; }
+constexpr bool isReduce(int16_t a) { return a < 0; }
+
+}  // namespace byyl::parse_format
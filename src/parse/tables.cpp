@@ -0,0 +1,281 @@
+#include "parse/tables.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <tuple>
+
+#include "parse/table_format.h"
+
+namespace byyl::lr {
+
+namespace pf = parse_format;
+
+namespace {
+
+void buildRecovery(const Grammar& g, ParseTable& t) {
+  const int numNt = t.numNonterminals;
+  // reaches(b, a): some sentential form derived from b contains a.
+  std::vector<char> reach(static_cast<size_t>(numNt) * numNt, 0);
+  auto reaches = [&](int b, int a) -> char& { return reach[static_cast<size_t>(b) * numNt + a]; };
+  for (const Production& p : g.productions)
+    for (int sym : p.rhs)
+      if (!g.isTerminal(sym)) reaches(g.ntIndex(p.lhs), g.ntIndex(sym)) = 1;
+  for (int k = 0; k < numNt; ++k)
+    for (int b = 0; b < numNt; ++b)
+      if (reaches(b, k))
+        for (int a = 0; a < numNt; ++a)
+          if (reaches(k, a)) reaches(b, a) = 1;
+
+  // Each recovery state's own sync set, and their union per nonterminal.
+  std::vector<int> lhsOf(t.numStates, -1);
+  std::vector<std::vector<char>> syncOf(t.numStates);
+  std::vector<std::vector<char>> unionOf(numNt, std::vector<char>(t.numTerminals, 0));
+  for (int s = 0; s < t.numStates; ++s) {
+    for (int sym : g.recovery) {
+      const int nt = g.ntIndex(sym);
+      const int target = t.gotos[static_cast<size_t>(s) * numNt + nt];
+      if (target < 0) continue;
+      lhsOf[s] = nt;
+      syncOf[s].resize(t.numTerminals);
+      for (int tok = 0; tok < t.numTerminals; ++tok) {
+        syncOf[s][tok] = t.action[static_cast<size_t>(target) * t.numTerminals + tok] != pf::kError;
+        unionOf[nt][tok] |= syncOf[s][tok];
+      }
+      break;
+    }
+  }
+
+  t.stateRecovery.assign(t.numStates, -1);
+  std::map<std::tuple<int, std::vector<char>, std::vector<char>>, int> shared;
+  for (int s = 0; s < t.numStates; ++s) {
+    if (lhsOf[s] < 0) continue;
+    RecoveryEntry e{lhsOf[s], syncOf[s], syncOf[s]};
+    for (int sym : g.recovery) {
+      const int b = g.ntIndex(sym);
+      if (!reaches(b, e.lhs)) continue;
+      for (int tok = 0; tok < t.numTerminals; ++tok) e.stop[tok] |= unionOf[b][tok];
+    }
+    auto [it, added] = shared.emplace(std::make_tuple(e.lhs, e.sync, e.stop),
+                                      static_cast<int>(t.recovery.size()));
+    if (added) t.recovery.push_back(std::move(e));
+    t.stateRecovery[s] = it->second;
+  }
+}
+
+}  // namespace
+
+ParseTable buildTable(const Grammar& g, const Automaton& a) {
+  ParseTable t;
+  t.numStates = static_cast<int>(a.states.size());
+  t.numTerminals = g.numTerminals;
+  t.numNonterminals = g.numNonterminals();
+  t.action.assign(static_cast<size_t>(t.numStates) * t.numTerminals, pf::kError);
+  t.explicitError.assign(t.action.size(), 0);
+  t.gotos.assign(static_cast<size_t>(t.numStates) * t.numNonterminals, -1);
+
+  std::vector<std::string> rrErrors;
+  for (int s = 0; s < t.numStates; ++s) {
+    const LrState& st = a.states[s];
+    int* row = &t.action[static_cast<size_t>(s) * t.numTerminals];
+    for (auto [sym, target] : st.transitions) {
+      if (g.isTerminal(sym)) row[sym] = target;
+      else t.gotos[static_cast<size_t>(s) * t.numNonterminals + g.ntIndex(sym)] = target;
+    }
+    // Reductions are sorted by production, so the first claim on a
+    // lookahead is the earliest production.
+    std::vector<int> reducedBy(t.numTerminals, -1);
+    for (const auto& [prod, la] : st.reductions) {
+      la.forEach([&, prod = prod](size_t term) {
+        int tok = static_cast<int>(term);
+        if (prod == 0) {
+          row[tok] = pf::kAccept;
+          return;
+        }
+        if (reducedBy[tok] >= 0) {
+          rrErrors.push_back("state " + std::to_string(s) + ": reduce/reduce conflict on " +
+                             g.names[tok] + " between '" + g.describe(reducedBy[tok]) + "' and '" +
+                             g.describe(prod) + "'");
+          return;
+        }
+        reducedBy[tok] = prod;
+        if (!pf::isShift(static_cast<int16_t>(row[tok]))) {
+          row[tok] = -prod;
+          return;
+        }
+        const Precedence& rp = g.productions[prod].prec;
+        const Precedence& tp = g.termPrec[tok];
+        if (rp.level && tp.level) {
+          if (rp.level > tp.level || (rp.level == tp.level && tp.assoc == Assoc::Left)) {
+            row[tok] = -prod;
+          } else if (rp.level == tp.level && tp.assoc == Assoc::Nonassoc) {
+            row[tok] = pf::kError;
+            t.explicitError[static_cast<size_t>(s) * t.numTerminals + tok] = 1;
+          }
+          return;  // otherwise keep the shift
+        }
+        ++t.shiftReduceConflicts;
+        t.conflictReports.push_back("state " + std::to_string(s) + ": shift/reduce conflict on " +
+                                    g.names[tok] + ", shifting instead of reducing '" +
+                                    g.describe(prod) + "'");
+      });
+    }
+  }
+
+  if (!rrErrors.empty() || t.shiftReduceConflicts != g.expectedConflicts) {
+    std::string msg = std::to_string(t.shiftReduceConflicts) + " shift/reduce conflicts (expected " +
+                      std::to_string(g.expectedConflicts) + "), " +
+                      std::to_string(rrErrors.size()) + " reduce/reduce conflicts";
+    for (const auto& r : t.conflictReports) msg += "\n  " + r;
+    for (const auto& r : rrErrors) msg += "\n  " + r;
+    throw GrammarError(msg);
+  }
+  buildRecovery(g, t);
+  return t;
+}
+
+namespace {
+
+struct SparseVector {
+  bool isAction;  // action row of a state, or goto column of a nonterminal
+  int index;
+  std::vector<std::pair<int, int>> entries;  // (column, value)
+};
+
+int mostCommon(const std::map<int, int>& tally, int fallback) {
+  int best = fallback, bestCount = 0;
+  for (auto [value, count] : tally)
+    if (count > bestCount) {
+      best = value;
+      bestCount = count;
+    }
+  return best;
+}
+
+}  // namespace
+
+PackedTables pack(const ParseTable& t) {
+  PackedTables out;
+  out.actionBase.assign(t.numStates, pf::kNoBase);
+  out.defaultAction.assign(t.numStates, pf::kError);
+  out.gotoBase.assign(t.numNonterminals, pf::kNoBase);
+  out.defaultGoto.assign(t.numNonterminals, 0);
+
+  std::vector<SparseVector> vectors;
+  for (int s = 0; s < t.numStates; ++s) {
+    const int* row = &t.action[static_cast<size_t>(s) * t.numTerminals];
+    std::map<int, int> reduces;
+    for (int tok = 0; tok < t.numTerminals; ++tok)
+      if (pf::isReduce(static_cast<int16_t>(row[tok]))) ++reduces[row[tok]];
+    // The most frequent reduction also covers this state's error entries:
+    // the error is then detected after the reduction, before any shift.
+    // Recovery states keep their errors, so that the reduction cannot take
+    // the parser past the state it would resynchronize in.
+    int def = t.stateRecovery[s] >= 0 ? pf::kError : mostCommon(reduces, pf::kError);
+    out.defaultAction[s] = def;
+    SparseVector v{true, s, {}};
+    for (int tok = 0; tok < t.numTerminals; ++tok) {
+      bool explicitErr = t.explicitError[static_cast<size_t>(s) * t.numTerminals + tok];
+      if (row[tok] == def && !(explicitErr && def != pf::kError)) continue;
+      if (row[tok] == pf::kError && !explicitErr) continue;
+      v.entries.emplace_back(tok, row[tok]);
+    }
+    if (!v.entries.empty()) vectors.push_back(std::move(v));
+  }
+  for (int nt = 0; nt < t.numNonterminals; ++nt) {
+    std::map<int, int> targets;
+    for (int s = 0; s < t.numStates; ++s) {
+      int target = t.gotos[static_cast<size_t>(s) * t.numNonterminals + nt];
+      if (target >= 0) ++targets[target];
+    }
+    int def = mostCommon(targets, 0);
+    out.defaultGoto[nt] = def;
+    SparseVector v{false, nt, {}};
+    for (int s = 0; s < t.numStates; ++s) {
+      int target = t.gotos[static_cast<size_t>(s) * t.numNonterminals + nt];
+      if (target >= 0 && target != def) v.entries.emplace_back(s, target);
+    }
+    if (!v.entries.empty()) vectors.push_back(std::move(v));
+  }
+
+  // Densest vectors first; they are the hardest to place.
+  std::stable_sort(vectors.begin(), vectors.end(), [](const SparseVector& a, const SparseVector& b) {
+    return a.entries.size() > b.entries.size();
+  });
+
+  std::vector<char> used;
+  std::set<int> bases;
+  std::map<std::vector<std::pair<int, int>>, int> identicalRows;
+  for (const SparseVector& v : vectors) {
+    int base;
+    auto same = v.isAction ? identicalRows.find(v.entries) : identicalRows.end();
+    if (same != identicalRows.end()) {
+      base = same->second;
+    } else {
+      base = -v.entries.front().first;
+      while (true) {
+        bool fits = !bases.count(base);
+        for (size_t i = 0; fits && i < v.entries.size(); ++i) {
+          size_t pos = static_cast<size_t>(base + v.entries[i].first);
+          fits = pos >= used.size() || !used[pos];
+        }
+        if (fits) break;
+        ++base;
+      }
+      bases.insert(base);
+      for (auto [col, value] : v.entries) {
+        size_t pos = static_cast<size_t>(base + col);
+        if (pos >= used.size()) {
+          used.resize(pos + 1, 0);
+          out.table.resize(pos + 1, pf::kError);
+          out.check.resize(pos + 1, -1);
+        }
+        used[pos] = 1;
+        out.table[pos] = value;
+        out.check[pos] = col;
+      }
+      if (v.isAction) identicalRows.emplace(v.entries, base);
+    }
+    (v.isAction ? out.actionBase : out.gotoBase)[v.index] = base;
+  }
+
+  out.stateRecovery = t.stateRecovery;
+  const size_t setBytes = (static_cast<size_t>(t.numTerminals) + 7) / 8;
+  for (const RecoveryEntry& e : t.recovery) {
+    out.recoveryLhs.push_back(e.lhs);
+    for (const std::vector<char>* set : {&e.sync, &e.stop}) {
+      const size_t at = out.recoverySets.size();
+      out.recoverySets.resize(at + setBytes, 0);
+      for (int tok = 0; tok < t.numTerminals; ++tok)
+        if ((*set)[tok]) out.recoverySets[at + tok / 8] |= 1 << (tok % 8);
+    }
+  }
+
+  if (out.table.size() > static_cast<size_t>(INT16_MAX) || t.numStates >= INT16_MAX)
+    throw GrammarError("parse tables exceed the 16-bit encoding");
+
+  // Self-check: every packed lookup must agree with the dense table, except
+  // that implicit errors may have become the state's default reduction.
+  auto lookup = [&](int base, int col, int def) {
+    size_t i = static_cast<size_t>(base + col);
+    if (base != pf::kNoBase && i < out.table.size() && out.check[i] == col) return out.table[i];
+    return def;
+  };
+  for (int s = 0; s < t.numStates; ++s) {
+    for (int tok = 0; tok < t.numTerminals; ++tok) {
+      size_t k = static_cast<size_t>(s) * t.numTerminals + tok;
+      int got = lookup(out.actionBase[s], tok, out.defaultAction[s]);
+      bool implicitError = t.action[k] == pf::kError && !t.explicitError[k];
+      if (got != t.action[k] && !(implicitError && got == out.defaultAction[s]))
+        throw GrammarError("internal error: packed ACTION mismatch at state " + std::to_string(s));
+    }
+    for (int nt = 0; nt < t.numNonterminals; ++nt) {
+      int want = t.gotos[static_cast<size_t>(s) * t.numNonterminals + nt];
+      if (want >= 0 && lookup(out.gotoBase[nt], s, out.defaultGoto[nt]) != want)
+        throw GrammarError("internal error: packed GOTO mismatch at state " + std::to_string(s));
+    }
+  }
+  return out;
+}
+
+}  // namespace byyl::lr
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "parse/grammar.h"
+#include "parse/lalr.h"
+
+namespace byyl::lr {
+
+// Where a state resynchronizes after a syntax error: it has a goto on the
+// %recover nonterminal `lhs`, which the parser pushes after discarding
+// input up to a token in `sync`, the tokens the goto target accepts. `stop`
+// adds the tokens of every recovery state that can enclose this one, so a
+// token an outer construct synchronizes on is never discarded.
+struct RecoveryEntry {
+  int lhs = 0;  // nonterminal index
+  std::vector<char> sync, stop;  // per terminal
+};
+
+// Dense ACTION/GOTO after conflict resolution. Only the generator builds
+// this; the compiler ships the packed form.
+struct ParseTable {
+  int numStates = 0;
+  int numTerminals = 0;
+  int numNonterminals = 0;
+  std::vector<int> action;        // numStates * numTerminals, parse_format encoding
+  std::vector<char> explicitError;  // %nonassoc errors that must survive packing
+  std::vector<int> gotos;         // numStates * numNonterminals, -1 if none
+  int shiftReduceConflicts = 0;
+  std::vector<std::string> conflictReports;
+  std::vector<int> stateRecovery;  // per state: index into recovery, or -1
+  std::vector<RecoveryEntry> recovery;
+};
+
+// Fills ACTION/GOTO, resolving conflicts as yacc does: precedence and
+// associativity first, then shift over reduce and the earlier production
+// in a reduce/reduce conflict. Throws GrammarError on reduce/reduce
+// conflicts and when the shift/reduce count differs from %expect. States
+// with a goto on a %recover nonterminal get recovery entries, identical
+// entries shared.
+ParseTable buildTable(const Grammar& g, const Automaton& a);
+
+struct PackedTables {
+  std::vector<int> actionBase;     // per state
+  std::vector<int> defaultAction;  // per state: a default reduction or kError
+  std::vector<int> gotoBase;       // per nonterminal
+  std::vector<int> defaultGoto;    // per nonterminal
+  std::vector<int> table;
+  std::vector<int> check;
+  std::vector<int> stateRecovery;  // per state
+  std::vector<int> recoveryLhs;    // per recovery entry
+  // Per recovery entry, its sync and then its stop set, each a bitset of
+  // (numTerminals + 7) / 8 bytes.
+  std::vector<int> recoverySets;
+};
+
+// Default reductions plus comb-vector (row displacement) packing.
+PackedTables pack(const ParseTable& t);
+
+}  // namespace byyl::lr
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "support/interner.h"
+
+namespace byyl {
+
+// Nested lexical scopes. An inner declaration shadows an outer one of the
+// same name until its scope is popped.
+//
+// There is one flat table from Symbol id to the innermost binding (Symbols
+// are dense, so the id is the index) and an undo stack of the bindings each
+// declaration displaced. push() only records the undo stack's height, and
+// pop() restores the entries above it, so entering and leaving a scope
+// costs nothing beyond the declarations made in it, and lookup is a single
+// index whatever the nesting depth.
+template <typename T>
+class ScopeStack {
+ public:
+  void push() { marks_.push_back(static_cast<uint32_t>(undo_.size())); }
+  void pop() {
+    for (const uint32_t mark = marks_.back(); undo_.size() > mark; undo_.pop_back())
+      table_[undo_.back().name] = undo_.back().shadowed;
+    marks_.pop_back();
+  }
+
+  // Returns false, declaring nothing, if the innermost scope already has
+  // `name`.
+  bool declare(Symbol name, T entity) {
+    if (name.id() >= table_.size()) table_.resize(name.id() + 1);
+    Binding& b = table_[name.id()];
+    const auto depth = static_cast<uint32_t>(marks_.size());
+    if (b.depth == depth) return false;
+    undo_.push_back({name.id(), b});
+    b = {entity, depth};
+    return true;
+  }
+
+  const T* lookup(Symbol name) const {
+    if (name.id() >= table_.size() || table_[name.id()].depth == 0) return nullptr;
+    return &table_[name.id()].entity;
+  }
+
+ private:
+  struct Binding {
+    T entity{};
+    uint32_t depth = 0;  // of the declaring scope, counting from 1; 0 if unbound
+  };
+  struct Undo {
+    uint32_t name;
+    Binding shadowed;
+  };
+
+  std::vector<Binding> table_;  // by Symbol id
+  std::vector<Undo> undo_;
+  std::vector<uint32_t> marks_;  // undo_.size() at each push()
+};
+
+}  // namespace byyl
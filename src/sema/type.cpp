@@ -0,0 +1,101 @@
+#include "sema/type.h"
+
+#include <utility>
+
+#include "support/hash.h"
+
+namespace byyl {
+
+const Type::Field* Type::field(Symbol name) const {
+  for (const Field& f : fields)
+    if (f.name == name) return &f;
+  return nullptr;
+}
+
+TypeTable::TypeTable() {
+  Type t;
+  error_ = add(t);
+  t.kind = Type::Kind::Void;
+  void_ = add(t);
+  t.kind = Type::Kind::Int;
+  t.size = 1;
+  int_ = add(t);
+  t.kind = Type::Kind::Bool;
+  bool_ = add(t);
+}
+
+size_t TypeTable::Shallow::operator()(const Type* t) const {
+  constexpr uint64_t k = 0x9e3779b97f4a7c15ull;
+  uint64_t h = hashMix(static_cast<uint64_t>(t->kind) ^ uint64_t(t->length) << 8, k);
+  h = hashMix(h ^ reinterpret_cast<uintptr_t>(t->element), k);
+  for (const Type::Field& f : t->fields)
+    h = hashMix(h ^ f.name.id() ^ reinterpret_cast<uintptr_t>(f.type) << 16, k);
+  return static_cast<size_t>(h);
+}
+
+bool TypeTable::Shallow::operator()(const Type* a, const Type* b) const {
+  if (a->kind != b->kind || a->length != b->length || a->element != b->element ||
+      a->fields.size() != b->fields.size())
+    return false;
+  for (size_t i = 0; i < a->fields.size(); ++i)
+    if (a->fields[i].name != b->fields[i].name || a->fields[i].type != b->fields[i].type)
+      return false;
+  return true;
+}
+
+const Type* TypeTable::add(Type type) {
+  types_.push_back(std::make_unique<Type>(std::move(type)));
+  return types_.back().get();
+}
+
+const Type* TypeTable::intern(Type type) {
+  auto found = canonical_.find(&type);
+  if (found != canonical_.end()) return *found;
+  const Type* t = add(std::move(type));
+  canonical_.insert(t);
+  return t;
+}
+
+const Type* TypeTable::array(const Type* element, uint32_t length) {
+  Type t;
+  t.kind = Type::Kind::Array;
+  t.element = element;
+  t.length = length;
+  t.size = element->size * length;
+  return intern(std::move(t));
+}
+
+const Type* TypeTable::record(std::vector<Type::Field> fields) {
+  Type t;
+  t.kind = Type::Kind::Record;
+  for (Type::Field& f : fields) {
+    f.offset = t.size;
+    t.size += f.type->size;
+  }
+  t.fields = std::move(fields);
+  return intern(std::move(t));
+}
+
+std::string TypeTable::name(const Type* type, const Interner& interner) const {
+  switch (type->kind) {
+    case Type::Kind::Error:
+      return "<error>";
+    case Type::Kind::Void:
+      return "void";
+    case Type::Kind::Int:
+      return "int";
+    case Type::Kind::Bool:
+      return "bool";
+    case Type::Kind::Array:
+      return name(type->element, interner) + "[" + std::to_string(type->length) + "]";
+    case Type::Kind::Record: {
+      std::string s = "record {";
+      for (const Type::Field& f : type->fields)
+        s += " " + std::string(interner.spelling(f.name)) + ": " + name(f.type, interner) + ";";
+      return s + " }";
+    }
+  }
+  return "";
+}
+
+}  // namespace byyl
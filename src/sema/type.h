@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "support/interner.h"
+
+namespace byyl {
+
+// Storage is counted in slots; int and bool take one slot each.
+struct Type {
+  enum class Kind : uint8_t { Error, Void, Int, Bool, Array, Record };
+  struct Field {
+    Symbol name;
+    const Type* type;
+    uint32_t offset;  // slots from the start of the record
+  };
+
+  Kind kind = Kind::Error;
+  uint32_t size = 0;              // slots
+  uint32_t length = 0;            // Array
+  const Type* element = nullptr;  // Array
+  std::vector<Field> fields;      // Record
+
+  bool isScalar() const { return kind == Kind::Int || kind == Kind::Bool; }
+  bool isError() const { return kind == Kind::Error; }
+  // Null if the record has no field `name`.
+  const Field* field(Symbol name) const;
+};
+
+// Owns the types of one translation unit. Types are hash-consed: array()
+// and record() return the existing node for a structure already built, so
+// two spellings of record { x: int; } are one Type and equality is a
+// pointer compare. A type's components are canonical before it is, so
+// hashing and comparing a structure only looks one level deep.
+class TypeTable {
+ public:
+  TypeTable();
+
+  const Type* error() const { return error_; }
+  const Type* voidType() const { return void_; }
+  const Type* intType() const { return int_; }
+  const Type* boolType() const { return bool_; }
+  const Type* array(const Type* element, uint32_t length);
+  // Offsets are assigned in field order.
+  const Type* record(std::vector<Type::Field> fields);
+
+  std::string name(const Type* type, const Interner& interner) const;
+
+ private:
+  struct Shallow {
+    size_t operator()(const Type* t) const;
+    bool operator()(const Type* a, const Type* b) const;
+  };
+
+  const Type* add(Type type);
+  const Type* intern(Type type);
+
+  std::vector<std::unique_ptr<Type>> types_;
+  std::unordered_set<const Type*, Shallow, Shallow> canonical_;
+  const Type* error_;
+  const Type* void_;
+  const Type* int_;
+  const Type* bool_;
+};
+
+// Types from one TypeTable are equal exactly when they are the same node.
+inline bool sameType(const Type* a, const Type* b) { return a == b; }
+
+}  // namespace byyl
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace byyl {
+
+// Bump-pointer allocator. Memory is released all at once when the arena is
+// destroyed; destructors of objects placed in it are never run, so only
+// trivially destructible types belong here.
+class Arena {
+ public:
+  explicit Arena(size_t firstChunk = 4096) : nextChunk_(firstChunk) {}
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  Arena(Arena&&) = default;
+  Arena& operator=(Arena&&) = default;
+
+  void* allocate(size_t size, size_t align) {
+    size_t pad = (align - reinterpret_cast<uintptr_t>(cur_) % align) % align;
+    if (static_cast<size_t>(end_ - cur_) < size + pad) {
+      grow(size + align);
+      pad = (align - reinterpret_cast<uintptr_t>(cur_) % align) % align;
+    }
+    char* p = cur_ + pad;
+    cur_ = p + size;
+    used_ += size + pad;
+    return p;
+  }
+
+  template <typename T, typename... Args>
+  T* make(Args&&... args) {
+    static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+    return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  // Copies `s` into the arena. The copy is not NUL-terminated.
+  std::string_view copy(std::string_view s) {
+    char* p = static_cast<char*>(allocate(s.size(), 1));
+    std::memcpy(p, s.data(), s.size());
+    return {p, s.size()};
+  }
+
+  // Bytes handed out, including alignment padding.
+  size_t bytesUsed() const { return used_; }
+  // Bytes reserved from the system.
+  size_t bytesReserved() const { return reserved_; }
+
+ private:
+  static constexpr size_t kMaxChunk = 1 << 20;
+
+  void grow(size_t atLeast) {
+    size_t size = std::max(nextChunk_, atLeast);
+    if (nextChunk_ < kMaxChunk) nextChunk_ *= 2;
+    chunks_.emplace_back(new char[size]);
+    cur_ = chunks_.back().get();
+    end_ = cur_ + size;
+    reserved_ += size;
+  }
+
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  char* cur_ = nullptr;
+  char* end_ = nullptr;
+  size_t nextChunk_;
+  size_t used_ = 0;
+  size_t reserved_ = 0;
+};
+
+}  // namespace byyl
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace byyl {
+
+// Fixed-size dynamic bitset over 64-bit words. Set operations run a word at a
+// time and report whether anything changed, which is what fixpoint loops need.
+class BitSet {
+ public:
+  BitSet() = default;
+  explicit BitSet(size_t bits) : bits_(bits), words_((bits + 63) / 64, 0) {}
+
+  size_t size() const { return bits_; }
+
+  bool test(size_t i) const { return (words_[i >> 6] >> (i & 63)) & 1; }
+  void set(size_t i) { words_[i >> 6] |= uint64_t(1) << (i & 63); }
+  void reset(size_t i) { words_[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+  void clear() {
+    for (auto& w : words_) w = 0;
+  }
+  // Sets bits [0, size()); the unused tail of the last word stays clear.
+  void setAll() {
+    for (auto& w : words_) w = ~uint64_t(0);
+    if (bits_ & 63) words_.back() = (uint64_t(1) << (bits_ & 63)) - 1;
+  }
+
+  // this = other; returns true if that changed anything.
+  bool assign(const BitSet& other) {
+    uint64_t changed = 0;
+    for (size_t i = 0; i < words_.size(); ++i) {
+      changed |= words_[i] ^ other.words_[i];
+      words_[i] = other.words_[i];
+    }
+    return changed != 0;
+  }
+
+  // this = gen | (in & ~kill), the gen/kill transfer function of a data-flow
+  // problem; returns true if that changed anything. Like the other set
+  // operations the loop has no branches, so it compiles to vector code.
+  bool assignTransfer(const BitSet& gen, const BitSet& in, const BitSet& kill) {
+    uint64_t changed = 0;
+    for (size_t i = 0; i < words_.size(); ++i) {
+      uint64_t next = gen.words_[i] | (in.words_[i] & ~kill.words_[i]);
+      changed |= next ^ words_[i];
+      words_[i] = next;
+    }
+    return changed != 0;
+  }
+
+  // this |= other; returns true if any bit was added.
+  bool orWith(const BitSet& other) {
+    uint64_t changed = 0;
+    for (size_t i = 0; i < words_.size(); ++i) {
+      uint64_t merged = words_[i] | other.words_[i];
+      changed |= merged ^ words_[i];
+      words_[i] = merged;
+    }
+    return changed != 0;
+  }
+
+  // this &= other; returns true if any bit was removed.
+  bool andWith(const BitSet& other) {
+    uint64_t changed = 0;
+    for (size_t i = 0; i < words_.size(); ++i) {
+      uint64_t kept = words_[i] & other.words_[i];
+      changed |= kept ^ words_[i];
+      words_[i] = kept;
+    }
+    return changed != 0;
+  }
+
+  // this &= ~other.
+  void subtract(const BitSet& other) {
+    for (size_t i = 0; i < words_.size(); ++i) words_[i] &= ~other.words_[i];
+  }
+
+  bool intersects(const BitSet& other) const {
+    for (size_t i = 0; i < words_.size(); ++i)
+      if (words_[i] & other.words_[i]) return true;
+    return false;
+  }
+
+  bool any() const {
+    for (uint64_t w : words_)
+      if (w) return true;
+    return false;
+  }
+
+  size_t count() const {
+    size_t n = 0;
+    for (uint64_t w : words_) n += static_cast<size_t>(__builtin_popcountll(w));
+    return n;
+  }
+
+  // Calls f(index) for every set bit in increasing order.
+  template <typename F>
+  void forEach(F&& f) const {
+    for (size_t i = 0; i < words_.size(); ++i) {
+      for (uint64_t w = words_[i]; w; w &= w - 1)
+        f(i * 64 + static_cast<size_t>(__builtin_ctzll(w)));
+    }
+  }
+
+  const std::vector<uint64_t>& words() const { return words_; }
+
+  friend bool operator==(const BitSet& a, const BitSet& b) { return a.words_ == b.words_; }
+  friend bool operator!=(const BitSet& a, const BitSet& b) { return !(a == b); }
+  friend bool operator<(const BitSet& a, const BitSet& b) { return a.words_ < b.words_; }
+
+ private:
+  size_t bits_ = 0;
+  std::vector<uint64_t> words_;
+};
+
+}  // namespace byyl
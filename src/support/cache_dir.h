@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+namespace byyl {
+
+// $BYYL_CACHE_DIR, else $XDG_CACHE_HOME/byyl, else $HOME/.cache/byyl.
+std::string defaultCacheDir();
+
+// mkdir -p; existing directories are fine.
+bool makeDirs(const std::string& dir);
+
+// Writes `bytes` to a temporary in the same directory and renames it into
+// place, creating the directory if needed, so concurrent compilers see
+// either no file or a complete one. Sets `error` on failure.
+bool writeFileAtomically(const std::string& path, const std::string& bytes, std::string& error);
+
+}  // namespace byyl
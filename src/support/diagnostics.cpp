@@ -0,0 +1,73 @@
+#include "support/diagnostics.h"
+
+#include <ostream>
+
+namespace byyl {
+
+namespace {
+
+const char* severityName(Severity s) {
+  switch (s) {
+    case Severity::Note: return "note";
+    case Severity::Warning: return "warning";
+    case Severity::Error: return "error";
+  }
+  return "error";
+}
+
+}  // namespace
+
+void Diagnostics::report(Severity severity, SourcePos pos, const char* format,
+                         std::initializer_list<DiagArg> args) {
+  if (!keeps(severity)) {
+    ++errors_;
+    return;
+  }
+  if (severity == Severity::Error) {
+    ++errors_;
+    ++keptErrors_;
+  }
+  diags_.push_back({severity, pos, format, static_cast<uint32_t>(args_.size()),
+                    static_cast<uint32_t>(args.size())});
+  for (DiagArg a : args) {
+    if (!a.isNumber_ && !a.isLiteral_) a.text_ = text_.copy(a.text_);
+    args_.push_back(a);
+  }
+}
+
+std::string Diagnostics::message(const Diagnostic& d) const {
+  std::string out;
+  const DiagArg* arg = args_.data() + d.firstArg;
+  const DiagArg* end = arg + d.numArgs;
+  for (const char* p = d.format; *p; ++p) {
+    if (p[0] == '{' && p[1] == '}' && arg != end) {
+      if (arg->isNumber_) out += std::to_string(arg->number_);
+      else out += arg->text_;
+      ++arg;
+      ++p;
+    } else {
+      out += *p;
+    }
+  }
+  return out;
+}
+
+const LineTable& Diagnostics::lines() const {
+  if (!lines_) lines_.emplace(source_);
+  return *lines_;
+}
+
+void Diagnostics::print(std::ostream& os) const {
+  for (const Diagnostic& d : diags_) {
+    const LineColumn at = lines().locate(d.pos);
+    os << fileName_ << ':' << at.line << ':' << at.column << ": " << severityName(d.severity)
+       << ": " << message(d) << '\n';
+  }
+  if (errors_ > keptErrors_) {
+    const size_t dropped = errors_ - keptErrors_;
+    os << fileName_ << ": note: " << dropped << (dropped == 1 ? " more error" : " more errors")
+       << " not shown\n";
+  }
+}
+
+}  // namespace byyl
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "support/arena.h"
+#include "support/line_table.h"
+
+namespace byyl {
+
+enum class Severity { Note, Warning, Error };
+
+// One argument of a diagnostic message, kept unformatted until the message
+// is printed: a number, a string literal, or text the Diagnostics copies
+// into its arena when the diagnostic is reported.
+class DiagArg {
+ public:
+  template <typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+  DiagArg(T n) : number_(static_cast<int64_t>(n)), isNumber_(true) {}
+  DiagArg(const char* literal) : text_(literal), isLiteral_(true) {}
+  DiagArg(std::string_view text) : text_(text) {}
+  DiagArg(const std::string& text) : text_(text) {}
+
+ private:
+  friend class Diagnostics;
+
+  std::string_view text_;
+  int64_t number_ = 0;
+  bool isNumber_ = false;
+  bool isLiteral_ = false;
+};
+
+struct Diagnostic {
+  Severity severity = Severity::Error;
+  SourcePos pos;
+  const char* format = "";  // each "{}" stands for the next argument
+  uint32_t firstArg = 0;    // into the owning Diagnostics' arguments
+  uint32_t numArgs = 0;
+};
+
+// Collects the diagnostics of one translation unit in report order.
+// Reporting stores the format, the position and the arguments, with no
+// heap allocation of its own; messages are formatted, and line and column
+// worked out, only when they are printed. Errors past the error limit are
+// counted but not kept.
+class Diagnostics {
+ public:
+  // `source` is the unit's text, for the line table; it must outlive
+  // print().
+  explicit Diagnostics(std::string fileName, std::string_view source = {})
+      : fileName_(std::move(fileName)), source_(source), text_(512) {}
+
+  void report(Severity severity, SourcePos pos, const char* format,
+              std::initializer_list<DiagArg> args = {});
+  void error(SourcePos pos, const char* format, std::initializer_list<DiagArg> args = {}) {
+    report(Severity::Error, pos, format, args);
+  }
+  void warning(SourcePos pos, const char* format, std::initializer_list<DiagArg> args = {}) {
+    report(Severity::Warning, pos, format, args);
+  }
+  // Keeps at most `limit` errors; 0 keeps them all.
+  void setErrorLimit(size_t limit) { errorLimit_ = limit; }
+  // Whether a diagnostic reported now would be kept, for a caller whose
+  // arguments cost something to gather.
+  bool keeps(Severity severity) const {
+    return severity != Severity::Error || !errorLimit_ || keptErrors_ < errorLimit_;
+  }
+
+  const std::string& fileName() const { return fileName_; }
+  const std::vector<Diagnostic>& all() const { return diags_; }
+  size_t errorCount() const { return errors_; }
+  bool hasErrors() const { return errors_ != 0; }
+  std::string message(const Diagnostic& d) const;
+
+  // The source's line table, scanned on first use.
+  const LineTable& lines() const;
+  // For a unit without its source text at hand.
+  void setLines(LineTable lines) { lines_ = std::move(lines); }
+
+  // Prints "file:line:col: severity: message" lines, and how many errors
+  // the limit dropped.
+  void print(std::ostream& os) const;
+
+ private:
+  std::string fileName_;
+  std::string_view source_;
+  mutable std::optional<LineTable> lines_;
+  std::vector<Diagnostic> diags_;
+  std::vector<DiagArg> args_;
+  Arena text_;  // copied argument text
+  size_t errors_ = 0;
+  size_t keptErrors_ = 0;
+  size_t errorLimit_ = 0;
+};
+
+}  // namespace byyl
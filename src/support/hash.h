@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace byyl {
+
+// 64x64 -> 128 multiply folded to 64 bits; the mixing step of wyhash.
+inline uint64_t hashMix(uint64_t a, uint64_t b) {
+  __uint128_t r = static_cast<__uint128_t>(a) * b;
+  return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+// Fast non-cryptographic hash of a byte string, 8 bytes per step. It is
+// unseeded, so the same bytes hash the same in every process.
+inline uint64_t hashBytes(const char* data, size_t len) {
+  constexpr uint64_t k0 = 0xa0761d6478bd642full;
+  constexpr uint64_t k1 = 0xe7037ed1a0b428dbull;
+  uint64_t h = k0 ^ len;
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t w;
+    std::memcpy(&w, data + i, 8);
+    h = hashMix(h ^ w, k1);
+  }
+  if (i < len) {
+    uint64_t w = 0;
+    std::memcpy(&w, data + i, len - i);
+    h = hashMix(h ^ w, k1 ^ (len - i));
+  }
+  return hashMix(h, k0);
+}
+
+inline uint64_t hashBytes(std::string_view s) { return hashBytes(s.data(), s.size()); }
+
+}  // namespace byyl
@@ -0,0 +1,80 @@
+#include "support/interner.h"
+
+#include <cstring>
+#include <utility>
+
+#include "support/hash.h"
+
+namespace byyl {
+
+namespace {
+
+constexpr size_t kInitialCapacity = 1024;
+
+uint32_t hash32(std::string_view s) { return static_cast<uint32_t>(hashBytes(s)); }
+
+}  // namespace
+
+Interner::Interner() : arena_(64 * 1024) {
+  entries_.push_back({"", 0, 0});  // invalid symbol
+  rehash(kInitialCapacity);
+}
+
+Symbol Interner::lookup(std::string_view spelling) const {
+  uint32_t hash = hash32(spelling);
+  for (size_t i = hash & mask_, dist = 0;; i = (i + 1) & mask_, ++dist) {
+    const Slot& slot = slots_[i];
+    // Robin Hood invariant: once we pass an entry closer to its home than we
+    // are to ours, the key cannot be further along.
+    if (slot.id == 0 || probeDistance(slot.hash, i) < dist) return Symbol();
+    if (slot.hash == hash) {
+      const Entry& e = entries_[slot.id];
+      if (e.length == spelling.size() && std::memcmp(e.data, spelling.data(), e.length) == 0)
+        return Symbol(slot.id);
+    }
+  }
+}
+
+Symbol Interner::intern(std::string_view spelling) {
+  uint32_t hash = hash32(spelling);
+  for (size_t i = hash & mask_, dist = 0;; i = (i + 1) & mask_, ++dist) {
+    const Slot& slot = slots_[i];
+    if (slot.id == 0 || probeDistance(slot.hash, i) < dist) break;
+    if (slot.hash == hash) {
+      const Entry& e = entries_[slot.id];
+      if (e.length == spelling.size() && std::memcmp(e.data, spelling.data(), e.length) == 0)
+        return Symbol(slot.id);
+    }
+  }
+
+  std::string_view stored = arena_.copy(spelling);
+  uint32_t id = static_cast<uint32_t>(entries_.size());
+  entries_.push_back({stored.data(), static_cast<uint32_t>(stored.size()), hash});
+  // Keep the load factor at or below 7/8.
+  if (entries_.size() * 8 > slots_.size() * 7) rehash(slots_.size() * 2);
+  else insertSlot({hash, id});
+  return Symbol(id);
+}
+
+void Interner::insertSlot(Slot incoming) {
+  for (size_t i = incoming.hash & mask_, dist = 0;; i = (i + 1) & mask_, ++dist) {
+    Slot& slot = slots_[i];
+    if (slot.id == 0) {
+      slot = incoming;
+      return;
+    }
+    uint32_t existing = probeDistance(slot.hash, i);
+    if (existing < dist) {
+      std::swap(slot, incoming);
+      dist = existing;
+    }
+  }
+}
+
+void Interner::rehash(size_t capacity) {
+  slots_.assign(capacity, Slot());
+  mask_ = capacity - 1;
+  for (uint32_t id = 1; id < entries_.size(); ++id) insertSlot({entries_[id].hash, id});
+}
+
+}  // namespace byyl
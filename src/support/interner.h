@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "support/arena.h"
+
+namespace byyl {
+
+// Dense 32-bit handle for an interned spelling. Equal spellings intern to the
+// same Symbol, so comparing names is an integer compare. Id 0 is reserved as
+// the invalid symbol.
+class Symbol {
+ public:
+  constexpr Symbol() = default;
+  constexpr explicit Symbol(uint32_t id) : id_(id) {}
+
+  constexpr uint32_t id() const { return id_; }
+  constexpr bool valid() const { return id_ != 0; }
+  constexpr explicit operator bool() const { return valid(); }
+
+  friend constexpr bool operator==(Symbol a, Symbol b) { return a.id_ == b.id_; }
+  friend constexpr bool operator!=(Symbol a, Symbol b) { return a.id_ != b.id_; }
+  friend constexpr bool operator<(Symbol a, Symbol b) { return a.id_ < b.id_; }
+
+ private:
+  uint32_t id_ = 0;
+};
+
+// String interner. Spellings are copied once into an arena; the index is a
+// flat Robin Hood hash table of (hash, id) pairs, so a lookup touches one
+// cache line on a hit and compares the full 32-bit hash before the bytes.
+// Not synchronised: each translation unit owns one, and Symbols are only
+// meaningful within the unit's Interner.
+class Interner {
+ public:
+  Interner();
+
+  Symbol intern(std::string_view spelling);
+  // Returns the invalid Symbol if `spelling` has never been interned.
+  Symbol lookup(std::string_view spelling) const;
+  std::string_view spelling(Symbol sym) const { return entries_[sym.id()].text(); }
+
+  // Number of interned spellings.
+  size_t size() const { return entries_.size() - 1; }
+  const Arena& arena() const { return arena_; }
+
+ private:
+  struct Entry {
+    const char* data;
+    uint32_t length;
+    uint32_t hash;
+    std::string_view text() const { return {data, length}; }
+  };
+  struct Slot {
+    uint32_t hash = 0;
+    uint32_t id = 0;  // 0 = empty
+  };
+
+  uint32_t probeDistance(uint32_t hash, size_t slot) const {
+    return static_cast<uint32_t>((slot - (hash & mask_)) & mask_);
+  }
+  void insertSlot(Slot slot);
+  void rehash(size_t capacity);
+
+  Arena arena_;
+  std::vector<Entry> entries_;
+  std::vector<Slot> slots_;
+  size_t mask_ = 0;
+};
+
+}  // namespace byyl
@@ -0,0 +1,22 @@
+#include "support/line_table.h"
+
+#include <algorithm>
+
+#include "lex/simd_scan.h"
+
+namespace byyl {
+
+LineTable::LineTable(std::string_view text) : starts_{0} {
+  const char* begin = text.data();
+  simd::forEachNewline(begin, begin + text.size(), [&](const char* nl) {
+    starts_.push_back(static_cast<uint32_t>(nl - begin) + 1);
+  });
+}
+
+LineColumn LineTable::locate(SourcePos pos) const {
+  const auto next = std::upper_bound(starts_.begin(), starts_.end(), pos.offset);
+  const auto line = static_cast<uint32_t>(next - starts_.begin());
+  return {line, pos.offset - starts_[line - 1] + 1};
+}
+
+}  // namespace byyl
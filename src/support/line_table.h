@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace byyl {
+
+// Byte offset into a translation unit's source. Tokens, nodes and
+// diagnostics carry only this; line and column come from the file's
+// LineTable when a position is printed.
+struct SourcePos {
+  uint32_t offset = 0;
+
+  friend constexpr bool operator<(SourcePos a, SourcePos b) { return a.offset < b.offset; }
+  friend constexpr bool operator==(SourcePos a, SourcePos b) { return a.offset == b.offset; }
+};
+
+// 1-based line and byte column.
+struct LineColumn {
+  uint32_t line = 0;
+  uint32_t column = 0;
+};
+
+// Offsets at which the lines of one file start, found by one vectorised
+// scan for newlines. Nothing needs it until a position is printed, so
+// callers build it then.
+class LineTable {
+ public:
+  LineTable() : starts_{0} {}
+  explicit LineTable(std::string_view text);
+  // Starts as starts() returned them, for a file whose text is not at hand.
+  explicit LineTable(std::vector<uint32_t> starts) : starts_(std::move(starts)) {}
+
+  LineColumn locate(SourcePos pos) const;
+  const std::vector<uint32_t>& starts() const { return starts_; }
+
+ private:
+  std::vector<uint32_t> starts_;  // the first is 0
+};
+
+}  // namespace byyl
@@ -0,0 +1,192 @@
+#include "support/profile.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+
+namespace byyl {
+
+namespace {
+
+struct CounterInfo {
+  const char* description;
+  const char* phase;
+};
+
+constexpr CounterInfo kCounterInfo[] = {
+#define BYYL_COUNTER_INFO(name, description, phase) {description, phase},
+    BYYL_PROFILE_COUNTERS(BYYL_COUNTER_INFO)
+#undef BYYL_COUNTER_INFO
+};
+
+// One line of the report: a phase within one enclosing phase, over all
+// units.
+struct Row {
+  const char* name;
+  uint32_t depth;
+  size_t parent;  // kRoot for an outermost phase
+  int64_t ns = 0;
+};
+constexpr size_t kRoot = SIZE_MAX;
+
+// Phases in tree order, children in first-use order under their parent.
+std::vector<Row> collect(const std::vector<const Profile*>& units) {
+  std::vector<Row> rows;
+  for (const Profile* p : units) {
+    std::vector<size_t> open;  // row of each enclosing event
+    for (const Profile::Event& e : p->events()) {
+      open.resize(e.depth);
+      const size_t parent = open.empty() ? kRoot : open.back();
+      size_t r = 0;
+      while (r < rows.size() && (rows[r].parent != parent || std::strcmp(rows[r].name, e.name)))
+        ++r;
+      if (r == rows.size()) rows.push_back({e.name, e.depth, parent});
+      rows[r].ns += e.end - e.begin;
+      open.push_back(r);
+    }
+  }
+  std::vector<Row> ordered;
+  auto visit = [&](size_t parent, auto& self) -> void {
+    for (size_t r = 0; r < rows.size(); ++r) {
+      if (rows[r].parent != parent) continue;
+      ordered.push_back(rows[r]);
+      self(r, self);
+    }
+  };
+  visit(kRoot, visit);
+  return ordered;
+}
+
+int64_t phaseTime(const std::vector<Row>& rows, const char* name) {
+  int64_t ns = 0;
+  for (const Row& r : rows)
+    if (std::strcmp(r.name, name) == 0) ns += r.ns;
+  return ns;
+}
+
+// 12.3k, 4.56M, ...
+std::string scaled(double v) {
+  const char* const units[] = {"", "k", "M", "G"};
+  int u = 0;
+  while (v >= 1000 && u < 3) {
+    v /= 1000;
+    ++u;
+  }
+  char buf[32];
+  std::snprintf(buf, sizeof buf, u ? "%.2f%s" : "%.0f%s", v, units[u]);
+  return buf;
+}
+
+void jsonString(std::ostream& os, const std::string& s) {
+  os << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') os << '\\' << c;
+    else if (static_cast<unsigned char>(c) < 0x20) os << ' ';
+    else os << c;
+  }
+  os << '"';
+}
+
+}  // namespace
+
+void printTimeReport(const std::vector<const Profile*>& units, std::ostream& os) {
+  const std::vector<Row> rows = collect(units);
+  int64_t total = 0;
+  uint64_t bytes = 0;
+  for (const Row& r : rows)
+    if (r.depth == 0) total += r.ns;
+  for (const Profile* p : units) bytes += p->sourceBytes();
+
+  char line[128];
+  std::snprintf(line, sizeof line, "time report: %zu file%s, %s bytes\n", units.size(),
+                units.size() == 1 ? "" : "s", scaled(static_cast<double>(bytes)).c_str());
+  os << line;
+  std::snprintf(line, sizeof line, "  %-26s %12s %8s %10s\n", "phase", "wall ms", "share",
+                "MB/s");
+  os << line;
+  for (const Row& r : rows) {
+    std::string name = std::string(2 * r.depth, ' ') + r.name;
+    const double ms = static_cast<double>(r.ns) / 1e6;
+    const double share =
+        total ? 100.0 * static_cast<double>(r.ns) / static_cast<double>(total) : 0;
+    const bool sourcePhase = r.depth == 0 && (std::strcmp(r.name, "lex") == 0 ||
+                                              std::strcmp(r.name, "parse") == 0);
+    std::string rate;
+    if (sourcePhase && r.ns > 0) {
+      char buf[32];
+      std::snprintf(buf, sizeof buf, "%.1f", static_cast<double>(bytes) / 1e6 / (ms / 1e3));
+      rate = buf;
+    }
+    std::snprintf(line, sizeof line, "  %-26s %12.3f %7.1f%% %10s\n", name.c_str(), ms, share,
+                  rate.c_str());
+    os << line;
+  }
+  std::snprintf(line, sizeof line, "  %-26s %12.3f %7.1f%%\n", "total",
+                static_cast<double>(total) / 1e6, 100.0);
+  os << line;
+
+  if (!Profile::kCounters) return;
+  std::snprintf(line, sizeof line, "  %-26s %12s %19s\n", "counter", "total", "rate");
+  os << line;
+  for (int c = 0; c < kNumCounters; ++c) {
+    uint64_t n = 0;
+    for (const Profile* p : units) n += p->counter(static_cast<Counter>(c));
+    const CounterInfo& info = kCounterInfo[c];
+    std::string rate;
+    if (info.phase) {
+      const int64_t ns = phaseTime(rows, info.phase);
+      if (ns > 0)
+        rate = scaled(static_cast<double>(n) * 1e9 / static_cast<double>(ns)) + "/s (" +
+               info.phase + ")";
+    }
+    std::snprintf(line, sizeof line, "  %-26s %12" PRIu64 " %19s\n", info.description, n,
+                  rate.c_str());
+    os << line;
+  }
+}
+
+void writeChromeTrace(const std::vector<const Profile*>& units, std::ostream& os) {
+  char ts[64];
+  auto micros = [&](int64_t ns) {
+    std::snprintf(ts, sizeof ts, "%.3f", static_cast<double>(ns) / 1e3);
+    return ts;
+  };
+  os << "{\"traceEvents\":[\n";
+  bool first = true;
+  auto next = [&] {
+    if (!first) os << ",\n";
+    first = false;
+  };
+  for (size_t u = 0; u < units.size(); ++u) {
+    const Profile& p = *units[u];
+    const size_t tid = u + 1;
+    next();
+    os << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+       << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+    jsonString(os, p.unit());
+    os << "}}";
+    if (p.events().empty()) continue;
+
+    int64_t begin = p.events().front().begin, end = begin;
+    for (const Profile::Event& e : p.events()) end = std::max(end, e.end);
+    next();
+    os << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << tid << ",\"name\":";
+    jsonString(os, p.unit());
+    os << ",\"ts\":" << micros(begin);
+    os << ",\"dur\":" << micros(end - begin) << ",\"args\":{\"source bytes\":" << p.sourceBytes();
+    for (int c = 0; Profile::kCounters && c < kNumCounters; ++c)
+      os << ",\"" << kCounterInfo[c].description << "\":" << p.counter(static_cast<Counter>(c));
+    os << "}}";
+    for (const Profile::Event& e : p.events()) {
+      next();
+      os << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << tid << ",\"name\":\"" << e.name << "\"";
+      os << ",\"ts\":" << micros(e.begin);
+      os << ",\"dur\":" << micros(e.end - e.begin) << "}";
+    }
+  }
+  os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+}  // namespace byyl
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace byyl {
+
+// X(name, description, phase): what the counter counts, and the phase its
+// rate is measured against (null for none).
+#define BYYL_PROFILE_COUNTERS(X)                                   \
+  X(Tokens, "tokens", "lex")                                       \
+  X(AstNodes, "AST nodes", "parse")                                \
+  X(IrInstructions, "IR instructions", "lower")                    \
+  X(Bytecode, "bytecode instructions", "bytecode")                 \
+  X(CodeCacheHits, "code cache hits", nullptr)                     \
+  X(CodeCacheMisses, "code cache misses", nullptr)                 \
+  X(ArenaBytes, "arena bytes", nullptr)
+
+enum class Counter : uint8_t {
+#define BYYL_COUNTER_ENUM(name, description, phase) name,
+  BYYL_PROFILE_COUNTERS(BYYL_COUNTER_ENUM)
+#undef BYYL_COUNTER_ENUM
+};
+
+inline constexpr int kNumCounters = 0
+#define BYYL_COUNTER_COUNT(name, description, phase) +1
+    BYYL_PROFILE_COUNTERS(BYYL_COUNTER_COUNT)
+#undef BYYL_COUNTER_COUNT
+    ;
+
+// Wall-clock phase timings and counters of one translation unit, for
+// -ftime-report and -ftime-trace. Phases nest; each begin()/end() pair is
+// one event, timed in nanoseconds since the process started profiling, so
+// the events of units compiled concurrently line up in a trace.
+//
+// Counters exist only in builds with BYYL_ENABLE_STATS (the default except
+// for Release): elsewhere BYYL_COUNT expands to nothing, not even its
+// arguments, and the reports leave the counters out.
+class Profile {
+ public:
+  struct Event {
+    const char* name;  // a string literal
+    int64_t begin = 0, end = 0;
+    uint32_t depth = 0;
+  };
+
+#ifdef BYYL_NO_STATS
+  static constexpr bool kCounters = false;
+#else
+  static constexpr bool kCounters = true;
+#endif
+
+  explicit Profile(std::string unit, uint64_t sourceBytes = 0)
+      : unit_(std::move(unit)), sourceBytes_(sourceBytes) {}
+
+  // Fixes the time events are measured from; the first Profile does it
+  // otherwise.
+  static void startClock() { now(); }
+
+  void begin(const char* name) {
+    open_.push_back(static_cast<uint32_t>(events_.size()));
+    events_.push_back({name, now(), 0, static_cast<uint32_t>(open_.size() - 1)});
+  }
+  void end() {
+    events_[open_.back()].end = now();
+    open_.pop_back();
+  }
+
+  void count(Counter c, uint64_t n) {
+#ifndef BYYL_NO_STATS
+    counters_[static_cast<size_t>(c)] += n;
+#endif
+  }
+  uint64_t counter(Counter c) const {
+#ifndef BYYL_NO_STATS
+    return counters_[static_cast<size_t>(c)];
+#else
+    return 0;
+#endif
+  }
+
+  const std::string& unit() const { return unit_; }
+  uint64_t sourceBytes() const { return sourceBytes_; }
+  void setSourceBytes(uint64_t bytes) { sourceBytes_ = bytes; }
+  const std::vector<Event>& events() const { return events_; }
+
+ private:
+  static int64_t now() {
+    using Clock = std::chrono::steady_clock;
+    static const Clock::time_point epoch = Clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+  }
+
+  std::string unit_;
+  uint64_t sourceBytes_;
+  std::vector<Event> events_;
+  std::vector<uint32_t> open_;  // indices of the events not yet ended
+#ifndef BYYL_NO_STATS
+  std::array<uint64_t, kNumCounters> counters_{};
+#endif
+};
+
+// Times the enclosing block as a phase of `profile`, if there is one.
+class ProfileScope {
+ public:
+  ProfileScope(Profile* profile, const char* name) : profile_(profile) {
+    if (profile_) profile_->begin(name);
+  }
+  ~ProfileScope() {
+    if (profile_) profile_->end();
+  }
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+ private:
+  Profile* profile_;
+};
+
+#ifndef BYYL_NO_STATS
+#define BYYL_COUNT(profile, counter, n)                                   \
+  do {                                                                    \
+    if (profile) (profile)->count(::byyl::Counter::counter, (n));        \
+  } while (0)
+#else
+#define BYYL_COUNT(profile, counter, n) ((void)0)
+#endif
+
+// The -ftime-report table: phases summed over all units by name, nested
+// as they ran, with their share of the total and, for lex and parse, the
+// source throughput; then the counters and their rates.
+void printTimeReport(const std::vector<const Profile*>& units, std::ostream& os);
+
+// Chrome trace event JSON (chrome://tracing, Perfetto): one thread per
+// unit, one complete event per phase, and an event spanning each unit that
+// carries its counters.
+void writeChromeTrace(const std::vector<const Profile*>& units, std::ostream& os);
+
+}  // namespace byyl
@@ -0,0 +1,124 @@
+#include "support/source_buffer.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace byyl {
+
+namespace {
+
+// Below this size a read() is cheaper than setting up and tearing down a
+// mapping.
+constexpr size_t kMinMapSize = 64 * 1024;
+
+char* allocatePadded(size_t size) {
+  char* buf = new char[size + SourceBuffer::kPadding];
+  std::memset(buf + size, 0, SourceBuffer::kPadding);
+  return buf;
+}
+
+}  // namespace
+
+std::optional<SourceBuffer> SourceBuffer::open(const std::string& path, std::string& error) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    error = std::strerror(errno);
+    return std::nullopt;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    error = std::strerror(errno);
+    ::close(fd);
+    return std::nullopt;
+  }
+  if (!S_ISREG(st.st_mode)) {
+    error = "not a regular file";
+    ::close(fd);
+    return std::nullopt;
+  }
+  // SourcePos is a 32-bit byte offset.
+  if (static_cast<uint64_t>(st.st_size) > UINT32_MAX) {
+    error = "source file too large (limit 4 GiB)";
+    ::close(fd);
+    return std::nullopt;
+  }
+
+  SourceBuffer buf;
+  buf.size_ = static_cast<size_t>(st.st_size);
+
+  // The kernel zero-fills the tail of the last page, which doubles as the
+  // sentinel padding when there is room for it.
+  const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  const size_t tail = buf.size_ % page;
+  if (buf.size_ >= kMinMapSize && tail != 0 && page - tail >= kPadding) {
+    void* addr = ::mmap(nullptr, buf.size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      ::madvise(addr, buf.size_, MADV_SEQUENTIAL);
+      ::close(fd);
+      buf.data_ = static_cast<const char*>(addr);
+      buf.mapped_ = buf.size_;
+      return buf;
+    }
+  }
+
+  buf.owned_ = allocatePadded(buf.size_);
+  size_t done = 0;
+  while (done < buf.size_) {
+    ssize_t n = ::read(fd, buf.owned_ + done, buf.size_ - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      error = n < 0 ? std::strerror(errno) : "file shrank while reading";
+      ::close(fd);
+      return std::nullopt;
+    }
+    done += static_cast<size_t>(n);
+  }
+  ::close(fd);
+  buf.data_ = buf.owned_;
+  return buf;
+}
+
+SourceBuffer SourceBuffer::fromString(std::string_view text) {
+  SourceBuffer buf;
+  buf.size_ = text.size();
+  buf.owned_ = allocatePadded(text.size());
+  std::memcpy(buf.owned_, text.data(), text.size());
+  buf.data_ = buf.owned_;
+  return buf;
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      owned_(std::exchange(other.owned_, nullptr)),
+      mapped_(std::exchange(other.mapped_, 0)) {}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept {
+  if (this != &other) {
+    release();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    owned_ = std::exchange(other.owned_, nullptr);
+    mapped_ = std::exchange(other.mapped_, 0);
+  }
+  return *this;
+}
+
+SourceBuffer::~SourceBuffer() { release(); }
+
+void SourceBuffer::release() {
+  if (mapped_) ::munmap(const_cast<char*>(data_), mapped_);
+  delete[] owned_;
+  data_ = nullptr;
+  owned_ = nullptr;
+  mapped_ = 0;
+}
+
+}  // namespace byyl
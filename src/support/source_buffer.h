@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace byyl {
+
+// Immutable contents of one source file, followed by at least kPadding NUL
+// bytes. The scanner uses the first NUL as its end-of-input sentinel and may
+// read up to kPadding bytes past the last character without a bounds check.
+//
+// Large files are mapped read-only when the page tail can hold the padding;
+// everything else is read with a single read() into an owned buffer.
+class SourceBuffer {
+ public:
+  static constexpr size_t kPadding = 64;
+
+  // Returns nullopt and sets `error` if the file cannot be read or is larger
+  // than a SourcePos can address.
+  static std::optional<SourceBuffer> open(const std::string& path, std::string& error);
+  // Copies `text` into a padded buffer; used for in-memory sources.
+  static SourceBuffer fromString(std::string_view text);
+
+  SourceBuffer(SourceBuffer&& other) noexcept;
+  SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+  SourceBuffer(const SourceBuffer&) = delete;
+  SourceBuffer& operator=(const SourceBuffer&) = delete;
+  ~SourceBuffer();
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  std::string_view text() const { return {data_, size_}; }
+  bool isMapped() const { return mapped_ != 0; }
+
+ private:
+  SourceBuffer() = default;
+  void release();
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  char* owned_ = nullptr;
+  size_t mapped_ = 0;  // length of the mapping, 0 if heap-backed
+};
+
+}  // namespace byyl
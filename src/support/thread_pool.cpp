@@ -0,0 +1,129 @@
+#include "support/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+namespace byyl {
+
+namespace {
+
+// Worker index of the calling thread within its pool, or -1 outside one.
+thread_local const ThreadPool* tCurrentPool = nullptr;
+thread_local int tWorkerIndex = -1;
+
+}  // namespace
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0) threads = 1;
+  for (unsigned i = 0; i < threads; ++i) queues_.push_back(std::make_unique<Queue>());
+  for (unsigned i = 0; i < threads; ++i) workers_.emplace_back([this, i] { workerLoop(i); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto& w : workers_) w.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  unsigned target;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    target = tCurrentPool == this ? static_cast<unsigned>(tWorkerIndex) : next_++ % size();
+    ++pending_;
+  }
+  {
+    std::lock_guard<std::mutex> lock(queues_[target]->mu);
+    queues_[target]->tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    ++queued_;
+  }
+  wake_.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(mu_);
+  idle_.wait(lock, [this] { return pending_ == 0; });
+}
+
+bool ThreadPool::runOne(unsigned self) {
+  std::function<void()> task;
+  for (unsigned k = 0; k < size() && !task; ++k) {
+    Queue& q = *queues_[(self + k) % size()];
+    std::lock_guard<std::mutex> lock(q.mu);
+    if (q.tasks.empty()) continue;
+    if (k == 0) {
+      task = std::move(q.tasks.back());
+      q.tasks.pop_back();
+    } else {
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+    }
+  }
+  if (!task) return false;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    --queued_;
+  }
+  task();
+  bool drained;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    drained = --pending_ == 0;
+  }
+  if (drained) idle_.notify_all();
+  return true;
+}
+
+void ThreadPool::workerLoop(unsigned self) {
+  tCurrentPool = this;
+  tWorkerIndex = static_cast<int>(self);
+  while (true) {
+    if (runOne(self)) continue;
+    std::unique_lock<std::mutex> lock(mu_);
+    wake_.wait(lock, [this] { return queued_ > 0 || stop_; });
+    if (stop_ && queued_ <= 0) return;
+  }
+}
+
+void parallelFor(ThreadPool* pool, size_t n, const std::function<void(size_t)>& body) {
+  if (!pool || pool->size() <= 1 || n <= 1) {
+    for (size_t i = 0; i < n; ++i) body(i);
+    return;
+  }
+  // Shared with the helper tasks, which may only be picked up after every
+  // index has been claimed: they then find nothing left and never touch
+  // `body`, so this can return as soon as the claimed items are done.
+  struct Loop {
+    std::atomic<size_t> next{0};
+    size_t n = 0;
+    const std::function<void(size_t)>* body = nullptr;
+    std::mutex mu;
+    std::condition_variable finished;
+    size_t done = 0;
+  };
+  auto loop = std::make_shared<Loop>();
+  loop->n = n;
+  loop->body = &body;
+  auto work = [loop] {
+    size_t ran = 0;
+    for (size_t i; (i = loop->next.fetch_add(1, std::memory_order_relaxed)) < loop->n; ++ran)
+      (*loop->body)(i);
+    if (ran == 0) return;
+    std::lock_guard<std::mutex> lock(loop->mu);
+    if ((loop->done += ran) == loop->n) loop->finished.notify_all();
+  };
+  const size_t helpers = std::min<size_t>(pool->size() - 1, n - 1);
+  for (size_t h = 0; h < helpers; ++h) pool->submit(work);
+  work();
+  std::unique_lock<std::mutex> lock(loop->mu);
+  loop->finished.wait(lock, [&] { return loop->done == n; });
+}
+
+}  // namespace byyl
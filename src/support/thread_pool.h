@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace byyl {
+
+// Fixed set of worker threads with one task deque each. A worker runs the
+// newest task of its own deque and, once that is empty, steals the oldest
+// task of another worker's, so uneven tasks balance without one shared
+// queue. Tasks must not throw.
+class ThreadPool {
+ public:
+  explicit ThreadPool(unsigned threads);
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  // Finishes the queued tasks, then joins the workers.
+  ~ThreadPool();
+
+  // From a worker, the task goes to that worker's own deque; otherwise the
+  // deques are filled round-robin.
+  void submit(std::function<void()> task);
+  // Blocks until every task submitted so far has finished.
+  void wait();
+
+  unsigned size() const { return static_cast<unsigned>(queues_.size()); }
+
+ private:
+  struct Queue {
+    std::mutex mu;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void workerLoop(unsigned self);
+  bool runOne(unsigned self);
+
+  std::vector<std::unique_ptr<Queue>> queues_;  // complete before any worker starts
+  std::vector<std::thread> workers_;
+  std::mutex mu_;
+  std::condition_variable wake_;  // queued_ > 0 or stop_
+  std::condition_variable idle_;  // pending_ == 0
+  long queued_ = 0;    // submitted, not yet taken by a worker
+  long pending_ = 0;   // submitted, not yet finished
+  unsigned next_ = 0;  // round-robin cursor for outside submitters
+  bool stop_ = false;
+};
+
+// Runs body(0) .. body(n - 1) and returns once all have finished. With a
+// pool, the calling thread and up to pool->size() - 1 pool tasks claim
+// indices one at a time, so uneven items balance; the caller working too
+// means it can be called from a pool task without waiting on itself.
+// Without a pool, or for a single item, it is a plain loop. `body` must
+// not throw.
+void parallelFor(ThreadPool* pool, size_t n, const std::function<void(size_t)>& body);
+
+}  // namespace byyl
@@ -0,0 +1,374 @@
+#include "vm/bytecode.h"
+
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "codegen/select.h"
+#include "support/profile.h"
+#include "support/thread_pool.h"
+#include "vm/peephole.h"
+
+namespace byyl::vm {
+
+namespace {
+
+const char* const kOperands[] = {
+#define BYYL_VM_OPERANDS(name, operands) operands,
+    BYYL_VM_OPS(BYYL_VM_OPERANDS)
+#undef BYYL_VM_OPERANDS
+};
+
+// The binary opcodes follow the IR's, in the same order.
+constexpr uint32_t index(Op op) { return static_cast<uint32_t>(op); }
+constexpr uint32_t index(Opcode op) { return static_cast<uint32_t>(op); }
+constexpr uint32_t kBinaryOps = index(Op::Ne) - index(Op::Add) + 1;
+static_assert(index(Opcode::Ne) - index(Opcode::Add) + 1 == kBinaryOps &&
+                  index(Opcode::AddI) - index(Opcode::Add) == kBinaryOps,
+              "Opcode::Add..Ne and AddI..NeI mirror Op::Add..Ne");
+
+bool isJump(const Insn& in) {
+  const Opcode op = static_cast<Opcode>(in.op);
+  return op == Opcode::Jump || op == Opcode::JumpIf || op == Opcode::JumpIfNot;
+}
+
+Opcode binaryOpcode(Op op, bool immediate) {
+  return static_cast<Opcode>(index(Opcode::Add) + (immediate ? kBinaryOps : 0) + index(op) -
+                             index(Op::Add));
+}
+
+// Assembles one function. It reads only the module and its own state, so
+// functions can be assembled on separate threads and linked afterwards.
+class Assembler {
+ public:
+  Assembler(const Module& m, const std::vector<int32_t>& globalBase, uint32_t registers,
+            Allocator allocator, bool optimize, Profile* profile)
+      : m_(m),
+        globalBase_(globalBase),
+        registers_(registers),
+        allocator_(allocator),
+        optimize_(optimize),
+        profile_(profile) {}
+
+  void function(const Function& fn, FunctionBytecode& result) {
+    FunctionCode& out = result.info;
+    fn_ = &fn;
+    Allocation a;
+    {
+      ProfileScope scope(profile_, "regalloc");
+      a = allocateRegisters(fn, registers_, allocator_);
+    }
+    slot_.clear();
+    for (const Location& l : a.vars)
+      slot_.push_back(static_cast<int32_t>(
+          l.kind == Location::Kind::Register ? l.index : a.registersUsed + l.index));
+    scratch_ = static_cast<int32_t>(a.registersUsed + a.stackSlots);
+    out.frameSize = static_cast<uint32_t>(scratch_) + 2;
+    for (uint32_t v = 0; v < fn.numParams; ++v) out.params.push_back(slot_[v]);
+
+    code_.clear();
+    labels_.assign(fn.numLabels, 0);
+    {
+      ProfileScope scope(profile_, "isel");
+      forest_.build(m_, fn);
+    }
+    for (uint32_t root : forest_.roots()) reduce(root, isel::BursNt::stmt, -1);
+    // Falling off the end returns, as the lowering's own epilogue does.
+    emit(Opcode::ReturnVoid);
+    if (optimize_) {
+      ProfileScope scope(profile_, "peephole");
+      peephole(code_, labels_, scratch_);
+    }
+
+    for (Insn& in : code_)
+      if (isJump(in)) in.a = static_cast<int32_t>(labels_[in.a]);
+    result.code = std::move(code_);
+  }
+
+ private:
+  void emit(Opcode op, int32_t a = 0, int32_t b = 0, int32_t c = 0) {
+    code_.push_back({static_cast<uint32_t>(op), a, b, c});
+  }
+
+  void loadImm(int32_t dst, int64_t v) {
+    emit(Opcode::LoadI, dst, static_cast<int32_t>(v), static_cast<int32_t>(v >> 32));
+  }
+
+  void jump(Opcode op, Operand label, int32_t cond = 0) {
+    emit(op, static_cast<int32_t>(label.index()), cond);
+  }
+
+  // Emits the cheapest cover of the tree at `n` as nonterminal `nt` and
+  // returns the slot holding a `reg` value, or an `imm` value itself. A
+  // computed `reg` goes into `dst`.
+  int32_t reduce(uint32_t n, isel::BursNt nt, int32_t dst) {
+    using isel::BursAction;
+    const int rule = forest_.rule(n, nt);
+    const isel::Node& node = forest_[n];
+    const BursAction action = isel::kBursRuleAction[rule];
+    const uint32_t first = isel::kBursRuleKids[rule];
+    const uint32_t count = isel::kBursRuleKids[rule + 1] - first;
+
+    // A rule with one kid may send its value straight where the rule would
+    // otherwise copy it.
+    int32_t into = -1;
+    switch (action) {
+      case BursAction::Pass:
+        into = dst;
+        break;
+      case BursAction::SetVar:
+        into = slot_[forest_[node.kids[0]].operand.index()];
+        break;
+      case BursAction::StoreSlot:
+        into = elementSlot(node);
+        break;
+      default:
+        break;
+    }
+    // Folded subtrees first, in order: their quadruples came before this
+    // one. Then the leaves, whose values are read here.
+    uint32_t at[isel::kBursMaxArity];
+    int32_t kid[isel::kBursMaxArity];
+    for (uint32_t k = 0; k < count; ++k) at[k] = forest_.follow(n, isel::kBursKidPath[first + k]);
+    for (bool folded : {true, false}) {
+      for (uint32_t k = 0; k < count; ++k) {
+        const isel::Node& child = forest_[at[k]];
+        if (child.folded != folded) continue;
+        const int32_t target = into >= 0         ? into
+                               : child.folded    ? slot_[child.operand.index()]
+                                                 : scratch_ + static_cast<int32_t>(k);
+        kid[k] = reduce(at[k], static_cast<isel::BursNt>(isel::kBursKidNt[first + k]), target);
+      }
+    }
+
+    const Function& fn = *fn_;
+    const Op op = fn.op[node.insn];
+    switch (action) {
+      case BursAction::Pass:
+        return kid[0];
+      case BursAction::Var:
+        return slot_[node.operand.index()];
+      case BursAction::GetG:
+        emit(Opcode::GetG, dst, globalBase_[node.operand.index()]);
+        return dst;
+      case BursAction::LoadI:
+        loadImm(dst, m_.constantValue(node.operand));
+        return dst;
+      case BursAction::Imm:
+        return static_cast<int32_t>(m_.constantValue(node.operand));
+      case BursAction::Const:
+        return 0;
+      case BursAction::Binary:
+      case BursAction::BinaryImm:
+        emit(binaryOpcode(op, action == BursAction::BinaryImm), dst, kid[0], kid[1]);
+        return dst;
+      case BursAction::Unary:
+        emit(op == Op::Neg ? Opcode::Neg : op == Op::Not ? Opcode::Not : Opcode::BitNot, dst,
+             kid[0]);
+        return dst;
+      case BursAction::LoadSlot:
+        emit(Opcode::Mov, dst, elementSlot(node));
+        return dst;
+      case BursAction::LoadGlobalSlot:
+        emit(Opcode::GetG, dst, elementSlot(node));
+        return dst;
+      case BursAction::LoadX:
+      case BursAction::LoadGX: {
+        const Operand base = forest_[node.kids[0]].operand;
+        emit(action == BursAction::LoadX ? Opcode::LoadX : Opcode::LoadGX, dst, baseSlot(base),
+             kid[0]);
+        emit(Opcode::Data, static_cast<int32_t>(size(base)));
+        return dst;
+      }
+      case BursAction::Call:
+      case BursAction::CallVoid:
+        emit(Opcode::Call, action == BursAction::Call ? dst : -1,
+             static_cast<int32_t>(fn.arg1[node.insn].index()),
+             static_cast<int32_t>(m_.constantValue(fn.arg2[node.insn])));
+        return dst;
+      case BursAction::SetVar:
+        if (kid[0] != into) emit(Opcode::Mov, into, kid[0]);
+        return into;
+      case BursAction::SetGlobal:
+        emit(Opcode::SetG, globalBase_[forest_[node.kids[0]].operand.index()], kid[0]);
+        return 0;
+      case BursAction::StoreSlot:
+        if (kid[0] != into) emit(Opcode::Mov, into, kid[0]);
+        return 0;
+      case BursAction::StoreGlobalSlot:
+        emit(Opcode::SetG, elementSlot(node), kid[0]);
+        return 0;
+      case BursAction::StoreX:
+      case BursAction::StoreGX: {
+        const Operand base = forest_[node.kids[0]].operand;
+        emit(action == BursAction::StoreX ? Opcode::StoreX : Opcode::StoreGX, baseSlot(base),
+             kid[0], kid[1]);
+        emit(Opcode::Data, static_cast<int32_t>(size(base)));
+        return 0;
+      }
+      case BursAction::BranchConst:
+        if ((m_.constantValue(forest_[node.kids[0]].operand) != 0) == (op == Op::JumpIf))
+          jump(Opcode::Jump, fn.result[node.insn]);
+        return 0;
+      case BursAction::Branch:
+        jump(op == Op::JumpIf ? Opcode::JumpIf : Opcode::JumpIfNot, fn.result[node.insn], kid[0]);
+        return 0;
+      case BursAction::Param:
+        emit(Opcode::Arg, kid[0]);
+        return 0;
+      case BursAction::Return:
+        emit(Opcode::Return, kid[0]);
+        return 0;
+      case BursAction::ReturnVoid:
+        emit(Opcode::ReturnVoid);
+        return 0;
+      case BursAction::Print:
+        emit(op == Op::PrintInt ? Opcode::PrintInt : Opcode::PrintBool, kid[0]);
+        return 0;
+      case BursAction::PrintStr:
+        emit(Opcode::PrintStr, static_cast<int32_t>(node.operand.index()));
+        return 0;
+      case BursAction::PrintLn:
+        emit(Opcode::PrintLn);
+        return 0;
+      case BursAction::Label:
+        labels_[node.operand.index()] = static_cast<uint32_t>(code_.size());
+        return 0;
+      case BursAction::Jump:
+        jump(Opcode::Jump, node.operand);
+        return 0;
+    }
+    return 0;
+  }
+
+  uint32_t size(Operand aggregate) const {
+    return aggregate.is(Operand::Kind::Global) ? m_.globals[aggregate.index()].size
+                                               : fn_->vars[aggregate.index()].size;
+  }
+  int32_t baseSlot(Operand aggregate) const {
+    return aggregate.is(Operand::Kind::Global) ? globalBase_[aggregate.index()]
+                                               : slot_[aggregate.index()];
+  }
+  // Frame or global slot of a Load or Store whose index is a Slot leaf.
+  int32_t elementSlot(const isel::Node& n) const {
+    return baseSlot(forest_[n.kids[0]].operand) +
+           static_cast<int32_t>(m_.constantValue(forest_[n.kids[1]].operand));
+  }
+
+  const Module& m_;
+  const std::vector<int32_t>& globalBase_;  // first slot of each global
+  const uint32_t registers_;
+  const Allocator allocator_;
+  const bool optimize_;
+  Profile* const profile_;
+
+  const Function* fn_ = nullptr;
+  std::vector<int32_t> slot_;  // frame slot of each variable
+  int32_t scratch_ = 0;
+  // The function's code until it is appended to the program, with jumps
+  // to label numbers and labels at indices into it.
+  std::vector<Insn> code_;
+  std::vector<uint32_t> labels_;
+  isel::Forest forest_;
+};
+
+}  // namespace
+
+const char* opcodeName(Opcode op) {
+  static const char* const names[] = {
+#define BYYL_VM_NAME(name, operands) #name,
+      BYYL_VM_OPS(BYYL_VM_NAME)
+#undef BYYL_VM_NAME
+  };
+  return names[static_cast<uint32_t>(op)];
+}
+
+std::vector<int32_t> globalSlots(const Module& module) {
+  std::vector<int32_t> slots;
+  int32_t slot = 0;
+  for (const Var& g : module.globals) {
+    slots.push_back(slot);
+    slot += static_cast<int32_t>(g.size);
+  }
+  return slots;
+}
+
+FunctionBytecode assembleFunction(const Module& module, const Function& fn,
+                                  const std::vector<int32_t>& globalSlots, uint32_t registers,
+                                  Allocator allocator, bool optimize, Profile* profile) {
+  FunctionBytecode result;
+  Assembler(module, globalSlots, registers, allocator, optimize, profile).function(fn, result);
+  return result;
+}
+
+Program linkProgram(const Module& module, const Interner& interner,
+                    std::vector<FunctionBytecode> functions) {
+  Program p;
+  p.strings = module.strings;
+  p.initFunction = module.initFunction;
+  p.mainFunction = module.findFunction(interner.lookup("main"));
+  for (const Var& g : module.globals) p.globalSlots += g.size;
+  size_t total = 0;
+  for (const FunctionBytecode& f : functions) total += f.code.size();
+  p.code.reserve(total);
+  for (size_t f = 0; f < functions.size(); ++f) {
+    FunctionBytecode& fb = functions[f];
+    fb.info.name = interner.spelling(module.functions[f].name);
+    fb.info.entry = static_cast<uint32_t>(p.code.size());
+    for (Insn& in : fb.code)
+      if (isJump(in)) in.a += static_cast<int32_t>(fb.info.entry);
+    p.code.insert(p.code.end(), fb.code.begin(), fb.code.end());
+    std::vector<Insn>().swap(fb.code);
+    p.functions.push_back(std::move(fb.info));
+  }
+  return p;
+}
+
+Program compileBytecode(const Module& module, const Interner& interner, uint32_t registers,
+                        Allocator allocator, bool optimize, Profile* profile, ThreadPool* pool) {
+  ProfileScope scope(profile, "bytecode");
+  const std::vector<int32_t> slots = globalSlots(module);
+  std::vector<FunctionBytecode> functions(module.functions.size());
+  Profile* const phases = pool ? nullptr : profile;
+  parallelFor(pool, functions.size(), [&](size_t f) {
+    functions[f] = assembleFunction(module, module.functions[f], slots, registers, allocator,
+                                    optimize, phases);
+  });
+  // Module order, however the functions were scheduled.
+  Program p = linkProgram(module, interner, std::move(functions));
+  BYYL_COUNT(profile, Bytecode, p.code.size());
+  return p;
+}
+
+void dumpBytecode(const Program& program, std::ostream& os) {
+  for (size_t f = 0; f < program.functions.size(); ++f) {
+    const FunctionCode& fc = program.functions[f];
+    const size_t end = f + 1 < program.functions.size() ? program.functions[f + 1].entry
+                                                        : program.code.size();
+    os << "\nfn " << fc.name << ": " << fc.frameSize << " slots\n";
+    for (size_t pc = fc.entry; pc < end; ++pc) {
+      const Insn& in = program.code[pc];
+      os << "  " << pc << '\t' << opcodeName(static_cast<Opcode>(in.op));
+      const int32_t fields[] = {in.a, in.b, in.c};
+      int k = 0;
+      for (const char* o = kOperands[in.op]; *o; ++o) {
+        os << (k ? ", " : " ");
+        const int32_t v = fields[k++];
+        switch (*o) {
+          case 'r': v < 0 ? os << '-' : os << 'r' << v; break;
+          case 'g': os << '@' << v; break;
+          case 'j': os << v; break;
+          case 'f': os << program.functions[v].name; break;
+          case 's': os << '"' << program.strings[v] << '"'; break;
+          case 'I':
+            os << static_cast<int64_t>(uint32_t(v) | uint64_t(uint32_t(fields[k++])) << 32);
+            break;
+          default: os << v; break;
+        }
+      }
+      os << '\n';
+    }
+  }
+}
+
+}  // namespace byyl::vm
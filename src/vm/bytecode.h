@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "codegen/regalloc.h"
+#include "ir/ir.h"
+
+namespace byyl {
+class Profile;
+class ThreadPool;
+}  // namespace byyl
+
+namespace byyl::vm {
+
+// Register bytecode: X(name, operands). Each operand letter names what the
+// a, b and c fields hold: r a frame slot, i a 32-bit immediate, I a 64-bit
+// immediate over b and c, g a global slot, j a code index, f a function,
+// n an argument count, s a string. Ops ending in X index an aggregate and
+// are followed by a Data word whose `a` is its size in slots, so the index
+// can be bounds-checked. The I forms of the binary ops take their right
+// operand as an immediate.
+#define BYYL_VM_OPS(X)                                                 \
+  X(Mov, "rr")                                                         \
+  X(LoadI, "rI")                                                       \
+  X(GetG, "rg")                                                        \
+  X(SetG, "gr")                                                        \
+  X(Add, "rrr")                                                        \
+  X(Sub, "rrr")                                                        \
+  X(Mul, "rrr")                                                        \
+  X(Div, "rrr")                                                        \
+  X(Rem, "rrr")                                                        \
+  X(Shl, "rrr")                                                        \
+  X(Shr, "rrr")                                                        \
+  X(And, "rrr")                                                        \
+  X(Or, "rrr")                                                         \
+  X(Xor, "rrr")                                                        \
+  X(Lt, "rrr")                                                         \
+  X(Le, "rrr")                                                         \
+  X(Gt, "rrr")                                                         \
+  X(Ge, "rrr")                                                         \
+  X(Eq, "rrr")                                                         \
+  X(Ne, "rrr")                                                         \
+  X(AddI, "rri")                                                       \
+  X(SubI, "rri")                                                       \
+  X(MulI, "rri")                                                       \
+  X(DivI, "rri")                                                       \
+  X(RemI, "rri")                                                       \
+  X(ShlI, "rri")                                                       \
+  X(ShrI, "rri")                                                       \
+  X(AndI, "rri")                                                       \
+  X(OrI, "rri")                                                        \
+  X(XorI, "rri")                                                       \
+  X(LtI, "rri")                                                        \
+  X(LeI, "rri")                                                        \
+  X(GtI, "rri")                                                        \
+  X(GeI, "rri")                                                        \
+  X(EqI, "rri")                                                        \
+  X(NeI, "rri")                                                        \
+  X(Neg, "rr")                                                         \
+  X(Not, "rr")                                                         \
+  X(BitNot, "rr")                                                      \
+  X(LoadX, "rrr")      /* a = b[c], b a frame slot  */                 \
+  X(LoadGX, "rgr")     /* a = b[c], b a global slot */                 \
+  X(StoreX, "rrr")     /* a[b] = c                  */                 \
+  X(StoreGX, "grr")    /* a[b] = c                  */                 \
+  X(Data, "i")                                                         \
+  X(Jump, "j")                                                         \
+  X(JumpIf, "jr")                                                      \
+  X(JumpIfNot, "jr")                                                   \
+  X(Arg, "r")                                                          \
+  X(Call, "rfn")       /* a = b(args), a < 0 drops the result */       \
+  X(Return, "r")                                                       \
+  X(ReturnVoid, "")                                                    \
+  X(PrintInt, "r")                                                     \
+  X(PrintBool, "r")                                                    \
+  X(PrintStr, "s")                                                     \
+  X(PrintLn, "")
+
+enum class Opcode : uint32_t {
+#define BYYL_VM_ENUM(name, operands) name,
+  BYYL_VM_OPS(BYYL_VM_ENUM)
+#undef BYYL_VM_ENUM
+};
+
+// How many opcodes BYYL_VM_OPS lists.
+constexpr uint32_t kNumOpcodes = 0
+#define BYYL_VM_COUNT(name, operands) +1
+    BYYL_VM_OPS(BYYL_VM_COUNT)
+#undef BYYL_VM_COUNT
+    ;
+
+const char* opcodeName(Opcode op);
+
+// One 16-byte instruction. The interpreter threads a copy of the code by
+// replacing `op` with the offset of its handler.
+struct Insn {
+  uint32_t op;
+  int32_t a = 0, b = 0, c = 0;
+};
+static_assert(sizeof(Insn) == 16, "instructions are four words");
+
+struct FunctionCode {
+  std::string name;
+  uint32_t entry = 0;      // index of the first instruction
+  uint32_t frameSize = 0;  // slots, all zero on entry
+  std::vector<int32_t> params;  // frame slot of each parameter
+};
+
+struct Program {
+  std::vector<Insn> code;
+  std::vector<FunctionCode> functions;  // as in Module::functions
+  std::vector<std::string> strings;
+  uint32_t globalSlots = 0;
+  int initFunction = -1;
+  int mainFunction = -1;
+};
+
+// Lowers a checked module to bytecode. Variables live in the frame slots
+// allocateRegisters() gives them, numbered registers first, and each frame
+// ends in two scratch slots for constant and global operands. With
+// `optimize`, each function's code goes through peephole() first.
+// Register allocation and the peephole pass are phases of `profile`.
+// With a `pool`, functions are allocated and assembled on it and then
+// linked in module order, so the program is the same either way; only the
+// whole pass is timed then.
+Program compileBytecode(const Module& module, const Interner& interner, uint32_t registers,
+                        Allocator allocator, bool optimize, Profile* profile = nullptr,
+                        ThreadPool* pool = nullptr);
+
+// compileBytecode in steps, for a caller that gets some functions' code
+// elsewhere (the driver's code cache). A function's code depends only on
+// its own IR, the module's constants, the global layout and the flags.
+struct FunctionBytecode {
+  FunctionCode info;       // linkProgram() sets the name and entry
+  std::vector<Insn> code;  // jumps index into this vector
+};
+// First slot of each global.
+std::vector<int32_t> globalSlots(const Module& module);
+FunctionBytecode assembleFunction(const Module& module, const Function& fn,
+                                  const std::vector<int32_t>& globalSlots, uint32_t registers,
+                                  Allocator allocator, bool optimize, Profile* profile = nullptr);
+// Lays out `functions`, one per Module::functions entry, in module order.
+Program linkProgram(const Module& module, const Interner& interner,
+                    std::vector<FunctionBytecode> functions);
+
+// Listing, for --dump-bytecode.
+void dumpBytecode(const Program& program, std::ostream& os);
+
+}  // namespace byyl::vm
@@ -0,0 +1,334 @@
+#include "vm/jit.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__unix__) && !defined(BYYL_NO_JIT)
+#define BYYL_JIT 1
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "vm/x86_64.h"
+#else
+#define BYYL_JIT 0
+#endif
+
+namespace byyl::vm {
+
+#if BYYL_JIT
+
+namespace {
+
+using namespace x86_64;
+
+Mem slot(int32_t s) { return {rbx, s * 8}; }
+
+Cond condition(Opcode op) {
+  switch (op) {
+    case Opcode::Lt: case Opcode::LtI: return kLess;
+    case Opcode::Le: case Opcode::LeI: return kLessEqual;
+    case Opcode::Gt: case Opcode::GtI: return kGreater;
+    case Opcode::Ge: case Opcode::GeI: return kGreaterEqual;
+    case Opcode::Eq: case Opcode::EqI: return kEqual;
+    default: return kNotEqual;
+  }
+}
+
+Alu aluOp(Opcode op) {
+  switch (op) {
+    case Opcode::Add: case Opcode::AddI: return Alu::Add;
+    case Opcode::Sub: case Opcode::SubI: return Alu::Sub;
+    case Opcode::And: case Opcode::AndI: return Alu::And;
+    case Opcode::Or: case Opcode::OrI: return Alu::Or;
+    default: return Alu::Xor;
+  }
+}
+
+class Compiler {
+ public:
+  Compiler(const Program& p, const JitRuntime& rt, uint32_t f) : p_(p), rt_(rt), f_(f) {}
+
+  // Machine code for the function, and the offset of each instruction.
+  std::vector<uint8_t>& run(std::vector<uint32_t>& offsets) {
+    const FunctionCode& fc = p_.functions[f_];
+    const uint32_t begin = fc.entry;
+    const uint32_t end = f_ + 1 < p_.functions.size() ? p_.functions[f_ + 1].entry
+                                                      : static_cast<uint32_t>(p_.code.size());
+    labels_.resize(end - begin);
+    prologue();
+    for (uint32_t pc = begin; pc < end; ++pc) {
+      offsets.push_back(as_.size());
+      as_.bind(labels_[pc - begin]);
+      instruction(pc, begin);
+    }
+    traps();
+    return as_.code();
+  }
+
+ private:
+  // Saves the callee-saved registers it pins, then jumps to the address
+  // passed in rsi.
+  void prologue() {
+    for (Reg r : {rbx, r12, r13, r14, r15}) as_.push(r);
+    as_.mov(rbx, rdi);
+    as_.mov(r12, reinterpret_cast<int64_t>(rt_.machine));
+    as_.mov(r13, reinterpret_cast<int64_t>(rt_.globals));
+    as_.mov(r14, reinterpret_cast<int64_t>(rt_.args));
+    as_.mov(r15, reinterpret_cast<int64_t>(rt_.trap));
+    as_.jmp(rsi);
+    as_.bind(epilogue_);
+    for (Reg r : {r15, r14, r13, r12, rbx}) as_.pop(r);
+    as_.ret();
+  }
+
+  template <typename F>
+  void callHelper(F* helper) {
+    as_.mov(rax, reinterpret_cast<int64_t>(helper));
+    as_.call(rax);
+  }
+
+  void traps() {
+    for (auto [label, error] : {std::make_pair(&divTrap_, JitError::DivisionByZero),
+                                std::make_pair(&indexTrap_, JitError::IndexOutOfBounds)}) {
+      as_.bind(*label);
+      as_.mov(rdi, r12);
+      as_.mov(rsi, static_cast<int64_t>(error));
+      as_.mov(rdx, static_cast<int64_t>(f_));
+      callHelper(rt_.raise);
+      as_.jmp(epilogue_);
+    }
+  }
+
+  // rax = b / c or b % c, given rax = b and rcx = c with c != 0.
+  void divide(bool rem) {
+    Assembler::Label divide, done;
+    as_.alu(Alu::Cmp, rcx, -1);
+    as_.jcc(kNotEqual, divide);
+    if (rem) as_.xor32(rax, rax);
+    else as_.neg(rax);
+    as_.jmp(done);
+    as_.bind(divide);
+    as_.cqo();
+    as_.idiv(rcx);
+    if (rem) as_.mov(rax, rdx);
+    as_.bind(done);
+  }
+
+  void instruction(uint32_t pc, uint32_t begin) {
+    const Insn& in = p_.code[pc];
+    const auto op = static_cast<Opcode>(in.op);
+    switch (op) {
+      case Opcode::Mov:
+        as_.mov(rax, slot(in.b));
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::LoadI: {
+        const auto v = static_cast<int64_t>(uint32_t(in.b) | uint64_t(uint32_t(in.c)) << 32);
+        if (v >= INT32_MIN && v <= INT32_MAX) {
+          as_.mov(slot(in.a), static_cast<int32_t>(v));
+        } else {
+          as_.mov(rax, v);
+          as_.mov(slot(in.a), rax);
+        }
+        return;
+      }
+      case Opcode::GetG:
+        as_.mov(rax, Mem{r13, in.b * 8});
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::SetG:
+        as_.mov(rax, slot(in.b));
+        as_.mov(Mem{r13, in.a * 8}, rax);
+        return;
+      case Opcode::Add: case Opcode::Sub: case Opcode::And: case Opcode::Or: case Opcode::Xor:
+        as_.mov(rax, slot(in.b));
+        as_.alu(aluOp(op), rax, slot(in.c));
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::AddI: case Opcode::SubI: case Opcode::AndI: case Opcode::OrI:
+      case Opcode::XorI:
+        as_.mov(rax, slot(in.b));
+        as_.alu(aluOp(op), rax, in.c);
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::Mul:
+        as_.mov(rax, slot(in.b));
+        as_.imul(rax, slot(in.c));
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::MulI:
+        as_.mov(rax, slot(in.b));
+        as_.imul(rax, rax, in.c);
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::Shl: case Opcode::Shr:
+        as_.mov(rax, slot(in.b));
+        as_.mov(rcx, slot(in.c));  // the hardware takes the count mod 64
+        if (op == Opcode::Shl) as_.shlCl(rax);
+        else as_.sarCl(rax);
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::ShlI: case Opcode::ShrI:
+        as_.mov(rax, slot(in.b));
+        if (op == Opcode::ShlI) as_.shl(rax, in.c & 63);
+        else as_.sar(rax, in.c & 63);
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::Div: case Opcode::Rem:
+        as_.mov(rax, slot(in.b));
+        as_.mov(rcx, slot(in.c));
+        as_.test(rcx, rcx);
+        as_.jcc(kEqual, divTrap_);
+        divide(op == Opcode::Rem);
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::DivI: case Opcode::RemI:
+        as_.mov(rax, slot(in.b));
+        as_.mov(rcx, in.c);
+        divide(op == Opcode::RemI);
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::Lt: case Opcode::Le: case Opcode::Gt: case Opcode::Ge: case Opcode::Eq:
+      case Opcode::Ne:
+        as_.mov(rax, slot(in.b));
+        as_.alu(Alu::Cmp, rax, slot(in.c));
+        as_.setcc(condition(op));
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::LtI: case Opcode::LeI: case Opcode::GtI: case Opcode::GeI: case Opcode::EqI:
+      case Opcode::NeI:
+        as_.mov(rax, slot(in.b));
+        as_.alu(Alu::Cmp, rax, in.c);
+        as_.setcc(condition(op));
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::Neg: case Opcode::BitNot:
+        as_.mov(rax, slot(in.b));
+        if (op == Opcode::Neg) as_.neg(rax);
+        else as_.bitNot(rax);
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::Not:
+        as_.mov(rax, slot(in.b));
+        as_.test(rax, rax);
+        as_.setcc(kEqual);
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::LoadX: case Opcode::LoadGX:
+        as_.mov(rcx, slot(in.c));
+        as_.alu(Alu::Cmp, rcx, p_.code[pc + 1].a);
+        as_.jcc(kAboveEqual, indexTrap_);  // unsigned, so negative indices too
+        as_.mov(rax, Mem{op == Opcode::LoadX ? rbx : r13, in.b * 8, rcx});
+        as_.mov(slot(in.a), rax);
+        return;
+      case Opcode::StoreX: case Opcode::StoreGX:
+        as_.mov(rcx, slot(in.b));
+        as_.alu(Alu::Cmp, rcx, p_.code[pc + 1].a);
+        as_.jcc(kAboveEqual, indexTrap_);
+        as_.mov(rax, slot(in.c));
+        as_.mov(Mem{op == Opcode::StoreX ? rbx : r13, in.a * 8, rcx}, rax);
+        return;
+      case Opcode::Data:
+        return;
+      case Opcode::Jump:
+        as_.jmp(labels_[in.a - begin]);
+        return;
+      case Opcode::JumpIf: case Opcode::JumpIfNot:
+        as_.alu(Alu::Cmp, slot(in.b), 0);
+        as_.jcc(op == Opcode::JumpIf ? kNotEqual : kEqual, labels_[in.a - begin]);
+        return;
+      case Opcode::Arg:
+        as_.mov(rax, slot(in.a));
+        as_.mov(Mem{r14, 8 * args_++}, rax);
+        return;
+      case Opcode::Call:
+        as_.mov(rdi, r12);
+        as_.lea(rsi, slot(static_cast<int32_t>(p_.functions[f_].frameSize)));
+        as_.mov(rdx, in.b);
+        as_.mov(rcx, in.c);
+        as_.mov(r8, static_cast<int64_t>(f_));
+        callHelper(rt_.call);
+        as_.alu(Alu::Cmp, Mem{r15, 0}, 0);
+        as_.jcc(kNotEqual, epilogue_);
+        if (in.a >= 0) as_.mov(slot(in.a), rax);
+        args_ = 0;
+        return;
+      case Opcode::Return:
+        as_.mov(rax, slot(in.a));
+        as_.jmp(epilogue_);
+        return;
+      case Opcode::ReturnVoid:
+        as_.xor32(rax, rax);
+        as_.jmp(epilogue_);
+        return;
+      case Opcode::PrintInt: case Opcode::PrintBool:
+        as_.mov(rdi, r12);
+        as_.mov(rsi, slot(in.a));
+        callHelper(op == Opcode::PrintInt ? rt_.printInt : rt_.printBool);
+        return;
+      case Opcode::PrintStr:
+        as_.mov(rdi, r12);
+        as_.mov(rsi, in.a);
+        callHelper(rt_.printStr);
+        return;
+      case Opcode::PrintLn:
+        as_.mov(rdi, r12);
+        callHelper(rt_.printLn);
+        return;
+    }
+  }
+
+  const Program& p_;
+  const JitRuntime& rt_;
+  const uint32_t f_;
+  Assembler as_;
+  std::vector<Assembler::Label> labels_;  // per instruction
+  Assembler::Label epilogue_, divTrap_, indexTrap_;
+  int32_t args_ = 0;  // Args since the last Call
+};
+
+}  // namespace
+
+bool Jit::supported() { return true; }
+
+Jit::Jit(const Program& program, const JitRuntime& runtime)
+    : program_(program), runtime_(runtime), functions_(program.functions.size()) {}
+
+Jit::~Jit() {
+  for (Native& n : functions_)
+    if (n.memory) ::munmap(n.memory, n.mapped);
+}
+
+bool Jit::compile(uint32_t f) {
+  Native& n = functions_[f];
+  std::vector<uint32_t> offsets;
+  Compiler compiler(program_, runtime_, f);
+  const std::vector<uint8_t>& code = compiler.run(offsets);
+  const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  const size_t size = (code.size() + page - 1) / page * page;
+  void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) return false;
+  std::memcpy(memory, code.data(), code.size());
+  if (::mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+    ::munmap(memory, size);
+    return false;
+  }
+  n.memory = static_cast<uint8_t*>(memory);
+  n.mapped = size;
+  n.offsets = std::move(offsets);
+  return true;
+}
+
+#else
+
+bool Jit::supported() { return false; }
+
+Jit::Jit(const Program& program, const JitRuntime& runtime)
+    : program_(program), runtime_(runtime), functions_(program.functions.size()) {}
+
+Jit::~Jit() = default;
+
+bool Jit::compile(uint32_t) { return false; }
+
+#endif
+
+}  // namespace byyl::vm
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vm/bytecode.h"
+
+namespace byyl::vm {
+
+// What native code calls back into. Native frames are the interpreter's
+// frames, so the two can hand a running function back and forth.
+struct JitRuntime {
+  void* machine;
+  int64_t* globals;
+  int64_t* args;            // outgoing arguments, written by Arg
+  const char* const* trap;  // nonzero once a run-time error has been raised
+  // Runs `callee` in the frame at `frame`, taking `argc` values from
+  // `args`; the result is meaningless once *trap is set.
+  int64_t (*call)(void* machine, int64_t* frame, uint32_t callee, uint32_t argc,
+                  uint32_t caller);
+  void (*printInt)(void* machine, int64_t v);
+  void (*printBool)(void* machine, int64_t v);
+  void (*printStr)(void* machine, int64_t string);
+  void (*printLn)(void* machine);
+  void (*raise)(void* machine, int64_t error, int64_t fn);  // a JitError
+};
+
+enum class JitError : uint8_t { DivisionByZero, IndexOutOfBounds };
+
+// Baseline compiler from bytecode to x86-64: each instruction becomes a
+// fixed template over the frame in memory, with rbx holding the frame and
+// r12 to r15 the runtime pointers, so no register state crosses an
+// instruction and native code can be entered at any jump target. Code is
+// copied into its own mapping and made read-only and executable.
+class Jit {
+ public:
+  // Entered with the frame and the address to start at, either entry() or
+  // a loop head from address(); returns the function's result.
+  using Code = int64_t (*)(int64_t* frame, const void* at);
+
+  Jit(const Program& program, const JitRuntime& runtime);
+  ~Jit();
+  Jit(const Jit&) = delete;
+  Jit& operator=(const Jit&) = delete;
+
+  // True where this build can generate and run native code.
+  static bool supported();
+
+  // Compiles function `f`; false if it cannot be.
+  bool compile(uint32_t f);
+  bool compiled(uint32_t f) const { return !functions_[f].offsets.empty(); }
+  Code code(uint32_t f) const { return reinterpret_cast<Code>(functions_[f].memory); }
+  // Native address of bytecode instruction `pc` of compiled function `f`.
+  const void* address(uint32_t f, uint32_t pc) const {
+    return functions_[f].memory + functions_[f].offsets[pc - program_.functions[f].entry];
+  }
+  const void* entry(uint32_t f) const { return address(f, program_.functions[f].entry); }
+
+ private:
+  struct Native {
+    uint8_t* memory = nullptr;
+    size_t mapped = 0;
+    std::vector<uint32_t> offsets;  // per instruction of the function
+  };
+
+  const Program& program_;
+  JitRuntime runtime_;
+  std::vector<Native> functions_;
+};
+
+}  // namespace byyl::vm
@@ -0,0 +1,274 @@
+#include "vm/peephole.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+
+namespace byyl::vm {
+
+namespace {
+
+// A set of opcodes, for one position of a pattern.
+using OpSet = uint64_t;
+static_assert(kNumOpcodes <= 64, "opcode sets are 64-bit masks");
+
+template <typename... Ops>
+constexpr OpSet ops(Ops... op) {
+  return ((OpSet(1) << static_cast<uint32_t>(op)) | ...);
+}
+constexpr OpSet kAny = ~OpSet(0) >> (64 - kNumOpcodes);
+constexpr OpSet kBinary = ops(Opcode::Add, Opcode::Sub, Opcode::Mul, Opcode::Div, Opcode::Rem,
+                              Opcode::Shl, Opcode::Shr, Opcode::And, Opcode::Or, Opcode::Xor,
+                              Opcode::Lt, Opcode::Le, Opcode::Gt, Opcode::Ge, Opcode::Eq,
+                              Opcode::Ne);
+constexpr OpSet kBinaryI = kBinary << (static_cast<uint32_t>(Opcode::AddI) -
+                                       static_cast<uint32_t>(Opcode::Add));
+constexpr OpSet kJumps = ops(Opcode::Jump, Opcode::JumpIf, Opcode::JumpIfNot);
+
+Opcode opcode(const Insn& in) { return static_cast<Opcode>(in.op); }
+Opcode immediateForm(Opcode op) {
+  return static_cast<Opcode>(static_cast<uint32_t>(op) + static_cast<uint32_t>(Opcode::AddI) -
+                             static_cast<uint32_t>(Opcode::Add));
+}
+// The IR op an Add..NeI opcode computes.
+Op irOp(Opcode op) {
+  const uint32_t base = static_cast<uint32_t>(op >= Opcode::AddI ? Opcode::AddI : Opcode::Add);
+  return static_cast<Op>(static_cast<uint32_t>(Op::Add) + static_cast<uint32_t>(op) - base);
+}
+
+int64_t immediate(const Insn& loadI) {
+  return static_cast<int64_t>(uint32_t(loadI.b) | uint64_t(uint32_t(loadI.c)) << 32);
+}
+bool fitsInt32(int64_t v) { return v >= INT32_MIN && v <= INT32_MAX; }
+
+// The matched instructions and their replacement.
+struct Window {
+  const Insn* in;
+  int32_t scratch;
+  std::array<Insn, 3> out;
+  int count = 0;
+
+  bool isScratch(int32_t slot) const { return slot >= scratch; }
+  void emit(Opcode op, int32_t a = 0, int32_t b = 0, int32_t c = 0) {
+    out[count++] = {static_cast<uint32_t>(op), a, b, c};
+  }
+  void emit(const Insn& in) { out[count++] = in; }
+  void loadImm(int32_t dst, int64_t v) {
+    emit(Opcode::LoadI, dst, static_cast<int32_t>(v), static_cast<int32_t>(v >> 32));
+  }
+};
+
+struct Rule {
+  const char* name;
+  uint8_t length;
+  std::array<OpSet, 3> pattern;
+  // Fills w.out and returns true to replace the window.
+  bool (*rewrite)(Window& w);
+};
+
+// The rules. Each one shortens the code or replaces an instruction with a
+// cheaper one that no rule turns back, which is what keeps the pass
+// linear; add new ones anywhere, earlier rules are tried first.
+const Rule kRules[] = {
+    {"self move", 1, {ops(Opcode::Mov)}, [](Window& w) { return w.in[0].a == w.in[0].b; }},
+    {"move back", 2, {ops(Opcode::Mov), ops(Opcode::Mov)},
+     [](Window& w) {
+       if (w.in[1].a != w.in[0].b || w.in[1].b != w.in[0].a) return false;
+       w.emit(w.in[0]);
+       return true;
+     }},
+    {"identity", 1, {ops(Opcode::AddI, Opcode::SubI, Opcode::OrI, Opcode::XorI, Opcode::ShlI,
+                         Opcode::ShrI, Opcode::MulI, Opcode::DivI, Opcode::AndI)},
+     [](Window& w) {
+       const Insn& in = w.in[0];
+       const Opcode op = opcode(in);
+       const int32_t unit = op == Opcode::MulI || op == Opcode::DivI ? 1
+                            : op == Opcode::AndI                     ? -1
+                                                                     : 0;
+       const bool shift = op == Opcode::ShlI || op == Opcode::ShrI;
+       if ((shift ? in.c & 63 : in.c) != unit) return false;
+       w.emit(Opcode::Mov, in.a, in.b);
+       return true;
+     }},
+    {"annihilator", 1, {ops(Opcode::MulI, Opcode::AndI)},
+     [](Window& w) {
+       if (w.in[0].c != 0) return false;
+       w.loadImm(w.in[0].a, 0);
+       return true;
+     }},
+    {"multiply by power of two", 1, {ops(Opcode::MulI)},
+     [](Window& w) {
+       const int32_t c = w.in[0].c;
+       if (c <= 1 || (c & (c - 1)) != 0) return false;
+       w.emit(Opcode::ShlI, w.in[0].a, w.in[0].b, __builtin_ctz(static_cast<uint32_t>(c)));
+       return true;
+     }},
+    {"fold constant", 2,
+     {ops(Opcode::LoadI), kBinaryI | ops(Opcode::Neg, Opcode::Not, Opcode::BitNot)},
+     [](Window& w) {
+       const Insn &k = w.in[0], &in = w.in[1];
+       if (!w.isScratch(k.a) || in.b != k.a) return false;
+       int64_t v;
+       switch (opcode(in)) {
+         case Opcode::Neg: v = static_cast<int64_t>(0 - static_cast<uint64_t>(immediate(k))); break;
+         case Opcode::Not: v = !immediate(k); break;
+         case Opcode::BitNot: v = ~immediate(k); break;
+         default:
+           if (!evaluate(irOp(opcode(in)), immediate(k), in.c, v)) return false;
+       }
+       w.loadImm(in.a, v);
+       return true;
+     }},
+    {"constant right operand", 2, {ops(Opcode::LoadI), kBinary},
+     [](Window& w) {
+       const Insn &k = w.in[0], &in = w.in[1];
+       const Opcode op = opcode(in);
+       if (!w.isScratch(k.a) || in.c != k.a || in.b == k.a || !fitsInt32(immediate(k)) ||
+           ((op == Opcode::Div || op == Opcode::Rem) && immediate(k) == 0))
+         return false;
+       w.emit(immediateForm(op), in.a, in.b, static_cast<int32_t>(immediate(k)));
+       return true;
+     }},
+    {"constant left operand", 2,
+     {ops(Opcode::LoadI), ops(Opcode::Add, Opcode::Mul, Opcode::And, Opcode::Or, Opcode::Xor,
+                              Opcode::Eq, Opcode::Ne, Opcode::Lt, Opcode::Le, Opcode::Gt,
+                              Opcode::Ge)},
+     [](Window& w) {
+       const Insn &k = w.in[0], &in = w.in[1];
+       if (!w.isScratch(k.a) || in.b != k.a || in.c == k.a || !fitsInt32(immediate(k)))
+         return false;
+       Opcode op = opcode(in);  // k op y is y op' k
+       if (op == Opcode::Lt) op = Opcode::Gt;
+       else if (op == Opcode::Le) op = Opcode::Ge;
+       else if (op == Opcode::Gt) op = Opcode::Lt;
+       else if (op == Opcode::Ge) op = Opcode::Le;
+       w.emit(immediateForm(op), in.a, in.c, static_cast<int32_t>(immediate(k)));
+       return true;
+     }},
+    {"load into move", 2, {ops(Opcode::LoadI, Opcode::GetG), ops(Opcode::Mov)},
+     [](Window& w) {
+       const Insn &load = w.in[0], &mov = w.in[1];
+       if (!w.isScratch(load.a) || mov.b != load.a) return false;
+       w.emit(opcode(load), mov.a, load.b, load.c);
+       return true;
+     }},
+    {"unreachable", 2, {ops(Opcode::Jump, Opcode::Return, Opcode::ReturnVoid), kAny},
+     [](Window& w) {
+       w.emit(w.in[0]);
+       return true;
+     }},
+};
+
+uint32_t key(const Insn* in, size_t length) {
+  uint32_t k = static_cast<uint32_t>(length);
+  for (size_t i = 0; i < length; ++i) k = k << 8 | in[i].op;
+  return k;
+}
+
+// Every concrete opcode sequence a rule matches, to the rules in table
+// order.
+class RuleIndex {
+ public:
+  RuleIndex() {
+    for (const Rule& rule : kRules) add(rule, 0, static_cast<uint32_t>(rule.length));
+  }
+
+  const std::vector<const Rule*>* find(const Insn* in, size_t length) const {
+    auto it = rules_.find(key(in, length));
+    return it == rules_.end() ? nullptr : &it->second;
+  }
+
+ private:
+  void add(const Rule& rule, size_t i, uint32_t k) {
+    if (i == rule.length) {
+      rules_[k].push_back(&rule);
+      return;
+    }
+    for (uint32_t op = 0; op < kNumOpcodes; ++op)
+      if (rule.pattern[i] >> op & 1) add(rule, i + 1, k << 8 | op);
+  }
+
+  std::unordered_map<uint32_t, std::vector<const Rule*>> rules_;
+};
+
+Opcode inverse(Opcode jump) { return jump == Opcode::JumpIf ? Opcode::JumpIfNot : Opcode::JumpIf; }
+
+}  // namespace
+
+void peephole(std::vector<Insn>& code, std::vector<uint32_t>& labels, int32_t scratch) {
+  static const RuleIndex index;
+
+  // Labels by position in the input.
+  std::vector<uint32_t> order(labels.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](uint32_t x, uint32_t y) { return labels[x] < labels[y]; });
+  std::vector<uint32_t> placed(labels.size());
+
+  std::vector<Insn> out;
+  out.reserve(code.size());
+  std::vector<Insn> pending;  // replacements still to be read, last first
+  size_t barrier = 0;         // output index of the latest jump target
+  size_t nextLabel = 0;
+  size_t i = 0;
+  for (;;) {
+    Insn in;
+    if (!pending.empty()) {
+      in = pending.back();
+      pending.pop_back();
+    } else {
+      const size_t first = nextLabel;
+      while (nextLabel < order.size() && labels[order[nextLabel]] == i) ++nextLabel;
+      if (first != nextLabel) {
+        // Jumps to the labels about to be placed here: drop one that lands
+        // on the next instruction, and turn `if c goto L; goto M; L:` into
+        // `ifFalse c goto M; L:`.
+        auto here = [&](const Insn& jump) {
+          return (kJumps >> jump.op & 1) && labels[jump.a] == i;
+        };
+        for (;;) {
+          const size_t n = out.size();
+          if (n > barrier && here(out[n - 1])) {
+            out.pop_back();
+            barrier = std::min(barrier, out.size());
+            continue;
+          }
+          if (n >= barrier + 2 && opcode(out[n - 1]) == Opcode::Jump &&
+              opcode(out[n - 2]) != Opcode::Jump && here(out[n - 2])) {
+            out[n - 2].op = static_cast<uint32_t>(inverse(opcode(out[n - 2])));
+            out[n - 2].a = out[n - 1].a;
+            out.pop_back();
+            continue;
+          }
+          break;
+        }
+        for (size_t k = first; k < nextLabel; ++k)
+          placed[order[k]] = static_cast<uint32_t>(out.size());
+        barrier = out.size();
+      }
+      if (i == code.size()) break;
+      in = code[i++];
+    }
+    out.push_back(in);
+
+    // Longest window first.
+    for (size_t length = std::min<size_t>(3, out.size() - barrier); length >= 1; --length) {
+      const Insn* window = &out[out.size() - length];
+      const std::vector<const Rule*>* rules = index.find(window, length);
+      if (!rules) continue;
+      Window w{window, scratch, {}, 0};
+      const auto match = std::find_if(rules->begin(), rules->end(),
+                                      [&](const Rule* rule) { return rule->rewrite(w); });
+      if (match == rules->end()) continue;
+      out.resize(out.size() - length);
+      for (int k = w.count; k-- > 0;) pending.push_back(w.out[k]);
+      break;
+    }
+  }
+  code = std::move(out);
+  labels = std::move(placed);
+}
+
+}  // namespace byyl::vm
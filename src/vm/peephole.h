@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vm/bytecode.h"
+
+namespace byyl::vm {
+
+// Peephole optimization of one function's bytecode (Dragon Book 8.7),
+// before its jumps are resolved: a jump's `a` is still a label number and
+// `labels` holds each label's instruction index, which is updated.
+// Frame slots from `scratch` on are the assembler's scratch slots, dead
+// after the instruction that reads them.
+//
+// Instructions stream into an output buffer, and after each one the last
+// one, two and three instructions are looked up in a hash of the rule
+// table's opcode sequences, so only rules written for exactly those
+// opcodes are tried. A rewrite pops its window and feeds the replacement
+// back through the input, which re-examines the instructions before it;
+// every rule makes the code shorter or cheaper, so the pass reaches its
+// fixpoint in one linear sweep. Windows never span a jump target.
+void peephole(std::vector<Insn>& code, std::vector<uint32_t>& labels, int32_t scratch);
+
+}  // namespace byyl::vm
@@ -0,0 +1,458 @@
+#include "vm/vm.h"
+
+#include <algorithm>
+#include <charconv>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "vm/jit.h"
+
+#if defined(__GNUC__) && !defined(BYYL_NO_COMPUTED_GOTO)
+#define BYYL_VM_THREADED 1
+#else
+#define BYYL_VM_THREADED 0
+#endif
+
+namespace byyl::vm {
+
+namespace {
+
+constexpr size_t kMaxCallDepth = size_t(1) << 20;
+constexpr size_t kStackSlots = size_t(1) << 24;  // reserved, touched as used
+constexpr size_t kMaxGlobalSlots = kStackSlots;   // zeroed up front
+// Each native call nests a C++ call or two; past this many, callees are
+// interpreted instead.
+constexpr uint32_t kMaxNativeDepth = 4096;
+
+struct Frame {
+  const Insn* ret;
+  int64_t* frame;
+  int32_t dst;
+  uint32_t fn;
+};
+
+class Machine {
+ public:
+  Machine(const Program& p, const RunOptions& options, std::string& out)
+      : p_(p),
+        out_(out),
+        globals_(p.globalSlots, 0),
+        stack_(new int64_t[kStackSlots]),
+        calls_(p.functions.size(), 0),
+        loops_(p.functions.size(), 0),
+        failed_(p.functions.size(), 0),
+        threshold_(options.jitThreshold) {
+    size_t maxArgs = 1;
+    for (const FunctionCode& f : p.functions) maxArgs = std::max(maxArgs, f.params.size());
+    outArgs_.assign(maxArgs, 0);
+    if (options.jit && Jit::supported()) {
+      const JitRuntime rt{this,          globals_.data(), outArgs_.data(), &trap_,
+                          &callNative,   &printInt,       &printBool,      &printStr,
+                          &printLn,      &raise};
+      jit_ = std::make_unique<Jit>(p, rt);
+    }
+  }
+
+  // Runs function `f` from the bottom of the stack.
+  bool top(uint32_t f, std::string& error) {
+    int64_t* frame = enter(stack_.get(), p_.functions[f], nullptr, 0);
+    int64_t result;
+    if (invoke(f, frame, result)) return true;
+    error = std::string(trap_) + " in '" + p_.functions[trapFn_].name + "'";
+    return false;
+  }
+
+ private:
+  // Zeroes a frame of `f` at `frame` and moves `argc` arguments into its
+  // parameters; null if the stack has no room for it.
+  int64_t* enter(int64_t* frame, const FunctionCode& f, const int64_t* args, uint32_t argc) {
+    if (frame + f.frameSize > stack_.get() + kStackSlots) return nullptr;
+    std::fill_n(frame, f.frameSize, 0);
+    for (uint32_t i = 0; i < argc; ++i) frame[f.params[i]] = args[i];
+    return frame;
+  }
+
+  // Runs `f` in its entered frame, natively if it is hot.
+  bool invoke(uint32_t f, int64_t* frame, int64_t& result) {
+    if (!hot(f, calls_)) return interpret(f, frame, result);
+    result = native(f, frame, jit_->entry(f));
+    return !trap_;
+  }
+
+  bool interpret(uint32_t f, int64_t* frame, int64_t& result);
+
+  // Counts a call or loop iteration of `f`, compiling it once the count
+  // reaches the threshold. True if `f` should run natively now.
+  bool hot(uint32_t f, std::vector<uint32_t>& counts) {
+    if (!jit_ || failed_[f]) return false;
+    if (!jit_->compiled(f)) {
+      if (++counts[f] < threshold_) return false;
+      if (!jit_->compile(f)) {
+        failed_[f] = 1;
+        return false;
+      }
+    }
+    return nativeDepth_ < kMaxNativeDepth;
+  }
+
+  int64_t native(uint32_t f, int64_t* frame, const void* at) {
+    ++nativeDepth_;
+    const int64_t v = jit_->code(f)(frame, at);
+    --nativeDepth_;
+    return v;
+  }
+
+  // Runtime entry points for native code.
+  static int64_t callNative(void* self, int64_t* frame, uint32_t callee, uint32_t argc,
+                            uint32_t caller) {
+    Machine& m = *static_cast<Machine*>(self);
+    if (m.depth_ == kMaxCallDepth ||
+        !m.enter(frame, m.p_.functions[callee], m.outArgs_.data(), argc)) {
+      m.trap_ = "call stack overflow";
+      m.trapFn_ = caller;
+      return 0;
+    }
+    ++m.depth_;
+    int64_t result = 0;
+    m.invoke(callee, frame, result);
+    --m.depth_;
+    return result;
+  }
+  static void printInt(void* self, int64_t v) { static_cast<Machine*>(self)->print(v); }
+  static void printBool(void* self, int64_t v) {
+    static_cast<Machine*>(self)->print(v ? "true" : "false");
+  }
+  static void printStr(void* self, int64_t s) {
+    Machine& m = *static_cast<Machine*>(self);
+    m.print(m.p_.strings[s]);
+  }
+  static void printLn(void* self) { static_cast<Machine*>(self)->endLine(); }
+  static void raise(void* self, int64_t error, int64_t fn) {
+    Machine& m = *static_cast<Machine*>(self);
+    m.trap_ = static_cast<JitError>(error) == JitError::DivisionByZero ? "division by zero"
+                                                                         : "index out of bounds";
+    m.trapFn_ = static_cast<uint32_t>(fn);
+  }
+
+  void print(int64_t v) {
+    separate();
+    char buf[24];
+    out_.append(buf, std::to_chars(buf, buf + sizeof buf, v).ptr);
+  }
+  void print(std::string_view s) {
+    separate();
+    out_ += s;
+  }
+  void separate() {
+    if (midLine_) out_ += ' ';
+    midLine_ = true;
+  }
+  void endLine() {
+    out_ += '\n';
+    midLine_ = false;
+  }
+
+  const Program& p_;
+  std::string& out_;
+  bool midLine_ = false;
+  std::vector<Insn> code_;  // threaded copy of p_.code
+  std::vector<int64_t> globals_;
+  std::unique_ptr<int64_t[]> stack_;  // frames, back to back
+  std::vector<int64_t> args_;         // pushed by Arg, taken by Call
+  std::vector<Frame> frames_;         // of interpreted callers
+  size_t depth_ = 1;                  // calls in progress, native or not
+
+  const char* trap_ = nullptr;  // the run-time error, once raised
+  uint32_t trapFn_ = 0;
+
+  std::unique_ptr<Jit> jit_;
+  std::vector<int64_t> outArgs_;  // written by native Args
+  std::vector<uint32_t> calls_, loops_;  // per function, until compiled
+  std::vector<uint8_t> failed_;
+  uint32_t threshold_;
+  uint32_t nativeDepth_ = 0;
+};
+
+bool Machine::interpret(uint32_t entry, int64_t* frame, int64_t& result) {
+#if BYYL_VM_THREADED
+  static void* const kHandlers[] = {
+#define BYYL_VM_LABEL(name, operands) &&L_##name,
+      BYYL_VM_OPS(BYYL_VM_LABEL)
+#undef BYYL_VM_LABEL
+  };
+  char* const handlerBase = static_cast<char*>(kHandlers[0]);
+  if (code_.empty()) {
+    code_ = p_.code;
+    for (Insn& in : code_)
+      in.op = static_cast<uint32_t>(static_cast<char*>(kHandlers[in.op]) - handlerBase);
+  }
+#define HANDLER(name) L_##name
+#define DISPATCH() goto* (handlerBase + static_cast<int32_t>(pc->op))
+#else
+  if (code_.empty()) code_ = p_.code;
+#define HANDLER(name) case Opcode::name
+#define DISPATCH() goto dispatch
+#endif
+#define NEXT(n) \
+  do {          \
+    pc += n;    \
+    DISPATCH(); \
+  } while (0)
+
+  const Insn* const code = code_.data();
+  const size_t bottom = frames_.size();
+  uint32_t fn = entry;
+  int64_t* r = frame;
+  int64_t* const g = globals_.data();
+  const Insn* pc = code + p_.functions[fn].entry;
+  const Insn* target;
+  const char* trap = nullptr;
+  int64_t value = 0;
+
+#if BYYL_VM_THREADED
+  DISPATCH();
+#else
+dispatch:
+  switch (static_cast<Opcode>(pc->op)) {
+#endif
+
+#define BYYL_VM_BINARY(name, expr) \
+  HANDLER(name): {                 \
+    const int64_t x = r[pc->b];    \
+    const int64_t y = r[pc->c];    \
+    r[pc->a] = (expr);             \
+    NEXT(1);                       \
+  }                                \
+  HANDLER(name##I): {              \
+    const int64_t x = r[pc->b];    \
+    const int64_t y = pc->c;       \
+    r[pc->a] = (expr);             \
+    NEXT(1);                       \
+  }
+#define U(v) static_cast<uint64_t>(v)
+#define S(v) static_cast<int64_t>(v)
+  BYYL_VM_BINARY(Add, S(U(x) + U(y)))
+  BYYL_VM_BINARY(Sub, S(U(x) - U(y)))
+  BYYL_VM_BINARY(Mul, S(U(x) * U(y)))
+  BYYL_VM_BINARY(Shl, S(U(x) << (y & 63)))
+  BYYL_VM_BINARY(Shr, x >> (y & 63))
+  BYYL_VM_BINARY(And, x & y)
+  BYYL_VM_BINARY(Or, x | y)
+  BYYL_VM_BINARY(Xor, x ^ y)
+  BYYL_VM_BINARY(Lt, x < y)
+  BYYL_VM_BINARY(Le, x <= y)
+  BYYL_VM_BINARY(Gt, x > y)
+  BYYL_VM_BINARY(Ge, x >= y)
+  BYYL_VM_BINARY(Eq, x == y)
+  BYYL_VM_BINARY(Ne, x != y)
+#undef BYYL_VM_BINARY
+
+  // x / -1 and x % -1 are spelled out: INT64_MIN / -1 traps in hardware.
+  HANDLER(Div): {
+    const int64_t x = r[pc->b], y = r[pc->c];
+    if (y == 0) {
+      trap = "division by zero";
+      goto fail;
+    }
+    r[pc->a] = y == -1 ? S(0 - U(x)) : x / y;
+    NEXT(1);
+  }
+  HANDLER(Rem): {
+    const int64_t x = r[pc->b], y = r[pc->c];
+    if (y == 0) {
+      trap = "division by zero";
+      goto fail;
+    }
+    r[pc->a] = y == -1 ? 0 : x % y;
+    NEXT(1);
+  }
+  HANDLER(DivI): {
+    const int64_t x = r[pc->b], y = pc->c;
+    r[pc->a] = y == -1 ? S(0 - U(x)) : x / y;
+    NEXT(1);
+  }
+  HANDLER(RemI): {
+    const int64_t x = r[pc->b], y = pc->c;
+    r[pc->a] = y == -1 ? 0 : x % y;
+    NEXT(1);
+  }
+  HANDLER(Neg):
+    r[pc->a] = S(0 - U(r[pc->b]));
+    NEXT(1);
+  HANDLER(Not):
+    r[pc->a] = !r[pc->b];
+    NEXT(1);
+  HANDLER(BitNot):
+    r[pc->a] = ~r[pc->b];
+    NEXT(1);
+#undef U
+#undef S
+
+  HANDLER(Mov):
+    r[pc->a] = r[pc->b];
+    NEXT(1);
+  HANDLER(LoadI):
+    r[pc->a] = static_cast<int64_t>(uint32_t(pc->b) | uint64_t(uint32_t(pc->c)) << 32);
+    NEXT(1);
+  HANDLER(GetG):
+    r[pc->a] = g[pc->b];
+    NEXT(1);
+  HANDLER(SetG):
+    g[pc->a] = r[pc->b];
+    NEXT(1);
+
+#define BYYL_VM_CHECK_INDEX(i)                                      \
+  if (static_cast<uint64_t>(i) >= static_cast<uint64_t>(pc[1].a)) { \
+    trap = "index out of bounds";                                   \
+    goto fail;                                                      \
+  }
+  HANDLER(LoadX): {
+    const int64_t i = r[pc->c];
+    BYYL_VM_CHECK_INDEX(i)
+    r[pc->a] = r[pc->b + i];
+    NEXT(2);
+  }
+  HANDLER(LoadGX): {
+    const int64_t i = r[pc->c];
+    BYYL_VM_CHECK_INDEX(i)
+    r[pc->a] = g[pc->b + i];
+    NEXT(2);
+  }
+  HANDLER(StoreX): {
+    const int64_t i = r[pc->b];
+    BYYL_VM_CHECK_INDEX(i)
+    r[pc->a + i] = r[pc->c];
+    NEXT(2);
+  }
+  HANDLER(StoreGX): {
+    const int64_t i = r[pc->b];
+    BYYL_VM_CHECK_INDEX(i)
+    g[pc->a + i] = r[pc->c];
+    NEXT(2);
+  }
+#undef BYYL_VM_CHECK_INDEX
+  HANDLER(Data):
+    NEXT(1);
+
+  // A hot loop moves to native code at its head, in the same frame.
+#define BYYL_VM_JUMP()                           \
+  do {                                           \
+    target = code + pc->a;                       \
+    if (target <= pc && hot(fn, loops_)) goto osr; \
+    pc = target;                                 \
+    DISPATCH();                                  \
+  } while (0)
+  HANDLER(Jump):
+    BYYL_VM_JUMP();
+  HANDLER(JumpIf):
+    if (!r[pc->b]) NEXT(1);
+    BYYL_VM_JUMP();
+  HANDLER(JumpIfNot):
+    if (r[pc->b]) NEXT(1);
+    BYYL_VM_JUMP();
+#undef BYYL_VM_JUMP
+
+  HANDLER(Arg):
+    args_.push_back(r[pc->a]);
+    NEXT(1);
+  HANDLER(Call): {
+    const auto callee = static_cast<uint32_t>(pc->b);
+    const auto argc = static_cast<uint32_t>(pc->c);
+    int64_t* const next = depth_ == kMaxCallDepth
+                              ? nullptr
+                              : enter(r + p_.functions[fn].frameSize, p_.functions[callee],
+                                      args_.data() + args_.size() - argc, argc);
+    if (!next) {
+      trap = "call stack overflow";
+      goto fail;
+    }
+    args_.resize(args_.size() - argc);
+    ++depth_;
+    if (hot(callee, calls_)) {
+      value = native(callee, next, jit_->entry(callee));
+      --depth_;
+      if (trap_) return false;
+      if (pc->a >= 0) r[pc->a] = value;
+      NEXT(1);
+    }
+    frames_.push_back({pc + 1, r, pc->a, fn});
+    fn = callee;
+    r = next;
+    pc = code + p_.functions[callee].entry;
+    DISPATCH();
+  }
+  HANDLER(Return):
+    value = r[pc->a];
+    goto leave;
+  HANDLER(ReturnVoid):
+    value = 0;
+    goto leave;
+
+  HANDLER(PrintInt):
+    print(r[pc->a]);
+    NEXT(1);
+  HANDLER(PrintBool):
+    print(r[pc->a] ? "true" : "false");
+    NEXT(1);
+  HANDLER(PrintStr):
+    print(p_.strings[pc->a]);
+    NEXT(1);
+  HANDLER(PrintLn):
+    endLine();
+    NEXT(1);
+
+#if !BYYL_VM_THREADED
+  }
+#endif
+
+leave:
+  if (frames_.size() == bottom) {
+    result = value;
+    return true;
+  }
+  {
+    const Frame f = frames_.back();
+    frames_.pop_back();
+    --depth_;
+    fn = f.fn;
+    r = f.frame;
+    if (f.dst >= 0) r[f.dst] = value;
+    pc = f.ret;
+  }
+  DISPATCH();
+
+osr:
+  value = native(fn, r, jit_->address(fn, static_cast<uint32_t>(target - code)));
+  if (trap_) return false;
+  goto leave;
+
+fail:
+  trap_ = trap;
+  trapFn_ = fn;
+  return false;
+#undef HANDLER
+#undef DISPATCH
+#undef NEXT
+}
+
+}  // namespace
+
+bool run(const Program& program, const RunOptions& options, std::string& output,
+         std::string& error) {
+  if (program.mainFunction < 0) {
+    error = "no 'main' function";
+    return false;
+  }
+  if (program.globalSlots > kMaxGlobalSlots) {
+    error = "globals need " + std::to_string(program.globalSlots) + " slots, more than the " +
+            std::to_string(kMaxGlobalSlots) + " available";
+    return false;
+  }
+  Machine m(program, options, output);
+  if (program.initFunction >= 0 && !m.top(static_cast<uint32_t>(program.initFunction), error))
+    return false;
+  return m.top(static_cast<uint32_t>(program.mainFunction), error);
+}
+
+}  // namespace byyl::vm
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+#include "vm/bytecode.h"
+
+namespace byyl::vm {
+
+struct RunOptions {
+  bool jit = true;  // where Jit::supported()
+  // Calls, or loop back edges, of one function before it is compiled.
+  uint32_t jitThreshold = 1000;
+};
+
+// Runs the global initialisers and then main(), appending what the program
+// prints to `output`. Division by zero, an index outside its variable and
+// running out of call depth stop the run: the result is false and `error`
+// says what happened in which function. So do globals larger than the
+// machine's stack, before anything runs.
+//
+// Dispatch is direct-threaded: a copy of the code has each opcode replaced
+// by the offset of its handler, and every handler ends in a computed goto
+// to the next one, so there is no central switch and each handler's
+// indirect branch is predicted on its own. Compilers without labels as
+// values, or a build with BYYL_NO_COMPUTED_GOTO, get the same handlers
+// behind a switch.
+//
+// With the JIT, a function is compiled to native code once it has been
+// called, or has taken a backward jump, `jitThreshold` times. Later calls
+// run the native code, and an interpreted activation that reaches a loop
+// head again moves into it in place (native frames are interpreter frames).
+// Native code calls back through the machine, which picks native code or
+// the interpreter for each callee, and deep native recursion continues in
+// the interpreter rather than on the C++ stack.
+bool run(const Program& program, const RunOptions& options, std::string& output,
+         std::string& error);
+
+}  // namespace byyl::vm
@@ -0,0 +1,201 @@
+#pragma once
+
+// A minimal x86-64 macro-assembler for the baseline JIT: just the
+// instruction forms its templates use, all 64-bit, with memory operands
+// always encoded as base + disp32 (or base + index*8 + disp32).
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace byyl::x86_64 {
+
+enum Reg : uint8_t {
+  rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi,
+  r8, r9, r10, r11, r12, r13, r14, r15,
+};
+
+enum Cond : uint8_t {
+  kBelow = 0x2, kAboveEqual = 0x3, kEqual = 0x4, kNotEqual = 0x5,
+  kLess = 0xC, kGreaterEqual = 0xD, kLessEqual = 0xE, kGreater = 0xF,
+};
+
+// Integer ops with the `op r64, r/m64` opcode and the /digit of their
+// `op r/m64, imm32` form.
+enum class Alu : uint8_t { Add, Or, And, Sub, Xor, Cmp };
+
+// [base + disp], or [base + index*8 + disp] when `index` is not rsp.
+struct Mem {
+  Reg base;
+  int32_t disp = 0;
+  Reg index = rsp;
+};
+
+class Assembler {
+ public:
+  std::vector<uint8_t>& code() { return code_; }
+  uint32_t size() const { return static_cast<uint32_t>(code_.size()); }
+
+  void mov(Reg dst, Mem src) { op(0x8B, dst, src); }
+  void mov(Mem dst, Reg src) { op(0x89, src, dst); }
+  void mov(Reg dst, Reg src) { opReg(0x89, src, dst); }
+  void mov(Reg dst, int64_t imm) {
+    if (imm >= 0 && imm <= UINT32_MAX) {  // mov r32, imm32 zero-extends
+      if (dst >= r8) byte(0x41);
+      byte(0xB8 + (dst & 7));
+      dword(static_cast<uint32_t>(imm));
+      return;
+    }
+    byte(0x48 | (dst >> 3));
+    byte(0xB8 + (dst & 7));
+    qword(static_cast<uint64_t>(imm));
+  }
+  void mov(Mem dst, int32_t imm) {
+    op(0xC7, 0, dst);
+    dword(static_cast<uint32_t>(imm));
+  }
+  void lea(Reg dst, Mem src) { op(0x8D, dst, src); }
+
+  void alu(Alu a, Reg dst, Mem src) {
+    static const uint8_t kOps[] = {0x03, 0x0B, 0x23, 0x2B, 0x33, 0x3B};
+    op(kOps[static_cast<int>(a)], dst, src);
+  }
+  void alu(Alu a, Reg dst, int32_t imm) {
+    opReg(0x81, digit(a), dst);
+    dword(static_cast<uint32_t>(imm));
+  }
+  void alu(Alu a, Mem dst, int32_t imm) {
+    op(0x81, digit(a), dst);
+    dword(static_cast<uint32_t>(imm));
+  }
+  void imul(Reg dst, Mem src) {
+    rex(dst, src);
+    byte(0x0F);
+    byte(0xAF);
+    modrm(dst, src);
+  }
+  void imul(Reg dst, Reg src, int32_t imm) {
+    opReg(0x69, dst, src);
+    dword(static_cast<uint32_t>(imm));
+  }
+  void shlCl(Reg r) { opReg(0xD3, 4, r); }
+  void sarCl(Reg r) { opReg(0xD3, 7, r); }
+  void shl(Reg r, uint8_t n) {
+    opReg(0xC1, 4, r);
+    byte(n);
+  }
+  void sar(Reg r, uint8_t n) {
+    opReg(0xC1, 7, r);
+    byte(n);
+  }
+  void neg(Reg r) { opReg(0xF7, 3, r); }
+  void bitNot(Reg r) { opReg(0xF7, 2, r); }
+  void cqo() {
+    byte(0x48);
+    byte(0x99);
+  }
+  void idiv(Reg r) { opReg(0xF7, 7, r); }
+  void test(Reg a, Reg b) { opReg(0x85, b, a); }
+  void xor32(Reg a, Reg b) {  // clears the whole register
+    if (a >= r8 || b >= r8) byte(0x40 | (b >> 3) << 2 | (a >> 3));
+    byte(0x31);
+    byte(0xC0 | (b & 7) << 3 | (a & 7));
+  }
+  // rax = condition ? 1 : 0
+  void setcc(Cond cc) {
+    byte(0x0F);
+    byte(0x90 + cc);
+    byte(0xC0);
+    byte(0x0F);  // movzx eax, al
+    byte(0xB6);
+    byte(0xC0);
+  }
+
+  void push(Reg r) {
+    if (r >= r8) byte(0x41);
+    byte(0x50 + (r & 7));
+  }
+  void pop(Reg r) {
+    if (r >= r8) byte(0x41);
+    byte(0x58 + (r & 7));
+  }
+  void call(Reg r) { opReg(0xFF, 2, r, false); }
+  void jmp(Reg r) { opReg(0xFF, 4, r, false); }
+  void ret() { byte(0xC3); }
+
+  // Jumps to a label; bind() patches them once the label's offset is known.
+  struct Label {
+    int32_t offset = -1;
+    std::vector<uint32_t> uses;  // rel32 fields to patch
+  };
+  void jmp(Label& l) {
+    byte(0xE9);
+    rel32(l);
+  }
+  void jcc(Cond cc, Label& l) {
+    byte(0x0F);
+    byte(0x80 + cc);
+    rel32(l);
+  }
+  void bind(Label& l) {
+    l.offset = static_cast<int32_t>(size());
+    for (uint32_t at : l.uses) patch(at, l.offset);
+    l.uses.clear();
+  }
+
+ private:
+  static uint8_t digit(Alu a) {
+    static const uint8_t kDigits[] = {0, 1, 4, 5, 6, 7};
+    return kDigits[static_cast<int>(a)];
+  }
+
+  void byte(uint32_t b) { code_.push_back(static_cast<uint8_t>(b)); }
+  void dword(uint32_t v) {
+    uint8_t b[4];
+    std::memcpy(b, &v, 4);
+    code_.insert(code_.end(), b, b + 4);
+  }
+  void qword(uint64_t v) {
+    dword(static_cast<uint32_t>(v));
+    dword(static_cast<uint32_t>(v >> 32));
+  }
+  void patch(uint32_t at, int32_t target) {
+    const int32_t rel = target - static_cast<int32_t>(at + 4);
+    std::memcpy(&code_[at], &rel, 4);
+  }
+  void rel32(Label& l) {
+    const uint32_t at = size();
+    dword(0);
+    if (l.offset >= 0) patch(at, l.offset);
+    else l.uses.push_back(at);
+  }
+
+  void rex(uint8_t reg, Mem m) {
+    byte(0x48 | (reg >> 3) << 2 | (m.index >> 3) << 1 | (m.base >> 3));
+  }
+  void modrm(uint8_t reg, Mem m) {
+    if (m.index != rsp) {
+      byte(0x84 | (reg & 7) << 3);
+      byte(0xC0 | (m.index & 7) << 3 | (m.base & 7));
+    } else {
+      byte(0x80 | (reg & 7) << 3 | (m.base & 7));
+      if ((m.base & 7) == rsp) byte(0x24);
+    }
+    dword(static_cast<uint32_t>(m.disp));
+  }
+  void op(uint8_t opcode, uint8_t reg, Mem m) {
+    rex(reg, m);
+    byte(opcode);
+    modrm(reg, m);
+  }
+  void opReg(uint8_t opcode, uint8_t reg, Reg rm, bool wide = true) {
+    const uint8_t prefix = (wide ? 0x48 : 0x40) | (reg >> 3) << 2 | (rm >> 3);
+    if (prefix != 0x40) byte(prefix);
+    byte(opcode);
+    byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+  }
+
+  std::vector<uint8_t> code_;
+};
+
+}  // namespace byyl::x86_64
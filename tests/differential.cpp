@@ -0,0 +1,174 @@
+// byyl-differential: compiles random programs under every configuration of
+// the compiler and checks that each prints what the reference does.
+//
+//   byyl-differential [--seeds=FIRST-LAST]
+//
+// The reference is -O0 through the LR parser, the fast scanner and the
+// interpreter alone. Each mode changes some of that: the table scanner, the
+// descent parser, the optimizer, either allocator with few registers, the
+// JIT at once or at its threshold, the thread pool, the code cache cold
+// and warm, and a round trip through each kind of unit file. A mismatch
+// prints the seed, the mode and both results, and leaves the program in
+// the temporary directory to be rerun with byyl.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+#include "driver/code_cache.h"
+#include "driver/compiler.h"
+#include "support/thread_pool.h"
+#include "tests/random_program.h"
+
+namespace {
+
+using namespace byyl;
+
+ThreadPool* gPool = nullptr;
+CodeCache* gCodeCache = nullptr;  // for -O1 with 16 registers and linear scan
+
+struct Mode {
+  const char* name;
+  void (*configure)(CompileOptions& opts);
+  EmitKind through = EmitKind::None;  // compiled from this unit file instead
+};
+
+void optimize(CompileOptions& opts, bool graph = false) {
+  opts.optimize = true;
+  if (graph) opts.allocator = Allocator::GraphColoring;
+}
+void jitAtOnce(CompileOptions& opts) {
+  opts.runOptions.jit = true;
+  opts.runOptions.jitThreshold = 0;
+}
+
+const Mode kModes[] = {
+    {"--lex-mode=table", [](CompileOptions& o) { o.lexMode = LexMode::Table; }},
+    {"--parser=descent", [](CompileOptions& o) { o.descent = true; }},
+    {"-O1", [](CompileOptions& o) { optimize(o); }},
+    {"-O2", [](CompileOptions& o) { optimize(o, true); }},
+    {"-O0 --jit-threshold=0", [](CompileOptions& o) { jitAtOnce(o); }},
+    {"-O1 --jit-threshold=0", [](CompileOptions& o) { optimize(o), jitAtOnce(o); }},
+    {"-O2 --jit-threshold=0", [](CompileOptions& o) { optimize(o, true), jitAtOnce(o); }},
+    {"-O1 --jit", [](CompileOptions& o) { optimize(o), o.runOptions.jit = true; }},
+    {"-O1 --registers=2 --jit-threshold=0",
+     [](CompileOptions& o) { optimize(o), jitAtOnce(o), o.registers = 2; }},
+    {"-O2 --registers=2 --jit-threshold=0",
+     [](CompileOptions& o) { optimize(o, true), jitAtOnce(o), o.registers = 2; }},
+    {"-O0 --regalloc=graph --registers=3",
+     [](CompileOptions& o) { o.allocator = Allocator::GraphColoring, o.registers = 3; }},
+    {"-O1 -j4 --jit-threshold=0",
+     [](CompileOptions& o) { optimize(o), jitAtOnce(o), o.pool = gPool; }},
+    {"-O1 --code-cache (cold)", [](CompileOptions& o) { optimize(o), o.codeCache = gCodeCache; }},
+    {"-O1 --code-cache (warm)", [](CompileOptions& o) { optimize(o), o.codeCache = gCodeCache; }},
+    {"--emit=ast, then -O1", [](CompileOptions& o) { optimize(o); }, EmitKind::Ast},
+    {"--emit=ir, then -O2 --jit-threshold=0",
+     [](CompileOptions& o) { optimize(o, true), jitAtOnce(o); }, EmitKind::Ir},
+};
+
+CompileOptions reference() {
+  CompileOptions opts;
+  opts.run = true;
+  opts.runOptions.jit = false;
+  return opts;
+}
+
+bool same(const UnitResult& a, const UnitResult& b) {
+  return a.failed == b.failed && a.output == b.output && a.diagnostics == b.diagnostics;
+}
+
+void report(const UnitResult& result) {
+  std::cerr << "    failed: " << (result.failed ? "yes" : "no") << "\n    output:\n"
+            << result.output << "    diagnostics:\n"
+            << result.diagnostics;
+}
+
+// Compiles and runs `path` in every mode; false on the first disagreement.
+bool check(uint64_t seed, const std::string& path, const std::string& unitPath) {
+  const UnitResult expected = compileUnit(path, reference());
+  if (expected.failed || !expected.diagnostics.empty()) {
+    std::cerr << "seed " << seed << ": " << path << " does not compile and run cleanly:\n";
+    report(expected);
+    return false;
+  }
+  for (const Mode& mode : kModes) {
+    CompileOptions opts = reference();
+    mode.configure(opts);
+    UnitResult result;
+    if (mode.through == EmitKind::None) {
+      result = compileUnit(path, opts);
+    } else {
+      CompileOptions emit;
+      emit.emit = mode.through;
+      emit.emitPath = unitPath;
+      result = compileUnit(path, emit);
+      if (!result.failed) result = compileUnit(unitPath, opts);
+      std::remove(unitPath.c_str());
+    }
+    if (!same(expected, result)) {
+      std::cerr << "seed " << seed << ": " << path << " differs under " << mode.name
+                << "\n  reference:\n";
+      report(expected);
+      std::cerr << "  " << mode.name << ":\n";
+      report(result);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool parseSeeds(const char* arg, uint64_t& first, uint64_t& last) {
+  char* end;
+  first = std::strtoull(arg, &end, 10);
+  if (end == arg || *end != '-') return false;
+  const char* second = end + 1;
+  last = std::strtoull(second, &end, 10);
+  return end != second && *end == '\0' && first <= last;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint64_t first = 1, last = 200;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], "--seeds=", 8) != 0 || !parseSeeds(argv[i] + 8, first, last)) {
+      std::cerr << "usage: byyl-differential [--seeds=FIRST-LAST]\n";
+      return 2;
+    }
+  }
+
+  const char* tmp = std::getenv("TMPDIR");
+  std::string dir = std::string(tmp && *tmp ? tmp : "/tmp") + "/byyl-differential.XXXXXX";
+  if (!mkdtemp(dir.data())) {
+    std::perror("byyl-differential: mkdtemp");
+    return 2;
+  }
+  ThreadPool pool(4);
+  CodeCache codeCache(dir + "/code", 16, Allocator::LinearScan, true);
+  gPool = &pool;
+  gCodeCache = &codeCache;
+
+  const std::string unitPath = dir + "/unit.byu";
+  uint64_t failures = 0;
+  for (uint64_t seed = first; seed <= last; ++seed) {
+    const std::string path = dir + "/" + std::to_string(seed) + ".byl";
+    std::ofstream(path) << test::randomProgram(seed);
+    if (check(seed, path, unitPath)) std::remove(path.c_str());
+    else ++failures;
+  }
+  const uint64_t programs = last - first + 1;
+  const size_t modes = sizeof kModes / sizeof kModes[0];
+  if (failures) {
+    std::cerr << failures << " of " << programs << " programs differ; they are in " << dir << "\n";
+    return 1;
+  }
+  std::cout << programs << " programs agree in " << modes << " modes\n";
+  std::filesystem::remove_all(dir);
+  return 0;
+}
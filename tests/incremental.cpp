@@ -0,0 +1,166 @@
+// byyl-incremental: edits random programs through IncrementalParser and
+// checks after every edit that it agrees with a full parse of the text.
+//
+//   byyl-incremental [--seeds=FIRST-LAST]
+//
+// Each edit replaces a random span with a random snippet: trivia, single
+// brackets and quotes, whole declarations, stray characters. Half of them
+// are undone by the next edit, so the text keeps going from broken back to
+// valid. After each one, root() must be null exactly when the full parse
+// reports an error, the tree must dump the same when it is not, and
+// diagnostics() must list the full parse's diagnostics in source order.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ast/ast.h"
+#include "lex/lexer.h"
+#include "parse/incremental.h"
+#include "parse/parser.h"
+#include "support/diagnostics.h"
+#include "support/interner.h"
+#include "support/source_buffer.h"
+#include "tests/random_program.h"
+
+namespace {
+
+using namespace byyl;
+
+constexpr int kEditsPerProgram = 40;
+
+const char* const kSnippets[] = {
+    "", " ", "\n", "// note\n", "/* note */", "/*", "\"", "\"text\"", ";", "{", "}", "(", ")", "[",
+    ",", ":", "=", "@", "$", "x", "1", "99999999999999999999", "fn", "var", "if (", "else",
+    "return 1;", "var z: int = 3;", "fn g(): int { return 7; }\n", "type T = int[2];\n",
+};
+
+std::string describe(const IncrementalParser::Message& m) {
+  return std::to_string(m.pos.offset) + ": " + std::to_string(static_cast<int>(m.severity)) +
+         ": " + m.text;
+}
+
+// Compares `inc` with a full parse of its text; empty when they agree.
+std::string compare(const IncrementalParser& inc) {
+  const SourceBuffer source = SourceBuffer::fromString(inc.text());
+  Diagnostics diags("edit.byl");
+  Interner interner;
+  Ast ast;
+  Lexer lexer(source, diags, interner);
+  const NodeId root = Parser(lexer, diags, ast).parse();
+
+  std::vector<IncrementalParser::Message> expected;
+  for (const Diagnostic& d : diags.all()) expected.push_back({d.severity, d.pos, diags.message(d)});
+  std::stable_sort(expected.begin(), expected.end(),
+                   [](const auto& a, const auto& b) { return a.pos < b.pos; });
+  const std::vector<IncrementalParser::Message> actual = inc.diagnostics();
+
+  std::ostringstream out;
+  if (!inc.root() != diags.hasErrors())
+    out << "root() is " << (inc.root() ? "set" : "null") << " but the full parse has "
+        << diags.errorCount() << " errors\n";
+  const size_t n = std::max(expected.size(), actual.size());
+  for (size_t i = 0; i < n; ++i) {
+    const std::string want = i < expected.size() ? describe(expected[i]) : "(none)";
+    const std::string got = i < actual.size() ? describe(actual[i]) : "(none)";
+    if (want != got) {
+      out << "diagnostic " << i << ": expected " << want << ", got " << got << "\n";
+      break;
+    }
+  }
+  if (inc.root() && root) {
+    std::ostringstream want, got;
+    const LineTable lines(inc.text());
+    dumpAst(ast, root, interner, lines, want);
+    dumpAst(inc.ast(), inc.root(), inc.interner(), inc.lines(), got);
+    if (want.str() != got.str()) out << "the trees differ\n";
+  }
+  return out.str();
+}
+
+// xorshift64, seeded apart from the program's generator.
+struct Rng {
+  uint64_t state;
+  uint32_t below(uint32_t n) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return static_cast<uint32_t>(state % n);
+  }
+};
+
+bool check(const IncrementalParser& inc, uint64_t seed, int step, const char* what) {
+  const std::string problem = compare(inc);
+  if (problem.empty()) return true;
+  std::cerr << "seed " << seed << ", " << what << " " << step << ":\n" << problem;
+  return false;
+}
+
+bool run(uint64_t seed) {
+  IncrementalParser inc("edit.byl", test::randomProgram(seed));
+  if (!check(inc, seed, 0, "initial parse")) return false;
+  Rng rng{seed * 0x2545f4914f6cdd1dull + 1};
+  for (int step = 1; step <= kEditsPerProgram; ++step) {
+    const auto size = static_cast<uint32_t>(inc.text().size());
+    const uint32_t offset = rng.below(size + 1);
+    const uint32_t removed = std::min(rng.below(24), size - offset);
+    const std::string before(inc.text().substr(offset, removed));
+    const std::string inserted = kSnippets[rng.below(sizeof kSnippets / sizeof kSnippets[0])];
+    inc.edit({offset, removed, inserted});
+    if (!check(inc, seed, step, "edit")) return false;
+    if (rng.below(2)) {
+      inc.edit({offset, static_cast<uint32_t>(inserted.size()), before});
+      if (!check(inc, seed, step, "undoing edit")) return false;
+    }
+    // A fresh parse of the same text must agree too.
+    if (step % 10 == 0 &&
+        !check(IncrementalParser("edit.byl", inc.text()), seed, step, "fresh parse of edit"))
+      return false;
+  }
+  return true;
+}
+
+bool parseSeeds(const char* arg, uint64_t& first, uint64_t& last) {
+  char* end;
+  first = std::strtoull(arg, &end, 10);
+  if (end == arg || *end != '-') return false;
+  const char* second = end + 1;
+  last = std::strtoull(second, &end, 10);
+  return end != second && *end == '\0' && first <= last;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint64_t first = 1, last = 100;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], "--seeds=", 8) != 0 || !parseSeeds(argv[i] + 8, first, last)) {
+      std::cerr << "usage: byyl-incremental [--seeds=FIRST-LAST]\n";
+      return 2;
+    }
+  }
+  // The case that once kept a tree: a lexical error, with no syntax error.
+  {
+    IncrementalParser inc("edit.byl", "fn main() {\n  \";\n}\n");
+    if (!check(inc, 0, 0, "unterminated string")) return 1;
+    inc.edit({14, 1, "x"});
+    if (!check(inc, 0, 1, "unterminated string fixed")) return 1;
+    inc.edit({14, 1, "\""});
+    if (!check(inc, 0, 2, "unterminated string again")) return 1;
+  }
+  uint64_t failures = 0;
+  for (uint64_t seed = first; seed <= last; ++seed)
+    if (!run(seed)) ++failures;
+  const uint64_t programs = last - first + 1;
+  if (failures) {
+    std::cerr << failures << " of " << programs << " programs went wrong\n";
+    return 1;
+  }
+  std::cout << programs << " programs agree with a full parse through " << kEditsPerProgram
+            << " edits each\n";
+  return 0;
+}
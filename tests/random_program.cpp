@@ -0,0 +1,500 @@
+#include "tests/random_program.h"
+
+#include <vector>
+
+namespace byyl::test {
+
+namespace {
+
+constexpr uint32_t kFunctions = 4;       // besides main
+constexpr uint32_t kMaxStmtDepth = 3;    // nested statements
+constexpr uint32_t kMaxExprDepth = 4;    // nested operators
+constexpr uint32_t kMaxLoops = 2;        // nested loops, each at most 5 iterations
+constexpr uint32_t kCallsPerFunction = 2;
+constexpr int kHotIterations = 1500;     // past the default JIT threshold
+
+const char* const kIntOps[] = {" + ", " - ", " * ", " & ", " | ", " ^ ", " << ", " >> "};
+const char* const kCompareOps[] = {" < ", " > ", " <= ", " >= ", " == ", " != "};
+const char* const kDivisors[] = {"1", "-1", "2", "3", "7", "-5", "64", "1000"};
+const char* const kLiterals[] = {"0", "1", "2", "7", "63", "64", "1000", "65535", "5000000000",
+                                 "9223372036854775807"};
+
+struct Callee {
+  uint32_t params;
+  bool returnsInt;
+};
+
+class Generator {
+ public:
+  explicit Generator(uint64_t seed) : state_(seed) {}
+
+  std::string program() {
+    line("type R = record { a: int; b: int; c: int[4]; };");
+    line("var g0: int = " + literal() + ";");
+    line("var g1: int;");
+    line("var gb: bool = true;");
+    line("var ga: int[8];");
+    line("var gr: R;");
+    line("var gs: R[2];");
+    for (uint32_t f = 0; f < kFunctions; ++f) function(f);
+    mainFunction();
+    return std::move(s_);
+  }
+
+ private:
+  // splitmix64, so a seed means the same program everywhere.
+  uint64_t next() {
+    uint64_t z = (state_ += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+  uint32_t below(uint32_t n) { return static_cast<uint32_t>(next() % n); }
+  bool chance(uint32_t percent) { return below(100) < percent; }
+  template <typename T, size_t N>
+  const T& pick(const T (&items)[N]) { return items[below(N)]; }
+  const std::string& pick(const std::vector<std::string>& items) {
+    return items[below(static_cast<uint32_t>(items.size()))];
+  }
+
+  void line(const std::string& text) {
+    s_.append(2 * indent_, ' ');
+    s_ += text;
+    s_ += '\n';
+  }
+  std::string fresh(const char* prefix) { return prefix + std::to_string(names_++); }
+  std::string literal() { return pick(kLiterals); }
+
+  // ---------------------------------------------------------------------
+  // Expressions. Operands that are not leaves are parenthesized, but a
+  // chain of int operators is left bare: precedence then decides its value
+  // and never its type.
+
+  std::string index(uint32_t mask, uint32_t depth) {
+    return "(" + intExpr(depth + 1) + ") & " + std::to_string(mask);
+  }
+
+  std::string intLeaf(uint32_t depth) {
+    switch (below(8)) {
+      case 0:
+        return literal();
+      case 1:
+        if (!counters_.empty()) return pick(counters_);
+        [[fallthrough]];
+      case 2:
+      case 3:
+        return pick(ints_);
+      case 4:
+        if (depth < kMaxExprDepth) return "ga[" + index(7, depth) + "]";
+        return "ga[3]";
+      case 5:
+        return chance(50) ? "gr.a" : "gr.b";
+      case 6:
+        if (depth < kMaxExprDepth) return "gs[" + index(1, depth) + "].c[" + index(3, depth) + "]";
+        return "gs[1].a";
+      default:
+        if (hasLocalArray_ && depth < kMaxExprDepth) return "la[" + index(7, depth) + "]";
+        return std::to_string(below(100));
+    }
+  }
+
+  bool callable() const { return fn_ > 0 && calls_ > 0 && loops_ == 0; }
+
+  std::string call(uint32_t depth, bool needsValue) {
+    --calls_;
+    uint32_t f = below(fn_);
+    if (needsValue)
+      while (!callees_[f].returnsInt) f = below(fn_);
+    std::string s = "f" + std::to_string(f) + "(";
+    for (uint32_t p = 0; p < callees_[f].params; ++p) {
+      if (p) s += ", ";
+      s += intExpr(depth + 1);
+    }
+    return s + ")";
+  }
+
+  bool anyIntCallee() const {
+    for (uint32_t f = 0; f < fn_; ++f)
+      if (callees_[f].returnsInt) return true;
+    return false;
+  }
+
+  std::string intOperand(uint32_t depth) {
+    if (depth >= kMaxExprDepth || chance(35)) return intLeaf(depth);
+    return "(" + intExpr(depth + 1) + ")";
+  }
+
+  std::string intExpr(uint32_t depth) {
+    if (depth >= kMaxExprDepth) return intLeaf(depth);
+    switch (below(10)) {
+      case 0:
+      case 1:
+        return intOperand(depth) + pick(kIntOps) + intOperand(depth);
+      case 2: {
+        std::string s = intOperand(depth);
+        for (uint32_t i = 0, n = 2 + below(3); i < n; ++i) s += pick(kIntOps) + intOperand(depth);
+        return s;
+      }
+      case 3:
+        return intOperand(depth) + (chance(50) ? " / (" : " % (") + intExpr(depth + 1) + " | 1)";
+      case 4:
+        return intOperand(depth) + (chance(50) ? " / " : " % ") + pick(kDivisors);
+      case 5:
+        return (chance(50) ? "-" : "~") + intOperand(depth);
+      case 6:
+        if (callable() && anyIntCallee()) return call(depth, true);
+        [[fallthrough]];
+      default:
+        return intLeaf(depth);
+    }
+  }
+
+  std::string boolOperand(uint32_t depth) {
+    if (depth >= kMaxExprDepth || chance(30)) return boolLeaf(depth);
+    return "(" + boolExpr(depth + 1) + ")";
+  }
+
+  std::string boolLeaf(uint32_t depth) {
+    switch (below(4)) {
+      case 0:
+        return chance(50) ? "true" : "false";
+      case 1:
+        return pick(bools_);
+      default:
+        return compare(depth);
+    }
+  }
+
+  std::string compare(uint32_t depth) {
+    return intOperand(depth) + pick(kCompareOps) + intOperand(depth);
+  }
+
+  std::string boolExpr(uint32_t depth) {
+    if (depth >= kMaxExprDepth) return boolLeaf(depth);
+    switch (below(6)) {
+      case 0:
+        return boolOperand(depth) + " && " + boolOperand(depth);
+      case 1:
+        return boolOperand(depth) + " || " + boolOperand(depth);
+      case 2:
+        return boolOperand(depth) + " && " + boolOperand(depth) + " || " + boolOperand(depth);
+      case 3:
+        return "!(" + boolExpr(depth + 1) + ")";
+      case 4:
+        return compare(depth);
+      default:
+        return boolLeaf(depth);
+    }
+  }
+
+  // ---------------------------------------------------------------------
+  // Statements.
+
+  struct Scope {
+    size_t ints, bools, counters, outer;
+  };
+  Scope open() {
+    const Scope scope{ints_.size(), bools_.size(), counters_.size(), outer_};
+    outer_ = ints_.size();
+    return scope;
+  }
+  void close(const Scope& scope) {
+    outer_ = scope.outer;
+    ints_.resize(scope.ints);
+    bools_.resize(scope.bools);
+    counters_.resize(scope.counters);
+  }
+
+  // An int from an enclosing scope that this one has not redeclared yet,
+  // or a fresh name.
+  std::string shadow() {
+    const std::string& name = ints_[below(outer_)];
+    for (size_t i = outer_; i < ints_.size(); ++i)
+      if (ints_[i] == name) return fresh("v");
+    return name;
+  }
+
+  std::string intTarget() {
+    switch (below(6)) {
+      case 0:
+        return "ga[" + index(7, 1) + "]";
+      case 1:
+        return chance(50) ? "gr.a" : "gr.c[" + index(3, 1) + "]";
+      case 2:
+        return "gs[" + index(1, 1) + "]." + (chance(50) ? "b" : "a");
+      case 3:
+        if (hasLocalArray_) return "la[" + index(7, 1) + "]";
+        [[fallthrough]];
+      default:
+        return pick(ints_);
+    }
+  }
+
+  void block(uint32_t depth) {
+    line("{");
+    ++indent_;
+    const Scope scope = open();
+    for (uint32_t i = 0, n = 1 + below(depth == 0 ? 6 : 3); i < n; ++i) stmt(depth + 1);
+    close(scope);
+    --indent_;
+    line("}");
+  }
+
+  // A loop body: `extra` goes last, inside the braces.
+  void body(uint32_t depth, const std::string& extra = {}) {
+    line("{");
+    ++indent_;
+    const Scope scope = open();
+    for (uint32_t i = 0, n = 1 + below(3); i < n; ++i) stmt(depth + 1);
+    if (!extra.empty()) line(extra);
+    close(scope);
+    --indent_;
+    line("}");
+  }
+
+  void stmt(uint32_t depth) {
+    const bool nested = depth < kMaxStmtDepth;
+    switch (below(16)) {
+      case 0:
+      case 1:
+        line(intTarget() + " = " + intExpr(0) + ";");
+        return;
+      case 2:
+        line(pick(ints_) + " = " + intTarget() + " = " + intExpr(1) + ";");
+        return;
+      case 3:
+        line(pick(bools_) + " = " + boolExpr(0) + ";");
+        return;
+      case 4: {
+        const std::string init = intExpr(0);
+        const std::string name = chance(20) ? shadow() : fresh("v");
+        line("var " + name + ": int = " + init + ";");
+        ints_.push_back(name);
+        return;
+      }
+      case 5: {
+        const std::string init = boolExpr(0);
+        const std::string name = fresh("b");
+        line("var " + name + ": bool = " + init + ";");
+        bools_.push_back(name);
+        return;
+      }
+      case 6:
+        if (nested) {
+          line("if (" + boolExpr(0) + ")");
+          block(depth);
+          if (chance(50)) {
+            line("else");
+            if (chance(30)) {
+              line("if (" + boolExpr(0) + ")");
+              block(depth + 1);
+            } else {
+              block(depth);
+            }
+          }
+          return;
+        }
+        break;
+      case 7:
+        if (nested && loops_ < kMaxLoops) {
+          const std::string i = fresh("i");
+          const std::string n = std::to_string(below(6));
+          line("var " + i + ": int = 0;");
+          line("for (" + i + " = 0; " + i + " < " + n + "; " + i + " = " + i + " + 1)");
+          loop(depth, i, true, {});
+          return;
+        }
+        break;
+      case 8:
+        if (nested && loops_ < kMaxLoops) {
+          const std::string w = fresh("w");
+          line("var " + w + ": int = " + std::to_string(below(3)) + ";");
+          line("while (" + w + " < " + std::to_string(below(6)) + ")");
+          loop(depth, w, false, w + " = " + w + " + 1;");
+          return;
+        }
+        break;
+      case 9:
+        if (nested) {
+          switchStmt(depth);
+          return;
+        }
+        break;
+      case 10: {
+        std::string s = "print(";
+        for (uint32_t i = 0, n = 1 + below(3); i < n; ++i) {
+          if (i) s += ", ";
+          const uint32_t kind = below(6);
+          if (kind == 0) s += boolExpr(0);
+          else if (kind == 1) s += "\"s" + std::to_string(below(10)) + "\"";
+          else s += intExpr(0);
+        }
+        line(s + ");");
+        return;
+      }
+      case 11:
+        if (inLoop_ || inSwitch_) {
+          line("if (" + boolExpr(0) + ") break;");
+          return;
+        }
+        break;
+      case 12:
+        if (continues_) {
+          line("if (" + boolExpr(0) + ") continue;");
+          return;
+        }
+        break;
+      case 13:
+        if (fn_ < kFunctions && chance(40)) {
+          line("if (" + boolExpr(0) + ") return" +
+               (callees_[fn_].returnsInt ? " " + intExpr(0) : std::string()) + ";");
+          return;
+        }
+        break;
+      case 14:
+        if (callable()) {
+          line(call(0, false) + ";");
+          return;
+        }
+        break;
+      case 15:
+        if (nested) {
+          block(depth);
+          return;
+        }
+        line(";");
+        return;
+    }
+    line(pick(ints_) + " = " + intExpr(0) + ";");
+  }
+
+  void loop(uint32_t depth, const std::string& counter, bool isFor, const std::string& step) {
+    const bool inLoop = inLoop_, inSwitch = inSwitch_, continues = continues_;
+    inLoop_ = true;
+    inSwitch_ = false;
+    continues_ = isFor;  // in a while loop, continue would skip the step
+    ++loops_;
+    counters_.push_back(counter);
+    body(depth, step);
+    counters_.pop_back();
+    --loops_;
+    inLoop_ = inLoop;
+    inSwitch_ = inSwitch;
+    continues_ = continues;
+    counters_.push_back(counter);  // readable after the loop, not assignable
+  }
+
+  void switchStmt(uint32_t depth) {
+    line("switch (" + intOperand(1) + " % 5) {");
+    ++indent_;
+    const bool inSwitch = inSwitch_;
+    inSwitch_ = true;
+    static const char* const kLabels[] = {"0", "1", "2", "-1", "-3", "4"};
+    for (const char* label : kLabels) {
+      if (chance(40)) continue;
+      line(std::string("case ") + label + ":");
+      ++indent_;
+      block(depth);
+      if (chance(70)) line("break;");  // otherwise it falls through
+      --indent_;
+    }
+    if (chance(60)) {
+      line("default:");
+      ++indent_;
+      block(depth);
+      --indent_;
+    }
+    inSwitch_ = inSwitch;
+    --indent_;
+    line("}");
+  }
+
+  // ---------------------------------------------------------------------
+  // Declarations.
+
+  void beginFunction(uint32_t fn) {
+    fn_ = fn;
+    calls_ = kCallsPerFunction;
+    loops_ = 0;
+    inLoop_ = inSwitch_ = continues_ = false;
+    hasLocalArray_ = false;
+    ints_ = {"g0", "g1"};
+    outer_ = ints_.size();
+    bools_ = {"gb"};
+    counters_.clear();
+    ++indent_;
+  }
+
+  // Local storage is not zeroed, so everything is written before it is read.
+  void locals() {
+    line("var v: int = " + intExpr(1) + ";");
+    ints_.push_back("v");
+    line("var b: bool = " + boolExpr(1) + ";");
+    bools_.push_back("b");
+    if (chance(50)) {
+      line("var la: int[8];");
+      line("var li: int = 0;");
+      line("while (li < 8) { la[li] = li * " + std::to_string(below(9)) + " - " + pick(ints_) +
+           "; li = li + 1; }");
+      hasLocalArray_ = true;
+      counters_.push_back("li");
+    }
+  }
+
+  void function(uint32_t fn) {
+    Callee& callee = callees_[fn];
+    callee.params = below(4);
+    callee.returnsInt = fn == 0 || chance(75);
+    std::string s = "fn f" + std::to_string(fn) + "(";
+    for (uint32_t p = 0; p < callee.params; ++p)
+      s += (p ? ", p" : "p") + std::to_string(p) + ": int";
+    line(s + ")" + (callee.returnsInt ? ": int {" : " {"));
+    beginFunction(fn);
+    for (uint32_t p = 0; p < callee.params; ++p) ints_.push_back("p" + std::to_string(p));
+    locals();
+    for (uint32_t i = 0, n = 2 + below(5); i < n; ++i) stmt(0);
+    if (callee.returnsInt) line("return " + intExpr(0) + ";");
+    --indent_;
+    line("}");
+  }
+
+  void mainFunction() {
+    line("fn main() {");
+    beginFunction(kFunctions);
+    calls_ = kCallsPerFunction + 1;
+    locals();
+    for (uint32_t i = 0, n = 3 + below(6); i < n; ++i) stmt(0);
+    line("var hot: int = " + pick(ints_) + ";");
+    line("var h: int;");
+    line("for (h = 0; h < " + std::to_string(kHotIterations) + "; h = h + 1) {");
+    line("  hot = hot * 31 + (h ^ g0) + f0(" + std::string(callees_[0].params ? "h" : "") +
+         (callees_[0].params > 1 ? ", hot & 255" : "") + (callees_[0].params > 2 ? ", g1" : "") +
+         ");");
+    line("  ga[h & 7] = ga[h & 7] + hot % 1000;");
+    line("}");
+    line("print(hot, g0, g1, gb, ga[0], ga[5], ga[7], gr.a, gr.b, gr.c[2], gs[0].a, gs[1].c[3]);");
+    --indent_;
+    line("}");
+  }
+
+  uint64_t state_;
+  std::string s_;
+  uint32_t indent_ = 0;
+  uint32_t names_ = 0;
+  Callee callees_[kFunctions] = {};
+  uint32_t fn_ = 0;  // the function being generated; it may call f0 to f(fn_ - 1)
+  uint32_t calls_ = 0;
+  uint32_t loops_ = 0;
+  bool inLoop_ = false, inSwitch_ = false, continues_ = false;
+  bool hasLocalArray_ = false;
+  std::vector<std::string> ints_;      // assignable
+  size_t outer_ = 0;                   // ints_ before this is declared in enclosing scopes
+  std::vector<std::string> counters_;  // loop counters: read only
+  std::vector<std::string> bools_;
+};
+
+}  // namespace
+
+std::string randomProgram(uint64_t seed) { return Generator(seed).program(); }
+
+}  // namespace byyl::test
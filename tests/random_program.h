@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace byyl::test {
+
+// A well-typed program that terminates without a runtime error, drawn from
+// `seed`: globals, a record, arrays, a few functions that call only earlier
+// ones, and every statement and operator. Divisors are nonzero and indices
+// are masked into range, so the result is defined and each configuration
+// of the compiler must print the same thing. main() ends with a loop long
+// enough to reach the JIT's default threshold.
+std::string randomProgram(uint64_t seed);
+
+}  // namespace byyl::test
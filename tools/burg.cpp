@@ -0,0 +1,68 @@
+// byyl-burg: builds the instruction selector's BURS automaton from a tree
+// grammar.
+//
+//   byyl-burg GRAMMAR OUTFILE [-v]
+//
+// OUTFILE is rewritten only when its content changes. -v prints the
+// automaton's size and how long it took to build.
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "codegen/burg.h"
+
+namespace {
+
+std::string readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) throw byyl::burs::BurgError("cannot open " + path);
+  std::ostringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+void writeIfChanged(const std::string& path, const std::string& content) {
+  {
+    std::ifstream in(path, std::ios::binary);
+    if (in) {
+      std::ostringstream ss;
+      ss << in.rdbuf();
+      if (ss.str() == content) return;
+    }
+  }
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) throw byyl::burs::BurgError("cannot write " + path);
+  out << content;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool verbose = false;
+  if (argc == 4 && std::strcmp(argv[3], "-v") == 0) {
+    verbose = true;
+  } else if (argc != 3) {
+    std::cerr << "usage: byyl-burg GRAMMAR OUTFILE [-v]\n";
+    return 2;
+  }
+  try {
+    auto started = std::chrono::steady_clock::now();
+    auto grammar = byyl::burs::parseTreeGrammar(readFile(argv[1]));
+    auto automaton = byyl::burs::buildBurs(grammar);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - started;
+    writeIfChanged(argv[2], byyl::burs::emitBursTables(grammar, automaton));
+    if (verbose) {
+      std::cerr << automaton.numStates << " states, " << grammar.rules.size() - 1 << " rules, "
+                << automaton.helperNonterminals << " helper nonterminals; "
+                << automaton.transition.size() << " transitions, " << automaton.projection.size()
+                << " projections; built in " << elapsed.count() << " ms\n";
+    }
+  } catch (const byyl::burs::BurgError& e) {
+    std::cerr << argv[1] << ": " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+// byyl-lexgen: compiles a token specification into the scanner tables.
+//
+//   byyl-lexgen SPEC OUTDIR
+//
+// Writes token_kinds.inc, lex_tables.inc and lex_direct.inc into OUTDIR.
+// Files whose content is unchanged are left untouched so that dependent
+// objects are not rebuilt.
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "lex/emit.h"
+
+namespace {
+
+std::string readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) throw byyl::lex::SpecError("cannot open " + path);
+  std::ostringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+void writeIfChanged(const std::string& path, const std::string& content) {
+  {
+    std::ifstream in(path, std::ios::binary);
+    if (in) {
+      std::ostringstream ss;
+      ss << in.rdbuf();
+      if (ss.str() == content) return;
+    }
+  }
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) throw byyl::lex::SpecError("cannot write " + path);
+  out << content;
+}
+
+// Every literal rule must be reachable: its own text has to match itself.
+// This catches keywords listed after the identifier rule and similar typos.
+void checkShadowing(const byyl::lex::LexerModel& model) {
+  for (size_t i = 0; i < model.spec.rules.size(); ++i) {
+    const auto& rule = model.spec.rules[i];
+    auto lit = byyl::lex::literalOf(*rule.regex);
+    if (!lit.ok) continue;
+    auto m = model.dfa.longestMatch(lit.text);
+    if (m.rule != static_cast<int>(i) || m.length != lit.text.size())
+      throw byyl::lex::SpecError("token " + rule.name + " is shadowed by " +
+                                 model.spec.rules[m.rule].name);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    std::cerr << "usage: byyl-lexgen SPEC OUTDIR\n";
+    return 2;
+  }
+  try {
+    auto model = byyl::lex::buildModel(byyl::lex::parseSpec(readFile(argv[1])));
+    checkShadowing(model);
+    std::string dir = argv[2];
+    writeIfChanged(dir + "/token_kinds.inc", byyl::lex::emitTokenKinds(model));
+    writeIfChanged(dir + "/lex_tables.inc", byyl::lex::emitTables(model));
+    writeIfChanged(dir + "/lex_direct.inc", byyl::lex::emitDirect(model));
+  } catch (const byyl::lex::SpecError& e) {
+    std::cerr << argv[1] << ": " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
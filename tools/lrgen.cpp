@@ -0,0 +1,101 @@
+// byyl-lrgen: builds LALR(1) parse tables for a grammar.
+//
+//   byyl-lrgen LEXSPEC GRAMMAR OUTFILE [-v] [--cache-dir=DIR] [--descent=FILE]
+//
+// Terminals are the tokens of LEXSPEC, numbered as TokenKind. OUTFILE is
+// rewritten only when its content changes. -v prints table statistics and
+// the conflicts resolved by default. --cache-dir also writes the binary
+// table file `byyl --grammar=GRAMMAR` looks for, pre-warming that cache.
+// --descent also writes the grammar's recursive-descent parser to FILE.
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "lex/regex.h"
+#include "parse/emit.h"
+#include "parse/table_cache.h"
+
+namespace {
+
+std::string readFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) throw byyl::lr::GrammarError("cannot open " + path);
+  std::ostringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+void writeIfChanged(const std::string& path, const std::string& content) {
+  {
+    std::ifstream in(path, std::ios::binary);
+    if (in) {
+      std::ostringstream ss;
+      ss << in.rdbuf();
+      if (ss.str() == content) return;
+    }
+  }
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) throw byyl::lr::GrammarError("cannot write " + path);
+  out << content;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool verbose = false;
+  std::string cacheDir;
+  std::string descentFile;
+  for (int i = 4; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (std::strncmp(argv[i], "--cache-dir=", 12) == 0) {
+      cacheDir = argv[i] + 12;
+    } else if (std::strncmp(argv[i], "--descent=", 10) == 0) {
+      descentFile = argv[i] + 10;
+    } else {
+      argc = 0;
+      break;
+    }
+  }
+  if (argc < 4) {
+    std::cerr << "usage: byyl-lrgen LEXSPEC GRAMMAR OUTFILE [-v] [--cache-dir=DIR]"
+                 " [--descent=FILE]\n";
+    return 2;
+  }
+  try {
+    auto terminals = byyl::lr::terminalsFromLexSpec(readFile(argv[1]));
+    std::string grammarText = readFile(argv[2]);
+    auto started = std::chrono::steady_clock::now();
+    auto grammar = byyl::lr::parseGrammar(grammarText, terminals);
+    auto automaton = byyl::lr::buildLalr(grammar);
+    auto dense = byyl::lr::buildTable(grammar, automaton);
+    auto packed = byyl::lr::pack(dense);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - started;
+    writeIfChanged(argv[3], byyl::lr::emitParseTables(grammar, dense, packed));
+    if (!descentFile.empty()) writeIfChanged(descentFile, byyl::lr::emitDescentParser(grammar));
+    if (!cacheDir.empty()) {
+      std::string path =
+          byyl::lr::tableCachePath(cacheDir, byyl::lr::tableKey(grammarText, terminals));
+      std::string writeError;
+      byyl::lr::buildTableFile(grammarText, terminals, path, writeError);
+      if (!writeError.empty()) throw byyl::lr::GrammarError("cannot write " + path + ": " + writeError);
+    }
+    if (verbose) {
+      std::cerr << automaton.states.size() << " states, " << grammar.productions.size()
+                << " productions; dense " << dense.action.size() + dense.gotos.size()
+                << " entries, packed " << packed.table.size() << "; built in " << elapsed.count()
+                << " ms\n";
+      for (const auto& r : dense.conflictReports) std::cerr << "  " << r << '\n';
+    }
+  } catch (const byyl::lr::GrammarError& e) {
+    std::cerr << argv[2] << ": " << e.what() << '\n';
+    return 1;
+  } catch (const byyl::lex::SpecError& e) {
+    std::cerr << argv[1] << ": " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}